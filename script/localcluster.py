@@ -0,0 +1,406 @@
+#!/usr/bin/env python3
+# Single-host OpenEC cluster for end-to-end benchmarks
+#
+# usage: python3 script/localcluster.py start [options]
+#        python3 script/localcluster.py run [options] [--workload file] [--keep]
+#        python3 script/localcluster.py stop [--workdir dir]
+#
+# The coordinator runs on 127.0.0.1 and agent i on 127.0.0.(i+2), each with its own redis-server
+# bound to its loopback address, so no port in the code changes. All nodes share a local
+# directory as UnderFS (dss.type Local). Build with -DFS_TYPE=Local.
+#
+# --trace writes the spans of encode and repair jobs of each node to <workdir>/<node>/trace.json,
+# merge them with python3 script/tracemerge.py <workdir>/*/trace.json
+#
+# --shape [rack=]rate,delay shapes the traffic into a rack from the other racks with netem on lo,
+# it needs root and may be repeated per rack, e.g. --shape 1gbit,0.5ms --shape rack0=100mbit,2ms
+#
+# workload file, one step per line:
+#   write <ecid|poolid> <online|offline> <sizeMB> <count>
+#   read
+#   encode
+#   repair <count>     drops one object of each of the first <count> online files
+#   coorbench <number> <clients> <mix> <ecids>
+#   oecload <options>  runs OECLoad on agent0, e.g. oecload --writers 8 --readers 8 --size 1M-16M
+from __future__ import print_function
+
+import argparse
+import glob
+import hashlib
+import os
+import shutil
+import signal
+import subprocess
+import time
+import xml.etree.ElementTree as ET
+
+filepath = os.path.realpath(__file__)
+script_dir = os.path.dirname(os.path.normpath(filepath))
+home_dir = os.path.dirname(os.path.normpath(script_dir))
+
+DEFAULT_WORKLOAD = """
+write rs_4_3 online 4 8
+read
+write rs_4_3_pool offline 1 12
+encode
+repair 2
+coorbench 2000 4 regonline:4,regoffline:4,degraded:2,encode:1 all
+"""
+
+
+def coor_ip():
+    return "127.0.0.1"
+
+
+def agent_ip(i):
+    return "127.0.0.%d" % (i + 2)
+
+
+def rack_of(i, racks):
+    return "rack%d" % (i % racks)
+
+
+def node_dirs(args):
+    return [("coor", coor_ip())] + [("agent%d" % i, agent_ip(i)) for i in range(args.agents)]
+
+
+def set_attr(root, name, values):
+    for attr in root.findall("attribute"):
+        if attr.find("name").text == name:
+            root.remove(attr)
+    attr = ET.SubElement(root, "attribute")
+    ET.SubElement(attr, "name").text = name
+    for v in values:
+        ET.SubElement(attr, "value").text = v
+
+
+def read_policies(conf):
+    # ecid -> (n, k), poolid -> (ecid, baseMB)
+    root = ET.parse(conf).getroot()
+    ecs, pools = {}, {}
+    for attr in root.findall("attribute"):
+        name = attr.find("name").text
+        for v in attr.findall("value"):
+            if name == "ec.policy":
+                ecs[v.find("ecid").text] = (int(v.find("n").text), int(v.find("k").text))
+            elif name == "offline.pool":
+                base = v.find("base")
+                pools[v.find("poolid").text] = (v.find("ecid").text, int(base.text) if base is not None else 1)
+    return ecs, pools
+
+
+def write_confs(args):
+    fsdir = os.path.join(args.workdir, "fs")
+    if not os.path.isdir(fsdir):
+        os.makedirs(fsdir)
+    agents = ["/%s/%s" % (rack_of(i, args.racks), agent_ip(i)) for i in range(args.agents)]
+    for name, ip in node_dirs(args):
+        tree = ET.parse(args.conf)
+        root = tree.getroot()
+        set_attr(root, "controller.addr", [coor_ip()])
+        set_attr(root, "agents.addr", agents)
+        set_attr(root, "local.addr", [ip])
+        set_attr(root, "dss.type", ["Local"])
+        set_attr(root, "dss.parameter", [fsdir])
+        if args.trace:
+            set_attr(root, "trace.file", [os.path.join(args.workdir, name, "trace.json")])
+        confdir = os.path.join(args.workdir, name, "conf")
+        if not os.path.isdir(confdir):
+            os.makedirs(confdir)
+        tree.write(os.path.join(confdir, "sysSetting.xml"))
+
+
+def redis_up(ip):
+    return subprocess.call(["redis-cli", "-h", ip, "ping"], stdout=subprocess.DEVNULL,
+                           stderr=subprocess.DEVNULL) == 0
+
+
+def start_redis(args):
+    started = []
+    for name, ip in node_dirs(args):
+        if redis_up(ip):
+            # a redis on the address already, e.g. the system one on 127.0.0.1
+            print("reuse redis on " + ip)
+        else:
+            nodedir = os.path.join(args.workdir, name)
+            subprocess.check_call(["redis-server", "--bind", ip, "--port", "6379", "--save", "",
+                                   "--appendonly", "no", "--daemonize", "yes", "--dir", nodedir,
+                                   "--pidfile", os.path.join(nodedir, "redis.pid")])
+            started.append(ip)
+        for _ in range(50):
+            if redis_up(ip):
+                break
+            time.sleep(0.1)
+        subprocess.call(["redis-cli", "-h", ip, "flushall"], stdout=subprocess.DEVNULL)
+    with open(os.path.join(args.workdir, "redis.started"), "w") as f:
+        f.write("\n".join(started))
+
+
+def spawn(args, name, binary, cmd=None, wait=False):
+    nodedir = os.path.join(args.workdir, name)
+    cmd = [os.path.join(args.bin, binary)] + (cmd or [])
+    if wait:
+        return subprocess.call(cmd, cwd=nodedir, stdout=open(os.path.join(nodedir, "client_output"), "a"),
+                               stderr=subprocess.STDOUT)
+    proc = subprocess.Popen(cmd, cwd=nodedir, stdout=open(os.path.join(nodedir, binary + "_output"), "w"),
+                            stderr=subprocess.STDOUT)
+    with open(os.path.join(args.workdir, "pids"), "a") as f:
+        f.write("%d\n" % proc.pid)
+    return proc
+
+
+def shape(args):
+    if not args.shape:
+        return
+    racks = sorted(set(rack_of(i, args.racks) for i in range(args.agents)))
+    if len(racks) > 15:
+        print("shape: at most 15 racks")
+        return
+    spec = {}
+    for item in args.shape:
+        if "=" in item:
+            rack, item = item.split("=", 1)
+            spec[rack] = item
+        else:
+            for rack in racks:
+                spec.setdefault(rack, item)
+    bands = len(racks) + 1
+    cmds = [["tc", "qdisc", "del", "dev", "lo", "root"],
+            ["tc", "qdisc", "add", "dev", "lo", "root", "handle", "1:", "prio", "bands", str(bands),
+             "priomap"] + [str(bands - 1)] * 16]
+    for r, rack in enumerate(racks):
+        if rack not in spec:
+            continue
+        rate, delay = spec[rack].split(",")
+        cmds.append(["tc", "qdisc", "add", "dev", "lo", "parent", "1:%d" % (r + 1), "handle", "%d:" % (r + 10),
+                     "netem", "delay", delay, "rate", rate])
+        # traffic from the other racks and the coordinator into the rack
+        dsts = [agent_ip(i) for i in range(args.agents) if rack_of(i, args.racks) == rack]
+        srcs = [coor_ip()] + [agent_ip(i) for i in range(args.agents) if rack_of(i, args.racks) != rack]
+        for src in srcs:
+            for dst in dsts:
+                cmds.append(["tc", "filter", "add", "dev", "lo", "parent", "1:", "protocol", "ip", "prio", "1",
+                             "u32", "match", "ip", "src", src + "/32", "match", "ip", "dst", dst + "/32",
+                             "flowid", "1:%d" % (r + 1)])
+    for i, cmd in enumerate(cmds):
+        res = subprocess.call(cmd, stderr=subprocess.DEVNULL if i == 0 else None)
+        if res != 0 and i > 0:
+            print("shape: '%s' failed, traffic is not shaped" % " ".join(cmd))
+            subprocess.call(cmds[0], stderr=subprocess.DEVNULL)
+            return
+    open(os.path.join(args.workdir, "shaped"), "w").close()
+
+
+def start(args):
+    if os.path.exists(os.path.join(args.workdir, "pids")):
+        stop(args)
+    write_confs(args)
+    start_redis(args)
+    shape(args)
+    spawn(args, "coor", "OECCoordinator")
+    time.sleep(1)
+    for i in range(args.agents):
+        spawn(args, "agent%d" % i, "OECAgent")
+    time.sleep(1)
+    print("started coordinator on %s and %d agents in %d racks, workdir %s" %
+          (coor_ip(), args.agents, args.racks, args.workdir))
+
+
+def stop(args):
+    pidfile = os.path.join(args.workdir, "pids")
+    if os.path.exists(pidfile):
+        for line in open(pidfile):
+            try:
+                os.kill(int(line), signal.SIGTERM)
+            except (OSError, ValueError):
+                pass
+        os.remove(pidfile)
+    started = os.path.join(args.workdir, "redis.started")
+    if os.path.exists(started):
+        for ip in open(started).read().split():
+            subprocess.call(["redis-cli", "-h", ip, "shutdown", "nosave"], stdout=subprocess.DEVNULL,
+                            stderr=subprocess.DEVNULL)
+        os.remove(started)
+    if os.path.exists(os.path.join(args.workdir, "shaped")):
+        subprocess.call(["tc", "qdisc", "del", "dev", "lo", "root"])
+        os.remove(os.path.join(args.workdir, "shaped"))
+    print("stopped")
+
+
+def report(step, count, mb, seconds):
+    line = "%-10s %4d ops %8.1f MB %8.2f s" % (step, count, mb, seconds)
+    if seconds > 0:
+        line += " %8.2f ops/s %8.2f MB/s" % (count / seconds, mb / seconds)
+    print(line)
+
+
+def run_clients(args, jobs):
+    # jobs: (node, argv), at most args.clients at a time, round robin over the agents
+    failed = 0
+    running = []
+    for node, argv in jobs:
+        while len(running) >= args.clients:
+            failed += running.pop(0).wait() != 0
+        running.append(subprocess.Popen([os.path.join(args.bin, "OECClient")] + argv,
+                                        cwd=os.path.join(args.workdir, node),
+                                        stdout=open(os.path.join(args.workdir, node, "client_output"), "a"),
+                                        stderr=subprocess.STDOUT))
+    for proc in running:
+        failed += proc.wait() != 0
+    return failed
+
+
+def fs_path(args, objname):
+    return os.path.join(args.workdir, "fs") + objname
+
+
+def wait_for(cond, timeout):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        if cond():
+            return True
+        time.sleep(0.2)
+    return False
+
+
+def workload(args):
+    ecs, pools = read_policies(args.conf)
+    files = []  # (filename, ecid|poolid, mode, sizeMB, md5)
+    lines = open(args.workload).read() if args.workload else DEFAULT_WORKLOAD
+    datadir = os.path.join(args.workdir, "data")
+    if not os.path.isdir(datadir):
+        os.makedirs(datadir)
+    for line in lines.splitlines():
+        words = line.split("#")[0].split()
+        if not words:
+            continue
+        step = words[0]
+        start = time.time()
+        if step == "write":
+            ecid, mode, size, count = words[1], words[2], int(words[3]), int(words[4])
+            inputfile = os.path.join(datadir, "input_%dMB" % size)
+            if not os.path.exists(inputfile):
+                with open(inputfile, "wb") as f:
+                    for _ in range(size):
+                        f.write(os.urandom(1048576))
+            md5 = hashlib.md5(open(inputfile, "rb").read()).hexdigest()
+            jobs, written = [], []
+            for j in range(count):
+                filename = "/bench/%s_%d_%d" % (mode, len(files) + j, int(start))
+                written.append((filename, ecid, mode, size, md5))
+                jobs.append(("agent%d" % ((len(files) + j) % args.agents),
+                             ["write", inputfile, filename, ecid, mode, str(size)]))
+            failed = run_clients(args, jobs)
+            files += written
+            report(step, count - failed, size * (count - failed), time.time() - start)
+        elif step == "read":
+            jobs = []
+            for j, item in enumerate(files):
+                jobs.append(("agent%d" % ((j + 1) % args.agents),
+                             ["read", item[0], os.path.join(datadir, "read_%d" % j)]))
+            failed = run_clients(args, jobs)
+            seconds = time.time() - start
+            bad = 0
+            for j, item in enumerate(files):
+                saved = os.path.join(datadir, "read_%d" % j)
+                if not os.path.exists(saved) or hashlib.md5(open(saved, "rb").read()).hexdigest() != item[4]:
+                    bad += 1
+            report(step, len(files) - failed, sum(f[3] for f in files), seconds)
+            if bad:
+                print("read: %d files differ from what was written" % bad)
+        elif step == "encode":
+            expected = 0
+            for poolid in pools:
+                ecid, base = pools[poolid]
+                n, k = ecs[ecid]
+                objs = sum((f[3] + base - 1) // base for f in files if f[1] == poolid and f[2] == "offline")
+                expected += objs // k * (n - k)
+            spawn(args, "agent0", "OECClient", ["startEncode"], wait=True)
+
+            def parities():
+                done, mb = 0, 0
+                for poolid in pools:
+                    base = pools[poolid][1]
+                    for path in glob.glob(os.path.join(args.workdir, "fs", poolid + "-oecstripe-*")):
+                        if os.path.getsize(path) >= base * 1048576:
+                            done += 1
+                            mb += base
+                return done, mb
+            ok = wait_for(lambda: parities()[0] >= expected, args.timeout)
+            done, mb = parities()
+            report(step, done, mb, time.time() - start)
+            if not ok:
+                print("encode: %d of %d parity objects after %d s" % (done, expected, args.timeout))
+        elif step == "repair":
+            count = int(words[1])
+            lost = []
+            for item in files:
+                if item[2] != "online" or len(lost) >= count:
+                    continue
+                objname = item[0] + "_oecobj_0"
+                path = fs_path(args, objname)
+                if os.path.exists(path):
+                    lost.append((objname, os.path.getsize(path)))
+                    os.remove(path)
+            for objname, _ in lost:
+                spawn(args, "agent0", "OECClient", ["reportLost", objname], wait=True)
+            spawn(args, "agent0", "OECClient", ["startRepair"], wait=True)
+            repaired = lambda: sum(1 for o, s in lost if os.path.exists(fs_path(args, o)) and
+                                   os.path.getsize(fs_path(args, o)) >= s)
+            ok = wait_for(lambda: repaired() == len(lost), args.timeout)
+            report(step, repaired(), sum(s for _, s in lost) / 1048576.0, time.time() - start)
+            if not ok:
+                print("repair: %d of %d objects after %d s" % (repaired(), len(lost), args.timeout))
+        elif step == "coorbench":
+            spawn(args, "agent0", "OECClient", ["coorBench", "0"] + words[1:5], wait=True)
+            with open(os.path.join(args.workdir, "agent0", "client_output")) as f:
+                out = f.read()
+            print(out[out.rfind("CoorBench::"):].rstrip())
+        elif step == "oecload":
+            output = os.path.join(args.workdir, "agent0", "client_output")
+            offset = os.path.getsize(output) if os.path.exists(output) else 0
+            spawn(args, "agent0", "OECLoad", words[1:], wait=True)
+            with open(output) as f:
+                f.seek(offset)
+                print(f.read().rstrip())
+        else:
+            print("unknown step: " + line.strip())
+
+
+def main():
+    parser = argparse.ArgumentParser(description="single-host OpenEC cluster")
+    parser.add_argument("action", choices=["start", "run", "stop"])
+    parser.add_argument("--agents", type=int, default=6)
+    parser.add_argument("--racks", type=int, default=1)
+    parser.add_argument("--conf", default=os.path.join(home_dir, "conf", "sysSetting.xml"),
+                        help="template for the configuration of all nodes")
+    parser.add_argument("--bin", default=home_dir, help="directory of OECCoordinator, OECAgent and OECClient")
+    parser.add_argument("--workdir", default="/tmp/oec-local")
+    parser.add_argument("--shape", action="append", help="[rack=]rate,delay, e.g. 1gbit,0.5ms")
+    parser.add_argument("--workload", help="workload file, a default workload runs without it")
+    parser.add_argument("--clients", type=int, default=4, help="concurrent OECClient processes")
+    parser.add_argument("--timeout", type=int, default=300, help="seconds to wait for encode and repair")
+    parser.add_argument("--keep", action="store_true", help="keep the cluster running after run")
+    parser.add_argument("--trace", action="store_true",
+                        help="trace encode and repair to <workdir>/<node>/trace.json, see script/tracemerge.py")
+    args = parser.parse_args()
+    args.workdir = os.path.abspath(args.workdir)
+
+    if args.action == "stop":
+        stop(args)
+        return
+    if args.action == "run" and os.path.isdir(args.workdir):
+        # a run starts from empty metadata and objects
+        stop(args)
+        shutil.rmtree(args.workdir)
+    start(args)
+    if args.action == "run":
+        try:
+            workload(args)
+        finally:
+            if not args.keep:
+                stop(args)
+
+
+if __name__ == "__main__":
+    main()
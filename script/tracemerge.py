@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+# Merge the trace files of the coordinator and agents into one Chrome trace
+#
+# usage: python3 script/tracemerge.py [--stripe name] [--trace id] [--start time] [--end time]
+#                                     [-o out.json] file [file ...]
+#
+# Each node appends the spans of traced encode/repair jobs to its trace.file (sysSetting.xml),
+# one trace event per line. Copy the files of all nodes to one place and merge them:
+#   --stripe  spans of a stripe and the spans without a stripe (request, dispatch, persisted)
+#             of the same traces
+#   --trace   spans of one trace id
+#   --start/--end  spans that overlap the window, epoch seconds or "YYYY-mm-dd HH:MM:SS" (local time)
+# The filters combine, without any filter all spans are merged. Open the output in
+# chrome://tracing or https://ui.perfetto.dev. Spans of different hosts are placed by their
+# wall clocks, keep the clocks synchronized.
+from __future__ import print_function
+
+import argparse
+import json
+import sys
+import time
+
+
+def parse_time(value):
+    try:
+        return float(value)
+    except ValueError:
+        return time.mktime(time.strptime(value, "%Y-%m-%d %H:%M:%S"))
+
+
+def load(files):
+    events = []
+    for name in files:
+        with open(name) as f:
+            for line in f:
+                line = line.strip()
+                if not line:
+                    continue
+                try:
+                    events.append(json.loads(line))
+                except ValueError:
+                    # a node killed while writing leaves a partial last line
+                    print("skip malformed line in %s" % name, file=sys.stderr)
+    return events
+
+
+def select(events, args):
+    if args.stripe is not None:
+        traces = set(e["args"]["trace"] for e in events if e["args"]["stripe"] == args.stripe)
+        events = [e for e in events
+                  if e["args"]["trace"] in traces and e["args"]["stripe"] in (args.stripe, "")]
+    if args.trace is not None:
+        events = [e for e in events if e["args"]["trace"] == args.trace]
+    if args.start is not None:
+        start = parse_time(args.start) * 1000000
+        events = [e for e in events if e["ts"] + e.get("dur", 0) >= start]
+    if args.end is not None:
+        end = parse_time(args.end) * 1000000
+        events = [e for e in events if e["ts"] <= end]
+    return events
+
+
+def main():
+    parser = argparse.ArgumentParser(description="merge OpenEC trace files into a Chrome trace")
+    parser.add_argument("files", nargs="+", help="trace.file of the coordinator and agents")
+    parser.add_argument("--stripe", help="stripe name")
+    parser.add_argument("--trace", help="trace id")
+    parser.add_argument("--start", help="window start, epoch seconds or YYYY-mm-dd HH:MM:SS")
+    parser.add_argument("--end", help="window end, epoch seconds or YYYY-mm-dd HH:MM:SS")
+    parser.add_argument("-o", "--output", help="output file, stdout by default")
+    args = parser.parse_args()
+
+    events = select(load(args.files), args)
+    events.sort(key=lambda e: e["ts"])
+
+    # one process row per node, named by role and address
+    names = {}
+    for e in events:
+        names.setdefault(e["pid"], "%s %s" % (e["cat"], e["args"]["host"]))
+    meta = [{"name": "process_name", "ph": "M", "pid": pid, "tid": 0, "args": {"name": name}}
+            for pid, name in sorted(names.items())]
+
+    out = open(args.output, "w") if args.output else sys.stdout
+    json.dump({"traceEvents": meta + events, "displayTimeUnit": "ms"}, out)
+    out.write("\n")
+    if args.output:
+        out.close()
+        print("%d events of %d nodes written to %s" % (len(events), len(names), args.output), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -6,6 +6,9 @@
 #include "ec/NativeRS.hh"
 #include "inc/include.hh"
 
+#include <sstream>
+#include <sys/wait.h>
+
 using namespace std;
 
 void usage() {
@@ -15,6 +18,11 @@ void usage() {
   cout << "	3, k" << endl;
   cout << "	4, blocksizeB" << endl;
   cout << "	5, pktsizeB" << endl;
+  cout << "Usage: ./CodeTest codec [ecids] [threads] [pktsizesB] [sizeMB]" << endl;
+  cout << "	1, ecids: all or ecid,... of the configured ecpolicies, default all" << endl;
+  cout << "	2, threads: default 1" << endl;
+  cout << "	3, pktsizesB: packet size per node, default 4096,65536,1048576" << endl;
+  cout << "	4, sizeMB: data each thread encodes or repairs per case, default 64" << endl;
 }
 
 double getCurrentTime() {
@@ -23,7 +31,324 @@ double getCurrentTime() {
   return (double)tv.tv_sec * 1e+6 + (double)tv.tv_usec;
 }
 
+// compute task of a plan, the matrix is built once and reused by every stripe
+typedef struct {
+  vector<int> children;
+  vector<int> targets;
+  int* matrix;
+} Compute;
+
+// plan to rebuild the sub-packets of the lost nodes
+typedef struct {
+  vector<int> lost;
+  vector<Compute> computes;
+  // sub-packets read by the plan
+  int reads;
+  bool valid;
+} Repair;
+
+vector<Compute> parseComputes(ECDAG* ecdag) {
+  vector<Compute> toret;
+  vector<ECTask*> tasks;
+  vector<int> toposeq = ecdag->toposort();
+  for (int i=0; i<toposeq.size(); i++) {
+    ECNode* curnode = ecdag->getNode(toposeq[i]);
+    curnode->parseForClient(tasks);
+  }
+  for (auto task: tasks) {
+    Compute compute;
+    compute.children = task->getChildren();
+    unordered_map<int, vector<int>> coefMap = task->getCoefMap();
+    int col = compute.children.size();
+    compute.matrix = (int*)calloc(coefMap.size() * col, sizeof(int));
+    for (auto it: coefMap) {
+      int row = compute.targets.size();
+      compute.targets.push_back(it.first);
+      for (int j=0; j<col; j++) compute.matrix[row * col + j] = it.second[j];
+    }
+    toret.push_back(compute);
+    delete task;
+  }
+  return toret;
+}
+
+// buffers of intermediate nodes are allocated on first use and recorded in owned
+void runComputes(vector<Compute>& computes, unordered_map<int, char*>& bufMap, vector<char*>& owned, int len) {
+  for (auto& compute: computes) {
+    int col = compute.children.size();
+    int row = compute.targets.size();
+    char* data[col];
+    char* code[row];
+    for (int i=0; i<col; i++) data[i] = bufMap[compute.children[i]];
+    for (int i=0; i<row; i++) {
+      int target = compute.targets[i];
+      if (bufMap.find(target) == bufMap.end()) {
+        char* buf = (char*)calloc(len, sizeof(char));
+        owned.push_back(buf);
+        bufMap.insert(make_pair(target, buf));
+      }
+      code[i] = bufMap[target];
+    }
+    Computation::Multi(code, data, compute.matrix, row, col, len, "Isal");
+  }
+}
+
+void freeComputes(vector<Compute>& computes) {
+  for (auto& compute: computes) free(compute.matrix);
+  computes.clear();
+}
+
+// codes assert on failures they have no construction for, try Decode in a child process first
+bool canDecode(ECBase* ec, vector<int> from, vector<int> to) {
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    int devnull = open("/dev/null", O_WRONLY);
+    dup2(devnull, 2);
+    ECDAG* ecdag = ec->Decode(from, to);
+    delete ecdag;
+    _exit(0);
+  }
+  int status;
+  if (pid < 0 || waitpid(pid, &status, 0) < 0) return false;
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+Repair planRepair(ECBase* ec, int n, int w, vector<int> lostnodes) {
+  Repair toret;
+  vector<int> availcidx;
+  for (int i=0; i<n; i++) {
+    bool lost = find(lostnodes.begin(), lostnodes.end(), i) != lostnodes.end();
+    for (int j=0; j<w; j++) {
+      if (lost) toret.lost.push_back(i*w+j);
+      else availcidx.push_back(i*w+j);
+    }
+  }
+  toret.reads = 0;
+  toret.valid = canDecode(ec, availcidx, toret.lost);
+  if (!toret.valid) return toret;
+  ECDAG* ecdag = ec->Decode(availcidx, toret.lost);
+  vector<int> toposeq = ecdag->toposort();
+  for (auto cid: toret.lost) {
+    if (find(toposeq.begin(), toposeq.end(), cid) == toposeq.end()) toret.valid = false;
+  }
+  for (auto cid: ecdag->getLeaves()) {
+    if (cid < n*w) toret.reads++;
+  }
+  if (toret.valid) toret.computes = parseComputes(ecdag);
+  delete ecdag;
+  return toret;
+}
+
+// runs repairs round robin on a private copy of the stripe, checks the first round against it
+bool runRepairs(vector<Repair>& repairs, unordered_map<int, char*>& stripe, int len, int stripes) {
+  unordered_map<int, char*> copy;
+  for (auto item: stripe) {
+    char* buf = (char*)calloc(len, sizeof(char));
+    memcpy(buf, item.second, len);
+    copy.insert(make_pair(item.first, buf));
+  }
+  vector<unordered_map<int, char*>> bufMaps;
+  vector<char*> owned;
+  for (auto& repair: repairs) {
+    unordered_map<int, char*> bufMap = copy;
+    for (auto cid: repair.lost) {
+      char* buf = (char*)calloc(len, sizeof(char));
+      owned.push_back(buf);
+      bufMap[cid] = buf;
+    }
+    bufMaps.push_back(bufMap);
+  }
+
+  bool success = true;
+  for (int i=0; i<stripes; i++) {
+    int ridx = i % repairs.size();
+    runComputes(repairs[ridx].computes, bufMaps[ridx], owned, len);
+    if (i >= repairs.size()) continue;
+    for (auto cid: repairs[ridx].lost) {
+      if (memcmp(bufMaps[ridx][cid], stripe.at(cid), len) != 0) success = false;
+    }
+  }
+
+  for (auto item: copy) free(item.second);
+  for (auto buf: owned) free(buf);
+  return success;
+}
+
+// a plan counts if it covers the lost sub-packets and rebuilds them, the others are dropped
+bool checkRepair(Repair& repair, unordered_map<int, char*>& stripe, int len) {
+  if (repair.valid) {
+    vector<Repair> repairs = {repair};
+    repair.valid = runRepairs(repairs, stripe, len, 1);
+  }
+  if (!repair.valid) freeComputes(repair.computes);
+  return repair.valid;
+}
+
+// MB/s of repaired data over all threads, 0 if there is no plan or a run rebuilds wrong data
+double benchRepairs(vector<Repair>& repairs, unordered_map<int, char*>& stripe, int len, int threads, long sizeB) {
+  if (repairs.size() == 0) return 0;
+  int repairedB = repairs[0].lost.size() * len;
+  int stripes = max(sizeB / repairedB, (long)repairs.size());
+  vector<thread> workers;
+  vector<int> results(threads, 1);
+  double duration = -getCurrentTime();
+  for (int t=0; t<threads; t++) {
+    workers.push_back(thread([&, t]{ results[t] = runRepairs(repairs, stripe, len, stripes); }));
+  }
+  for (int t=0; t<threads; t++) workers[t].join();
+  duration += getCurrentTime();
+  for (auto result: results) {
+    if (!result) return 0;
+  }
+  return (double)repairedB * stripes * threads / 1.048576 / duration;
+}
+
+string rate(double MBps) {
+  if (MBps == 0) return "n/a";
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.1f", MBps);
+  return string(buf);
+}
+
+// sub-packets read per sub-packet repaired, averaged over the plans
+string readRatio(vector<Repair>& repairs, double MBps) {
+  if (MBps == 0) return "n/a";
+  double reads = 0;
+  for (auto& repair: repairs) reads += (double)repair.reads / repair.lost.size();
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.2f", reads / repairs.size());
+  return string(buf);
+}
+
+// encode, single-failure repair of every node and repair of n-k failed nodes for one ecpolicy
+void codecBench(ECPolicy* ecpolicy, int threads, int pktsizeB, long sizeB) {
+  // the codes log while they plan, keep it out of the report
+  int level = Logger::getLevel();
+  Logger::setLevel(LOG_LEVEL_OFF);
+  ECBase* ec = ecpolicy->createECClass();
+  int n = ecpolicy->getN();
+  int k = ecpolicy->getK();
+  int w = ecpolicy->getW();
+  // each node holds w sub-packets of a packet
+  int len = pktsizeB / w;
+
+  // 0. encode a reference stripe
+  ECDAG* encdag = ec->Encode();
+  vector<Compute> encodes = parseComputes(encdag);
+  delete encdag;
+  unordered_map<int, char*> stripe;
+  vector<char*> owned;
+  srand((unsigned)1234);
+  for (int cid=0; cid<n*w; cid++) {
+    char* buf = (char*)calloc(len, sizeof(char));
+    if (cid < k*w) {
+      for (int j=0; j<len; j++) buf[j] = rand();
+    }
+    stripe.insert(make_pair(cid, buf));
+  }
+  unordered_map<int, char*> encMap = stripe;
+  runComputes(encodes, encMap, owned, len);
+
+  // 1. encode throughput, each thread encodes its own copy of the data
+  int stripes = max(sizeB / (k*w*len), 1L);
+  vector<thread> workers;
+  double encodeTime = -getCurrentTime();
+  for (int t=0; t<threads; t++) {
+    workers.push_back(thread([&]{
+      unordered_map<int, char*> bufMap;
+      vector<char*> bufs;
+      for (int cid=0; cid<n*w; cid++) {
+        char* buf = (char*)calloc(len, sizeof(char));
+        memcpy(buf, stripe.at(cid), len);
+        bufMap.insert(make_pair(cid, buf));
+        bufs.push_back(buf);
+      }
+      for (int i=0; i<stripes; i++) runComputes(encodes, bufMap, bufs, len);
+      for (auto buf: bufs) free(buf);
+    }));
+  }
+  for (int t=0; t<threads; t++) workers[t].join();
+  encodeTime += getCurrentTime();
+  double encodeMBps = (double)k*w*len * stripes * threads / 1.048576 / encodeTime;
+
+  // 2. single failure of every node, the stripes rotate over the nodes
+  vector<Repair> singles;
+  bool singleAll = true;
+  for (int i=0; i<n; i++) {
+    Repair repair = planRepair(ec, n, w, {i});
+    if (checkRepair(repair, stripe, len)) singles.push_back(repair);
+    else singleAll = false;
+  }
+  double singleMBps = benchRepairs(singles, stripe, len, threads, sizeB);
+
+  // 3. the first n-k nodes fail
+  vector<Repair> multis;
+  vector<int> lostnodes;
+  for (int i=0; i<n-k; i++) lostnodes.push_back(i);
+  if (lostnodes.size() > 1) {
+    Repair repair = planRepair(ec, n, w, lostnodes);
+    if (checkRepair(repair, stripe, len)) multis.push_back(repair);
+  }
+  double multiMBps = benchRepairs(multis, stripe, len, threads, sizeB);
+
+  // n/a: the code has no plan for the failure that rebuilds the data
+  Logger::setLevel(level);
+  printf("%-16s %4d %4d %3d %9d %12.1f %12s %9s%s %12s %9s\n",
+         ecpolicy->getPolicyId().c_str(), n, k, w, len*w, encodeMBps,
+         rate(singleMBps).c_str(), readRatio(singles, singleMBps).c_str(), singleAll ? " " : "*",
+         rate(multiMBps).c_str(), readRatio(multis, multiMBps).c_str());
+  fflush(stdout);
+
+  freeComputes(encodes);
+  for (auto& repair: singles) freeComputes(repair.computes);
+  for (auto& repair: multis) freeComputes(repair.computes);
+  for (auto item: stripe) free(item.second);
+  for (auto buf: owned) free(buf);
+  delete ec;
+}
+
+int codec(int argc, char** argv) {
+  string ecids = argc > 2 ? string(argv[2]) : "all";
+  int threads = argc > 3 ? atoi(argv[3]) : 1;
+  string pktsizes = argc > 4 ? string(argv[4]) : "4096,65536,1048576";
+  long sizeB = (argc > 5 ? atol(argv[5]) : 64) * 1048576;
+  if (threads <= 0) threads = 1;
+
+  string confpath = "conf/sysSetting.xml";
+  Config* conf = new Config(confpath);
+
+  vector<string> ecidlist;
+  string item;
+  if (ecids == "all") {
+    for (auto ecitem: conf->_ecPolicyMap) ecidlist.push_back(ecitem.first);
+    sort(ecidlist.begin(), ecidlist.end());
+  } else {
+    stringstream ss(ecids);
+    while (getline(ss, item, ',')) {
+      if (conf->_ecPolicyMap.find(item) == conf->_ecPolicyMap.end()) {
+        cout << "unknown ecid " << item << ", skipped" << endl;
+        continue;
+      }
+      ecidlist.push_back(item);
+    }
+  }
+  vector<int> pktsizelist;
+  stringstream pss(pktsizes);
+  while (getline(pss, item, ',')) pktsizelist.push_back(atoi(item.c_str()));
+
+  // MB/s over all threads; read: sub-packets read per sub-packet repaired, * if some node has no repair plan
+  printf("%-16s %4s %4s %3s %9s %12s %12s %10s %12s %9s\n",
+         "ecid", "n", "k", "w", "pktsizeB", "encode", "single", "read", "multi", "read");
+  for (auto ecid: ecidlist) {
+    for (auto pktsizeB: pktsizelist) codecBench(conf->_ecPolicyMap[ecid], threads, pktsizeB, sizeB);
+  }
+  delete conf;
+  return 0;
+}
+
 int main(int argc, char** argv) {
+  if (argc > 1 && string(argv[1]) == "codec") return codec(argc, argv);
   if (argc < 6) {
     usage();
     return 0;
@@ -0,0 +1,220 @@
+#include "ec/ECBase.hh"
+#include "ec/ECDAG.hh"
+#include "ec/ECPolicy.hh"
+#include "inc/include.hh"
+
+#include <malloc.h>
+#include <sstream>
+
+using namespace std;
+
+void usage() {
+  cout << "Usage: ./ECDAGBench [classes] [reps]" << endl;
+  cout << "  1. classes: all or class,... (RSCONV/RSBINDX/RSPIPE/RSPPR/WASLRC/IA/DRC643/DRC963/BUTTERFLY64), default all" << endl;
+  cout << "  2. reps: plans per case, the stage times are averaged, default 5" << endl;
+}
+
+typedef struct {
+  string classname;
+  int n, k, w;
+  vector<string> param;
+} Shape;
+
+typedef struct {
+  // us per stage
+  double build, reconstruct, toposort, place, optimize, parse, persist;
+  int nodes, edges, cmds, maxcmdlen;
+  long bytes;
+} Plan;
+
+double getCurrentTime() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (double)tv.tv_sec * 1e+6 + (double)tv.tv_usec;
+}
+
+// bytes held by malloc, the difference around a plan is the memory the plan keeps
+long heapInUse() {
+#if __GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33)
+  struct mallinfo2 mi = mallinfo2();
+#else
+  struct mallinfo mi = mallinfo();
+#endif
+  return (long)mi.uordblks + (long)mi.hblkhd;
+}
+
+// shapes each class can be instantiated with, the rs family and lrc grow to wide stripes,
+// the others only exist for the shapes of their constructions
+vector<Shape> sweep(string classname) {
+  vector<Shape> toret;
+  vector<int> ks = {4, 6, 8, 12, 16, 24, 32, 48, 64, 96, 128};
+  if (classname == "RSCONV" || classname == "RSBINDX" || classname == "RSPIPE" || classname == "RSPPR") {
+    for (auto k: ks) {
+      for (int m=2; m<=4; m++) toret.push_back({classname, k+m, k, 1, {}});
+    }
+  } else if (classname == "WASLRC") {
+    for (auto k: ks) {
+      for (int l=2; l<=4; l*=2) {
+        if (k % l) continue;
+        toret.push_back({classname, k+l+2, k, 1, {to_string(l), "2"}});
+      }
+    }
+  } else if (classname == "IA") {
+    for (int k=2; k<=4; k++) toret.push_back({classname, 2*k, k, k, {}});
+  } else if (classname == "DRC643") {
+    toret.push_back({classname, 6, 4, 2, {"3"}});
+  } else if (classname == "DRC963") {
+    toret.push_back({classname, 9, 6, 3, {"3"}});
+  } else if (classname == "BUTTERFLY64") {
+    toret.push_back({classname, 6, 4, 8, {}});
+  } else {
+    cout << "unrecognized code " << classname << ", skipped" << endl;
+  }
+  return toret;
+}
+
+// plans one stripe the way the coordinator does offline, node 0 is lost for decode
+Plan plan(Shape shape, int opt, string operation) {
+  Plan toret;
+  int n = shape.n;
+  int k = shape.k;
+  int w = shape.w;
+  bool locality = opt > 0;
+  ECPolicy* ecpolicy = new ECPolicy(shape.classname, shape.classname, n, k, w, opt, shape.param);
+  ECBase* ec = ecpolicy->createECClass();
+
+  // simulate physical information, one agent per node and three agents per rack
+  vector<unsigned int> allIps;
+  unordered_map<unsigned int, string> ip2Rack;
+  unordered_map<int, pair<string, unsigned int>> objlist;
+  unordered_map<int, unsigned int> sid2ip;
+  for (int sid=0; sid<n; sid++) {
+    unsigned int ip = htonl((10 << 24) + sid + 1);
+    allIps.push_back(ip);
+    ip2Rack.insert(make_pair(ip, "/rack" + to_string(sid/3)));
+    if (operation == "decode" && sid == 0) continue;
+    objlist.insert(make_pair(sid, make_pair("benchobj" + to_string(sid), ip)));
+    sid2ip.insert(make_pair(sid, ip));
+  }
+  vector<int> availcidx;
+  vector<int> toreccidx;
+  for (int i=0; i<n; i++) {
+    for (int j=0; j<w; j++) {
+      if (i == 0) toreccidx.push_back(i*w+j);
+      else availcidx.push_back(i*w+j);
+    }
+  }
+
+  long heap = heapInUse();
+  double t = getCurrentTime(), tnow;
+
+  ECDAG* ecdag = operation == "encode" ? ec->Encode() : ec->Decode(availcidx, toreccidx);
+  tnow = getCurrentTime(); toret.build = tnow - t; t = tnow;
+
+  ecdag->reconstruct(opt);
+  tnow = getCurrentTime(); toret.reconstruct = tnow - t; t = tnow;
+
+  vector<int> toposeq = ecdag->toposort();
+  tnow = getCurrentTime(); toret.toposort = tnow - t; t = tnow;
+
+  unordered_map<int, unsigned int> cid2ip;
+  for (int i=0; i<toposeq.size(); i++) {
+    int curcid = toposeq[i];
+    ECNode* cnode = ecdag->getNode(curcid);
+    vector<unsigned int> candidates = cnode->candidateIps(sid2ip, cid2ip, allIps, n, k, w, locality);
+    cid2ip.insert(make_pair(curcid, candidates[0]));
+  }
+  tnow = getCurrentTime(); toret.place = tnow - t; t = tnow;
+
+  ecdag->optimize2(opt, cid2ip, ip2Rack, n, k, w, sid2ip, allIps, locality);
+  tnow = getCurrentTime(); toret.optimize = tnow - t; t = tnow;
+
+  int pktnum = 8;
+  unordered_map<int, AGCommand*> agCmds = ecdag->parseForOEC(cid2ip, "benchstripe", n, k, w, pktnum, objlist);
+  tnow = getCurrentTime(); toret.parse = tnow - t; t = tnow;
+
+  vector<AGCommand*> persistCmds = ecdag->persist(cid2ip, "benchstripe", n, k, w, pktnum, objlist);
+  tnow = getCurrentTime(); toret.persist = tnow - t; t = tnow;
+
+  toret.bytes = heapInUse() - heap;
+
+  // shape of the plan after optimization
+  toposeq = ecdag->toposort();
+  toret.nodes = toposeq.size();
+  toret.edges = 0;
+  for (auto cid: toposeq) toret.edges += ecdag->getNode(cid)->getChildNum();
+  toret.cmds = agCmds.size() + persistCmds.size();
+  toret.maxcmdlen = 0;
+  for (auto item: agCmds) {
+    toret.maxcmdlen = max(toret.maxcmdlen, item.second->getCmdLen());
+    delete item.second;
+  }
+  for (auto cmd: persistCmds) {
+    toret.maxcmdlen = max(toret.maxcmdlen, cmd->getCmdLen());
+    delete cmd;
+  }
+
+  delete ecdag;
+  delete ec;
+  delete ecpolicy;
+  return toret;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1 && (string(argv[1]) == "-h" || string(argv[1]) == "--help")) {
+    usage();
+    return 0;
+  }
+  string classes = argc > 1 ? string(argv[1]) : "all";
+  int reps = argc > 2 ? atoi(argv[2]) : 5;
+  if (reps <= 0) reps = 1;
+
+  vector<string> classnames;
+  if (classes == "all") {
+    classnames = {"RSCONV", "RSBINDX", "RSPIPE", "RSPPR", "WASLRC", "IA", "DRC643", "DRC963", "BUTTERFLY64"};
+  } else {
+    stringstream ss(classes);
+    string item;
+    while (getline(ss, item, ',')) classnames.push_back(item);
+  }
+  vector<int> opts = {-1, 0, 1, 2};
+  vector<string> operations = {"encode", "decode"};
+
+  // oversize: a command exceeds MAX_COMMAND_LEN and can not share a batch with other stripes
+  printf("%-12s %4s %4s %3s %3s %-6s %9s %9s %9s %9s %9s %9s %9s %10s %6s %6s %5s %7s %9s\n",
+         "class", "n", "k", "w", "opt", "op",
+         "build", "recons", "topo", "place", "optim", "parse", "persist", "total(us)",
+         "nodes", "edges", "cmds", "maxcmd", "mem(KB)");
+  for (auto classname: classnames) {
+    for (auto shape: sweep(classname)) {
+      for (auto opt: opts) {
+        for (auto operation: operations) {
+          Plan avg = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+          Plan last;
+          // the codes log while they plan, keep it out of the measurement and the report
+          int level = Logger::getLevel();
+          Logger::setLevel(LOG_LEVEL_OFF);
+          for (int i=0; i<reps; i++) {
+            last = plan(shape, opt, operation);
+            avg.build += last.build / reps;
+            avg.reconstruct += last.reconstruct / reps;
+            avg.toposort += last.toposort / reps;
+            avg.place += last.place / reps;
+            avg.optimize += last.optimize / reps;
+            avg.parse += last.parse / reps;
+            avg.persist += last.persist / reps;
+          }
+          Logger::setLevel(level);
+          double total = avg.build + avg.reconstruct + avg.toposort + avg.place + avg.optimize + avg.parse + avg.persist;
+          printf("%-12s %4d %4d %3d %3d %-6s %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %10.1f %6d %6d %5d %7d %9.1f%s\n",
+                 classname.c_str(), shape.n, shape.k, shape.w, opt, operation.c_str(),
+                 avg.build, avg.reconstruct, avg.toposort, avg.place, avg.optimize, avg.parse, avg.persist, total,
+                 last.nodes, last.edges, last.cmds, last.maxcmdlen, last.bytes / 1024.0,
+                 last.maxcmdlen > MAX_COMMAND_LEN ? " oversize" : "");
+          fflush(stdout);
+        }
+      }
+    }
+  }
+  return 0;
+}
@@ -25,6 +25,9 @@ int main(int argc, char** argv) {
     exit(1);
   }
 
+  // the dags and tasks are dumped at debug level
+  Logger::setLevel(LOG_LEVEL_DEBUG);
+
   string parsetype = string(argv[1]);
   string ecid = string(argv[2]);
   string operation = string(argv[3]);
@@ -0,0 +1,232 @@
+#include "common/BlockingQueue.hh"
+#include "common/Config.hh"
+#include "common/FSObjInputStream.hh"
+#include "common/FSObjOutputStream.hh"
+#include "common/OECDataPacket.hh"
+#include "ec/Computation.hh"
+#include "ec/ECTask.hh"
+#include "fs/LocalFS.hh"
+#include "protocol/AGCommand.hh"
+#include "inc/include.hh"
+
+using namespace std;
+
+void usage() {
+  cout << "Usage: ./MicroBench suite [fsdir] [objsizeMB]" << endl;
+  cout << "	1, suite (multi/queue/packet/command/fsstream/all)" << endl;
+  cout << "	2, fsdir: directory of the local backend for fsstream, default /tmp/oec-microbench" << endl;
+  cout << "	3, objsizeMB: object size for fsstream, default 64" << endl;
+}
+
+double getCurrentTime() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (double)tv.tv_sec * 1e+6 + (double)tv.tv_usec;
+}
+
+// bytes: payload of one op, 0 if the case has no bandwidth
+void report(string name, long ops, double us, long bytes) {
+  double nsop = us * 1000 / ops;
+  printf("%-48s %12ld ops %14.1f ns/op", name.c_str(), ops, nsop);
+  if (bytes > 0) printf(" %10.3f GB/s", (double)bytes * ops / (us * 1000));
+  printf("\n");
+  fflush(stdout);
+}
+
+// repeats op in doubling batches until a batch takes at least 200ms, reports the last batch
+template <class F>
+void measure(string name, long bytes, F op) {
+  long ops = 1;
+  while (true) {
+    double us = -getCurrentTime();
+    for (long i=0; i<ops; i++) op();
+    us += getCurrentTime();
+    if (us >= 200000 || ops >= (1L << 32)) {
+      report(name, ops, us, bytes);
+      return;
+    }
+    ops *= 2;
+  }
+}
+
+void benchMulti() {
+  vector<pair<int, int>> shapes = {{1, 4}, {2, 6}, {3, 10}, {4, 12}, {4, 32}, {8, 64}};
+  vector<int> lens = {4096, 65536, 1048576};
+  vector<string> libs = {"Jerasure", "Isal"};
+  srand(1234);
+  for (auto lib: libs) {
+    for (auto shape: shapes) {
+      int row = shape.first;
+      int col = shape.second;
+      for (auto len: lens) {
+        int* matrix = (int*)calloc(row*col, sizeof(int));
+        for (int i=0; i<row*col; i++) matrix[i] = rand() % 255 + 1;
+        char** data = (char**)calloc(col, sizeof(char*));
+        char** code = (char**)calloc(row, sizeof(char*));
+        for (int i=0; i<col; i++) {
+          data[i] = (char*)calloc(len, sizeof(char));
+          for (int j=0; j<len; j++) data[i][j] = rand();
+        }
+        for (int i=0; i<row; i++) code[i] = (char*)calloc(len, sizeof(char));
+
+        string name = "multi." + lib + "." + to_string(row) + "x" + to_string(col) + "." + to_string(len);
+        measure(name, (long)len*col, [&]{ Computation::Multi(code, data, matrix, row, col, len, lib); });
+
+        for (int i=0; i<col; i++) free(data[i]);
+        for (int i=0; i<row; i++) free(code[i]);
+        free(data);
+        free(code);
+        free(matrix);
+      }
+    }
+  }
+}
+
+void benchQueue() {
+  vector<int> threads = {1, 2, 4, 8};
+  int items = 1 << 20;
+  for (auto num: threads) {
+    // num producers and num consumers share one queue
+    BlockingQueue<OECDataPacket*>* queue = new BlockingQueue<OECDataPacket*>();
+    int perThread = items / num;
+    double us = -getCurrentTime();
+    vector<thread> producers, consumers;
+    for (int i=0; i<num; i++) {
+      producers.push_back(thread([=]{ for (int j=0; j<perThread; j++) queue->push((OECDataPacket*)1); }));
+      consumers.push_back(thread([=]{ for (int j=0; j<perThread; j++) queue->pop(); }));
+    }
+    for (int i=0; i<num; i++) {
+      producers[i].join();
+      consumers[i].join();
+    }
+    us += getCurrentTime();
+    report("queue.pushpop." + to_string(num) + "x" + to_string(num), (long)perThread*num, us, 0);
+    delete queue;
+  }
+}
+
+void benchPacket() {
+  vector<int> lens = {4096, 131072, 1048576};
+  for (auto len: lens) {
+    measure("packet.alloc." + to_string(len), len, [&]{
+      OECDataPacket* pkt = new OECDataPacket(len);
+      delete pkt;
+    });
+    OECDataPacket* src = new OECDataPacket(len);
+    memset(src->getData(), 1, len);
+    measure("packet.copy." + to_string(len), len, [&]{
+      OECDataPacket* pkt = new OECDataPacket(src->getRaw());
+      delete pkt;
+    });
+    delete src;
+  }
+}
+
+void benchCommand() {
+  vector<int> prevs = {4, 16, 64};
+  for (auto nprevs: prevs) {
+    vector<int> prevCids;
+    vector<unsigned int> prevLocs;
+    unordered_map<int, vector<int>> coefs;
+    unordered_map<int, int> refs;
+    for (int i=0; i<nprevs; i++) {
+      prevCids.push_back(i);
+      prevLocs.push_back(i+1);
+    }
+    for (int t=0; t<4; t++) {
+      coefs.insert(make_pair(nprevs+t, vector<int>(nprevs, t+1)));
+      refs.insert(make_pair(nprevs+t, 1));
+    }
+
+    measure("command.agcommand.build." + to_string(nprevs), 0, [&]{
+      AGCommand* cmd = new AGCommand();
+      cmd->buildType3(3, 1, "benchstripe", 1, 32, nprevs, prevCids, prevLocs, coefs, refs);
+      delete cmd;
+    });
+    AGCommand* built = new AGCommand();
+    built->buildType3(3, 1, "benchstripe", 1, 32, nprevs, prevCids, prevLocs, coefs, refs);
+    measure("command.agcommand.parse." + to_string(nprevs), 0, [&]{
+      AGCommand* cmd = new AGCommand(built->getCmd());
+      delete cmd;
+    });
+    delete built;
+
+    vector<int> children(prevCids.begin(), prevCids.end());
+    measure("command.ectask.build." + to_string(nprevs), 0, [&]{
+      ECTask* task = new ECTask();
+      task->setType(2);
+      task->setChildren(children);
+      task->setCoefmap(coefs);
+      task->buildType2();
+      delete task;
+    });
+    ECTask* task = new ECTask();
+    task->setType(2);
+    task->setChildren(children);
+    task->setCoefmap(coefs);
+    task->buildType2();
+    measure("command.ectask.parse." + to_string(nprevs), 0, [&]{
+      ECTask* parsed = new ECTask(task->getCmd());
+      delete parsed;
+    });
+    delete task;
+  }
+}
+
+void benchFSStream(Config* conf, string fsdir, int objsizeMB) {
+  vector<string> param = {fsdir};
+  LocalFS* fs = new LocalFS(param, conf);
+  int pktsize = conf->_pktSize;
+  int pktnum = (long)objsizeMB * 1048576 / pktsize;
+  string objname = "/microbench-obj";
+
+  // write: packets are enqueued while the writer thread drains them
+  double us = -getCurrentTime();
+  FSObjOutputStream* outstream = new FSObjOutputStream(conf, objname, fs, pktnum);
+  thread writeThread = thread([=]{outstream->writeObj();});
+  for (int i=0; i<pktnum; i++) {
+    OECDataPacket* pkt = new OECDataPacket(pktsize);
+    memset(pkt->getData(), i, pktsize);
+    outstream->enqueue(pkt);
+  }
+  writeThread.join();
+  delete outstream;
+  us += getCurrentTime();
+  report("fsstream.write." + to_string(objsizeMB) + "MB", pktnum, us, pktsize);
+
+  // read: the reader thread fills the queue with read-ahead
+  us = -getCurrentTime();
+  FSObjInputStream* instream = new FSObjInputStream(conf, objname, fs);
+  thread readThread = thread([=]{instream->readObj();});
+  BlockingQueue<OECDataPacket*>* queue = instream->getQueue();
+  for (int i=0; i<pktnum; i++) delete queue->pop();
+  readThread.join();
+  delete instream;
+  us += getCurrentTime();
+  report("fsstream.read." + to_string(objsizeMB) + "MB", pktnum, us, pktsize);
+
+  delete fs;
+  remove((fsdir + objname).c_str());
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    usage();
+    return 0;
+  }
+  string suite = string(argv[1]);
+  string fsdir = argc > 2 ? string(argv[2]) : "/tmp/oec-microbench";
+  int objsizeMB = argc > 3 ? atoi(argv[3]) : 64;
+
+  string confpath = "conf/sysSetting.xml";
+  Config* conf = new Config(confpath);
+
+  if (suite == "multi" || suite == "all") benchMulti();
+  if (suite == "queue" || suite == "all") benchQueue();
+  if (suite == "packet" || suite == "all") benchPacket();
+  if (suite == "command" || suite == "all") benchCommand();
+  if (suite == "fsstream" || suite == "all") benchFSStream(conf, fsdir, objsizeMB);
+
+  delete conf;
+  return 0;
+}
@@ -1,5 +1,7 @@
 #include "common/Config.hh"
+#include "common/Metrics.hh"
 #include "common/OECWorker.hh"
+#include "common/Tracer.hh"
 
 #include "inc/include.hh"
 
@@ -9,6 +11,8 @@ int main(int argc, char** argv) {
 
   string configPath = "conf/sysSetting.xml";
   Config* conf = new Config(configPath);
+  Logger::init(conf->_log_level, conf->_log_file);
+  Tracer::start(conf, "agent");
 
   OECWorker** workers = (OECWorker**)calloc(conf -> _agWorkerThreadNum, sizeof(OECWorker*)); 
 
@@ -17,7 +21,9 @@ int main(int argc, char** argv) {
     workers[i] = new OECWorker(conf);
     thrds[i] = thread([=]{workers[i] -> doProcess();});
   }
-  cout << "OECAgent started ..." << endl;
+  // export the stage metrics of the workers
+  Metrics::start(conf);
+  LOG_INFO << "OECAgent started ...";
 
   /**
    * Shoule never reach here
@@ -10,22 +10,37 @@ using namespace std;
 
 void usage() {
   cout << "usage: ./OECClient write inputfile saveas ecid online sizeinMB" << endl;
+  cout << "       ./OECClient write inputfile saveas ecid online -1" << endl;
   cout << "       ./OECClient write inputfile saveas poolid offline sizeinMB" << endl;
   cout << "       ./OECClient read filename saveas" << endl;
+  cout << "       ./OECClient read filename saveas offset length" << endl;
   cout << "       ./OECClient startEncode" << endl;
   cout << "       ./OECClient startRepair" << endl;
+  cout << "       ./OECClient reportLost objname" << endl;
   cout << "       ./OECClient coorBench id number" << endl;
+  cout << "       ./OECClient coorBench id number clients mix ecids [metafile]" << endl;
+  cout << "         mix: regonline:4,regoffline:4,meta:8,degraded:2,encode:1  ecids: rs_9_6,... or all" << endl;
 }
 
-void read(string filename, string saveas) {
+int read(string filename, string saveas, long offset, long length) {
 
   string confpath("./conf/sysSetting.xml");
   Config* conf = new Config(confpath);
+  Logger::init(conf->_log_level, conf->_log_file);
 
   struct timeval time1, time2;
   gettimeofday(&time1, NULL);
   // 0. create OECInputStream and init
-  OECInputStream* instream = new OECInputStream(conf, filename);
+  OECInputStream* instream;
+  if (length < 0) instream = new OECInputStream(conf, filename);
+  else instream = new OECInputStream(conf, filename, offset, length);
+  if (!instream->exist()) {
+    cout << "ERROR: " << filename << " not found" << endl;
+    instream->close();
+    delete instream;
+    delete conf;
+    return -1;
+  }
   instream->output2file(saveas);
   instream->close();
 
@@ -34,11 +49,13 @@ void read(string filename, string saveas) {
 
   delete instream;
   delete conf;
+  return 0;
 }
  
 void write(string inputname, string filename, string ecidpool, string encodemode, int sizeinMB) {
    string confpath("./conf/sysSetting.xml");
    Config* conf = new Config(confpath);
+   Logger::init(conf->_log_level, conf->_log_file);
    struct timeval time1, time2, time3, time4;
    gettimeofday(&time1, NULL);
  
@@ -51,7 +68,7 @@ void write(string inputname, string filename, string ecidpool, string encodemode
  
    int sizeinBytes = sizeinMB * 1048576;
    int num = sizeinBytes/conf->_pktSize;
-   cout << "num = " << num << endl;
+   LOG_DEBUG << "num = " << num;
    srand((unsigned)time(0));
  
    for (int i=0; i<num; i++) {
@@ -64,6 +81,19 @@ void write(string inputname, string filename, string ecidpool, string encodemode
      outstream->write(buf, conf->_pktSize+4);
      free(buf);
    } 
+
+   // sizeinMB < 0: stream the input file until EOF, the last pkt may be short
+   while (sizeinMB < 0) {
+     char* buf = (char*)calloc(conf->_pktSize+4, sizeof(char));
+     int len = fread(buf+4, 1, conf->_pktSize, inputfile);
+     if (len > 0) {
+       int tmplen = htonl(len);
+       memcpy(buf, (char*)&tmplen, 4);
+       outstream->write(buf, len+4);
+     }
+     free(buf);
+     if (len < conf->_pktSize) break;
+   }
  
    gettimeofday(&time3, NULL);
    outstream->close();
@@ -100,6 +130,10 @@ int main(int argc, char** argv) {
     string ecid(argv[4]);
     string mode(argv[5]);
     int size = atoi(argv[6]);
+    if (size < 0 && mode != "online") {
+      cout << "Error sizeinMB: only online encode mode supports unknown size" << endl;
+      return -1;
+    }
     if ((mode == "online") || (mode == "offline")) {
       write(inputfile, filename, ecid, mode, size)    ;
     } else {
@@ -107,16 +141,23 @@ int main(int argc, char** argv) {
       return -1;
     }   
   } else if (reqType == "read") {
-    if (argc != 4) {
+    if (argc != 4 && argc != 6) {
       usage();
       return -1;
     }
     string filename(argv[2]);
     string saveas(argv[3]);
-    read(filename, saveas);
+    long offset = 0;
+    long length = -1;
+    if (argc == 6) {
+      offset = atol(argv[4]);
+      length = atol(argv[5]);
+    }
+    return read(filename, saveas, offset, length);
   } else if (reqType == "startEncode") {
     string confpath("./conf/sysSetting.xml");
-    Config* conf = new Config(confpath);    
+    Config* conf = new Config(confpath);
+    Logger::init(conf->_log_level, conf->_log_file);
     // send coorCmd to coordinator?
     CoorCommand* cmd = new CoorCommand();
     cmd->buildType7(7, 1, "encode");
@@ -127,14 +168,30 @@ int main(int argc, char** argv) {
   } else if (reqType == "startRepair") {
     string confpath("./conf/sysSetting.xml");
     Config* conf = new Config(confpath);
+    Logger::init(conf->_log_level, conf->_log_file);
     // send coorCmd to coordinator
     CoorCommand* cmd = new CoorCommand();
     cmd->buildType7(7, 1, "repair");
     cmd->sendTo(conf->_coorIp);
     delete cmd;
     delete conf;
+  } else if (reqType == "reportLost") {
+    if (argc != 3) {
+      usage();
+      return -1;
+    }
+    string objname(argv[2]);
+    string confpath("./conf/sysSetting.xml");
+    Config* conf = new Config(confpath);
+    Logger::init(conf->_log_level, conf->_log_file);
+    // the object is repaired once repair is enabled
+    CoorCommand* cmd = new CoorCommand();
+    cmd->buildType6(6, conf->_localIp, objname);
+    cmd->sendTo(conf->_coorIp);
+    delete cmd;
+    delete conf;
   } else if (reqType == "coorBench") {
-    if (argc != 4) {
+    if (argc != 4 && argc != 7 && argc != 8) {
       usage();
       return -1;
     }
@@ -142,7 +199,11 @@ int main(int argc, char** argv) {
     int number = atoi(argv[3]);
     string confpath("./conf/sysSetting.xml");
     Config* conf = new Config(confpath);
-    CoorBench* benchClient = new CoorBench(conf, id, number);
+    Logger::init(conf->_log_level, conf->_log_file);
+    CoorBench* benchClient;
+    if (argc == 4) benchClient = new CoorBench(conf, id, number);
+    else benchClient = new CoorBench(conf, id, number, atoi(argv[4]), string(argv[5]), string(argv[6]),
+                                     argc == 8 ? string(argv[7]) : "");
     benchClient->close();
 
     delete benchClient;
@@ -1,7 +1,11 @@
 #include "common/CmdDistributor.hh"
+#include "common/CompletionTracker.hh"
 #include "common/Config.hh"
 #include "common/Coordinator.hh"
+#include "common/Metrics.hh"
+#include "common/RequestScheduler.hh"
 #include "common/StripeStore.hh"
+#include "common/Tracer.hh"
 
 #include "inc/include.hh"
 
@@ -12,23 +16,36 @@ int main(int argc, char** argv) {
   
   string configpath = "conf/sysSetting.xml";
   Config* conf = new Config(configpath);
+  Logger::init(conf->_log_level, conf->_log_file);
+  Tracer::start(conf, "coordinator");
   // create stripestore
   // TODO: need to add recover from backup
   StripeStore* ss = new StripeStore(conf); 
   thread scanThread = thread([=]{ss->scanning();});
   thread rpThread = thread([=]{ss->scanRepair();});
+  thread snapThread = thread([=]{ss->snapshotting();});
 
   // command distributor
   CmdDistributor* cmdDistributor = new CmdDistributor(conf);
 
+  // requests are received by one thread and scheduled among the coordinator threads by class
+  RequestScheduler* scheduler = new RequestScheduler(conf);
+  thread recvThread = thread([=]{scheduler->receive();});
+
+  // persist reports of agents finish offline encoding and repair
+  CompletionTracker* tracker = new CompletionTracker(conf);
+  thread finishThread = thread([=]{tracker->listen();});
+
   // coordinator
   Coordinator** coors = (Coordinator**)calloc(conf->_coorThreadNum, sizeof(Coordinator*));
   thread thrds[conf->_coorThreadNum];
   for (int i=0; i<conf->_coorThreadNum; i++) {
-    coors[i] = new Coordinator(conf, ss);
+    coors[i] = new Coordinator(conf, ss, scheduler, tracker);
     thrds[i] = thread([=]{coors[i]->doProcess();});
   }
-  cout << "OECCoordinator started ......" << endl;
+  // export the request metrics of the coordinator threads
+  Metrics::start(conf);
+  LOG_INFO << "OECCoordinator started ......";
   /**
    * Shoule never reach here
    */
@@ -38,9 +55,14 @@ int main(int argc, char** argv) {
   for (int i=0; i<conf->_coorThreadNum; i++) {
     delete coors[i];
   }
+  finishThread.join();
+  recvThread.join();
   rpThread.join();
   scanThread.join();
+  snapThread.join();
   free(coors);
+  delete scheduler;
+  delete tracker;
   delete conf;
   delete cmdDistributor;
 
@@ -0,0 +1,374 @@
+#include "client/OECAsyncClient.hh"
+#include "common/Config.hh"
+#include "common/Metrics.hh"
+#include "fs/FSUtil.hh"
+#include "protocol/AGCommand.hh"
+#include "inc/include.hh"
+#include "util/RedisUtil.hh"
+
+#include <atomic>
+#include <condition_variable>
+#include <random>
+#include <sstream>
+
+using namespace std;
+
+void usage() {
+  cout << "usage: ./OECLoad [--rw write|read|rw] [--mode online|offline] [--ecids id,...]" << endl;
+  cout << "                 [--writers N] [--readers N] [--files N] [--size dist] [--reads N] [--time s]" << endl;
+  cout << "                 [--range bytes] [--degraded N] [--interval s] [--prefix name] [--seed N]" << endl;
+  cout << "	--rw: write --files files, read existing files, or both (default rw)" << endl;
+  cout << "	--mode, --ecids: files go round robin to the ecids (online) or poolids (offline), default the first in the configuration" << endl;
+  cout << "	--writers/--readers: operations kept in flight, default 4/4" << endl;
+  cout << "	--size: 64M (fixed), 1M-64M (uniform) or 4M:8,64M:1 (size:weight), default 4M" << endl;
+  cout << "	        offline files are rounded up to whole MBs" << endl;
+  cout << "	--reads/--time: the read phase stops after N reads or s seconds, default one read per file, files are read in turn" << endl;
+  cout << "	--range: read random ranges of this many bytes instead of whole files" << endl;
+  cout << "	--degraded: delete the first N objects of every online file before reading (up to n-k)" << endl;
+  cout << "	--interval: seconds between progress lines, default 1" << endl;
+  cout << "	--prefix, --seed: names and contents of the files, read an earlier run with its --prefix, --size and --seed" << endl;
+}
+
+typedef struct {
+  string filename;
+  string ecidpool;
+  long size;
+  // offset of the content in the data pool
+  long poolOff;
+} LoadFile;
+
+// operations, bytes and latency of one kind over a period
+typedef struct {
+  long ops;
+  long failed;
+  long bytes;
+  Histogram* latency;
+} LoadStat;
+
+mutex statLock;
+LoadStat intervalStat;
+LoadStat totalStat;
+
+void resetStat(LoadStat& stat) {
+  stat.ops = 0;
+  stat.failed = 0;
+  stat.bytes = 0;
+  if (stat.latency) delete stat.latency;
+  stat.latency = new Histogram();
+}
+
+void record(double ms, long bytes, bool ok) {
+  lock_guard<mutex> lck(statLock);
+  for (LoadStat* stat: {&intervalStat, &totalStat}) {
+    if (!ok) {
+      stat->failed++;
+      continue;
+    }
+    stat->ops++;
+    stat->bytes += bytes;
+    stat->latency->record(ms);
+  }
+}
+
+void printStat(string name, LoadStat& stat, double seconds) {
+  printf("%-12s %8ld ops %6ld failed %10.1f MB %10.2f MB/s %10.2f ops/s  p50 %9.2f  p90 %9.2f  p99 %9.2f  p999 %9.2f  max %9.2f ms\n",
+         name.c_str(), stat.ops, stat.failed, stat.bytes / 1048576.0,
+         seconds > 0 ? stat.bytes / 1048576.0 / seconds : 0, seconds > 0 ? stat.ops / seconds : 0,
+         stat.latency->percentile(50) / 1000.0, stat.latency->percentile(90) / 1000.0,
+         stat.latency->percentile(99) / 1000.0, stat.latency->percentile(99.9) / 1000.0,
+         stat.latency->percentile(100) / 1000.0);
+  fflush(stdout);
+}
+
+// size[:weight],... with sizes like 512K, 4M, 1G, or min-max
+vector<pair<long, int>> sizeMix;
+long sizeMin = 0, sizeMax = 0;
+
+long parseBytes(string s) {
+  if (s.empty()) return 0;
+  long unit = 1;
+  char last = toupper(s.back());
+  if (last == 'K') unit = 1024;
+  else if (last == 'M') unit = 1048576;
+  else if (last == 'G') unit = 1073741824;
+  if (unit > 1) s = s.substr(0, s.size() - 1);
+  return (long)(atof(s.c_str()) * unit);
+}
+
+bool parseSize(string dist) {
+  size_t dash = dist.find('-');
+  if (dash != string::npos) {
+    sizeMin = parseBytes(dist.substr(0, dash));
+    sizeMax = parseBytes(dist.substr(dash + 1));
+    return sizeMin > 0 && sizeMax >= sizeMin;
+  }
+  stringstream ss(dist);
+  string item;
+  while (getline(ss, item, ',')) {
+    if (item.empty()) continue;
+    int weight = 1;
+    size_t pos = item.find(':');
+    if (pos != string::npos) {
+      weight = atoi(item.substr(pos + 1).c_str());
+      item = item.substr(0, pos);
+    }
+    long size = parseBytes(item);
+    if (size <= 0 || weight <= 0) return false;
+    sizeMix.push_back(make_pair(size, weight));
+  }
+  return sizeMix.size() > 0;
+}
+
+long drawSize(mt19937_64& rng) {
+  if (sizeMix.empty()) return sizeMin + rng() % (sizeMax - sizeMin + 1);
+  int total = 0;
+  for (auto item: sizeMix) total += item.second;
+  int r = rng() % total;
+  for (auto item: sizeMix) {
+    if (r < item.second) return item.first;
+    r -= item.second;
+  }
+  return sizeMix.back().first;
+}
+
+/*
+ * Keeps concurrency operations in flight until total operations are issued (total < 0: no limit)
+ * or seconds have passed (seconds <= 0: no limit), and prints the interval stats meanwhile.
+ * issue(i, done) starts the i-th operation, done(ok, bytes) is called once it has finished.
+ */
+void runPhase(string name, int concurrency, long total, double seconds, double interval,
+              function<void(long, function<void(bool, long)>)> issue) {
+  mutex lock;
+  condition_variable cv;
+  long issued = 0;
+  long finished = 0;
+  bool stop = false;
+  struct timeval start;
+  gettimeofday(&start, NULL);
+  statLock.lock();
+  resetStat(intervalStat);
+  resetStat(totalStat);
+  statLock.unlock();
+
+  // each finished operation starts the next one
+  function<void()> next = [&]() {
+    unique_lock<mutex> lk(lock);
+    if (stop || (total >= 0 && issued >= total)) {
+      stop = true;
+      cv.notify_all();
+      return;
+    }
+    long idx = issued++;
+    lk.unlock();
+    struct timeval time1;
+    gettimeofday(&time1, NULL);
+    issue(idx, [&, time1](bool ok, long bytes) {
+      struct timeval time2;
+      gettimeofday(&time2, NULL);
+      record(RedisUtil::duration(time1, time2), bytes, ok);
+      next();
+      // the phase may return once this is counted, touch nothing of it afterwards
+      lock_guard<mutex> lck(lock);
+      finished++;
+      cv.notify_all();
+    });
+  };
+  for (int i=0; i<concurrency; i++) next();
+
+  struct timeval last = start;
+  unique_lock<mutex> lk(lock);
+  while (!stop || finished < issued) {
+    cv.wait_for(lk, chrono::milliseconds(100));
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    if (seconds > 0 && RedisUtil::duration(start, now) >= seconds * 1000) stop = true;
+    if (RedisUtil::duration(last, now) >= interval * 1000) {
+      lk.unlock();
+      char label[32];
+      snprintf(label, sizeof(label), "[%6.1fs]", RedisUtil::duration(start, now) / 1000);
+      statLock.lock();
+      printStat(string(label) + " " + name, intervalStat, RedisUtil::duration(last, now) / 1000);
+      resetStat(intervalStat);
+      statLock.unlock();
+      last = now;
+      lk.lock();
+    }
+  }
+  lk.unlock();
+
+  struct timeval end;
+  gettimeofday(&end, NULL);
+  statLock.lock();
+  printStat(name + " total", totalStat, RedisUtil::duration(start, end) / 1000);
+  statLock.unlock();
+}
+
+int main(int argc, char** argv) {
+  string rw = "rw", mode = "online", ecids, sizedist = "4M", prefix;
+  int writers = 4, readers = 4, files = 16, degraded = 0;
+  long reads = -1, range = 0;
+  double seconds = 0, interval = 1;
+  unsigned int seed = (unsigned int)time(NULL);
+  for (int i=1; i<argc; i++) {
+    string opt(argv[i]);
+    if (i + 1 >= argc || opt.substr(0, 2) != "--") {
+      usage();
+      return -1;
+    }
+    string val(argv[++i]);
+    if (opt == "--rw") rw = val;
+    else if (opt == "--mode") mode = val;
+    else if (opt == "--ecids") ecids = val;
+    else if (opt == "--writers") writers = atoi(val.c_str());
+    else if (opt == "--readers") readers = atoi(val.c_str());
+    else if (opt == "--files") files = atoi(val.c_str());
+    else if (opt == "--size") sizedist = val;
+    else if (opt == "--reads") reads = atol(val.c_str());
+    else if (opt == "--time") seconds = atof(val.c_str());
+    else if (opt == "--range") range = parseBytes(val);
+    else if (opt == "--degraded") degraded = atoi(val.c_str());
+    else if (opt == "--interval") interval = atof(val.c_str());
+    else if (opt == "--prefix") prefix = val;
+    else if (opt == "--seed") seed = atoi(val.c_str());
+    else {
+      usage();
+      return -1;
+    }
+  }
+  if ((rw != "write" && rw != "read" && rw != "rw") || (mode != "online" && mode != "offline") ||
+      writers <= 0 || readers <= 0 || files <= 0 || interval <= 0 || !parseSize(sizedist)) {
+    usage();
+    return -1;
+  }
+
+  string confpath("./conf/sysSetting.xml");
+  Config* conf = new Config(confpath);
+  Logger::init(conf->_log_level, conf->_log_file);
+  // every writer and reader keeps its operation at the agent
+  conf->_client_inflight = max(conf->_client_inflight, max(writers, readers));
+
+  // 0. ecids of online files or poolids of offline files
+  vector<string> targets;
+  if (ecids.empty()) {
+    if (mode == "online") for (auto item: conf->_ecPolicyMap) targets.push_back(item.first);
+    else for (auto item: conf->_offlineECMap) targets.push_back(item.first);
+    sort(targets.begin(), targets.end());
+    if (targets.size()) targets.resize(1);
+  } else {
+    stringstream ss(ecids);
+    string item;
+    while (getline(ss, item, ',')) {
+      bool known = mode == "online" ? conf->_ecPolicyMap.count(item) : conf->_offlineECMap.count(item);
+      if (!known) {
+        cout << "OECLoad::unknown " << (mode == "online" ? "ecid " : "poolid ") << item << endl;
+        return -1;
+      }
+      targets.push_back(item);
+    }
+  }
+  if (targets.empty()) {
+    cout << "OECLoad::no " << (mode == "online" ? "ecid" : "poolid") << " in the configuration" << endl;
+    return -1;
+  }
+
+  // 1. sizes and contents of the files follow from the seed
+  if (prefix.empty()) prefix = "/oecload/" + to_string(seed);
+  mt19937_64 rng(seed);
+  vector<LoadFile> loadFiles;
+  long maxsize = 0;
+  for (int i=0; i<files; i++) {
+    LoadFile file;
+    file.filename = prefix + "_" + to_string(i);
+    file.ecidpool = targets[i % targets.size()];
+    file.size = drawSize(rng);
+    if (mode == "offline") file.size = (file.size + 1048575) / 1048576 * 1048576;
+    file.poolOff = rng() % 65536;
+    maxsize = max(maxsize, file.size);
+    loadFiles.push_back(file);
+  }
+  string pool(maxsize + 65536, 0);
+  for (long i=0; i<(long)pool.size(); i+=8) {
+    unsigned long r = rng();
+    memcpy(&pool[i], &r, min(8L, (long)pool.size() - i));
+  }
+
+  cout << "OECLoad::" << files << " " << mode << " files of " << prefix << "_*, size " << sizedist
+       << ", " << writers << " writers, " << readers << " readers, seed " << seed << endl;
+
+  intervalStat.latency = NULL;
+  totalStat.latency = NULL;
+  OECAsyncClient* client = new OECAsyncClient(conf);
+
+  // 2. write phase
+  if (rw == "write" || rw == "rw") {
+    runPhase("write", writers, files, 0, interval, [&](long i, function<void(bool, long)> done) {
+      LoadFile& file = loadFiles[i];
+      client->write(file.filename, file.ecidpool, mode, pool.substr(file.poolOff, file.size),
+                    [=](int status) { done(status == OEC_OK, file.size); });
+    });
+  }
+
+  // 3. drop objects of online files so that reads go degraded
+  if (degraded > 0 && rw != "write") {
+    if (mode != "online") {
+      cout << "OECLoad::--degraded only applies to online files, ignored" << endl;
+    } else {
+      UnderFS* fs = FSUtil::createFS(conf->_fsType, conf->_fsFactory[conf->_fsType], conf);
+      vector<string> deleted;
+      for (auto& file: loadFiles) {
+        ECPolicy* ecpolicy = conf->_ecPolicyMap[file.ecidpool];
+        int lost = min(degraded, ecpolicy->getN() - ecpolicy->getK());
+        for (int j=0; j<lost; j++) {
+          deleted.push_back(file.filename + "_oecobj_" + to_string(j));
+          fs->deleteFile(deleted.back());
+        }
+      }
+      FSUtil::deleteFS(conf->_fsType, fs);
+      // the agents drop the handles they cached, so that the reads go degraded right away
+      for (auto ip: conf->_agentsIPs) {
+        redisContext* sendCtx = RedisUtil::createContext(ip);
+        vector<AGCommand*> agCmds;
+        for (auto objname: deleted) {
+          AGCommand* agCmd = new AGCommand();
+          agCmd->buildType1(13, objname);
+          redisAppendCommand(sendCtx, "RPUSH ag_request %b", agCmd->getCmd(), agCmd->getCmdLen());
+          agCmds.push_back(agCmd);
+        }
+        for (auto agCmd: agCmds) {
+          redisReply* rReply;
+          redisGetReply(sendCtx, (void**)&rReply);
+          freeReplyObject(rReply);
+          delete agCmd;
+        }
+        redisFree(sendCtx);
+      }
+      cout << "OECLoad::deleted " << deleted.size() << " objects" << endl;
+    }
+  }
+
+  // 4. read phase, whole files or random ranges, checked against what was written
+  if (rw == "read" || rw == "rw") {
+    if (reads < 0 && seconds <= 0) reads = files;
+    mutex rngLock;
+    runPhase(range > 0 ? "rangeread" : "read", readers, reads, seconds, interval, [&](long i, function<void(bool, long)> done) {
+      LoadFile* file = &loadFiles[i % files];
+      rngLock.lock();
+      long offset = range > 0 && file->size > range ? rng() % (file->size - range + 1) : 0;
+      rngLock.unlock();
+      long length = range > 0 ? min(range, file->size) : file->size;
+      const char* expected = pool.c_str() + file->poolOff + offset;
+      OECReadCallback check = [=](int status, string data) {
+        bool ok = status == OEC_OK && (long)data.size() == length && memcmp(data.c_str(), expected, length) == 0;
+        if (!ok) LOG_WARN << "OECLoad::read " << file->filename << " at " << offset << " failed, status " << status
+                          << ", " << data.size() << " of " << length << " bytes";
+        done(ok, data.size());
+      };
+      if (range > 0) client->read(file->filename, offset, length, check);
+      else client->read(file->filename, check);
+    });
+  }
+
+  delete client;
+  delete conf;
+  return 0;
+}
@@ -0,0 +1,414 @@
+#include "OECAsyncClient.hh"
+
+#include <atomic>
+#include <unistd.h>
+
+#define ASYNC_OP_WRITE 0
+#define ASYNC_OP_READ 1
+#define ASYNC_OP_STAT 2
+
+// pkts of a read popped by one pipelined round
+#define ASYNC_READ_BATCH 16
+
+OECAsyncClient::OECAsyncClient(Config* conf) {
+  _conf = conf;
+  _ioThreadNum = _conf->_client_threads > 0 ? _conf->_client_threads : 1;
+  _maxInflight = _conf->_client_inflight > 0 ? _conf->_client_inflight : 1;
+  _inflight = 0;
+
+  // the wake key is private to this client on the shared redis of the agent
+  static atomic<int> nextClient(0);
+  _wakeKey = "asyncclient:" + RedisUtil::ip2Str(_conf->_localIp) + ":" + to_string(getpid()) + ":" + to_string(nextClient++);
+  _wakeCtx = RedisUtil::createContext(_conf->_localIp);
+
+  for (int i=0; i<_ioThreadNum; i++) _ioThreads.push_back(thread([=]{ioWorker();}));
+  _waitThread = thread([=]{waitWorker();});
+}
+
+OECAsyncClient::~OECAsyncClient() {
+  drain();
+  for (int i=0; i<_ioThreadNum; i++) _ioQueue.push(NULL);
+  for (auto& t: _ioThreads) t.join();
+  _waitLock.lock();
+  redisReply* rReply = (redisReply*)redisCommand(_wakeCtx, "RPUSH %s stop", _wakeKey.c_str());
+  freeReplyObject(rReply);
+  _waitLock.unlock();
+  _waitThread.join();
+  rReply = (redisReply*)redisCommand(_wakeCtx, "DEL %s", _wakeKey.c_str());
+  freeReplyObject(rReply);
+  redisFree(_wakeCtx);
+}
+
+void OECAsyncClient::write(string filename, string ecidpool, string mode, string data, OECWriteCallback callback) {
+  // the agent drops offline writes without a size of whole MBs and never answers
+  bool valid = mode == "online" || (mode == "offline" && data.size() > 0 && data.size() % 1048576 == 0);
+  if (!valid) {
+    LOG_WARN << "OECAsyncClient::write.invalid write of " << filename << ", mode: " << mode << ", size: " << data.size();
+    callback(OEC_INVALID);
+    return;
+  }
+  Op* op = new Op();
+  op->type = ASYNC_OP_WRITE;
+  op->filename = filename;
+  op->ecidpool = ecidpool;
+  op->mode = mode;
+  op->data.swap(data);
+  op->dataPhase = false;
+  op->writeDone = callback;
+  submit(op);
+}
+
+void OECAsyncClient::read(string filename, OECReadCallback callback) {
+  read(filename, 0, -1, callback);
+}
+
+void OECAsyncClient::read(string filename, long offset, long length, OECReadCallback callback) {
+  Op* op = new Op();
+  op->type = ASYNC_OP_READ;
+  op->filename = filename;
+  op->offset = offset;
+  op->length = length;
+  op->dataPhase = false;
+  op->readDone = callback;
+  submit(op);
+}
+
+void OECAsyncClient::stat(string filename, OECStatCallback callback) {
+  Op* op = new Op();
+  op->type = ASYNC_OP_STAT;
+  op->filename = filename;
+  op->dataPhase = false;
+  op->statDone = callback;
+  submit(op);
+}
+
+future<int> OECAsyncClient::write(string filename, string ecidpool, string mode, string data) {
+  shared_ptr<promise<int>> result = make_shared<promise<int>>();
+  write(filename, ecidpool, mode, move(data), [=](int status) { result->set_value(status); });
+  return result->get_future();
+}
+
+future<pair<int, string>> OECAsyncClient::read(string filename) {
+  return read(filename, 0, -1);
+}
+
+future<pair<int, string>> OECAsyncClient::read(string filename, long offset, long length) {
+  shared_ptr<promise<pair<int, string>>> result = make_shared<promise<pair<int, string>>>();
+  read(filename, offset, length, [=](int status, string data) { result->set_value(make_pair(status, move(data))); });
+  return result->get_future();
+}
+
+future<pair<int, OECFileStat>> OECAsyncClient::stat(string filename) {
+  shared_ptr<promise<pair<int, OECFileStat>>> result = make_shared<promise<pair<int, OECFileStat>>>();
+  stat(filename, [=](int status, OECFileStat stat) { result->set_value(make_pair(status, stat)); });
+  return result->get_future();
+}
+
+void OECAsyncClient::drain() {
+  unique_lock<mutex> lk(_lock);
+  _idleCv.wait(lk, [&]{ return _inflight == 0 && _pending.empty(); });
+}
+
+void OECAsyncClient::submit(Op* op) {
+  _lock.lock();
+  if (op) _pending.push_back(op);
+  vector<Op*> toissue;
+  // the first pending operation of each filename, while there is room at the agent
+  unordered_set<string> blocked;
+  for (auto it = _pending.begin(); it != _pending.end() && _inflight < _maxInflight; ) {
+    Op* cur = *it;
+    if (_busyFiles.count(cur->filename) || blocked.count(cur->filename)) {
+      blocked.insert(cur->filename);
+      it++;
+      continue;
+    }
+    _busyFiles.insert(cur->filename);
+    _inflight++;
+    toissue.push_back(cur);
+    it = _pending.erase(it);
+  }
+  _lock.unlock();
+  for (auto cur: toissue) _ioQueue.push(cur);
+}
+
+void OECAsyncClient::finish(Op* op, int status, string data, OECFileStat stat) {
+  if (op->type == ASYNC_OP_WRITE) op->writeDone(status);
+  else if (op->type == ASYNC_OP_READ) op->readDone(status, move(data));
+  else op->statDone(status, stat);
+
+  _lock.lock();
+  _busyFiles.erase(op->filename);
+  _inflight--;
+  _lock.unlock();
+  delete op;
+
+  // the released slot and filename may let pending operations go
+  submit(NULL);
+  _lock.lock();
+  bool idle = _inflight == 0 && _pending.empty();
+  _lock.unlock();
+  if (idle) _idleCv.notify_all();
+}
+
+void OECAsyncClient::waitFor(string key, Op* op) {
+  lock_guard<mutex> lck(_waitLock);
+  _waits[key] = op;
+  // the waiter takes the new key into its next BLPOP
+  redisReply* rReply = (redisReply*)redisCommand(_wakeCtx, "RPUSH %s wake", _wakeKey.c_str());
+  freeReplyObject(rReply);
+}
+
+void OECAsyncClient::ioWorker() {
+  redisContext* localCtx = RedisUtil::createContext(_conf->_localIp);
+  redisContext* coorCtx = NULL;
+  while (true) {
+    Op* op = _ioQueue.pop();
+    if (op == NULL) break;
+    if (op->dataPhase) {
+      readData(localCtx, op);
+    } else if (op->type == ASYNC_OP_WRITE) {
+      issueWrite(localCtx, op);
+    } else if (op->type == ASYNC_OP_READ) {
+      issueRead(localCtx, op);
+    } else {
+      if (coorCtx == NULL) coorCtx = RedisUtil::createContext(_conf->_coorIp);
+      issueStat(coorCtx, op);
+    }
+  }
+  redisFree(localCtx);
+  if (coorCtx) redisFree(coorCtx);
+}
+
+void OECAsyncClient::issueWrite(redisContext* ctx, Op* op) {
+  long len = op->data.size();
+  int pktsize = _conf->_pktSize;
+  // sizes of whole MBs are announced, other online writes end with a pkt of length 0
+  int filesizeMB = (len > 0 && len % 1048576 == 0) ? len / 1048576 : -1;
+
+  AGCommand* agCmd = new AGCommand();
+  agCmd->buildType0(0, op->filename, op->ecidpool, op->mode, filesizeMB);
+  agCmd->sendTo(ctx);
+  delete agCmd;
+
+  // |datalen|data| pkts as written by OECOutputStream, pipelined
+  char* buf = (char*)calloc(pktsize + 4, sizeof(char));
+  int pktid = 0;
+  for (long off=0; off<len; off+=pktsize) {
+    int curlen = min((long)pktsize, len - off);
+    int tmplen = htonl(curlen);
+    memcpy(buf, (char*)&tmplen, 4);
+    memcpy(buf + 4, op->data.c_str() + off, curlen);
+    string key = op->filename + ":" + to_string(pktid++);
+    redisAppendCommand(ctx, "RPUSH %s %b", key.c_str(), buf, curlen + 4);
+  }
+  if (filesizeMB < 0) {
+    int tmplen = htonl(0);
+    string key = op->filename + ":" + to_string(pktid++);
+    redisAppendCommand(ctx, "RPUSH %s %b", key.c_str(), (char*)&tmplen, 4);
+  }
+  free(buf);
+  redisReply* rReply;
+  for (int i=0; i<pktid; i++) {
+    redisGetReply(ctx, (void**)&rReply);
+    freeReplyObject(rReply);
+  }
+  // the pkts are in redis now
+  string().swap(op->data);
+
+  waitFor("writefinish:" + op->filename, op);
+}
+
+void OECAsyncClient::issueRead(redisContext* ctx, Op* op) {
+  AGCommand* agCmd = new AGCommand();
+  if (op->length < 0) agCmd->buildType1(1, op->filename);
+  else agCmd->buildType8(8, op->filename, op->offset, op->length);
+  agCmd->sendTo(ctx);
+  delete agCmd;
+  waitFor("filesize:" + op->filename, op);
+}
+
+void OECAsyncClient::issueStat(redisContext* coorCtx, Op* op) {
+  CoorCommand* coorCmd = new CoorCommand();
+  coorCmd->buildType3(3, _conf->_localIp, op->filename);
+  coorCmd->sendTo(coorCtx);
+  delete coorCmd;
+  waitFor("filemeta:" + op->filename, op);
+}
+
+void OECAsyncClient::appendPkt(Op* op, int pktid, const char* content) {
+  // drop the bytes before offset in the first pkt and after offset+length in the last one
+  int len;
+  memcpy((char*)&len, content, 4);
+  len = ntohl(len);
+  const char* pktdata = content + 4;
+  if (pktid == 0) {
+    pktdata += op->skip;
+    len -= op->skip;
+  }
+  long remain = op->length - (long)op->data.size();
+  if (len > remain) len = remain;
+  if (len > 0) op->data.append(pktdata, len);
+}
+
+void OECAsyncClient::readData(redisContext* ctx, Op* op) {
+  // take the pkts that are already there without blocking, up to ASYNC_READ_BATCH at a time,
+  // and leave the first missing one to the waiter so that no io thread waits for the agent
+  while (op->nextPkt < op->pktnum) {
+    vector<int> popped;
+    for (int i=op->nextPkt; i<op->pktnum && i<op->nextPkt+ASYNC_READ_BATCH; i++) {
+      if (op->parked.count(i)) continue;
+      string key = op->filename + ":" + to_string(i);
+      redisAppendCommand(ctx, "LPOP %s", key.c_str());
+      popped.push_back(i);
+    }
+    redisReply* rReply;
+    for (auto pktid: popped) {
+      redisGetReply(ctx, (void**)&rReply);
+      // pkts behind a missing one are parked until it arrives
+      if (rReply->type == REDIS_REPLY_STRING) op->parked[pktid] = string(rReply->str, rReply->len);
+      freeReplyObject(rReply);
+    }
+    int before = op->nextPkt;
+    for (auto it = op->parked.find(op->nextPkt); it != op->parked.end(); it = op->parked.find(op->nextPkt)) {
+      appendPkt(op, op->nextPkt, it->second.c_str());
+      op->parked.erase(it);
+      op->nextPkt++;
+    }
+    if (op->nextPkt == before) {
+      waitFor(op->filename + ":" + to_string(op->nextPkt), op);
+      return;
+    }
+  }
+  string data;
+  data.swap(op->data);
+  finish(op, OEC_OK, move(data), OECFileStat());
+}
+
+void OECAsyncClient::onReply(Op* op, char* value, int len) {
+  OECFileStat stat;
+  memset(&stat, 0, sizeof(stat));
+  if (op->type == ASYNC_OP_WRITE) {
+    finish(op, OEC_OK, "", stat);
+  } else if (op->type == ASYNC_OP_READ && op->dataPhase) {
+    // the pkt readData was missing, an io thread takes the ones behind it
+    op->parked[op->nextPkt] = string(value, len);
+    _ioQueue.push(op);
+  } else if (op->type == ASYNC_OP_READ) {
+    // |filesizeMB|filesizeB|, filesizeMB < 0 if the file does not exist
+    int tmpsize;
+    memcpy((char*)&tmpsize, value, 4);
+    int filesizeMB = ntohl(tmpsize);
+    long filebytes = (long)filesizeMB * 1048576;
+    if (len >= 12) {
+      int tmphigh, tmplow;
+      memcpy((char*)&tmphigh, value + 4, 4);
+      memcpy((char*)&tmplow, value + 8, 4);
+      filebytes = (long)(((unsigned long)(unsigned int)ntohl(tmphigh) << 32) | (unsigned int)ntohl(tmplow));
+    }
+    if (filesizeMB < 0) {
+      finish(op, OEC_NOT_FOUND, "", stat);
+      return;
+    }
+    // clamp the range to the file in the same way as OECWorker::clientRead
+    int pktsize = _conf->_pktSize;
+    if (op->length < 0) {
+      op->offset = 0;
+      op->length = filebytes;
+      op->pktnum = (filebytes + pktsize - 1) / pktsize;
+      op->skip = 0;
+    } else {
+      if (op->offset < 0) op->offset = 0;
+      if (op->offset > filebytes) op->offset = filebytes;
+      if (op->offset + op->length > filebytes) op->length = filebytes - op->offset;
+      int firstpkt = op->offset / pktsize;
+      op->pktnum = (op->length > 0) ? (op->offset + op->length - 1) / pktsize - firstpkt + 1 : 0;
+      op->skip = op->offset - (long)firstpkt * pktsize;
+    }
+    if (op->pktnum == 0) {
+      finish(op, OEC_OK, "", stat);
+      return;
+    }
+    // the agent streams the pkts now, an io thread collects them
+    op->dataPhase = true;
+    op->nextPkt = 0;
+    op->data.reserve(op->length);
+    _ioQueue.push(op);
+  } else {
+    // |type|filesizeMB|ecn|eck|ecw|filesizeB| or |type|filesizeMB|objnum|filesizeB|, type < 0 if not found
+    int fields[5];
+    int nfields = min(len / 4, 5);
+    for (int i=0; i<nfields; i++) {
+      memcpy((char*)&fields[i], value + i*4, 4);
+      fields[i] = ntohl(fields[i]);
+    }
+    stat.redundancy = fields[0];
+    if (stat.redundancy < 0) {
+      finish(op, OEC_NOT_FOUND, "", stat);
+      return;
+    }
+    stat.filesizeMB = fields[1];
+    int off;
+    if (stat.redundancy == 0) {
+      stat.ecn = fields[2];
+      stat.eck = fields[3];
+      stat.ecw = fields[4];
+      off = 20;
+    } else {
+      stat.objnum = fields[2];
+      off = 12;
+    }
+    int tmphigh, tmplow;
+    memcpy((char*)&tmphigh, value + off, 4);
+    memcpy((char*)&tmplow, value + off + 4, 4);
+    stat.filesizeB = (long)(((unsigned long)(unsigned int)ntohl(tmphigh) << 32) | (unsigned int)ntohl(tmplow));
+    finish(op, OEC_OK, "", stat);
+  }
+}
+
+void OECAsyncClient::waitWorker() {
+  redisContext* waitCtx = RedisUtil::createContext(_conf->_localIp);
+  while (true) {
+    // BLPOP wakekey key1 key2 ... 0
+    vector<string> args;
+    args.push_back("BLPOP");
+    args.push_back(_wakeKey);
+    _waitLock.lock();
+    for (auto item: _waits) args.push_back(item.first);
+    _waitLock.unlock();
+    args.push_back("0");
+    vector<const char*> argv;
+    vector<size_t> argvlen;
+    for (auto& arg: args) {
+      argv.push_back(arg.c_str());
+      argvlen.push_back(arg.size());
+    }
+    redisReply* rReply = (redisReply*)redisCommandArgv(waitCtx, argv.size(), argv.data(), argvlen.data());
+    if (rReply == NULL) {
+      LOG_ERROR << "OECAsyncClient::waitWorker.lost connection to redis";
+      break;
+    }
+    if (rReply->type != REDIS_REPLY_ARRAY || rReply->elements != 2) {
+      LOG_ERROR << "OECAsyncClient::waitWorker.unexpected reply of BLPOP";
+      freeReplyObject(rReply);
+      continue;
+    }
+    string key(rReply->element[0]->str, rReply->element[0]->len);
+    if (key == _wakeKey) {
+      bool stop = string(rReply->element[1]->str, rReply->element[1]->len) == "stop";
+      freeReplyObject(rReply);
+      if (stop) break;
+      continue;
+    }
+    Op* op = NULL;
+    _waitLock.lock();
+    unordered_map<string, Op*>::iterator it = _waits.find(key);
+    if (it != _waits.end()) {
+      op = it->second;
+      _waits.erase(it);
+    }
+    _waitLock.unlock();
+    if (op) onReply(op, rReply->element[1]->str, rReply->element[1]->len);
+    freeReplyObject(rReply);
+  }
+  redisFree(waitCtx);
+}
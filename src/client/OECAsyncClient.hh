@@ -0,0 +1,134 @@
+#ifndef _OECASYNCCLIENT_HH_
+#define _OECASYNCCLIENT_HH_
+
+#include "../common/BlockingQueue.hh"
+#include "../common/Config.hh"
+#include "../inc/include.hh"
+#include "../protocol/AGCommand.hh"
+#include "../protocol/CoorCommand.hh"
+#include "../util/RedisUtil.hh"
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <unordered_set>
+
+using namespace std;
+
+// status of a finished operation
+#define OEC_OK 0
+#define OEC_NOT_FOUND -1
+// offline writes need a size of whole MBs, mode is online or offline
+#define OEC_INVALID -2
+
+typedef struct {
+  // 0 online, 1 offline
+  int redundancy;
+  int filesizeMB;
+  long filesizeB;
+  // online
+  int ecn;
+  int eck;
+  int ecw;
+  // offline
+  int objnum;
+} OECFileStat;
+
+typedef function<void(int status)> OECWriteCallback;
+typedef function<void(int status, string data)> OECReadCallback;
+typedef function<void(int status, OECFileStat stat)> OECStatCallback;
+
+/*
+ * Asynchronous client of the local OECAgent (libopenec)
+ *
+ * Speaks the protocol of OECOutputStream/OECInputStream, but many operations of a process share
+ * a few redis connections instead of a connection and a blocked thread each:
+ *   - io threads send the requests and move the packets, each over its own connection, and
+ *     never block: reads pop the packets that have arrived and hand the first missing one
+ *     to the waiter
+ *   - one waiter thread blocks on the replies of all waiting operations with a single BLPOP
+ *     (writefinish of writes, filesize and missing packets of reads, filemeta of stats)
+ * At most client.inflight operations are sent to the agent at a time, later ones wait in the
+ * client. Replies of the agent are keyed by filename, so operations on the same filename run one
+ * after another in submission order.
+ *
+ * Callbacks run on the threads of the client and must not block on other operations of it.
+ */
+class OECAsyncClient {
+  private:
+    typedef struct {
+      int type;
+      string filename;
+      // write, data is the payload of a write and the result of a read
+      string ecidpool;
+      string mode;
+      string data;
+      // read, length < 0 reads the whole file
+      long offset;
+      long length;
+      int pktnum;
+      int skip;
+      bool dataPhase;
+      // next pkt to append to data and pkts popped ahead of it
+      int nextPkt;
+      unordered_map<int, string> parked;
+      OECWriteCallback writeDone;
+      OECReadCallback readDone;
+      OECStatCallback statDone;
+    } Op;
+
+    Config* _conf;
+    int _ioThreadNum;
+    int _maxInflight;
+    vector<thread> _ioThreads;
+    thread _waitThread;
+    BlockingQueue<Op*> _ioQueue;
+
+    mutex _lock;
+    condition_variable _idleCv;
+    // operations waiting for the inflight limit or their filename
+    deque<Op*> _pending;
+    unordered_set<string> _busyFiles;
+    int _inflight;
+
+    // reply key -> operation waiting for it, guarded by _waitLock
+    mutex _waitLock;
+    unordered_map<string, Op*> _waits;
+    string _wakeKey;
+    redisContext* _wakeCtx;
+
+    void submit(Op* op);
+    void finish(Op* op, int status, string data, OECFileStat stat);
+    void waitFor(string key, Op* op);
+    void onReply(Op* op, char* value, int len);
+
+    void ioWorker();
+    void waitWorker();
+    void issueWrite(redisContext* ctx, Op* op);
+    void issueRead(redisContext* ctx, Op* op);
+    void issueStat(redisContext* coorCtx, Op* op);
+    void readData(redisContext* ctx, Op* op);
+    void appendPkt(Op* op, int pktid, const char* content);
+  public:
+    // client.threads io threads, up to client.inflight operations at the agent
+    OECAsyncClient(Config* conf);
+    // waits for the submitted operations
+    ~OECAsyncClient();
+
+    // mode online/offline, ecidpool is an ecid for online and a poolid for offline writes
+    void write(string filename, string ecidpool, string mode, string data, OECWriteCallback callback);
+    void read(string filename, OECReadCallback callback);
+    // bytes [offset, offset+length) of the file, clamped to its size
+    void read(string filename, long offset, long length, OECReadCallback callback);
+    void stat(string filename, OECStatCallback callback);
+
+    future<int> write(string filename, string ecidpool, string mode, string data);
+    future<pair<int, string>> read(string filename);
+    future<pair<int, string>> read(string filename, long offset, long length);
+    future<pair<int, OECFileStat>> stat(string filename);
+
+    // blocks until every submitted operation has finished
+    void drain();
+};
+
+#endif
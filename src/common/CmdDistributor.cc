@@ -21,14 +21,14 @@ void CmdDistributor::distribute() {
   redisContext* selfCtx = RedisUtil::createContext(_conf->_coorIp);
   redisReply* rReply;
   while(true) {
-    cout << "CmdDistributor::distribute.wait for request!" << endl;
+    LOG_DEBUG << "CmdDistributor::distribute.wait for request!";
     rReply = (redisReply*)redisCommand(selfCtx, "blpop dist_request 0");
     if (rReply -> type == REDIS_REPLY_NIL) {
-      cerr << "CmdDistributor::distribute. empty queue!" << endl;
+      LOG_ERROR << "CmdDistributor::distribute. empty queue!";
       freeReplyObject(rReply);
       continue;
     } else if (rReply -> type == REDIS_REPLY_ERROR) {
-      cerr << "CmdDistributor::distribute. error!" << endl;
+      LOG_ERROR << "CmdDistributor::distribute. error!";
       freeReplyObject(rReply);
       continue;
     } else {
@@ -0,0 +1,81 @@
+#include "CompletionTracker.hh"
+
+CompletionTracker::CompletionTracker(Config* conf) {
+  _conf = conf;
+  _jobNum = 0;
+}
+
+void CompletionTracker::watch(string name, vector<string> objs, function<void()> callback) {
+  if (objs.size() == 0) {
+    callback();
+    return;
+  }
+  Job* job = new Job();
+  job->name = name;
+  job->remaining = objs.size();
+  job->callback = callback;
+  gettimeofday(&job->start, NULL);
+  _lock.lock();
+  for (auto obj: objs) _watchers[obj].push_back(job);
+  _jobNum++;
+  _lock.unlock();
+}
+
+void CompletionTracker::complete(string objname) {
+  Job* finished = NULL;
+  _lock.lock();
+  unordered_map<string, deque<Job*>>::iterator it = _watchers.find(objname);
+  if (it == _watchers.end()) {
+    _lock.unlock();
+    LOG_DEBUG << "CompletionTracker::complete.no job waits for " << objname;
+    return;
+  }
+  Job* job = it->second.front();
+  it->second.pop_front();
+  if (it->second.empty()) _watchers.erase(it);
+  job->remaining--;
+  if (job->remaining == 0) {
+    finished = job;
+    _jobNum--;
+  }
+  _lock.unlock();
+
+  if (finished) {
+    struct timeval end;
+    gettimeofday(&end, NULL);
+    LOG_DEBUG << "CompletionTracker::complete." << finished->name << " duration: "
+         << RedisUtil::duration(finished->start, end);
+    finished->callback();
+    delete finished;
+  }
+}
+
+int CompletionTracker::getJobNum() {
+  _lock.lock();
+  int toret = _jobNum;
+  _lock.unlock();
+  return toret;
+}
+
+void CompletionTracker::listen() {
+  redisContext* localCtx = RedisUtil::createContext(_conf->_localIp);
+  redisReply* rReply;
+  while (true) {
+    rReply = (redisReply*)redisCommand(localCtx, "blpop coor_finish 0");
+    if (rReply -> type == REDIS_REPLY_NIL) {
+      LOG_ERROR << "CompletionTracker::listen() get feed back empty queue ";
+    } else if (rReply -> type == REDIS_REPLY_ERROR) {
+      LOG_ERROR << "CompletionTracker::listen() get feed back ERROR happens ";
+    } else {
+      char* reqStr = rReply -> element[1] -> str;
+      CoorCommand* coorCmd = new CoorCommand(reqStr);
+      if (coorCmd->getType() == 14) {
+        Tracer::mark(coorCmd->getTraceId(), "persisted", "", coorCmd->getFilename());
+        complete(coorCmd->getFilename());
+      }
+      delete coorCmd;
+    }
+    freeReplyObject(rReply);
+  }
+  redisFree(localCtx);
+}
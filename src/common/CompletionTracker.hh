@@ -0,0 +1,51 @@
+#ifndef _COMPLETIONTRACKER_HH_
+#define _COMPLETIONTRACKER_HH_
+
+#include "Config.hh"
+#include "Tracer.hh"
+
+#include "../inc/include.hh"
+#include "../protocol/CoorCommand.hh"
+#include "../util/RedisUtil.hh"
+
+#include <functional>
+
+using namespace std;
+
+/*
+ * Completion of the persist commands sent by the coordinator
+ *
+ * Agents report each persisted object to coor_finish (CoorCommand type 14). A coordinator
+ * thread registers the objects of a job with watch before it dispatches the commands and
+ * returns, the listener runs the callback of the job once all of them are reported.
+ */
+class CompletionTracker {
+  private:
+    Config* _conf;
+
+    typedef struct {
+      string name;
+      int remaining;
+      function<void()> callback;
+      struct timeval start;
+    } Job;
+
+    mutex _lock;
+    // an object may be written again by a later job before an earlier one finishes,
+    // reports go to its watchers in registration order
+    unordered_map<string, deque<Job*>> _watchers;
+    int _jobNum;
+
+  public:
+    CompletionTracker(Config* conf);
+
+    // callback runs on the listener thread
+    void watch(string name, vector<string> objs, function<void()> callback);
+    void complete(string objname);
+    int getJobNum();
+
+    // pops coor_finish forever
+    void listen();
+};
+
+#endif
@@ -18,7 +18,14 @@ Config::Config(std::string& filepath) {
          size_t pos = tmpstring.find("/");
          std::string rack = tmpstring.substr(0, pos);
          std::string ipstr = tmpstring.substr(pos+1);
+         size_t wpos = ipstr.find(":");
+         double weight = 1;
+         if (wpos != std::string::npos) {
+           weight = std::stod(ipstr.substr(wpos+1));
+           ipstr = ipstr.substr(0, wpos);
+         }
          unsigned int ip = inet_addr(ipstr.c_str());
+         if (weight != 1) _ip2Weight.insert(make_pair(ip, weight));
          _agentsIPs.push_back(ip);
          _ip2Rack.insert(make_pair(ip, rack));
          std::unordered_map<string, std::vector<unsigned int>>::iterator it = _rack2Ips.find(rack);
@@ -34,14 +41,74 @@ Config::Config(std::string& filepath) {
       _agWorkerThreadNum = std::stoi(ele -> NextSiblingElement("value") -> GetText());
     } else if (attName == "oec.controller.thread.num") {
       _coorThreadNum = std::stoi(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "coor.sched.weight" || attName == "coor.sched.reserve") {
+      // comma separated, in the order meta,degraded,write,repair,encode
+      int* values = attName == "coor.sched.weight" ? _coor_sched_weight : _coor_sched_reserve;
+      std::string valtext = ele->NextSiblingElement("value")->GetText();
+      int start = 0;
+      int end = 0;
+      int idx = 0;
+      while (idx < 5 && (end = valtext.find(",", start)) != -1) {
+        values[idx++] = std::stoi(valtext.substr(start, end - start));
+        start = end + 1;
+      }
+      if (idx < 5) values[idx] = std::stoi(valtext.substr(start));
     } else if (attName == "oec.cmddist.thread.num") {
       _distThreadNum = std::stoi(ele -> NextSiblingElement("value") -> GetText());
     } else if (attName == "ec.concurrent.num") {
       _ec_concurrent = std::stoi(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "ec.agent.concurrent") {
+      _ec_agent_concurrent = std::stoi(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "ec.batch.size") {
+      _ec_batch_size = std::stoi(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "ec.batch.window") {
+      _ec_batch_window = std::stoi(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "metrics.port") {
+      _metrics_port = std::stoi(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "metrics.dump.file") {
+      _metrics_dump_file = ele -> NextSiblingElement("value") -> GetText();
+    } else if (attName == "metrics.dump.interval") {
+      _metrics_dump_interval = std::stoi(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "log.level") {
+      _log_level = ele -> NextSiblingElement("value") -> GetText();
+    } else if (attName == "log.file") {
+      _log_file = ele -> NextSiblingElement("value") -> GetText();
+    } else if (attName == "trace.file") {
+      _trace_file = ele -> NextSiblingElement("value") -> GetText();
+    } else if (attName == "client.threads") {
+      _client_threads = std::stoi(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "client.inflight") {
+      _client_inflight = std::stoi(ele -> NextSiblingElement("value") -> GetText());
     } else if (attName == "local.addr") {
       _localIp = inet_addr(ele -> NextSiblingElement("value") -> GetText());
     } else if (attName == "packet.size") {
       _pktSize = std::stoi(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "readahead.size") {
+      _readahead_size = std::stoi(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "readahead.max") {
+      _readahead_max = std::stoi(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "fscache.ttl") {
+      _fscache_ttl = std::stoi(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "fscache.handles") {
+      _fscache_handles = std::stoi(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "offline.read.window") {
+      _offline_read_window = std::stoi(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "metastore.snapshot.records") {
+      _meta_snapshot_records = std::stoi(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "metastore.load.threads") {
+      _meta_load_threads = std::stoi(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "load.decay.halflife") {
+      _load_decay_halflife = std::stoi(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "load.history.weight") {
+      _load_history_weight = std::stod(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "load.hot.threshold") {
+      _load_hot_threshold = std::stoi(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "placement.rack.max") {
+      _placement_rack_max = std::stoi(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "placement.sample.threshold") {
+      _placement_sample_threshold = std::stoi(ele -> NextSiblingElement("value") -> GetText());
+    } else if (attName == "placement.sample.choices") {
+      _placement_sample_choices = std::stoi(ele -> NextSiblingElement("value") -> GetText());
     } else if (attName == "dss.type") {
       _fsType = ele->NextSiblingElement("value")->GetText();
 //    } else if (attName == "control.policy") {
@@ -81,7 +148,7 @@ Config::Config(std::string& filepath) {
         // fstype
         curele = curele->FirstChildElement("fstype");
         if (!curele) {
-          cout << "wrong configuration for fs.factory!" << endl;
+          LOG_ERROR << "wrong configuration for fs.factory!";
           exit(1);
         }
         std::string fstype = curele->GetText();
@@ -89,7 +156,7 @@ Config::Config(std::string& filepath) {
         std::vector<std::string> param;
         curele = curele->NextSiblingElement("param");
         if (!curele) {
-          cout << "wrong configuration for fs.factory!";
+          LOG_ERROR << "wrong configuration for fs.factory!";
           exit(1);
         }
         std::string paramtext = curele->GetText();
@@ -112,35 +179,35 @@ Config::Config(std::string& filepath) {
          // ecid
          curele = curele->FirstChildElement("ecid");
          if (!curele) {
-           cout << "wrong configuration for ec.policy!" << endl;
+           LOG_ERROR << "wrong configuration for ec.policy!";
            exit(1);
          }
          std::string id = curele->GetText();
          // class
          curele = curele->NextSiblingElement("class");
          if (!curele) {
-           cout << "wrong configuration for ec.policy!" << endl;
+           LOG_ERROR << "wrong configuration for ec.policy!";
            exit(1);
          }
          std::string classname = curele->GetText();
          // n
          curele = curele->NextSiblingElement("n");
          if (!curele) {
-           cout << "wrong configuration for ec.policy!" << endl;
+           LOG_ERROR << "wrong configuration for ec.policy!";
            exit(1);
          }
          int n = std::stoi(curele->GetText());
          // k
          curele = curele->NextSiblingElement("k");
          if (!curele) {
-           cout << "wrong configuration for ec.policy!" << endl;
+           LOG_ERROR << "wrong configuration for ec.policy!";
            exit(1);
          }
          int k = std::stoi(curele->GetText());
          // w
          curele = curele->NextSiblingElement("w");
          if (!curele) {
-           cout << "wrong configuration for ec.policy!" << endl;
+           LOG_ERROR << "wrong configuration for ec.policy!";
            exit(1);
          }
          int w = std::stoi(curele->GetText());
@@ -185,14 +252,14 @@ Config::Config(std::string& filepath) {
         // poolid
         curele = curele->FirstChildElement("poolid");
         if (!curele) {
-          cout << "wrong configuration for offline.pool!" << endl;
+          LOG_ERROR << "wrong configuration for offline.pool!";
           exit(1);
         }
         std::string poolid = curele->GetText(); 
         // ecid
         curele = curele->NextSiblingElement("ecid");
         if (!curele) {
-          cout << "wrong configuration for offline.pool!" << endl;
+          LOG_ERROR << "wrong configuration for offline.pool!";
           exit(1);
         }
         std::string ecid = curele->GetText();
@@ -216,6 +283,14 @@ Config::Config(std::string& filepath) {
    }
 
    _fsFactory.insert(make_pair(_fsType, _fsParam));
+
+   // read-ahead window is sliced into packets, keep it a multiple of packet size
+   if (_readahead_size > 0) {
+     if (_readahead_size < _pktSize) _readahead_size = _pktSize;
+     _readahead_size = _readahead_size / _pktSize * _pktSize;
+     if (_readahead_max < _readahead_size) _readahead_max = _readahead_size;
+     _readahead_max = _readahead_max / _pktSize * _pktSize;
+   }
 }
 
 Config::~Config() {
@@ -18,6 +18,8 @@ class Config {
     unsigned int _coorIp;
     std::unordered_map<unsigned int, std::string> _ip2Rack;
     std::unordered_map<string, std::vector<unsigned int>> _rack2Ips;
+    // placement weight of an agent, given as /rack/ip:weight, 1 if absent
+    std::unordered_map<unsigned int, double> _ip2Weight;
 
 //    unsigned int _repairIp;
 //
@@ -27,12 +29,35 @@ class Config {
     //coor thread num
     int _coorThreadNum;
 
+    // coordinator request classes: meta, degraded, write, repair, encode
+    // weights of the fair dequeue and threads reserved for each class
+    int _coor_sched_weight[5] = {8, 4, 4, 2, 1};
+    int _coor_sched_reserve[5] = {1, 1, 0, 0, 0};
+
     //cmddistributor thread num
     int _distThreadNum;
 
     // size
     int _pktSize;
 
+    // read-ahead window of FSObjInputStream in bytes, 0 disables read-ahead
+    int _readahead_size = 4194304;
+    int _readahead_max = 33554432;
+
+    // agent-side cache of open read handles and object sizes, 0 ttl disables it.
+    // An obj is dropped from all workers of an agent when one of them writes or deletes it, and
+    // from all agents when the coordinator learns it is repaired. Changes made behind OEC (e.g.,
+    // deleting objs in the underlying store) are seen by the other agents within ttl
+    int _fscache_ttl = 5000;  // ms
+    int _fscache_handles = 64;
+
+    // number of objects of an offline-encoded file read concurrently
+    int _offline_read_window = 4;
+
+    // coordinator metastore: log records between snapshots (0 disables snapshots) and load threads
+    int _meta_snapshot_records = 100000;
+    int _meta_load_threads = 4;
+
     // fstype
     std::string _fsType;
     std::vector<std::string> _fsParam;
@@ -46,6 +71,12 @@ class Config {
     std::string _data_policy = "random";
     bool _avoid_local = false;
 
+    // placement engine: max objects of a stripe in one rack (0 disables), clusters larger than
+    // the sample threshold draw a few weighted candidates instead of enumerating all agents
+    int _placement_rack_max = 0;
+    int _placement_sample_threshold = 64;
+    int _placement_sample_choices = 2;
+
     // ecpolicymap
     std::unordered_map<std::string, ECPolicy*> _ecPolicyMap;
 
@@ -59,6 +90,33 @@ class Config {
     std::string _repair_scheduling = "normal";  // normal, delay, threshold
     std::string _repair_policy = "random";      // random, balance
     int _repair_threshold = 10;
+
+    // load accounting of placement: half-life (ms) and weight of the assignment history,
+    // agents with as many in-flight tasks as the hot threshold get no encode/repair work (0 disables)
+    int _load_decay_halflife = 60000;
+    double _load_history_weight = 0.1;
+    int _load_hot_threshold = 8;
     int _ec_concurrent; // concurrent stripe num
+    // encode/repair tasks an agent may be involved in at a time, 0 disables the limit
+    int _ec_agent_concurrent = 0;
+    // stripes of a pool encoded by one coordinator request, and stripes an agent runs at a time within it
+    int _ec_batch_size = 8;
+    int _ec_batch_window = 2;
+
+    // metrics export: text endpoint on local.addr (0 disables) and periodic dump file (- disables)
+    int _metrics_port = 0;
+    std::string _metrics_dump_file = "-";
+    int _metrics_dump_interval = 10000;  // ms
+
+    // logging: lowest level written (debug/info/warn/error/off) and log file (- for stdout)
+    std::string _log_level = "info";
+    std::string _log_file = "-";
+
+    // tracing: file the spans of traced encode/repair jobs are appended to (- disables)
+    std::string _trace_file = "-";
+
+    // libopenec: io threads of an OECAsyncClient and operations it keeps at the agent at a time
+    int _client_threads = 4;
+    int _client_inflight = 64;
 };
 #endif
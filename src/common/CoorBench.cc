@@ -1,43 +1,138 @@
 #include "CoorBench.hh"
 
-CoorBench::CoorBench(Config* conf, int benchid, int number) {
+CoorBench::CoorBench(Config* conf, int benchid, int number) :
+  CoorBench(conf, benchid, number, 1, "encode", "all", "") {
+}
+
+CoorBench::CoorBench(Config* conf, int benchid, int number, int clients, string mix, string ecids, string metafile) {
   _conf = conf;
   _id = benchid;
   _number = number;
+  _clients = clients > 0 ? clients : 1;
+  _metafile = metafile;
 
-  redisContext* localCtx = RedisUtil::createContext(_conf->_localIp);
-  redisContext* _coorCtx = RedisUtil::createContext(_conf->_coorIp);
-  redisReply* rReply;
-  _replyid=0;
+  // 0. op[:weight],...
+  _mixWeight = 0;
+  stringstream mixss(mix);
+  string item;
+  while (getline(mixss, item, ',')) {
+    if (item.empty()) continue;
+    string op = item;
+    int weight = 1;
+    size_t pos = item.find(':');
+    if (pos != string::npos) {
+      op = item.substr(0, pos);
+      weight = atoi(item.substr(pos+1).c_str());
+    }
+    if (op == "meta" && _metafile.empty()) {
+      LOG_WARN << "CoorBench::meta needs a metafile, skipped";
+      continue;
+    }
+    if (weight <= 0) continue;
+    _mix.push_back(make_pair(op, weight));
+    _mixWeight += weight;
+  }
 
-  // start client one by one?
-  for (int i=0; i<number; i++) {
-    string benchname = "bench:"+to_string(benchid)+":"+to_string(i);
-    CoorCommand* coorCmd = new CoorCommand();
-    coorCmd->buildType12(12, _conf->_localIp, benchname);
-    coorCmd->sendTo(_coorCtx);
-
-    if (i >= 0) {
-      string benchname = "bench:"+to_string(_id)+":"+to_string(_replyid++);
-      string key="benchfinish:"+benchname;
-      rReply = (redisReply*)redisCommand(localCtx, "blpop %s 0", key.c_str());
-      freeReplyObject(rReply);
+  // 1. ecid,... or all
+  if (ecids == "all") {
+    for (auto ecitem: _conf->_ecPolicyMap) _ecids.push_back(ecitem.first);
+    sort(_ecids.begin(), _ecids.end());
+  } else {
+    stringstream ecss(ecids);
+    while (getline(ecss, item, ',')) {
+      if (_conf->_ecPolicyMap.find(item) == _conf->_ecPolicyMap.end()) {
+        LOG_WARN << "CoorBench::unknown ecid " << item << ", skipped";
+        continue;
+      }
+      _ecids.push_back(item);
     }
+  }
+  if (_mix.size() == 0 || _ecids.size() == 0) {
+    LOG_WARN << "CoorBench::nothing to run";
+    _number = 0;
+  }
 
-    delete coorCmd;
+  // 2. start clients
+  gettimeofday(&_start, NULL);
+  for (int i=0; i<_clients; i++) {
+    _threads.push_back(thread([=]{client(i);}));
   }
-  redisFree(localCtx);
 }
 
-void CoorBench::close() {
-  redisReply* rReply;
+string CoorBench::chooseOp() {
+  int r = rand() % _mixWeight;
+  for (auto item: _mix) {
+    if (r < item.second) return item.first;
+    r -= item.second;
+  }
+  return _mix.back().first;
+}
+
+void CoorBench::client(int clientid) {
   redisContext* localCtx = RedisUtil::createContext(_conf->_localIp);
-  for (int i=_replyid; i<_number; i++) {
+  redisContext* coorCtx = RedisUtil::createContext(_conf->_coorIp);
+  redisReply* rReply;
+
+  unordered_map<string, vector<double>> latency;
+  unordered_map<string, int> failed;
+  // requests are spread over the clients, each client keeps one in flight
+  for (int i=clientid; i<_number; i+=_clients) {
+    string op = chooseOp();
+    string target = op == "meta" ? _metafile : _ecids[i % _ecids.size()];
     string benchname = "bench:"+to_string(_id)+":"+to_string(i);
+    struct timeval time1, time2;
+    gettimeofday(&time1, NULL);
+    CoorCommand* coorCmd = new CoorCommand();
+    coorCmd->buildType12(12, _conf->_localIp, benchname, op, target);
+    coorCmd->sendTo(coorCtx);
+    delete coorCmd;
+
     string key="benchfinish:"+benchname;
     rReply = (redisReply*)redisCommand(localCtx, "blpop %s 0", key.c_str());
+    gettimeofday(&time2, NULL);
+    int tmpval;
+    memcpy((char*)&tmpval, rReply->element[1]->str, 4);
     freeReplyObject(rReply);
+    if (ntohl(tmpval) == 1) latency[op].push_back(RedisUtil::duration(time1, time2));
+    else failed[op]++;
   }
   redisFree(localCtx);
-  redisFree(_coorCtx);
+  redisFree(coorCtx);
+
+  _lock.lock();
+  for (auto item: latency) _latency[item.first].insert(_latency[item.first].end(), item.second.begin(), item.second.end());
+  for (auto item: failed) _failed[item.first] += item.second;
+  _lock.unlock();
+}
+
+void CoorBench::close() {
+  for (int i=0; i<_threads.size(); i++) _threads[i].join();
+  struct timeval end;
+  gettimeofday(&end, NULL);
+  double duration = RedisUtil::duration(_start, end);
+
+  cout << "CoorBench::" << _number << " requests, " << _clients << " clients, duration: " << duration << " ms" << endl;
+  vector<double> all;
+  for (auto item: _mix) {
+    string op = item.first;
+    vector<double>& lat = _latency[op];
+    all.insert(all.end(), lat.begin(), lat.end());
+    sort(lat.begin(), lat.end());
+    if (lat.size() == 0 && _failed[op] == 0) continue;
+    cout << "  " << op << ": " << lat.size() << " done, " << _failed[op] << " failed";
+    if (lat.size() > 0) {
+      cout << ", throughput: " << lat.size() * 1000.0 / duration << " req/s"
+           << ", p50: " << lat[lat.size()*50/100]
+           << " ms, p99: " << lat[lat.size()*99/100]
+           << " ms, p999: " << lat[lat.size()*999/1000] << " ms";
+    }
+    cout << endl;
+  }
+  if (all.size() > 0) {
+    sort(all.begin(), all.end());
+    cout << "  total: " << all.size() << " done, throughput: " << all.size() * 1000.0 / duration << " req/s"
+         << ", p50: " << all[all.size()*50/100]
+         << " ms, p99: " << all[all.size()*99/100]
+         << " ms, p999: " << all[all.size()*999/1000] << " ms" << endl;
+  }
 }
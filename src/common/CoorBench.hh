@@ -5,19 +5,42 @@
 #include "../inc/include.hh"
 #include "../protocol/CoorCommand.hh"
 
+#include <sstream>
+
 using namespace std;
 
+/*
+ * Coordinator throughput benchmark
+ *
+ * Each client thread sends one benchmark request (CoorCommand type 12) at a time and waits for
+ * its benchfinish reply. The op of a request is drawn from the mix by weight, the ecid rotates
+ * over the targets. close() waits for the clients and reports throughput and latency per op.
+ *   mix: op[:weight],... with op in regonline, regoffline, meta, degraded, encode
+ *   ecids: ecid,... or all for every ecid in the configuration
+ *   metafile: file looked up by meta
+ */
 class CoorBench {
   private:
     Config* _conf;
     int _id;
     int _number;
+    int _clients;
+    vector<pair<string, int>> _mix;
+    int _mixWeight;
+    vector<string> _ecids;
+    string _metafile;
+
+    vector<thread> _threads;
+    struct timeval _start;
+    mutex _lock;
+    unordered_map<string, vector<double>> _latency;
+    unordered_map<string, int> _failed;
 
-    redisContext* _localCtx;
-    redisContext* _coorCtx;
-    int _replyid;
+    string chooseOp();
+    void client(int clientid);
   public:
     CoorBench(Config* conf, int id, int number);
+    CoorBench(Config* conf, int id, int number, int clients, string mix, string ecids, string metafile);
     void close();
 };
 
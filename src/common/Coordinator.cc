@@ -1,57 +1,70 @@
 #include "Coordinator.hh"
 
-Coordinator::Coordinator(Config* conf, StripeStore* ss) : _conf(conf) {
+Coordinator::Coordinator(Config* conf, StripeStore* ss, RequestScheduler* scheduler, CompletionTracker* tracker) : _conf(conf) {
   // create local context
   try {
     _localCtx = RedisUtil::createContext(_conf -> _localIp);
   } catch (int e) {
     // TODO: error handling
-    cerr << "initializing redis context to " << " error" << endl;
+    LOG_ERROR << "initializing redis context to " << " error";
   }
   _stripeStore = ss;
+  _scheduler = scheduler;
+  _tracker = tracker;
   _underfs = FSUtil::createFS(_conf->_fsType, _conf->_fsFactory[_conf->_fsType], _conf);
+  _placement = new PlacementEngine(_conf);
   srand((unsigned)time(0));
 }
 
 Coordinator::~Coordinator() {
   redisFree(_localCtx);
+  delete _placement;
 }
 
 void Coordinator::doProcess() {
-  redisReply* rReply;
+  // request latency by type, the histograms are looked up once per coordinator thread
+  unordered_map<int, Histogram*> latency;
+  vector<pair<int, string>> requestNames = {{0, "registerFile"}, {1, "getLocation"}, {2, "finalizeFile"}, {3, "getFileMeta"},
+                                            {4, "offlineEnc"}, {5, "offlineDegradedInst"}, {6, "reportLost"}, {7, "setECStatus"},
+                                            {8, "repairReqFromSS"}, {9, "onlineDegradedInst"}, {11, "reportRepaired"},
+                                            {12, "coorBenchmark"}, {13, "finalizeFileBytes"}, {15, "offlineEncBatch"}};
+  for (auto item: requestNames) latency.insert(make_pair(item.first, Metrics::histogram("coor.request." + item.second)));
+  Counter* requests = Metrics::counter("coor.requests");
+  Gauge* inflight = Metrics::gauge("coor.inflight");
   while (true) {
-    cout << "Coordinator::doProcess" << endl;
+    LOG_DEBUG << "Coordinator::doProcess";
     // will never stop looping
-    rReply = (redisReply*)redisCommand(_localCtx, "blpop coor_request 0");
-    if (rReply -> type == REDIS_REPLY_NIL) {
-      cerr << "Coordinator::doProcess() get feed back empty queue " << endl;
-    } else if (rReply -> type == REDIS_REPLY_ERROR) {
-      cerr << "Coordinator::doProcess() get feed back ERROR happens " << endl;
-    } else {
-      cout << "Coordinator::doProcess() receive a request!" << endl;
-      char* reqStr = rReply -> element[1] -> str;
-      CoorCommand* coorCmd = new CoorCommand(reqStr);
-      coorCmd->dump();
-      int type = coorCmd->getType();
-      switch (type) {
-        case 0: registerFile(coorCmd); break;
-        case 1: getLocation(coorCmd); break;
-        case 2: finalizeFile(coorCmd); break;
-        case 3: getFileMeta(coorCmd); break;
-        case 4: offlineEnc(coorCmd); break;
-        case 5: offlineDegradedInst(coorCmd); break;
-        case 6: reportLost(coorCmd); break;
-        case 7: setECStatus(coorCmd); break;
-        case 8: repairReqFromSS(coorCmd); break;
-        case 9: onlineDegradedInst(coorCmd); break;
-        case 11: reportRepaired(coorCmd); break;
-        case 12: coorBenchmark(coorCmd); break;
-        default: break;
-      }
-      delete coorCmd;
+    int cls;
+    CoorCommand* coorCmd = _scheduler->pop(cls);
+    LOG_DEBUG << "Coordinator::doProcess() receive a request of class " << cls;
+    coorCmd->dump();
+    int type = coorCmd->getType();
+    struct timeval time1, time2;
+    gettimeofday(&time1, NULL);
+    requests->add();
+    inflight->add(1);
+    switch (type) {
+      case 0: registerFile(coorCmd); break;
+      case 1: getLocation(coorCmd); break;
+      case 2: finalizeFile(coorCmd); break;
+      case 3: getFileMeta(coorCmd); break;
+      case 4: offlineEnc(coorCmd); break;
+      case 5: offlineDegradedInst(coorCmd); break;
+      case 6: reportLost(coorCmd); break;
+      case 7: setECStatus(coorCmd); break;
+      case 8: repairReqFromSS(coorCmd); break;
+      case 9: onlineDegradedInst(coorCmd); break;
+      case 11: reportRepaired(coorCmd); break;
+      case 12: coorBenchmark(coorCmd); break;
+      case 13: finalizeFile(coorCmd); break;
+      case 15: offlineEncBatch(coorCmd); break;
+      default: break;
     }
-    // free reply object
-    freeReplyObject(rReply);
+    gettimeofday(&time2, NULL);
+    inflight->add(-1);
+    if (latency.find(type) != latency.end()) latency[type]->record(RedisUtil::duration(time1, time2));
+    delete coorCmd;
+    _scheduler->done(cls);
   }
 }
 
@@ -94,16 +107,7 @@ void Coordinator::registerOnlineEC(unsigned int clientIp, string filename, strin
     objnames.push_back(obj);
     vector<int> colocWith;
     if (idx2group.find(i) != idx2group.end()) colocWith = idx2group[i];
-    vector<unsigned int> candidates = getCandidates(ips, placed, colocWith);
-    unsigned int curIp; // choose from candidates
-    if (_conf->_avoid_local) {
-      vector<unsigned int>::iterator position = find(candidates.begin(), candidates.end(), clientIp);
-      if (position != candidates.end()) candidates.erase(position);
-      curIp = chooseFromCandidates(candidates, _conf->_data_policy, "data");
-    } else {
-      if (find(candidates.begin(), candidates.end(), clientIp) != candidates.end()) curIp = clientIp;
-      else curIp = chooseFromCandidates(candidates, _conf->_data_policy, "data");
-    }
+    unsigned int curIp = placeData(clientIp, ips, placed, colocWith, filename);
     placed.push_back(i);
     ips.push_back(curIp);
   }
@@ -114,9 +118,7 @@ void Coordinator::registerOnlineEC(unsigned int clientIp, string filename, strin
   // 6. parse ECDAG and create commands for online encoding
   ECDAG* ecdag = ec->Encode();  
   vector<int> toposeq = ecdag->toposort();
-  cout << "toposeq: ";
-  for (int i=0; i<toposeq.size(); i++) cout << toposeq[i] << " ";
-  cout << endl;
+  LOG_DEBUG << "toposeq: " << logList(toposeq);
 
   // for online encoding, we assume k load tasks for original data
   // n persist tasks for encoded-obj 
@@ -145,7 +147,7 @@ void Coordinator::registerOnlineEC(unsigned int clientIp, string filename, strin
 }
 
 void Coordinator::registerOfflineEC(unsigned int clientIp, string filename, string ecpoolid, int filesizeMB) {
-  cout << "Coordinator::registerOfflineEC" << endl;
+  LOG_DEBUG << "Coordinator::registerOfflineEC";
   struct timeval time1, time2, time3, time4;
   // 0. make sure that there is no existing ssentry
   assert (!_stripeStore->existEntry(filename));
@@ -228,16 +230,7 @@ void Coordinator::registerOfflineEC(unsigned int clientIp, string filename, stri
     int stripeidx = stripeplaced.size();
     vector<int> colocWith;
     if (idx2group.find(stripeidx) != idx2group.end()) colocWith = idx2group[stripeidx];
-    vector<unsigned int> candidates = getCandidates(stripeips, stripeplaced, colocWith);
-    unsigned int curIp; // choose from candidates
-    if (_conf->_avoid_local) {
-      vector<unsigned int>::iterator position = find(candidates.begin(), candidates.end(), clientIp);
-      if (position != candidates.end()) candidates.erase(position);
-      curIp = chooseFromCandidates(candidates, _conf->_data_policy, "data");
-    } else {
-      if (find(candidates.begin(), candidates.end(), clientIp) != candidates.end()) curIp = clientIp;
-      else curIp = chooseFromCandidates(candidates, _conf->_data_policy, "data");
-    }
+    unsigned int curIp = placeData(clientIp, stripeips, stripeplaced, colocWith, filename);
 
     // 1.3 now we have preassigned a location for this objname, add to fileobjlocs
     fileobjlocs.push_back(curIp);
@@ -264,99 +257,79 @@ void Coordinator::registerOfflineEC(unsigned int clientIp, string filename, stri
   delete ec;
 }
 
-vector<unsigned int> Coordinator::getCandidates(vector<unsigned int> placedIp, vector<int> placedIdx, vector<int> colocWith) {
-  vector<unsigned int> toret;
-  // 0. check colocWith
-  // candidate should be within the same rack
-  for (int i=0; i<colocWith.size(); i++) {
-    int curIdx = colocWith[i];
-    // check whether this idx has been placed
-    // if this idx has been placed
-    if (placedIp.size() > curIdx) {
-      // then figure out 
-      unsigned int curIp = placedIp[curIdx];
-      // find corresponding rack for this ip
-      string rack = _conf->_ip2Rack[curIp];
-      // for all the ip in this rack, if :
-      // 1> this ip is not in toret
-      // 2> this ip is not in placedId
-      for (auto item:_conf->_rack2Ips[rack]) {
-        if (find(toret.begin(), toret.end(), item) == toret.end() && 
-            find(placedIp.begin(), placedIp.end(), item) == placedIp.end()) toret.push_back(item);
-      }
-    }
-  }
-  // if there is no constraints in colocWith, we add all ips into toret except for placedIp
-  if (toret.size() == 0) {
-    for (auto item:_conf->_agentsIPs) {
-      if (find(placedIp.begin(), placedIp.end(), item) == placedIp.end()) toret.push_back(item);
-    }
-  }
+vector<unsigned int> Coordinator::getCandidates(vector<unsigned int> placedIp, vector<int> placedIdx, vector<int> colocWith,
+                                                vector<unsigned int> exclude) {
+  // colocWith is checked against the racks of placed objects, placedIp never gets a second object
+  vector<unsigned int> toret = _placement->candidates(placedIp, colocWith, exclude);
   return toret; 
 }
 
-unsigned int Coordinator::chooseFromCandidates(vector<unsigned int> candidates, string policy, string type) {
-  if (policy == "random") {
+unsigned int Coordinator::placeData(unsigned int clientIp, vector<unsigned int> placedIp, vector<int> placedIdx,
+                                    vector<int> colocWith, string task, bool account) {
+  // the client keeps the object if it is a valid location, unless avoid_local is set
+  if (!_conf->_avoid_local && _placement->eligible(clientIp, placedIp, colocWith)) return clientIp;
+  vector<unsigned int> exclude;
+  if (_conf->_avoid_local) exclude.push_back(clientIp);
+  vector<unsigned int> candidates = getCandidates(placedIp, placedIdx, colocWith, exclude);
+  if (candidates.size() == 0) candidates = getCandidates(placedIp, placedIdx, colocWith);
+  return chooseFromCandidates(candidates, _conf->_data_policy, "data", task, account);
+}
+
+unsigned int Coordinator::chooseFromCandidates(vector<unsigned int> candidates, string policy, string type, string task,
+                                               bool account) {
+  int loadclass;
+  if (type == "control") loadclass = LOAD_CONTROL;
+  else if (type == "data") loadclass = LOAD_DATA;
+  else if (type == "repair") loadclass = LOAD_REPAIR;
+  else if (type == "encode") loadclass = LOAD_ENCODE;
+  else {
     int randomidx = rand() % candidates.size();
     return candidates[randomidx];
   }
   assert (candidates.size() > 0);
-  if (type == "control") {
-    int minload = _stripeStore->getControlLoad(candidates[0]);
-    unsigned int minip = candidates[0];
-    for (int i=1; i<candidates.size(); i++) {
-      unsigned int ip = candidates[i];
-      int load = _stripeStore->getControlLoad(ip);
-      if (load < minload) {
-        minload = load;
-        minip = ip;
-      }
+  bool avoidHot = (loadclass == LOAD_REPAIR || loadclass == LOAD_ENCODE) && _conf->_load_hot_threshold > 0;
+
+  // large candidate sets: compare a few random agents instead of the load of all of them
+  if (candidates.size() > _conf->_placement_sample_threshold) {
+    vector<unsigned int> sampled;
+    int attempts = _conf->_placement_sample_choices * 16;
+    for (int i=0; i<attempts && sampled.size() < _conf->_placement_sample_choices; i++) {
+      unsigned int ip = candidates[rand() % candidates.size()];
+      if (find(sampled.begin(), sampled.end(), ip) != sampled.end()) continue;
+      if (avoidHot && _stripeStore->getInflight(ip) >= _conf->_load_hot_threshold) continue;
+      sampled.push_back(ip);
     }
-    _stripeStore->increaseControlLoadMap(minip, 1);
-    return minip;
-  } else if (type == "data") {
-    int minload = _stripeStore->getDataLoad(candidates[0]);
-    unsigned int minip = candidates[0];
-    for (int i=1; i<candidates.size(); i++) {
-      unsigned int ip = candidates[i];
-      int load = _stripeStore->getDataLoad(ip);
-      if (load < minload) {
-        minload = load;
-        minip = ip;
-      }
-    }
-    _stripeStore->increaseDataLoadMap(minip, 1);
-    return minip;
-  } else if (type == "repair") {
-    int minload = _stripeStore->getRepairLoad(candidates[0]);
-    unsigned int minip = candidates[0];
-    for (int i=1; i<candidates.size(); i++) {
-      unsigned int ip = candidates[i];
-      int load = _stripeStore->getRepairLoad(ip);
-      if (load < minload) {
-        minload = load;
-        minip = ip;
-      }
+    if (sampled.size() > 0) candidates = sampled;
+  }
+
+  // hot agents get no new encode and repair work, unless all candidates are hot
+  if (avoidHot) {
+    vector<unsigned int> cooled;
+    for (auto ip: candidates) {
+      if (_stripeStore->getInflight(ip) < _conf->_load_hot_threshold) cooled.push_back(ip);
     }
-    _stripeStore->increaseRepairLoadMap(minip, 1);
-    return minip;
-  } else if (type == "encode") {
-    int minload = _stripeStore->getEncodeLoad(candidates[0]);
-    unsigned int minip = candidates[0];
+    if (cooled.size() > 0) candidates = cooled;
+  }
+
+  unsigned int minip;
+  if (policy == "random") {
+    int randomidx = rand() % candidates.size();
+    minip = candidates[randomidx];
+  } else {
+    double minload = _stripeStore->getLoad(candidates[0], loadclass);
+    minip = candidates[0];
     for (int i=1; i<candidates.size(); i++) {
       unsigned int ip = candidates[i];
-      int load = _stripeStore->getEncodeLoad(ip);
+      double load = _stripeStore->getLoad(ip, loadclass);
       if (load < minload) {
         minload = load;
         minip = ip;
       }
     }
-    _stripeStore->increaseEncodeLoadMap(minip, 1);
-    return minip;
-  } else {
-    int randomidx = rand() % candidates.size();
-    return candidates[randomidx];
   }
+  // the load is accounted for every policy, so that in-flight tasks are known to the others
+  if (account) _stripeStore->addLoad(minip, loadclass, 1, task);
+  return minip;
 }
 
 void Coordinator::getLocation(CoorCommand* coorCmd) {
@@ -382,7 +355,7 @@ void Coordinator::getLocation(CoorCommand* coorCmd) {
       vector<unsigned int> ips = ssentry->getObjloc();
       toret[0] = ips[idx];
     } else {
-      cout << "Coordinator::getLocation.ssentry for " << filename << " does not exist!!!" << endl;
+      LOG_DEBUG << "Coordinator::getLocation.ssentry for " << filename << " does not exist!!!";
     }
   } else if (objname.find("oecstripe") != string::npos) {
     // placement request for an oec parity object
@@ -395,11 +368,11 @@ void Coordinator::getLocation(CoorCommand* coorCmd) {
     toret[0] = chooseFromCandidates(candidates, "random", "other");
   }
 
-  cout << "Coordinator::getLocation.return: ";
-  for (int i=0; i<numOfReplicas; i++) {
-    cout << RedisUtil::ip2Str(toret[i]) << " ";
+  if (LOG_ENABLED(LOG_LEVEL_DEBUG)) {
+    vector<string> locs;
+    for (int i=0; i<numOfReplicas; i++) locs.push_back(RedisUtil::ip2Str(toret[i]));
+    LOG_DEBUG << "Coordinator::getLocation.return: " << logList(locs);
   }
-  cout << endl;
   // last. return ip
   redisReply* rReply;
   redisContext* clientCtx = RedisUtil::createContext(_conf->_coorIp);
@@ -415,6 +388,10 @@ void Coordinator::finalizeFile(CoorCommand* coorCmd) {
   // 0. given filename, get ssentry for this file
   SSEntry* ssentry = _stripeStore->getEntry(filename);
   assert(ssentry != NULL);
+  // type 13 carries the exact length written by the agent
+  if (coorCmd->getType() == 13) ssentry->setFilesizeB(coorCmd->getFilesizeB());
+  // the data load of the write is no longer in flight
+  _stripeStore->finishTaskLoad(filename);
   int type = ssentry->getType();
   if (type == 1) {
      // offline encoding
@@ -430,7 +407,7 @@ void Coordinator::finalizeFile(CoorCommand* coorCmd) {
       ecpool->finalizeObj(objname);
       string stripename = ecpool->getStripeForObj(objname);
       if (ecpool->isCandidateForEC(stripename)) {
-        cout << "Coordinator::finalizeFile. stripe " << stripename << "is candidate for ec " << endl;
+        LOG_DEBUG << "Coordinator::finalizeFile. stripe " << stripename << "is candidate for ec ";
         _stripeStore->addEncodeCandidate(ecpoolid, stripename);
       }
     }
@@ -438,25 +415,11 @@ void Coordinator::finalizeFile(CoorCommand* coorCmd) {
   }
 
   // backup this ssentry
-  _stripeStore->backupEntry(ssentry->toString());
+  _stripeStore->backupEntry(ssentry);
 }
 
-void Coordinator::offlineEnc(CoorCommand* coorCmd) {
-  string ecpoolid = coorCmd->getECPoolId();
-  string stripename = coorCmd->getStripeName();
-  cout << "Coordinator::offlineEnc start for " << stripename << endl; 
-
-  // 0. given ecpoolid, get OfflineECPool
-  OfflineECPool* ecpool = _stripeStore->getECPool(ecpoolid); 
-  ecpool->lock();
-  ECPolicy* ecpolicy = ecpool->getEcpolicy(); 
-  ECBase* ec = ecpolicy->createECClass();
-  int n = ecpolicy->getN();
-  int k = ecpolicy->getK();
-  int w = ecpolicy->getW(); 
-  bool locality = ecpolicy->getLocality();
-  int opt = ecpolicy->getOpt();
-
+vector<unsigned int> Coordinator::placeParity(ECBase* ec, int n, int k, vector<unsigned int> stripeips,
+                                              string task, bool account) {
   vector<vector<int>> group;
   ec->Place(group);
   unordered_map<int, vector<int>> idx2group;
@@ -465,12 +428,86 @@ void Coordinator::offlineEnc(CoorCommand* coorCmd) {
       idx2group.insert(make_pair(idx, item));
     }
   }
+  vector<int> stripeplaced;
+  for (int i=0; i<stripeips.size(); i++) stripeplaced.push_back(i);
+
+  vector<unsigned int> toret;
+  for (int i=k; i<n; i++) {
+    vector<int> colocWith;
+    if (idx2group.find(i) != idx2group.end()) colocWith = idx2group[i];
+    vector<unsigned int> candidates = getCandidates(stripeips, stripeplaced, colocWith);
+    unsigned int loc = chooseFromCandidates(candidates, _conf->_data_policy, "data", task, account);
+    toret.push_back(loc);
+    stripeips.push_back(loc);
+    stripeplaced.push_back(i);
+  }
+  return toret;
+}
+
+vector<AGCommand*> Coordinator::planEncodeCmds(ECPolicy* ecpolicy, ECBase* ec, string stripename, int pktnum,
+                                               unordered_map<int, pair<string, unsigned int>>& objlist,
+                                               unordered_map<int, unsigned int>& sid2ip,
+                                               vector<AGCommand*>& persistCmds, string task, bool account) {
+  int n = ecpolicy->getN();
+  int k = ecpolicy->getK();
+  int w = ecpolicy->getW(); 
+  bool locality = ecpolicy->getLocality();
+  int opt = ecpolicy->getOpt();
 
   // 1. encode ecdag
   ECDAG* ecdag = ec->Encode();
   ecdag->reconstruct(opt);
 
-  // 2. collect physical information
+  // 2. topological sorting
+  vector<int> sortedList = ecdag->toposort();
+
+  // 3. figure out corresponding ip for corresponding node
+  unordered_map<int, unsigned int> cid2ip;
+  for (int i=0; i<sortedList.size(); i++) {
+    int cidx = sortedList[i];
+    ECNode* node = ecdag->getNode(cidx);
+    vector<unsigned int> candidates = node->candidateIps(sid2ip, cid2ip, _conf->_agentsIPs, n, k, w, locality);
+    // choose from candidates
+    unsigned int curip = chooseFromCandidates(candidates, _conf->_encode_policy, "encode", task, account);
+    cid2ip.insert(make_pair(cidx, curip));
+  }
+
+  // optimize
+  ecdag->optimize2(opt, cid2ip, _conf->_ip2Rack, n, k, w, sid2ip, _conf->_agentsIPs, locality);
+  ecdag->dump();
+
+  // 4. parse for oec
+  unordered_map<int, AGCommand*> agCmds = ecdag->parseForOEC(cid2ip, stripename, n, k, w, pktnum, objlist);
+
+  // 5. add persist cmd
+  persistCmds = ecdag->persist(cid2ip, stripename, n, k, w, pktnum, objlist);
+
+  // 6. commands in the order an agent runs them: load and compute in topological order, then persist
+  vector<AGCommand*> toret;
+  for (auto cidx: sortedList) {
+    unordered_map<int, AGCommand*>::iterator it = agCmds.find(cidx);
+    if (it != agCmds.end() && it->second) toret.push_back(it->second);
+  }
+  for (auto agcmd: persistCmds) if (agcmd) toret.push_back(agcmd);
+
+  // free
+  delete ecdag;
+  return toret;
+}
+
+vector<AGCommand*> Coordinator::planOfflineEnc(OfflineECPool* ecpool, ECBase* ec, string stripename, string traceid) {
+  LOG_DEBUG << "Coordinator::offlineEnc start for " << stripename; 
+  string ecpoolid = ecpool->getECPoolId();
+  string task = "encode:"+stripename;
+  long planStart = Tracer::now();
+
+  // 0. the ec instance of the pool is shared by the stripes of a job
+  ecpool->lock();
+  ECPolicy* ecpolicy = ecpool->getEcpolicy(); 
+  int n = ecpolicy->getN();
+  int k = ecpolicy->getK();
+
+  // 1. collect physical information
   // stripeidx -> {objname, location}
   unordered_map<int, pair<string, unsigned int>> objlist;
   // stripeidx -> location
@@ -479,18 +516,12 @@ void Coordinator::offlineEnc(CoorCommand* coorCmd) {
   vector<string> stripelist = ecpool->getStripeObjList(stripename); 
   // location for current stripe, indexed by stripe idx (now we only have source locations)
   vector<unsigned int> stripeips;
-  // stripeplaced records the objnames that have been stored in this stripe
-  vector<int> stripeplaced;
- 
-//  cout << "Coordinator::offlineEnc.encode stripe " << stripename << ", objlist: ";
-//  for (int i=0; i<stripelist.size(); i++) cout << stripelist[i] << " ";
-//  cout << endl;
 
   // maximum obj size in current stripe
   int basesizeMB = ecpool->getBasesize();
   int pktnum = basesizeMB * 1048576/_conf->_pktSize;
   
-  // 2.1 get physical information for k source objs
+  // 1.1 get physical information for k source objs
   for (int i=0; i<stripelist.size(); i++) {
     int sid = i;
     string objname = stripelist[i];
@@ -501,23 +532,16 @@ void Coordinator::offlineEnc(CoorCommand* coorCmd) {
     objlist.insert(make_pair(sid, curpair));
     sid2ip.insert(make_pair(sid, loc));
     stripeips.push_back(loc);
-    stripeplaced.push_back(i);
   }
-  // 2.2 prepare physical information for m parity objs
+  // 1.2 prepare physical information for m parity objs
+  vector<unsigned int> parityips = placeParity(ec, n, k, stripeips, task);
   vector<string> parityobj;
   for (int i=k; i<n; i++) {
     string objname = "/"+ecpoolid+"-"+stripename+"-"+to_string(i);
+    unsigned int loc = parityips[i-k];
     parityobj.push_back(objname);
-    vector<int> colocWith;
-    if (idx2group.find(i) != idx2group.end()) colocWith = idx2group[i];
-    vector<unsigned int> candidates = getCandidates(stripeips, stripeplaced, colocWith);
-    unsigned int loc = chooseFromCandidates(candidates, _conf->_data_policy, "data");
-    pair<string, unsigned int> curpair = make_pair(objname, loc);
-
-    objlist.insert(make_pair(i, curpair));
+    objlist.insert(make_pair(i, make_pair(objname, loc)));
     sid2ip.insert(make_pair(i, loc));
-    stripeips.push_back(loc);
-    stripeplaced.push_back(i);
 
     // add parity obj to ecpool
     ecpool->addObj(objname, stripename);
@@ -527,76 +551,101 @@ void Coordinator::offlineEnc(CoorCommand* coorCmd) {
   }
   ecpool->unlock();
 
-  // debug info
-//  for (auto item: objlist) {
-//    int sid = item.first;
-//    pair<string, unsigned int> pair = item.second;
-//    string objname = pair.first;
-//    unsigned int ip = pair.second;
-//    cout << "stripe physical info: idx: " << sid << ", objname: " << objname << ", ip: " << RedisUtil::ip2Str(ip) << endl;
-//  }
-  
-  // 4. topological sorting
-  vector<int> sortedList = ecdag->toposort();
+  // 2. plan the ecdag on the stripe
+  vector<AGCommand*> persistCmds;
+  vector<AGCommand*> toret = planEncodeCmds(ecpolicy, ec, stripename, pktnum, objlist, sid2ip, persistCmds, task);
 
-  // 5. figure out corresponding ip for corresponding node
-  unordered_map<int, unsigned int> cid2ip;
-  for (int i=0; i<sortedList.size(); i++) {
-    int cidx = sortedList[i];
-    ECNode* node = ecdag->getNode(cidx);
-    vector<unsigned int> candidates = node->candidateIps(sid2ip, cid2ip, _conf->_agentsIPs, n, k, w, locality);
-    // choose from candidates
-    unsigned int curip = chooseFromCandidates(candidates, _conf->_encode_policy, "encode");
-    cid2ip.insert(make_pair(cidx, curip));
-  }
+  // 3. the completion listener finishes the stripe once the parity objects are persisted
+  vector<string> persistObjs;
+  for (auto agcmd: persistCmds) {
+    if (agcmd && agcmd->getShouldSend()) persistObjs.push_back(agcmd->getWriteObjName());
+  }
+  StripeStore* stripeStore = _stripeStore;
+  _tracker->watch(task, persistObjs, [=]{
+    LOG_DEBUG << "Coordinator::offlineEnc for " << stripename << " finishes";
+    Tracer::record(traceid, "encode", stripename, ecpoolid, planStart, Tracer::now());
+    stripeStore->finishECStripe(ecpool, stripename);
+    // backup entry for parity obj
+    for (int i=0; i<parityobj.size(); i++) {
+      SSEntry* curentry = stripeStore->getEntryFromObj(parityobj[i]);
+      stripeStore->backupEntry(curentry);
+    }
+  });
 
-  // optimize
-  ecdag->optimize2(opt, cid2ip, _conf->_ip2Rack, n, k, w, sid2ip, _conf->_agentsIPs, locality);
-  ecdag->dump();
+  for (auto agcmd: toret) agcmd->setTraceId(traceid);
+  Tracer::record(traceid, "plan", stripename, ecpoolid, planStart, Tracer::now());
+  return toret;
+}
+
+void Coordinator::offlineEnc(CoorCommand* coorCmd) {
+  string ecpoolid = coorCmd->getECPoolId();
+  vector<string> stripenames;
+  stripenames.push_back(coorCmd->getStripeName());
+  encodeStripes(ecpoolid, stripenames, coorCmd->getTraceId());
+}
 
-//  for (auto item: cid2ip) {
-//    cout << "cid: " << item.first << ", ip: " << RedisUtil::ip2Str(item.second) << endl;
-//  }
+void Coordinator::offlineEncBatch(CoorCommand* coorCmd) {
+  encodeStripes(coorCmd->getECPoolId(), coorCmd->getStripeNames(), coorCmd->getTraceId());
+}
 
-  // 6. parse for oec
-  unordered_map<int, AGCommand*> agCmds = ecdag->parseForOEC(cid2ip, stripename, n, k, w, pktnum, objlist);
+void Coordinator::encodeStripes(string ecpoolid, vector<string> stripenames, string traceid) {
+  struct timeval time1, time2;
+  gettimeofday(&time1, NULL);
+  OfflineECPool* ecpool = _stripeStore->getECPool(ecpoolid); 
+  ECBase* ec = ecpool->getEcpolicy()->createECClass();
+
+  // 1. plan each stripe, commands are grouped by agent in stripe order
+  vector<AGCommand*> agCmds;
+  vector<unsigned int> agents;
+  unordered_map<unsigned int, vector<AGCommand*>> agent2cmds;
+  for (auto stripename: stripenames) {
+    vector<AGCommand*> cmds = planOfflineEnc(ecpool, ec, stripename, traceid);
+    for (auto agcmd: cmds) {
+      agCmds.push_back(agcmd);
+      if (!agcmd->getShouldSend()) continue;
+      unsigned int ip = agcmd->getSendIp();
+      if (agent2cmds.find(ip) == agent2cmds.end()) agents.push_back(ip);
+      agent2cmds[ip].push_back(agcmd);
+    }
+  }
 
-  // 7. add persist cmd
-  vector<AGCommand*> persistCmds = ecdag->persist(cid2ip, stripename, n, k, w, pktnum, objlist);
+  // 2. a single stripe sends its commands as they are, a batch sends each agent one command per
+  // MAX_COMMAND_LEN, which runs the stripes in order
+  vector<pair<unsigned int, AGCommand*>> tosend;
+  vector<AGCommand*> batchCmds;
+  for (auto ip: agents) {
+    vector<AGCommand*>& cmds = agent2cmds[ip];
+    if (stripenames.size() == 1) {
+      for (auto agcmd: cmds) tosend.push_back(make_pair(ip, agcmd));
+      continue;
+    }
+    AGCommand* batch = NULL;
+    for (auto agcmd: cmds) {
+      if (batch == NULL || !batch->addBatchCmd(agcmd)) {
+        batch = new AGCommand();
+        batch->buildType12(12, ip);
+        batchCmds.push_back(batch);
+        tosend.push_back(make_pair(ip, batch));
+        batch->addBatchCmd(agcmd);
+      }
+    }
+  }
 
-  // 8. send commands to cmddistributor
+  // 3. send commands to cmddistributor
+  long dispatchStart = Tracer::now();
   vector<char*> todelete;
   redisContext* distCtx = RedisUtil::createContext(_conf->_coorIp);
 
   redisAppendCommand(distCtx, "MULTI");
-  for (auto item: agCmds) {
-    auto agcmd = item.second;
-    if (agcmd == NULL) continue;
-    unsigned int ip = agcmd->getSendIp();
-    ip = htonl(ip);
-    if (agcmd->getShouldSend()) {
-      char* cmdstr = agcmd->getCmd();
-      int cmLen = agcmd->getCmdLen();
-      char* todist = (char*)calloc(cmLen + 4, sizeof(char));
-      memcpy(todist, (char*)&ip, 4);
-      memcpy(todist+4, cmdstr, cmLen); 
-      todelete.push_back(todist);
-      redisAppendCommand(distCtx, "RPUSH dist_request %b", todist, cmLen+4);
-    }
-  }
-  for (auto agcmd: persistCmds) {
-    if (agcmd == NULL) continue;
-    unsigned int ip = agcmd->getSendIp();
-    ip = htonl(ip);
-    if (agcmd->getShouldSend()) {
-      char* cmdstr = agcmd->getCmd();
-      int cmLen = agcmd->getCmdLen();
-      char* todist = (char*)calloc(cmLen + 4, sizeof(char));
-      memcpy(todist, (char*)&ip, 4);
-      memcpy(todist+4, cmdstr, cmLen); 
-      todelete.push_back(todist);
-      redisAppendCommand(distCtx, "RPUSH dist_request %b", todist, cmLen+4);
-    }
+  for (auto item: tosend) {
+    unsigned int ip = htonl(item.first);
+    char* cmdstr = item.second->getCmd();
+    int cmLen = item.second->getCmdLen();
+    char* todist = (char*)calloc(cmLen + 4, sizeof(char));
+    memcpy(todist, (char*)&ip, 4);
+    memcpy(todist+4, cmdstr, cmLen); 
+    todelete.push_back(todist);
+    redisAppendCommand(distCtx, "RPUSH dist_request %b", todist, cmLen+4);
   }
   redisAppendCommand(distCtx, "EXEC");
 
@@ -611,29 +660,15 @@ void Coordinator::offlineEnc(CoorCommand* coorCmd) {
   freeReplyObject(distReply);
   redisFree(distCtx);
   
-  // 9. wait for finish flag?
-  for (auto agcmd: persistCmds) {
-    unsigned int ip = agcmd->getSendIp(); 
-    redisContext* waitCtx = RedisUtil::createContext(ip);
-    string wkey = "writefinish:"+agcmd->getWriteObjName();
-    redisReply* fReply = (redisReply*)redisCommand(waitCtx, "blpop %s 0", wkey.c_str());
-    freeReplyObject(fReply);
-    redisFree(waitCtx);
-  }
-  cout << "Coordinator::offlineEnc for " << stripename << " finishes" << endl;
-  _stripeStore->finishECStripe(ecpool, stripename);
-
-  // backup entry for parity obj
-  for (int i=0; i<parityobj.size(); i++) {
-    SSEntry* curentry = _stripeStore->getEntryFromObj(parityobj[i]);
-    _stripeStore->backupEntry(curentry->toString());
-  }
+  gettimeofday(&time2, NULL);
+  Tracer::record(traceid, "dispatch", stripenames.size() == 1 ? stripenames[0] : "", ecpoolid, dispatchStart, Tracer::now());
+  LOG_DEBUG << "Coordinator::encodeStripes dispatched " << stripenames.size() << " stripes of " << ecpoolid
+       << " in " << tosend.size() << " commands, duration: " << RedisUtil::duration(time1, time2);
   
   // free
-  delete ecdag;
   delete ec; 
-  for (auto item: agCmds) if (item.second) delete item.second;
-  for (auto item: persistCmds) if (item) delete item;
+  for (auto item: agCmds) delete item;
+  for (auto item: batchCmds) delete item;
   for (auto item: todelete) free(item);
 }
 
@@ -644,23 +679,40 @@ void Coordinator::setECStatus(CoorCommand* coorCmd) {
 }
 
 void Coordinator::getFileMeta(CoorCommand* coorCmd) {
-  cout << "Coordinator::getFileMeta" << endl;
+  LOG_DEBUG << "Coordinator::getFileMeta";
   struct timeval time1, time2;
   gettimeofday(&time1, NULL);
   string filename = coorCmd->getFilename();
   unsigned int clientip = coorCmd->getClientip();
 
-  // online:  |type|filesizeMB|ecn|eck|ecw|
-  // offline: |type|filesizeMB|objnum|
-
   // 0. getssentry
   SSEntry* ssentry = _stripeStore->getEntry(filename);
-  assert(ssentry != NULL);
-  int redundancy = ssentry->getType();
-  int filesizeMB = ssentry->getFilesizeMB();
-  // 1. type
   char* filemeta = (char*)calloc(1024, sizeof(char));
   string key = "filemeta:"+filename;
+  int metaoff;
+  if (ssentry != NULL) {
+    metaoff = buildFileMeta(ssentry, filemeta);
+  } else {
+    // not found: |-1|-1|0|0|0| in the offline layout, filemeta is zeroed
+    LOG_WARN << "Coordinator::getFileMeta." << filename << " not found";
+    int tmpval = htonl(-1);
+    memcpy(filemeta, (char*)&tmpval, 4);
+    memcpy(filemeta + 4, (char*)&tmpval, 4);
+    metaoff = 20;
+  }
+
+  redisContext* sendCtx = RedisUtil::createContext(clientip);
+  redisReply* rReply = (redisReply*)redisCommand(sendCtx, "RPUSH %s %b", key.c_str(), filemeta, metaoff);
+  freeReplyObject(rReply);
+  redisFree(sendCtx);
+  free(filemeta);
+}
+
+int Coordinator::buildFileMeta(SSEntry* ssentry, char* filemeta) {
+  // online:  |type|filesizeMB|ecn|eck|ecw|filesizeB|
+  // offline: |type|filesizeMB|objnum|filesizeB|
+  int redundancy = ssentry->getType();
+  int filesizeMB = ssentry->getFilesizeMB();
   int metaoff = 0;
   // 1.1 redundancy type
   int tmpr = htonl(redundancy);
@@ -694,15 +746,17 @@ void Coordinator::getFileMeta(CoorCommand* coorCmd) {
     int tmpnum = htonl(numobjs);
     memcpy(filemeta + metaoff, (char*)&tmpnum, 4); metaoff += 4;
   }
-
-  redisContext* sendCtx = RedisUtil::createContext(clientip);
-  redisReply* rReply = (redisReply*)redisCommand(sendCtx, "RPUSH %s %b", key.c_str(), filemeta, metaoff);
-  freeReplyObject(rReply);
-  redisFree(sendCtx);
+  // exact filesize in bytes, high 32 bits first
+  long filesizeB = ssentry->getFilesizeB();
+  int tmphigh = htonl((int)((unsigned long)filesizeB >> 32));
+  memcpy(filemeta + metaoff, (char*)&tmphigh, 4); metaoff += 4;
+  int tmplow = htonl((int)(filesizeB & 0xffffffff));
+  memcpy(filemeta + metaoff, (char*)&tmplow, 4); metaoff += 4;
+  return metaoff;
 }
 
 void Coordinator::onlineDegradedInst(CoorCommand* coorCmd) {
-  cout << "Coordinator::onlineDegradedInst" << endl;
+  LOG_DEBUG << "Coordinator::onlineDegradedInst";
   struct timeval time1, time2, time3, time4;
   gettimeofday(&time1, NULL);
   string filename = coorCmd->getFilename();
@@ -757,9 +811,7 @@ void Coordinator::onlineDegradedInst(CoorCommand* coorCmd) {
   // obtain decode ecdag
   ECDAG* ecdag = ec->Decode(availcidx, toreccidx);
   vector<int> toposeq = ecdag->toposort();
-  cout << "toposeq: ";
-  for (int i=0; i<toposeq.size(); i++) cout << toposeq[i] << " ";
-  cout << endl;
+  LOG_DEBUG << "toposeq: " << logList(toposeq);
    
   // prepare for load tasks
   vector<int> leaves = ecdag->getLeaves();
@@ -845,28 +897,12 @@ void Coordinator::offlineDegradedInst(CoorCommand* coorCmd) {
   ecpool->unlock();
 }
 
-void Coordinator::optOfflineDegrade(string lostobj, unsigned int clientIp, OfflineECPool* ecpool, ECPolicy* ecpolicy) {
-  // return |opt|stripename|num|key-ip|key-ip|...|
-  cout << "Coordinator::optOfflineDegrade" << endl;
+ECDAG* Coordinator::planDegradeDAG(ECPolicy* ecpolicy, ECBase* ec, int lostidx, string stripename, int pktnum,
+                                   unordered_map<int, pair<string, unsigned int>>& objlist,
+                                   unordered_map<int, unsigned int>& sid2ip,
+                                   unordered_map<int, AGCommand*>& agCmds, bool account) {
   int opt = ecpolicy->getOpt();  
 
-  // 0. create ec instances
-  ECBase* ec = ecpolicy->createECClass();
-
-  // 1, get stripeobjs for lostobj to figure out lostidx
-  string stripename = ecpool->getStripeForObj(lostobj);
-  vector<string> stripeobjs = ecpool->getStripeObjList(stripename);
-  int lostidx;
-  vector<int> integrity;
-  for (int i=0; i<stripeobjs.size(); i++) {
-    if (lostobj == stripeobjs[i]) {
-      integrity.push_back(0);
-      lostidx = i;
-    } else {
-      integrity.push_back(1);
-    }
-  }
-
   // prepare availcidx and toreccidx
   int ecn = ecpolicy->getN();
   int eck = ecpolicy->getK();
@@ -886,6 +922,51 @@ void Coordinator::optOfflineDegrade(string lostobj, unsigned int clientIp, Offli
   ECDAG* ecdag = ec->Decode(availcidx, toreccidx);
   ecdag->reconstruct(opt);
 
+  vector<int> toposeq = ecdag->toposort();
+  ecdag->dump();
+
+  // prepare cid2ip, for parseForOEC
+  unordered_map<int, unsigned int> cid2ip;
+  for (int i=0; i<toposeq.size(); i++) {
+    int cidx = toposeq[i];
+    ECNode* node = ecdag->getNode(cidx);
+    vector<unsigned int> candidates = node->candidateIps(sid2ip, cid2ip, _conf->_agentsIPs, ecn, eck, ecw, locality);
+    // choose from candidates
+    unsigned int curip = chooseFromCandidates(candidates, _conf->_repair_policy, "repair", "", account);
+    cid2ip.insert(make_pair(cidx, curip));
+  }
+
+  // optimize
+  ecdag->optimize2(opt, cid2ip, _conf->_ip2Rack, ecn, eck, ecw, sid2ip, _conf->_agentsIPs, locality);
+
+  // parse for oec
+  agCmds = ecdag->parseForOEC(cid2ip, stripename, ecn, eck, ecw, pktnum, objlist);
+  return ecdag;
+}
+
+void Coordinator::optOfflineDegrade(string lostobj, unsigned int clientIp, OfflineECPool* ecpool, ECPolicy* ecpolicy) {
+  // return |opt|stripename|num|key-ip|key-ip|...|
+  LOG_DEBUG << "Coordinator::optOfflineDegrade";
+  int opt = ecpolicy->getOpt();  
+  int ecw = ecpolicy->getW();
+
+  // 0. create ec instances
+  ECBase* ec = ecpolicy->createECClass();
+
+  // 1, get stripeobjs for lostobj to figure out lostidx
+  string stripename = ecpool->getStripeForObj(lostobj);
+  vector<string> stripeobjs = ecpool->getStripeObjList(stripename);
+  int lostidx;
+  vector<int> integrity;
+  for (int i=0; i<stripeobjs.size(); i++) {
+    if (lostobj == stripeobjs[i]) {
+      integrity.push_back(0);
+      lostidx = i;
+    } else {
+      integrity.push_back(1);
+    }
+  }
+
   // prepare sid2ip, for cip2ip
   // prepare stripeips for client info
   unordered_map<int, unsigned int> sid2ip;
@@ -905,31 +986,15 @@ void Coordinator::optOfflineDegrade(string lostobj, unsigned int clientIp, Offli
     stripeips.push_back(loc);
   }
 
-  vector<int> toposeq = ecdag->toposort();
-  ecdag->dump();
-
-  // prepare cid2ip, for parseForOEC
-  unordered_map<int, unsigned int> cid2ip;
-  for (int i=0; i<toposeq.size(); i++) {
-    int cidx = toposeq[i];
-    ECNode* node = ecdag->getNode(cidx);
-    vector<unsigned int> candidates = node->candidateIps(sid2ip, cid2ip, _conf->_agentsIPs, ecn, eck, ecw, locality);
-    // choose from candidates
-    unsigned int curip = chooseFromCandidates(candidates, _conf->_repair_policy, "repair");
-    cid2ip.insert(make_pair(cidx, curip));
-  }
-
   // prepare pktnum for parseForOEC
   int basesizeMB = ecpool->getBasesize();
   int pktnum = basesizeMB * 1048576/_conf->_pktSize;
 
-  // optimize
-  ecdag->optimize2(opt, cid2ip, _conf->_ip2Rack, ecn, eck, ecw, sid2ip, _conf->_agentsIPs, locality);
-
-  // 6. parse for oec
-  unordered_map<int, AGCommand*> agCmds = ecdag->parseForOEC(cid2ip, stripename, ecn, eck, ecw, pktnum, objlist);
+  // 2. plan the ecdag, which also parses for oec
+  unordered_map<int, AGCommand*> agCmds;
+  ECDAG* ecdag = planDegradeDAG(ecpolicy, ec, lostidx, stripename, pktnum, objlist, sid2ip, agCmds);
 
-  // 7. figure out roots and their ip
+  // 3. figure out roots and their ip
   vector<int> headers = ecdag->getHeaders();
   sort(headers.begin(), headers.end());
   int numblks = headers.size()/ecw; 
@@ -944,7 +1009,7 @@ void Coordinator::optOfflineDegrade(string lostobj, unsigned int clientIp, Offli
     rootinfo.push_back(curpair);
   }
    
-  // 8. send info to client
+  // 4. send info to client
   char* instruction = (char*)calloc(1024,sizeof(char));
   int offset = 0; 
 
@@ -1014,7 +1079,7 @@ void Coordinator::optOfflineDegrade(string lostobj, unsigned int clientIp, Offli
 }
 
 void Coordinator::nonOptOfflineDegrade(string lostobj, unsigned int clientIp, OfflineECPool* ecpool, ECPolicy* ecpolicy) {
-  cout << "Coordinator::nonOptOfflineDegrade" << endl;
+  LOG_DEBUG << "Coordinator::nonOptOfflineDegrade";
   int opt = ecpolicy->getOpt(); 
   // 0, create ec instance
   ECBase* ec = ecpolicy->createECClass();
@@ -1032,7 +1097,7 @@ void Coordinator::nonOptOfflineDegrade(string lostobj, unsigned int clientIp, Of
       integrity.push_back(1);
     }
   }
-  cout << "Coordinator::nonOptOfflineDegrade.lostidx = " << lostidx << endl;
+  LOG_DEBUG << "Coordinator::nonOptOfflineDegrade.lostidx = " << lostidx;
 
   // 2. we need n, k, w to obtain availcidx and toreccidx
   int ecn = ecpolicy->getN();
@@ -1146,26 +1211,56 @@ void Coordinator::reportLost(CoorCommand* coorCmd) {
 
 void Coordinator::reportRepaired(CoorCommand* coorCmd) {
   string objname = coorCmd->getFilename();
-  cout << "Coordinator::reportRepaired for " << objname << endl;
+  LOG_DEBUG << "Coordinator::reportRepaired for " << objname;
   _stripeStore->finishRepair(objname);
+  // the repaired obj replaces the lost one, agents drop the handles they cached before the loss
+  invalidateObj(objname);
+}
+
+void Coordinator::invalidateObj(string objname) {
+  AGCommand* agCmd = new AGCommand();
+  agCmd->buildType1(13, objname);
+  char* cmdstr = agCmd->getCmd();
+  int cmLen = agCmd->getCmdLen();
+  vector<char*> todelete;
+  redisContext* distCtx = RedisUtil::createContext(_conf->_coorIp);
+  for (auto ip: _conf->_agentsIPs) {
+    unsigned int tmpip = htonl(ip);
+    char* todist = (char*)calloc(cmLen + 4, sizeof(char));
+    memcpy(todist, (char*)&tmpip, 4);
+    memcpy(todist+4, cmdstr, cmLen);
+    todelete.push_back(todist);
+    redisAppendCommand(distCtx, "RPUSH dist_request %b", todist, cmLen+4);
+  }
+  redisReply* distReply;
+  for (auto item: todelete) {
+    redisGetReply(distCtx, (void **)&distReply);
+    freeReplyObject(distReply);
+  }
+  redisFree(distCtx);
+
+  // free
+  delete agCmd;
+  for (auto item: todelete) free(item);
 }
 
 void Coordinator::repairReqFromSS(CoorCommand* coorCmd) {
   string objname = coorCmd->getFilename();
-  cout << "Coordinator::repairReqFromSS.repair request for " << objname << endl;
+  LOG_DEBUG << "Coordinator::repairReqFromSS.repair request for " << objname;
 
   // figure out ec type
   SSEntry* ssentry = _stripeStore->getEntryFromObj(objname);
   int redundancy = ssentry->getType();
 
   if (redundancy == 0) {
-    return recoveryOnline(objname);
+    return recoveryOnline(objname, coorCmd->getTraceId());
   } else {
-    return recoveryOffline(objname);
+    return recoveryOffline(objname, coorCmd->getTraceId());
   }
 }
 
-void Coordinator::recoveryOnline(string lostobj) {
+void Coordinator::recoveryOnline(string lostobj, string traceid) {
+  long planStart = Tracer::now();
   // we need ecdag, toposort and parseForOEC, which requires cid2ip, stripename, n,k,w,pktnum,objlist
   // we also need to create persist command to persist repaired block
   // after we create commands, we send these commands to corresponding Agenst
@@ -1245,6 +1340,7 @@ void Coordinator::recoveryOnline(string lostobj) {
   // relocate 
   vector<unsigned int> placedIps;
   vector<int> placedIdx;
+  vector<string> relocated;
   for (int i=0; i<ecn; i++) {
     if (integrity[i] == 1) { 
       placedIdx.push_back(i);
@@ -1252,17 +1348,14 @@ void Coordinator::recoveryOnline(string lostobj) {
     } else {
       vector<int> colocWith;
       if (idx2group.find(i) != idx2group.end()) colocWith = idx2group[i];
-      vector<unsigned int> candidates = getCandidates(placedIps, placedIdx, colocWith);
-      // we need to remove remaining ips in candidates
+      // remaining ips of the stripe are not candidates
+      vector<unsigned int> exclude;
       for (int j=i+1; j<ecn; j++) {
-        if (integrity[j] == 1) {
-          unsigned int toremove = stripeips[j];
-          vector<unsigned int>::iterator position = find(candidates.begin(), candidates.end(), toremove);
-          if (position != candidates.end()) candidates.erase(position);
-        }
+        if (integrity[j] == 1) exclude.push_back(stripeips[j]);
       }
+      vector<unsigned int> candidates = getCandidates(placedIps, placedIdx, colocWith, exclude);
       // now we choose a loc from candidates
-      unsigned int curip = chooseFromCandidates(candidates, _conf->_repair_policy, "repair");
+      unsigned int curip = chooseFromCandidates(candidates, _conf->_repair_policy, "repair", "repair:"+lostobj);
       // update placedIps, placedIdx
       placedIps.push_back(curip);
       placedIdx.push_back(i);
@@ -1274,6 +1367,7 @@ void Coordinator::recoveryOnline(string lostobj) {
       string objname = objlist[i].first;
       SSEntry* curssentry = _stripeStore->getEntryFromObj(objname);
       curssentry->updateObjLoc(objname, curip);
+      relocated.push_back(objname);
     }
   }
 
@@ -1286,13 +1380,14 @@ void Coordinator::recoveryOnline(string lostobj) {
     ECNode* node = ecdag->getNode(cidx);
     vector<unsigned int> candidates = node->candidateIps(sid2ip, cid2ip, _conf->_agentsIPs, ecn, eck, ecw, locality, lostidx);
     // choose from candidates
-    unsigned int curip = chooseFromCandidates(candidates, _conf->_repair_policy, "repair");
+    unsigned int curip = chooseFromCandidates(candidates, _conf->_repair_policy, "repair", "repair:"+lostobj);
     cid2ip.insert(make_pair(cidx, curip));
   }
 
-  int filesizeMB = ssentry->getFilesizeMB();
-  int objsizeMB = filesizeMB / eck;
-  int pktnum = objsizeMB * 1048576/_conf->_pktSize;
+  // online objects hold one packet per stripe, the last stripe may be zero-padded
+  long filesizeB = ssentry->getFilesizeB();
+  int filepktnum = (filesizeB + _conf->_pktSize - 1) / _conf->_pktSize;
+  int pktnum = (filepktnum + eck - 1) / eck;
 
   // optimize
   ecdag->optimize2(opt, cid2ip, _conf->_ip2Rack, ecn, eck, ecw, sid2ip, _conf->_agentsIPs, locality);
@@ -1304,7 +1399,25 @@ void Coordinator::recoveryOnline(string lostobj) {
   // 7. add persist cmd
   vector<AGCommand*> persistCmds = ecdag->persist(cid2ip, stripename, ecn, eck, ecw, pktnum, objlist);
   
-  // 8. send commands to cmddistributor
+  // 8. the completion listener finishes the repair once the lost object is persisted
+  vector<string> persistObjs;
+  for (auto agcmd: persistCmds) {
+    if (agcmd && agcmd->getShouldSend()) persistObjs.push_back(agcmd->getWriteObjName());
+  }
+  StripeStore* stripeStore = _stripeStore;
+  _tracker->watch("repair:"+lostobj, persistObjs, [=]{
+    LOG_DEBUG << "Coordinator::repair for " << lostobj << " finishes";
+    Tracer::record(traceid, "repair", stripename, lostobj, planStart, Tracer::now());
+    // backup entries with relocated objects
+    for (auto obj: relocated) stripeStore->backupEntry(stripeStore->getEntryFromObj(obj));
+    stripeStore->finishRepair(lostobj);
+  });
+
+  // 9. send commands to cmddistributor
+  for (auto item: agCmds) if (item.second) item.second->setTraceId(traceid);
+  for (auto agcmd: persistCmds) if (agcmd) agcmd->setTraceId(traceid);
+  Tracer::record(traceid, "plan", stripename, lostobj, planStart, Tracer::now());
+  long dispatchStart = Tracer::now();
   vector<char*> todelete;
   redisContext* distCtx = RedisUtil::createContext(_conf->_coorIp);
 
@@ -1350,16 +1463,8 @@ void Coordinator::recoveryOnline(string lostobj) {
   freeReplyObject(distReply);
   redisFree(distCtx);
 
-  // 9. wait for finish flag?
-  for (auto agcmd: persistCmds) {
-    unsigned int ip = agcmd->getSendIp(); 
-    redisContext* waitCtx = RedisUtil::createContext(ip);
-    string wkey = "writefinish:"+agcmd->getWriteObjName();
-    redisReply* fReply = (redisReply*)redisCommand(waitCtx, "blpop %s 0", wkey.c_str());
-    freeReplyObject(fReply);
-    redisFree(waitCtx);
-  }
-  cout << "Coordinator::repair for " << lostobj << " finishes" << endl;
+  Tracer::record(traceid, "dispatch", stripename, lostobj, dispatchStart, Tracer::now());
+  LOG_DEBUG << "Coordinator::repair for " << lostobj << " dispatched";
 
   // delete
   delete ec;
@@ -1369,7 +1474,8 @@ void Coordinator::recoveryOnline(string lostobj) {
   for (auto item: todelete) free(item);
 }
 
-void Coordinator::recoveryOffline(string lostobj) {
+void Coordinator::recoveryOffline(string lostobj, string traceid) {
+  long planStart = Tracer::now();
   // obtain needed information
   SSEntry* ssentry = _stripeStore->getEntryFromObj(lostobj);
   string ecpoolid = ssentry->getEcidpool();
@@ -1447,6 +1553,7 @@ void Coordinator::recoveryOffline(string lostobj) {
   // relocate 
   vector<unsigned int> placedIps;
   vector<int> placedIdx;
+  vector<string> relocated;
   for (int i=0; i<ecn; i++) {
     if (integrity[i] == 1) { 
       placedIdx.push_back(i);
@@ -1454,17 +1561,14 @@ void Coordinator::recoveryOffline(string lostobj) {
     } else {
       vector<int> colocWith;
       if (idx2group.find(i) != idx2group.end()) colocWith = idx2group[i];
-      vector<unsigned int> candidates = getCandidates(placedIps, placedIdx, colocWith);
-      // we need to remove remaining ips in candidates
+      // remaining ips of the stripe are not candidates
+      vector<unsigned int> exclude;
       for (int j=i+1; j<ecn; j++) {
-        if (integrity[j] == 1) {
-          unsigned int toremove = stripeips[j];
-          vector<unsigned int>::iterator position = find(candidates.begin(), candidates.end(), toremove);
-          if (position != candidates.end()) candidates.erase(position);
-        }
+        if (integrity[j] == 1) exclude.push_back(stripeips[j]);
       }
+      vector<unsigned int> candidates = getCandidates(placedIps, placedIdx, colocWith, exclude);
       // now we choose a loc from candidates
-      unsigned int curip = chooseFromCandidates(candidates, _conf->_repair_policy, "repair");
+      unsigned int curip = chooseFromCandidates(candidates, _conf->_repair_policy, "repair", "repair:"+lostobj);
       // update placedIps, placedIdx
       placedIps.push_back(curip);
       placedIdx.push_back(i);
@@ -1476,6 +1580,7 @@ void Coordinator::recoveryOffline(string lostobj) {
       string objname = objlist[i].first;
       SSEntry* curssentry = _stripeStore->getEntryFromObj(objname);
       curssentry->updateObjLoc(objname, curip);
+      relocated.push_back(objname);
     }
   }
  
@@ -1488,7 +1593,7 @@ void Coordinator::recoveryOffline(string lostobj) {
     ECNode* node = ecdag->getNode(cidx);
     vector<unsigned int> candidates = node->candidateIps(sid2ip, cid2ip, _conf->_agentsIPs, ecn, eck, ecw, locality, lostidx);
     // choose from candidates
-    unsigned int curip = chooseFromCandidates(candidates, _conf->_repair_policy, "repair");
+    unsigned int curip = chooseFromCandidates(candidates, _conf->_repair_policy, "repair", "repair:"+lostobj);
     cid2ip.insert(make_pair(cidx, curip));
   }
 
@@ -1506,7 +1611,25 @@ void Coordinator::recoveryOffline(string lostobj) {
   // 7. add persist cmd
   vector<AGCommand*> persistCmds = ecdag->persist(cid2ip, stripename, ecn, eck, ecw, pktnum, objlist);
   
-  // 8. send commands to cmddistributor
+  // 8. the completion listener finishes the repair once the lost object is persisted
+  vector<string> persistObjs;
+  for (auto agcmd: persistCmds) {
+    if (agcmd && agcmd->getShouldSend()) persistObjs.push_back(agcmd->getWriteObjName());
+  }
+  StripeStore* stripeStore = _stripeStore;
+  _tracker->watch("repair:"+lostobj, persistObjs, [=]{
+    LOG_DEBUG << "Coordinator::repair for " << lostobj << " finishes";
+    Tracer::record(traceid, "repair", stripename, lostobj, planStart, Tracer::now());
+    // backup entries with relocated objects
+    for (auto obj: relocated) stripeStore->backupEntry(stripeStore->getEntryFromObj(obj));
+    stripeStore->finishRepair(lostobj);
+  });
+
+  // 9. send commands to cmddistributor
+  for (auto item: agCmds) if (item.second) item.second->setTraceId(traceid);
+  for (auto agcmd: persistCmds) if (agcmd) agcmd->setTraceId(traceid);
+  Tracer::record(traceid, "plan", stripename, lostobj, planStart, Tracer::now());
+  long dispatchStart = Tracer::now();
   vector<char*> todelete;
   redisContext* distCtx = RedisUtil::createContext(_conf->_coorIp);
 
@@ -1553,16 +1676,8 @@ void Coordinator::recoveryOffline(string lostobj) {
   freeReplyObject(distReply);
   redisFree(distCtx);
 
-  // 9. wait for finish flag?
-  for (auto agcmd: persistCmds) {
-    unsigned int ip = agcmd->getSendIp(); 
-    redisContext* waitCtx = RedisUtil::createContext(ip);
-    string wkey = "writefinish:"+agcmd->getWriteObjName();
-    redisReply* fReply = (redisReply*)redisCommand(waitCtx, "blpop %s 0", wkey.c_str());
-    freeReplyObject(fReply);
-    redisFree(waitCtx);
-  }
-  cout << "Coordinator::repair for " << lostobj << " finishes" << endl;
+  Tracer::record(traceid, "dispatch", stripename, lostobj, dispatchStart, Tracer::now());
+  LOG_DEBUG << "Coordinator::repair for " << lostobj << " dispatched";
 
   // delete
   delete ec;
@@ -1574,76 +1689,150 @@ void Coordinator::recoveryOffline(string lostobj) {
 
 void Coordinator::coorBenchmark(CoorCommand* coorCmd) {
   string benchname = coorCmd->getBenchName();
+  string op = coorCmd->getBenchOp();
+  string target = coorCmd->getBenchTarget();
   unsigned int clientIp = coorCmd->getClientip();
-  // plan to do simple ECDAG parsing in benchmark
-  string ecid="rs_9_6";
-  ECPolicy* ecpolicy = _conf->_ecPolicyMap[ecid];
-  ECBase* ec=ecpolicy->createECClass();
-  int ecn = ecpolicy->getN();
-  int eck = ecpolicy->getK();
-  int ecw = ecpolicy->getW();
-  int opt = ecpolicy->getOpt();
-  bool locality = ecpolicy->getLocality();
 
-  ECDAG* ecdag;
-  ecdag = ec->Encode();
-  // first optimize without physical information
-  ecdag->reconstruct(opt);
+  // the planning part of each request runs as it does for a real request, nothing is recorded
+  // in the stripe store and no command is sent to the agents
+  bool success = false;
+  if (op == "meta") {
+    SSEntry* ssentry = _stripeStore->getEntry(target);
+    if (ssentry != NULL) {
+      char* filemeta = (char*)calloc(1024, sizeof(char));
+      buildFileMeta(ssentry, filemeta);
+      free(filemeta);
+      success = true;
+    }
+  } else if (_conf->_ecPolicyMap.find(target) != _conf->_ecPolicyMap.end() &&
+             _conf->_ecPolicyMap[target]->getN() <= _conf->_agentsIPs.size()) {
+    ECPolicy* ecpolicy = _conf->_ecPolicyMap[target];
+    success = true;
+    if (op == "regonline") benchRegister(ecpolicy, clientIp, true);
+    else if (op == "regoffline") benchRegister(ecpolicy, clientIp, false);
+    else if (op == "degraded") benchDegraded(ecpolicy, clientIp);
+    else if (op == "encode") benchEncode(ecpolicy);
+    else success = false;
+  }
+  if (!success) LOG_DEBUG << "Coordinator::coorBenchmark.unsupported " << op << " for " << target;
 
-  // simulate physical information
-  unordered_map<int, pair<string, unsigned int>> objlist;
-  unordered_map<int, unsigned int> sid2ip;
-  for (int sid=0; sid<ecn; sid++) {
-    string objname = "testobj"+to_string(sid);
-    unsigned int ip = _conf->_agentsIPs[sid];
+  // send back response to client
+  // benchfinish:benchname
+  redisReply* rReply;
+  redisContext* waitCtx = RedisUtil::createContext(clientIp);
+  string wkey = "benchfinish:" + benchname;
+  int tmpval = htonl(success ? 1 : 0);
+  rReply = (redisReply*)redisCommand(waitCtx, "rpush %s %b", wkey.c_str(), (char*)&tmpval, sizeof(tmpval));
+  freeReplyObject(rReply);
+  redisFree(waitCtx);
+}
+
+void Coordinator::benchStripe(int num, unordered_map<int, pair<string, unsigned int>>& objlist,
+                              unordered_map<int, unsigned int>& sid2ip) {
+  // a stripe on consecutive agents from a random offset
+  int offset = rand() % _conf->_agentsIPs.size();
+  for (int sid=0; sid<num; sid++) {
+    string objname = "benchobj"+to_string(sid);
+    unsigned int ip = _conf->_agentsIPs[(offset+sid) % _conf->_agentsIPs.size()];
     objlist.insert(make_pair(sid, make_pair(objname, ip)));
     sid2ip.insert(make_pair(sid, ip));
   }
+}
 
-  // topological sorting
-  vector<int> toposeq = ecdag->toposort();
+void Coordinator::benchRegister(ECPolicy* ecpolicy, unsigned int clientIp, bool online) {
+  ECBase* ec = ecpolicy->createECClass();
+  int ecn = ecpolicy->getN();
+  int eck = ecpolicy->getK();
+  vector<vector<int>> group;
+  ec->Place(group);
+  unordered_map<int, vector<int>> idx2group;
+  for (auto item: group) {
+    for (auto idx: item) idx2group.insert(make_pair(idx, item));
+  }
 
-  // cid2ip
-  unordered_map<int, unsigned int> cid2ip;
-  for (int i=0; i<toposeq.size(); i++) {
-    int curcid = toposeq[i];
-    ECNode* cnode = ecdag->getNode(curcid);
-    vector<unsigned int> candidates = cnode->candidateIps(sid2ip, cid2ip, _conf->_agentsIPs, ecn, eck, ecw, locality || (opt>0));
-    unsigned int ip = candidates[0];
-    cid2ip.insert(make_pair(curcid, ip));
+  if (online) {
+    // placement of the n objs and the compute tasks for the client, as registerOnlineEC
+    vector<unsigned int> ips;
+    vector<int> placed;
+    for (int i=0; i<ecn; i++) {
+      vector<int> colocWith;
+      if (idx2group.find(i) != idx2group.end()) colocWith = idx2group[i];
+      ips.push_back(placeData(clientIp, ips, placed, colocWith, "", false));
+      placed.push_back(i);
+    }
+    ECDAG* ecdag = ec->Encode();
+    vector<int> toposeq = ecdag->toposort();
+    vector<ECTask*> computetasks;
+    for (int i=0; i<toposeq.size(); i++) ecdag->getNode(toposeq[i])->parseForClient(computetasks);
+    for (auto task: computetasks) {
+      task->buildType2();
+      delete task;
+    }
+    delete ecdag;
+  } else {
+    // placement of one obj into a partially filled stripe, as registerOfflineEC
+    unordered_map<int, pair<string, unsigned int>> objlist;
+    unordered_map<int, unsigned int> sid2ip;
+    int stripeidx = rand() % eck;
+    benchStripe(stripeidx, objlist, sid2ip);
+    vector<unsigned int> stripeips;
+    vector<int> stripeplaced;
+    for (int i=0; i<stripeidx; i++) {
+      stripeips.push_back(sid2ip[i]);
+      stripeplaced.push_back(i);
+    }
+    vector<int> colocWith;
+    if (idx2group.find(stripeidx) != idx2group.end()) colocWith = idx2group[stripeidx];
+    placeData(clientIp, stripeips, stripeplaced, colocWith, "", false);
   }
+  delete ec;
+}
 
-  ecdag->optimize2(opt, cid2ip, _conf->_ip2Rack, ecn, eck, ecw, sid2ip, _conf->_agentsIPs, locality || (opt>0));
-  ecdag->dump();
+void Coordinator::benchDegraded(ECPolicy* ecpolicy, unsigned int clientIp) {
+  // decode plan of one lost obj through the planner of optOfflineDegrade
+  ECBase* ec = ecpolicy->createECClass();
+  int ecn = ecpolicy->getN();
 
-  for (auto item: cid2ip) {
-//    cout << "cid: " << item.first << ", ip: " << RedisUtil::ip2Str(item.second) << ", ";
-    ECNode* cnode = ecdag->getNode(item.first);
-    unordered_map<int, int> map = cnode->getRefMap();
-//    for (auto iitem: map) {
-//      cout << "ref["<<iitem.first<<"]: " << iitem.second << ", ";
-//    }
-//    cout << endl;
-  }
+  int lostidx = rand() % ecn;
+  unordered_map<int, pair<string, unsigned int>> objlist;
+  unordered_map<int, unsigned int> sid2ip;
+  benchStripe(ecn, objlist, sid2ip);
+  objlist[lostidx].second = clientIp;
+  sid2ip[lostidx] = clientIp;
 
-  string stripename = "teststripe";
   int pktnum = 8;
-  unordered_map<int, AGCommand*> agCmds = ecdag->parseForOEC(cid2ip, stripename, ecn, eck, ecw, pktnum, objlist);
-  vector<AGCommand*> persistCmds = ecdag->persist(cid2ip, stripename, ecn, eck, ecw, pktnum, objlist); 
-
-  // send back response to client
-  // benchfinish:benchname
-  redisReply* rReply;
-  redisContext* waitCtx = RedisUtil::createContext(clientIp);
-  string wkey = "benchfinish:" + benchname;
-  int tmpval = htonl(1);
-  rReply = (redisReply*)redisCommand(waitCtx, "rpush %s %b", wkey.c_str(), (char*)&tmpval, sizeof(tmpval));
-  freeReplyObject(rReply);
-  redisFree(waitCtx);
+  unordered_map<int, AGCommand*> agCmds;
+  ECDAG* ecdag = planDegradeDAG(ecpolicy, ec, lostidx, "benchstripe", pktnum, objlist, sid2ip, agCmds, false);
 
   // free
-  for (auto item: persistCmds) delete item;
-  for (auto item: agCmds) delete item.second;
+  for (auto item: agCmds) if (item.second) delete item.second;
   delete ecdag;
   delete ec;
 }
+
+void Coordinator::benchEncode(ECPolicy* ecpolicy) {
+  // encode plan of one stripe through the planners of offlineEnc
+  ECBase* ec = ecpolicy->createECClass();
+  int ecn = ecpolicy->getN();
+  int eck = ecpolicy->getK();
+
+  // k source objs, the parity objs are placed
+  unordered_map<int, pair<string, unsigned int>> objlist;
+  unordered_map<int, unsigned int> sid2ip;
+  benchStripe(eck, objlist, sid2ip);
+  vector<unsigned int> stripeips;
+  for (int i=0; i<eck; i++) stripeips.push_back(sid2ip[i]);
+  vector<unsigned int> parityips = placeParity(ec, ecn, eck, stripeips, "", false);
+  for (int i=eck; i<ecn; i++) {
+    objlist.insert(make_pair(i, make_pair("benchobj"+to_string(i), parityips[i-eck])));
+    sid2ip.insert(make_pair(i, parityips[i-eck]));
+  }
+
+  int pktnum = 8;
+  vector<AGCommand*> persistCmds;
+  vector<AGCommand*> agCmds = planEncodeCmds(ecpolicy, ec, "benchstripe", pktnum, objlist, sid2ip, persistCmds, "", false);
+
+  // free
+  for (auto item: agCmds) delete item;
+  delete ec;
+}
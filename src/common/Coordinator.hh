@@ -2,10 +2,15 @@
 #define _COORDINATOR_HH_
 
 //#include "AGCommand.hh"
+#include "CompletionTracker.hh"
 #include "Config.hh"
 #include "FSObjInputStream.hh"
+#include "Metrics.hh"
+#include "PlacementEngine.hh"
+#include "RequestScheduler.hh"
 //#include "RedisUtil.hh"
 #include "StripeStore.hh"
+#include "Tracer.hh"
 //#include "SSEntry.hh"
 //#include "UnderFile.hh"
 //#include "Util/hdfs.h"
@@ -25,10 +30,13 @@ class Coordinator {
     Config* _conf;
     redisContext* _localCtx;
     StripeStore* _stripeStore;
+    RequestScheduler* _scheduler;
+    CompletionTracker* _tracker;
     UnderFS* _underfs;
+    PlacementEngine* _placement;
 
   public:
-    Coordinator(Config* conf, StripeStore* ss);
+    Coordinator(Config* conf, StripeStore* ss, RequestScheduler* scheduler, CompletionTracker* tracker);
     ~Coordinator();
 
     void doProcess();
@@ -37,25 +45,61 @@ class Coordinator {
     void getLocation(CoorCommand* coorCmd);
     void finalizeFile(CoorCommand* coorCmd);
     void offlineEnc(CoorCommand* coorCmd);
+    void offlineEncBatch(CoorCommand* coorCmd);
     void setECStatus(CoorCommand* coorCmd);
     void getFileMeta(CoorCommand* coorCmd);
+    // returns the length of the meta written into filemeta
+    int buildFileMeta(SSEntry* ssentry, char* filemeta);
     void reportLost(CoorCommand* coorCmd);
     void offlineDegradedInst(CoorCommand* coorCmd);
     void onlineDegradedInst(CoorCommand* coorCmd);
     void repairReqFromSS(CoorCommand* coorCmd);
     void reportRepaired(CoorCommand* coorCmd);
+    // every agent drops the cached read handles and size of objname
+    void invalidateObj(string objname);
     void coorBenchmark(CoorCommand* coorCmd);
+    // op of coorBenchmark: regonline, regoffline, degraded and encode plan for an ecid, meta looks up a file
+    void benchRegister(ECPolicy* ecpolicy, unsigned int clientIp, bool online);
+    void benchDegraded(ECPolicy* ecpolicy, unsigned int clientIp);
+    void benchEncode(ECPolicy* ecpolicy);
+    void benchStripe(int num, unordered_map<int, pair<string, unsigned int>>& objlist,
+                     unordered_map<int, unsigned int>& sid2ip);
 
     void registerOnlineEC(unsigned int clientIp, string filename, string ecid, int filesizeMB);
     void registerOfflineEC(unsigned int clientIp, string filename, string ecpoolid, int filesizeMB);
-    vector<unsigned int> getCandidates(vector<unsigned int> placedIp, vector<int> placedIdx, vector<int> colocWith);
-    unsigned int chooseFromCandidates(vector<unsigned int> candidates, string policy, string type); // policy:random/balance; type:control/data/other
+    // on large clusters only a few sampled agents are returned, chooseFromCandidates picks among them
+    vector<unsigned int> getCandidates(vector<unsigned int> placedIp, vector<int> placedIdx, vector<int> colocWith,
+                                       vector<unsigned int> exclude = vector<unsigned int>());
+    // location of a data object written by clientIp, honouring avoid_local
+    unsigned int placeData(unsigned int clientIp, vector<unsigned int> placedIp, vector<int> placedIdx,
+                           vector<int> colocWith, string task, bool account = true);
+    // policy:random/balance; type:control/data/repair/encode/other
+    // a non-empty task keeps the load in flight until StripeStore::finishTaskLoad(task)
+    // account = false leaves the load of the agents untouched, for plans that never run (benchmark)
+    unsigned int chooseFromCandidates(vector<unsigned int> candidates, string policy, string type, string task = "",
+                                      bool account = true);
 //    void onlineECInst(string filename, SSEntry* ssentry, unsigned int ip);
 //    void offlineECInst(string filename, SSEntry* ssentry, unsigned int ip);
     void nonOptOfflineDegrade(string lostobj, unsigned int clientIp, OfflineECPool* ecpool, ECPolicy* ecpolicy);
     void optOfflineDegrade(string lostobj, unsigned int clientIp, OfflineECPool* ecpool, ECPolicy* ecpolicy);
-    void recoveryOnline(string filename);
-    void recoveryOffline(string filename);
+    // decode ecdag of lostidx on the stripe of objlist and its commands, the caller deletes the ecdag
+    ECDAG* planDegradeDAG(ECPolicy* ecpolicy, ECBase* ec, int lostidx, string stripename, int pktnum,
+                          unordered_map<int, pair<string, unsigned int>>& objlist,
+                          unordered_map<int, unsigned int>& sid2ip,
+                          unordered_map<int, AGCommand*>& agCmds, bool account = true);
+    // plans one stripe of an encode job, returns the commands of the stripe in the order agents run them
+    vector<AGCommand*> planOfflineEnc(OfflineECPool* ecpool, ECBase* ec, string stripename, string traceid);
+    // locations of the parity objs k..n-1 of a stripe whose first objs are at stripeips
+    vector<unsigned int> placeParity(ECBase* ec, int n, int k, vector<unsigned int> stripeips,
+                                     string task, bool account = true);
+    // encode ecdag of a placed stripe, the commands in the order agents run them, persistCmds among them
+    vector<AGCommand*> planEncodeCmds(ECPolicy* ecpolicy, ECBase* ec, string stripename, int pktnum,
+                                      unordered_map<int, pair<string, unsigned int>>& objlist,
+                                      unordered_map<int, unsigned int>& sid2ip,
+                                      vector<AGCommand*>& persistCmds, string task, bool account = true);
+    void encodeStripes(string ecpoolid, vector<string> stripenames, string traceid);
+    void recoveryOnline(string filename, string traceid);
+    void recoveryOffline(string filename, string traceid);
 };
 
 #endif
@@ -1,5 +1,10 @@
 #include "FSObjInputStream.hh"
 
+// the window is resized so that one fill takes about this long at the
+// throughput measured for the previous fill
+#define READAHEAD_TARGET_MS 50
+#define READAHEAD_ALIGN 4096
+
 FSObjInputStream::FSObjInputStream(Config* conf, string objname, UnderFS* fs) {
   struct timeval time1, time2;
   gettimeofday(&time1, NULL);
@@ -7,40 +12,45 @@ FSObjInputStream::FSObjInputStream(Config* conf, string objname, UnderFS* fs) {
   _objname = objname;
   _queue = new BlockingQueue<OECDataPacket*>();
   _dataPktNum = 0;
+  _raWindow = _conf->_readahead_size;
+  _rangeStart = 0;
+  _rangeEnd = 0;
+  _rangePad = false;
 
   _underfs = fs;
-  _underfile = _underfs->openFile(objname, "read");
+  _underfile = _underfs->openCachedFile(objname);
   if (!_underfile) {
     _exist = false;
   } else {
 //    _exist = true;
-    _objbytes = _underfs->getFileSize(_underfile);
-    cout << "FSObjInputStream::constructor.objsize = " << _objbytes << endl;
+    _objbytes = _underfs->getCachedFileSize(objname, _underfile);
+    LOG_DEBUG << "FSObjInputStream::constructor.objsize = " << _objbytes;
     _offset = 0;
     if (_objbytes == 0) _exist = false;
     else _exist = true;
   }
   gettimeofday(&time2, NULL);
-  cout << "FSObjInputStream::constructor.time = " << RedisUtil::duration(time1, time2) << endl;
+  LOG_DEBUG << "FSObjInputStream::constructor.time = " << RedisUtil::duration(time1, time2);
 }
 
 FSObjInputStream::~FSObjInputStream() {
   if (_queue) delete _queue;
-  if (_underfile) _underfs->closeFile(_underfile);
+  if (_underfile) _underfs->releaseFile(_objname, _underfile);
 }
 
 void FSObjInputStream::readObj(int slicesize) {
   struct timeval time1, time2;
   gettimeofday(&time1, NULL);
-  while(true) {
+  if (_raWindow > 0) readAhead(slicesize);
+  else while(true) {
     int hasread = 0;
     char* buf = (char*)calloc(slicesize+4, sizeof(char));
     if (!buf) {
-      cout << "FSObjInputStream::readObj.malloc buffer fail" << endl;
+      LOG_ERROR << "FSObjInputStream::readObj.malloc buffer fail";
       return;
     }
     while(hasread < slicesize) {
-      int len = _underfs->readFile(_underfile, buf+4+hasread, slicesize-hasread);
+      int len = readFile(buf+4+hasread, slicesize-hasread);
       if (len == 0) break;
       hasread += len;
     }
@@ -57,22 +67,23 @@ void FSObjInputStream::readObj(int slicesize) {
     if (hasread <= 0) break;
   }
   gettimeofday(&time2, NULL);
-  cout << "FSObjInputStream.readObj.duration = " << RedisUtil::duration(time1, time2) << " for " << _objname << " of " << _dataPktNum << " slices"<< endl;
+  LOG_DEBUG << "FSObjInputStream.readObj.duration = " << RedisUtil::duration(time1, time2) << " for " << _objname << " of " << _dataPktNum << " slices";
 }
 
 void FSObjInputStream::readObj() {
 
   struct timeval time1, time2;
   gettimeofday(&time1, NULL);
-  while(true) {
+  if (_raWindow > 0) readAhead(_conf->_pktSize);
+  else while(true) {
     int hasread = 0;
     char* buf = (char*)calloc(_conf->_pktSize+4, sizeof(char));
     if (!buf) {
-      cout << "FSObjInputStream::readObj.malloc buffer fail" << endl;
+      LOG_ERROR << "FSObjInputStream::readObj.malloc buffer fail";
       return;
     }
     while(hasread < _conf->_pktSize) {
-      int len = _underfs->readFile(_underfile, buf+4+hasread, _conf->_pktSize-hasread);
+      int len = readFile(buf+4+hasread, _conf->_pktSize-hasread);
       if (len == 0) break;
       hasread += len;
     }
@@ -89,7 +100,7 @@ void FSObjInputStream::readObj() {
     if (hasread <= 0) break;
   }
   gettimeofday(&time2, NULL);
-  cout << "FSObjInputStream.readObj.duration = " << RedisUtil::duration(time1, time2) << " for " << _objname << ", pktnum: " << _dataPktNum << endl;
+  LOG_DEBUG << "FSObjInputStream.readObj.duration = " << RedisUtil::duration(time1, time2) << " for " << _objname << ", pktnum: " << _dataPktNum;
 }
 
 void FSObjInputStream::readObj(int w, vector<int> list, int slicesize) {
@@ -109,18 +120,18 @@ void FSObjInputStream::readObj(int w, vector<int> list, int slicesize) {
   int stripeid=0;
   int pktsize = _conf->_pktSize;
   int stripenum = _objbytes / pktsize;
-  cout << "FSObjInputStream::readObj.stripenum:  " << stripenum << endl;
+  LOG_DEBUG << "FSObjInputStream::readObj.stripenum:  " << stripenum;
   int slicenum = 0;
   while (stripeid < stripenum) {
-    int start = stripeid * pktsize;
+    long start = (long)stripeid * pktsize;
     for (int i=0; i<offsetlist.size(); i++) {
       int offidx = offsetlist[i];
-      int slicestart = start + offidx * slicesize;
+      long slicestart = start + offidx * slicesize;
       char* buf = (char*)calloc(slicesize+4, sizeof(char));
   
       int hasread = 0;
       while(hasread < slicesize) {
-        int len = _underfs->pReadFile(_underfile, slicestart + hasread, buf+4 + hasread, slicesize - hasread);
+        int len = pReadFile(slicestart + hasread, buf+4 + hasread, slicesize - hasread);
         if (len == 0)break;
         hasread += len;
       }
@@ -138,7 +149,7 @@ void FSObjInputStream::readObj(int w, vector<int> list, int slicesize) {
     stripeid++;
   }
   gettimeofday(&time2, NULL);
-  cout << "FSObjInputStream.readObj.duration = " << RedisUtil::duration(time1, time2) << " for " << _objname << ", totally " << slicenum << "slices" << endl;
+  LOG_DEBUG << "FSObjInputStream.readObj.duration = " << RedisUtil::duration(time1, time2) << " for " << _objname << ", totally " << slicenum << "slices";
 }
 
 void FSObjInputStream::readObj(int slicesize, int unitIdx) {
@@ -153,16 +164,16 @@ void FSObjInputStream::readObj(int slicesize, int unitIdx) {
   int pktnum = 0;
   while(true) {
     int hasread = 0;
-    long objoffset = pktnum * _conf->_pktSize + unitIdx * slicesize;
+    long objoffset = (long)pktnum * _conf->_pktSize + unitIdx * slicesize;
 
     char* buf = (char*)calloc(slicesize+4, sizeof(char));
     if (!buf) {
-      cout << "FSObjInputStream::readObj.malloc buffer fail" << endl;
+      LOG_ERROR << "FSObjInputStream::readObj.malloc buffer fail";
       return;
     }
 
     while(hasread < slicesize) {
-      int len = _underfs->pReadFile(_underfile, objoffset + hasread, buf+4 + hasread, slicesize - hasread);
+      int len = pReadFile(objoffset + hasread, buf+4 + hasread, slicesize - hasread);
       if (len == 0) break;
       hasread += len;
     }
@@ -181,7 +192,192 @@ void FSObjInputStream::readObj(int slicesize, int unitIdx) {
   }
 
   gettimeofday(&time2, NULL);
-  cout << "FSObjInputStream.readObj.duration = " << RedisUtil::duration(time1, time2) << " for " << _objname << ", pktnum = " << pktnum << endl;
+  LOG_DEBUG << "FSObjInputStream.readObj.duration = " << RedisUtil::duration(time1, time2) << " for " << _objname << ", pktnum = " << pktnum;
+}
+
+int FSObjInputStream::readFile(char* buf, int len) {
+  static Histogram* latency = Metrics::histogram("dss.read");
+  static Counter* readBytes = Metrics::counter("dss.read.bytes");
+  struct timeval time1, time2;
+  gettimeofday(&time1, NULL);
+  int toret = _underfs->readFile(_underfile, buf, len);
+  gettimeofday(&time2, NULL);
+  latency->record(RedisUtil::duration(time1, time2));
+  if (toret > 0) readBytes->add(toret);
+  return toret;
+}
+
+int FSObjInputStream::pReadFile(long offset, char* buf, int len) {
+  static Histogram* latency = Metrics::histogram("dss.read");
+  static Counter* readBytes = Metrics::counter("dss.read.bytes");
+  struct timeval time1, time2;
+  gettimeofday(&time1, NULL);
+  int toret = _underfs->pReadFile(_underfile, offset, buf, len);
+  gettimeofday(&time2, NULL);
+  latency->record(RedisUtil::duration(time1, time2));
+  if (toret > 0) readBytes->add(toret);
+  return toret;
+}
+
+int FSObjInputStream::fillWindow(char* buf, int len) {
+  int hasread = 0;
+  while (hasread < len) {
+    int curlen = readFile(buf + hasread, len - hasread);
+    if (curlen <= 0) break;
+    hasread += curlen;
+  }
+  return hasread;
+}
+
+void FSObjInputStream::readAhead(int slicesize) {
+  // two aligned windows: a background thread fills one from the underfs with
+  // large sequential reads while we slice the other one into packets
+  int maxwindow = _conf->_readahead_max / slicesize * slicesize;
+  // no window beyond the rest of the object, k streams of a small object stay small
+  long remain = _objbytes - _offset;
+  long remainwindow = (remain + slicesize - 1) / slicesize * slicesize;
+  if (remainwindow > 0 && remainwindow < maxwindow) maxwindow = remainwindow;
+  if (maxwindow < slicesize) maxwindow = slicesize;
+  char* windows[2];
+  int winlen[2] = {0, 0};
+  bool ready[2] = {false, false};
+  bool last[2] = {false, false};
+  for (int i=0; i<2; i++) {
+    if (posix_memalign((void**)&windows[i], READAHEAD_ALIGN, maxwindow)) {
+      LOG_ERROR << "FSObjInputStream::readAhead.malloc window fail";
+      if (i) free(windows[0]);
+      return;
+    }
+  }
+
+  mutex ralock;
+  condition_variable racv;
+  thread filler = thread([&]{
+    int widx = 0;
+    while (true) {
+      {
+        unique_lock<mutex> lck(ralock);
+        racv.wait(lck, [&]{ return !ready[widx]; });
+      }
+      int curwindow = _raWindow / slicesize * slicesize;
+      if (curwindow < slicesize) curwindow = slicesize;
+      if (curwindow > maxwindow) curwindow = maxwindow;
+
+      struct timeval t1, t2;
+      gettimeofday(&t1, NULL);
+      int len = fillWindow(windows[widx], curwindow);
+      gettimeofday(&t2, NULL);
+
+      // resize the next window from the throughput of this one
+      double ms = RedisUtil::duration(t1, t2);
+      if (len == curwindow) {
+        double target = (ms > 0) ? (double)len / ms * READAHEAD_TARGET_MS : (double)maxwindow;
+        if (target < _conf->_readahead_size) target = _conf->_readahead_size;
+        if (target > maxwindow) target = maxwindow;
+        _raWindow = (int)target;
+      }
+
+      {
+        unique_lock<mutex> lck(ralock);
+        winlen[widx] = len;
+        last[widx] = (len < curwindow);
+        ready[widx] = true;
+      }
+      racv.notify_all();
+      if (len < curwindow) break;
+      widx = 1 - widx;
+    }
+  });
+
+  int widx = 0;
+  while (true) {
+    int len;
+    bool islast;
+    {
+      unique_lock<mutex> lck(ralock);
+      racv.wait(lck, [&]{ return ready[widx]; });
+      len = winlen[widx];
+      islast = last[widx];
+    }
+    // packets own their |len|data| buffer and are freed by the consumer, often after this
+    // window is refilled, so slices are copied out rather than handed out as views
+    for (int off = 0; off < len; off += slicesize) {
+      int curlen = (len - off < slicesize) ? len - off : slicesize;
+      char* buf;
+      if (curlen == slicesize) buf = (char*)malloc(slicesize + 4);
+      else buf = (char*)calloc(slicesize + 4, sizeof(char));
+      int tmplen = htonl(curlen);
+      memcpy(buf, (char*)&tmplen, 4);
+      memcpy(buf + 4, windows[widx] + off, curlen);
+      OECDataPacket* curPkt = new OECDataPacket();
+      curPkt->setRaw(buf);
+      _queue->push(curPkt); _dataPktNum++;
+    }
+    {
+      unique_lock<mutex> lck(ralock);
+      ready[widx] = false;
+    }
+    racv.notify_all();
+    if (islast) break;
+    widx = 1 - widx;
+  }
+  filler.join();
+  free(windows[0]);
+  free(windows[1]);
+}
+
+void FSObjInputStream::setRange(long offset, long length, bool zeropadding) {
+  // restrict hasNext/dequeue to [offset, offset+length). Without zeropadding the
+  // range is clipped at the end of the object, otherwise readRange fills the
+  // part beyond the end with zero packets, as zero-padded stripes are encoded
+  _rangeStart = offset;
+  _rangeEnd = offset + length;
+  _rangePad = zeropadding;
+  if (!_rangePad && _rangeEnd > _objbytes) _rangeEnd = _objbytes;
+  if (_rangeStart > _rangeEnd) _rangeStart = _rangeEnd;
+  _offset = _rangeStart;
+  _objbytes = _rangeEnd;
+}
+
+void FSObjInputStream::readRange() {
+  struct timeval time1, time2;
+  gettimeofday(&time1, NULL);
+  int pktsize = _conf->_pktSize;
+  // issue positional reads of up to one read-ahead window and slice them into packets
+  int chunk = _conf->_readahead_size > pktsize ? _conf->_readahead_size / pktsize * pktsize : pktsize;
+  char* window = (char*)calloc(chunk, sizeof(char));
+  if (!window) {
+    LOG_ERROR << "FSObjInputStream::readRange.malloc buffer fail";
+    return;
+  }
+  bool eof = false;
+  for (long start = _rangeStart; start < _rangeEnd; start += chunk) {
+    int len = (_rangeEnd - start < chunk) ? _rangeEnd - start : chunk;
+    int hasread = 0;
+    while (!eof && hasread < len) {
+      int curlen = pReadFile(start + hasread, window + hasread, len - hasread);
+      if (curlen <= 0) eof = true;
+      else hasread += curlen;
+    }
+    if (_rangePad && hasread < len) {
+      memset(window + hasread, 0, len - hasread);
+      hasread = len;
+    }
+    for (int off = 0; off < hasread; off += pktsize) {
+      int curlen = (hasread - off < pktsize) ? hasread - off : pktsize;
+      char* buf = (char*)calloc(pktsize + 4, sizeof(char));
+      int tmplen = htonl(curlen);
+      memcpy(buf, (char*)&tmplen, 4);
+      memcpy(buf + 4, window + off, curlen);
+      OECDataPacket* curPkt = new OECDataPacket();
+      curPkt->setRaw(buf);
+      _queue->push(curPkt); _dataPktNum++;
+    }
+    if (hasread < len) break;
+  }
+  free(window);
+  gettimeofday(&time2, NULL);
+  LOG_DEBUG << "FSObjInputStream.readRange.duration = " << RedisUtil::duration(time1, time2) << " for " << _objname << " [" << _rangeStart << ", " << _rangeEnd << "), pktnum: " << _dataPktNum;
 }
 
 OECDataPacket* FSObjInputStream::dequeue() {
@@ -201,7 +397,7 @@ bool FSObjInputStream::hasNext() {
 int FSObjInputStream::pread(long objoffset, char* buffer, int buflen) {
   int hasread = 0;
   while (hasread < buflen) {
-    int len = _underfs->pReadFile(_underfile, objoffset + hasread, buffer+hasread, buflen - hasread);
+    int len = pReadFile(objoffset + hasread, buffer+hasread, buflen - hasread);
     hasread += len;
   }
   return hasread;
@@ -2,6 +2,7 @@
 #define _FSOBJINPUTSTREAM_HH_
 
 #include "BlockingQueue.hh"
+#include "Metrics.hh"
 #include "OECDataPacket.hh"
 
 #include "../fs/UnderFS.hh"
@@ -15,12 +16,25 @@ class FSObjInputStream {
     BlockingQueue<OECDataPacket*>* _queue;
     int _dataPktNum;
     bool _exist; 
-    int _objbytes;
-    int _offset;
+    long _objbytes;
+    long _offset;
 
     UnderFS* _underfs;
     UnderFile* _underfile;
 
+    // adaptive read-ahead window, measured in bytes
+    int _raWindow;
+
+    // byte range set by setRange
+    long _rangeStart;
+    long _rangeEnd;
+    bool _rangePad;
+    void readAhead(int slicesize);
+    int fillWindow(char* buf, int len);
+    // reads of the underfs, each call is recorded in the dss.read metrics
+    int readFile(char* buf, int len);
+    int pReadFile(long offset, char* buf, int len);
+
   public:
     FSObjInputStream(Config* conf, string objname, UnderFS* fs);
     ~FSObjInputStream();
@@ -28,6 +42,8 @@ class FSObjInputStream {
     void readObj(int slicesize, int unitIdx);
     void readObj(int slicesize);
     void readObj(int w, vector<int> list, int slicesize);
+    void setRange(long offset, long length, bool zeropadding);
+    void readRange();
     OECDataPacket* dequeue();
     bool exist();
     bool hasNext();
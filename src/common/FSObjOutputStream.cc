@@ -16,11 +16,11 @@ FSObjOutputStream::FSObjOutputStream(Config* conf, string objname, UnderFS* fs,
   _underfs = fs;
   _underfile = _underfs->openFile(objname, "write");
   if (!_underfile) {
-    cout << "ERROR::FSObjOutputStream fail to connect to DSS!" << endl;
+    LOG_ERROR << "ERROR::FSObjOutputStream fail to connect to DSS!";
     exit(-1);
   }
   gettimeofday(&time2, NULL);
-  cout << "FSObjOutputStream.objname: " << objname << ", pktnum: " << _totalPktNum << ", initialize time: " << RedisUtil::duration(time1, time2) << endl;
+  LOG_DEBUG << "FSObjOutputStream.objname: " << objname << ", pktnum: " << _totalPktNum << ", initialize time: " << RedisUtil::duration(time1, time2);
 }
 
 FSObjOutputStream::~FSObjOutputStream() {
@@ -32,21 +32,30 @@ FSObjOutputStream::~FSObjOutputStream() {
 }
 
 void FSObjOutputStream::writeObj() {
+  static Histogram* latency = Metrics::histogram("dss.write");
+  static Counter* writeBytes = Metrics::counter("dss.write.bytes");
   struct timeval time1, time2, time3;
   gettimeofday(&time1, NULL);
   int pktid = 0;
 
-  for (int pktid=0; pktid < _totalPktNum; pktid++) {
+  // pktnum < 0: the number of pkts is unknown, write until a NULL pkt is enqueued
+  for (int pktid=0; _totalPktNum < 0 || pktid < _totalPktNum; pktid++) {
     OECDataPacket* curPkt = _queue->pop();
+    if (curPkt == NULL) break;
     _objsize += curPkt->getDatalen();
     // write to hdfs
+    struct timeval t1, t2;
+    gettimeofday(&t1, NULL);
     _underfs->writeFile(_underfile, curPkt->getData(), curPkt->getDatalen());
     _underfs->flushFile(_underfile);
+    gettimeofday(&t2, NULL);
+    latency->record(RedisUtil::duration(t1, t2));
+    writeBytes->add(curPkt->getDatalen());
     delete curPkt;
   }
 
   gettimeofday(&time2, NULL);
-  cout << "FSObjOutputStream.writeObj " << _objname << ".writeFileTime: " << RedisUtil::duration(time1, time2) << endl;
+  LOG_DEBUG << "FSObjOutputStream.writeObj " << _objname << ".writeFileTime: " << RedisUtil::duration(time1, time2);
   _finish = true;
 }
 
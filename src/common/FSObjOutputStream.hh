@@ -3,6 +3,7 @@
 
 #include "BlockingQueue.hh"
 #include "../common/Config.hh"
+#include "../common/Metrics.hh"
 #include "../common/OECDataPacket.hh"
 #include "../fs/UnderFS.hh"
 #include "../inc/include.hh"
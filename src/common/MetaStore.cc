@@ -0,0 +1,298 @@
+#include "MetaStore.hh"
+
+#include <dirent.h>
+#include <unistd.h>
+
+#define META_MAGIC 0x4f45434d  // "OECM"
+#define META_RECORD_HEAD 9
+
+MetaStore::MetaStore(int snapshotRecords) {
+  _snapshotRecords = snapshotRecords;
+  _logFd = -1;
+  _logGen = 0;
+  _appendSeq = 0;
+  _durableSeq = 0;
+  _flushing = false;
+  _sinceSnapshot = 0;
+}
+
+MetaStore::~MetaStore() {
+  unique_lock<mutex> lk(_lock);
+  while (_flushing || !_pending.empty()) {
+    if (!_flushing) flush(lk);
+    else _cond.wait(lk);
+  }
+  if (_logFd >= 0) close(_logFd);
+  _logFd = -1;
+  lk.unlock();
+  releaseLoad();
+}
+
+vector<int> MetaStore::listLogs() {
+  vector<int> gens;
+  DIR* dir = opendir(".");
+  if (!dir) return gens;
+  struct dirent* ent;
+  while ((ent = readdir(dir)) != NULL) {
+    string name(ent->d_name);
+    if (name.compare(0, _logPrefix.length(), _logPrefix) != 0) continue;
+    string genstr = name.substr(_logPrefix.length());
+    if (genstr.empty() || genstr.find_first_not_of("0123456789") != string::npos) continue;
+    gens.push_back(stoi(genstr));
+  }
+  closedir(dir);
+  sort(gens.begin(), gens.end());
+  return gens;
+}
+
+string MetaStore::logPath(int gen) {
+  return _logPrefix + to_string(gen);
+}
+
+void MetaStore::openLog(int gen) {
+  if (_logFd >= 0) close(_logFd);
+  _logGen = gen;
+  _logFd = open(logPath(gen).c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (_logFd < 0) {
+    LOG_ERROR << "ERROR::MetaStore fail to open " << logPath(gen);
+    exit(-1);
+  }
+}
+
+bool MetaStore::exist() {
+  if (access(_snapshotPath.c_str(), F_OK) == 0) return true;
+  return listLogs().size() > 0;
+}
+
+unsigned int MetaStore::checksum(const char* buf, int len) {
+  // FNV-1a, enough to detect a torn record at the tail of a log
+  unsigned int hash = 2166136261u;
+  for (int i=0; i<len; i++) {
+    hash ^= (unsigned char)buf[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+void MetaStore::encodeRecord(string& out, char type, const string& payload) {
+  out.push_back(type);
+  writeInt(out, payload.length());
+  writeInt(out, checksum(payload.c_str(), payload.length()));
+  out.append(payload);
+}
+
+char* MetaStore::readFile(string path, long& size) {
+  size = 0;
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) return NULL;
+  long filesize = lseek(fd, 0, SEEK_END);
+  lseek(fd, 0, SEEK_SET);
+  char* buf = (char*)malloc(filesize > 0 ? filesize : 1);
+  while (size < filesize) {
+    int len = read(fd, buf + size, filesize - size);
+    if (len <= 0) break;
+    size += len;
+  }
+  close(fd);
+  _loadBufs.push_back(buf);
+  return buf;
+}
+
+int MetaStore::parseRecords(const char* buf, long size, vector<MetaRecord>& records) {
+  long off = 0;
+  int num = 0;
+  while (off + META_RECORD_HEAD <= size) {
+    const char* cur = buf + off;
+    MetaRecord rec;
+    rec.type = *cur; cur++;
+    rec.len = readInt(cur);
+    unsigned int sum = (unsigned int)readInt(cur);
+    if (rec.len < 0 || off + META_RECORD_HEAD + rec.len > size) break;
+    rec.data = cur;
+    if (checksum(rec.data, rec.len) != sum) break;
+    records.push_back(rec);
+    off += META_RECORD_HEAD + rec.len;
+    num++;
+  }
+  if (off < size) LOG_WARN << "MetaStore::parseRecords.skip torn tail of " << size - off << " bytes";
+  return num;
+}
+
+void MetaStore::load(vector<MetaRecord>& records) {
+  struct timeval time1, time2;
+  gettimeofday(&time1, NULL);
+
+  // 1. snapshot
+  int snapshotGen = 0;
+  long size;
+  char* buf = readFile(_snapshotPath, size);
+  if (buf && size >= 12) {
+    const char* cur = buf;
+    int magic = readInt(cur);
+    snapshotGen = readInt(cur);
+    int recnum = readInt(cur);
+    if (magic != META_MAGIC) {
+      LOG_ERROR << "ERROR::MetaStore " << _snapshotPath << " is not a metadata snapshot";
+      exit(-1);
+    }
+    records.reserve(recnum);
+    int num = parseRecords(cur, size - 12, records);
+    if (num != recnum) {
+      LOG_ERROR << "ERROR::MetaStore " << _snapshotPath << " is corrupted, " << num << "/" << recnum << " records";
+      exit(-1);
+    }
+  }
+
+  // 2. logs written since the snapshot, in gen order
+  vector<int> gens = listLogs();
+  int lastGen = snapshotGen;
+  for (int gen: gens) {
+    if (gen < snapshotGen) continue;
+    buf = readFile(logPath(gen), size);
+    if (buf) parseRecords(buf, size, records);
+    lastGen = gen;
+  }
+
+  // 3. append to a new log, a torn tail of the last one is never continued
+  _lock.lock();
+  openLog(lastGen + 1);
+  _lock.unlock();
+
+  gettimeofday(&time2, NULL);
+  LOG_INFO << "MetaStore::load.records: " << records.size() << ", snapshot gen: " << snapshotGen
+       << ", logs: " << gens.size() << ", duration: " << RedisUtil::duration(time1, time2);
+}
+
+void MetaStore::releaseLoad() {
+  for (auto buf: _loadBufs) free(buf);
+  _loadBufs.clear();
+}
+
+void MetaStore::flush(unique_lock<mutex>& lk) {
+  // called with _lock held and no flush in progress
+  _flushing = true;
+  string batch;
+  batch.swap(_pending);
+  long upto = _appendSeq;
+  int fd = _logFd;
+  lk.unlock();
+
+  long written = 0;
+  while (written < batch.length()) {
+    int len = write(fd, batch.c_str() + written, batch.length() - written);
+    if (len <= 0) {
+      LOG_ERROR << "ERROR::MetaStore fail to write " << logPath(_logGen);
+      exit(-1);
+    }
+    written += len;
+  }
+  fdatasync(fd);
+
+  lk.lock();
+  _flushing = false;
+  _durableSeq = upto;
+  _cond.notify_all();
+}
+
+void MetaStore::append(char type, const string& payload) {
+  unique_lock<mutex> lk(_lock);
+  encodeRecord(_pending, type, payload);
+  long myseq = ++_appendSeq;
+  _sinceSnapshot++;
+  while (_durableSeq < myseq) {
+    if (!_flushing) flush(lk);
+    else _cond.wait(lk);
+  }
+}
+
+bool MetaStore::needSnapshot() {
+  if (_snapshotRecords <= 0) return false;
+  _lock.lock();
+  bool toret = _sinceSnapshot >= _snapshotRecords;
+  _lock.unlock();
+  return toret;
+}
+
+int MetaStore::rotate() {
+  unique_lock<mutex> lk(_lock);
+  // records queued for the current log must reach it before it is closed
+  while (_flushing || !_pending.empty()) {
+    if (!_flushing) flush(lk);
+    else _cond.wait(lk);
+  }
+  openLog(_logGen + 1);
+  _sinceSnapshot = 0;
+  return _logGen;
+}
+
+void MetaStore::writeSnapshot(int gen, vector<pair<char, string>>& records) {
+  struct timeval time1, time2;
+  gettimeofday(&time1, NULL);
+
+  string out;
+  writeInt(out, META_MAGIC);
+  writeInt(out, gen);
+  writeInt(out, records.size());
+  for (auto& rec: records) encodeRecord(out, rec.first, rec.second);
+
+  // write into a temporary file and rename it, so that a crash keeps the old snapshot
+  string tmppath = _snapshotPath + ".tmp";
+  int fd = open(tmppath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    LOG_ERROR << "ERROR::MetaStore fail to open " << tmppath;
+    return;
+  }
+  long written = 0;
+  while (written < out.length()) {
+    int len = write(fd, out.c_str() + written, out.length() - written);
+    if (len <= 0) break;
+    written += len;
+  }
+  fsync(fd);
+  close(fd);
+  if (written < out.length() || rename(tmppath.c_str(), _snapshotPath.c_str()) != 0) {
+    LOG_ERROR << "ERROR::MetaStore fail to write " << _snapshotPath;
+    unlink(tmppath.c_str());
+    return;
+  }
+
+  // logs before gen are covered by the snapshot
+  for (int oldgen: listLogs()) {
+    if (oldgen < gen) unlink(logPath(oldgen).c_str());
+  }
+
+  gettimeofday(&time2, NULL);
+  LOG_INFO << "MetaStore::writeSnapshot.gen: " << gen << ", records: " << records.size()
+       << ", bytes: " << out.length() << ", duration: " << RedisUtil::duration(time1, time2);
+}
+
+void MetaStore::writeInt(string& out, int value) {
+  out.append((char*)&value, 4);
+}
+
+void MetaStore::writeLong(string& out, long value) {
+  out.append((char*)&value, 8);
+}
+
+void MetaStore::writeString(string& out, const string& s) {
+  writeInt(out, s.length());
+  out.append(s);
+}
+
+int MetaStore::readInt(const char*& buf) {
+  int value;
+  memcpy((char*)&value, buf, 4); buf += 4;
+  return value;
+}
+
+long MetaStore::readLong(const char*& buf) {
+  long value;
+  memcpy((char*)&value, buf, 8); buf += 8;
+  return value;
+}
+
+string MetaStore::readString(const char*& buf) {
+  int slen = readInt(buf);
+  string toret(buf, slen); buf += slen;
+  return toret;
+}
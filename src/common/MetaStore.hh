@@ -0,0 +1,92 @@
+#ifndef _METASTORE_HH_
+#define _METASTORE_HH_
+
+#include "../inc/include.hh"
+#include "../util/RedisUtil.hh"
+
+#include <condition_variable>
+
+using namespace std;
+
+/*
+ * Binary metadata store of the coordinator
+ *
+ * metaLog.<gen>: write-ahead log, a sequence of records
+ * metaSnapshot:  |magic|gen|recnum| + recnum records, the compacted state of all logs before gen
+ *
+ * record: |type (1 byte)|len (4 bytes)|checksum (4 bytes)|payload (len bytes)|
+ *
+ * A record is the whole state of one item (an SSEntry or an encoded stripe of an offline pool),
+ * so a later record of the same item replaces the earlier one. Loading reads the snapshot and
+ * replays the logs from gen on, a torn record ends its log.
+ */
+
+#define META_ENTRY_RECORD 0
+#define META_STRIPE_RECORD 1
+
+typedef struct {
+  char type;
+  const char* data;
+  int len;
+} MetaRecord;
+
+class MetaStore {
+  private:
+    string _snapshotPath = "metaSnapshot";
+    string _logPrefix = "metaLog.";
+    int _snapshotRecords;
+
+    // current log
+    int _logFd;
+    int _logGen;
+
+    // group commit: appenders queue records into _pending, one of them writes
+    // and syncs the whole batch while the others wait for it
+    mutex _lock;
+    condition_variable _cond;
+    string _pending;
+    long _appendSeq;
+    long _durableSeq;
+    bool _flushing;
+    int _sinceSnapshot;
+
+    // buffers holding loaded records
+    vector<char*> _loadBufs;
+
+    vector<int> listLogs();
+    string logPath(int gen);
+    void openLog(int gen);
+    void flush(unique_lock<mutex>& lk);
+    static unsigned int checksum(const char* buf, int len);
+    static void encodeRecord(string& out, char type, const string& payload);
+    char* readFile(string path, long& size);
+    int parseRecords(const char* buf, long size, vector<MetaRecord>& records);
+
+  public:
+    MetaStore(int snapshotRecords);
+    ~MetaStore();
+
+    bool exist();
+    // read snapshot and logs, records stay valid until releaseLoad
+    void load(vector<MetaRecord>& records);
+    void releaseLoad();
+
+    // returns when the record is durable in the log
+    void append(char type, const string& payload);
+
+    // snapshot in two steps: rotate starts a new log and returns its gen, the caller then collects
+    // the state and writes it with writeSnapshot, which drops the logs before gen
+    bool needSnapshot();
+    int rotate();
+    void writeSnapshot(int gen, vector<pair<char, string>>& records);
+
+    // helpers to encode payloads
+    static void writeInt(string& out, int value);
+    static void writeLong(string& out, long value);
+    static void writeString(string& out, const string& s);
+    static int readInt(const char*& buf);
+    static long readLong(const char*& buf);
+    static string readString(const char*& buf);
+};
+
+#endif
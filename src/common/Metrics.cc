@@ -0,0 +1,199 @@
+#include "Metrics.hh"
+
+#include <cmath>
+#include <sstream>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+Counter::Counter() : _value(0) {
+}
+
+void Counter::add(long value) {
+  _value.fetch_add(value, memory_order_relaxed);
+}
+
+long Counter::get() {
+  return _value.load(memory_order_relaxed);
+}
+
+Gauge::Gauge() : _value(0) {
+}
+
+void Gauge::set(long value) {
+  _value.store(value, memory_order_relaxed);
+}
+
+void Gauge::add(long value) {
+  _value.fetch_add(value, memory_order_relaxed);
+}
+
+long Gauge::get() {
+  return _value.load(memory_order_relaxed);
+}
+
+Histogram::Histogram() : _count(0), _sum(0), _max(0) {
+  for (int i=0; i<HIST_BUCKETS; i++) _buckets[i].store(0);
+}
+
+int Histogram::bucketOf(long us) {
+  if (us < HIST_SUB_BUCKETS) return us;
+  int exp = 63 - __builtin_clzl(us);
+  int sub = (us >> (exp - HIST_SUB_BITS)) & (HIST_SUB_BUCKETS - 1);
+  return (exp - HIST_SUB_BITS + 1) * HIST_SUB_BUCKETS + sub;
+}
+
+long Histogram::upperOf(int bucket) {
+  if (bucket < HIST_SUB_BUCKETS) return bucket;
+  int exp = bucket / HIST_SUB_BUCKETS + HIST_SUB_BITS - 1;
+  int sub = bucket % HIST_SUB_BUCKETS;
+  long width = 1L << (exp - HIST_SUB_BITS);
+  return (HIST_SUB_BUCKETS + sub) * width + width - 1;
+}
+
+void Histogram::record(double ms) {
+  long us = ms > 0 ? (long)(ms * 1000 + 0.5) : 0;
+  _buckets[bucketOf(us)].fetch_add(1, memory_order_relaxed);
+  _count.fetch_add(1, memory_order_relaxed);
+  _sum.fetch_add(us, memory_order_relaxed);
+  long curmax = _max.load(memory_order_relaxed);
+  while (us > curmax && !_max.compare_exchange_weak(curmax, us, memory_order_relaxed));
+}
+
+long Histogram::getCount() {
+  return _count.load(memory_order_relaxed);
+}
+
+long Histogram::percentile(double p) {
+  long count = getCount();
+  if (count == 0) return 0;
+  long rank = max((long)ceil(p / 100 * count), 1L);
+  long maxus = _max.load(memory_order_relaxed);
+  long seen = 0;
+  for (int i=0; i<HIST_BUCKETS; i++) {
+    seen += _buckets[i].load(memory_order_relaxed);
+    if (seen >= rank) return min(upperOf(i), maxus);
+  }
+  return maxus;
+}
+
+string Histogram::dump(string name) {
+  long count = getCount();
+  double mean = count ? (double)_sum.load(memory_order_relaxed) / count : 0;
+  char buf[256];
+  snprintf(buf, sizeof(buf), "%s count=%ld mean=%.3f p50=%.3f p90=%.3f p99=%.3f p999=%.3f max=%.3f\n",
+           name.c_str(), count, mean / 1000, percentile(50) / 1000.0, percentile(90) / 1000.0,
+           percentile(99) / 1000.0, percentile(99.9) / 1000.0, _max.load(memory_order_relaxed) / 1000.0);
+  return string(buf);
+}
+
+mutex Metrics::_lock;
+map<string, Counter*> Metrics::_counters;
+map<string, Gauge*> Metrics::_gauges;
+map<string, Histogram*> Metrics::_histograms;
+
+Counter* Metrics::counter(string name) {
+  lock_guard<mutex> lck(_lock);
+  Counter*& toret = _counters[name];
+  if (toret == NULL) toret = new Counter();
+  return toret;
+}
+
+Gauge* Metrics::gauge(string name) {
+  lock_guard<mutex> lck(_lock);
+  Gauge*& toret = _gauges[name];
+  if (toret == NULL) toret = new Gauge();
+  return toret;
+}
+
+Histogram* Metrics::histogram(string name) {
+  lock_guard<mutex> lck(_lock);
+  Histogram*& toret = _histograms[name];
+  if (toret == NULL) toret = new Histogram();
+  return toret;
+}
+
+string Metrics::dump() {
+  // the metrics are never freed, only the maps need the lock
+  vector<pair<string, Counter*>> counters;
+  vector<pair<string, Gauge*>> gauges;
+  vector<pair<string, Histogram*>> histograms;
+  _lock.lock();
+  counters.assign(_counters.begin(), _counters.end());
+  gauges.assign(_gauges.begin(), _gauges.end());
+  histograms.assign(_histograms.begin(), _histograms.end());
+  _lock.unlock();
+
+  stringstream ss;
+  for (auto item: counters) ss << item.first << " " << item.second->get() << "\n";
+  for (auto item: gauges) ss << item.first << " " << item.second->get() << "\n";
+  for (auto item: histograms) ss << item.second->dump(item.first);
+  return ss.str();
+}
+
+void Metrics::serve(unsigned int ip, int port) {
+  int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+  if (sockfd < 0) {
+    LOG_ERROR << "Metrics::serve.socket fail";
+    return;
+  }
+  int reuse = 1;
+  setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = ip;
+  addr.sin_port = htons(port);
+  if (bind(sockfd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(sockfd, 16) < 0) {
+    LOG_ERROR << "Metrics::serve.fail to listen on port " << port;
+    close(sockfd);
+    return;
+  }
+  LOG_INFO << "Metrics::serve.listen on port " << port;
+  while (true) {
+    int connfd = accept(sockfd, NULL, NULL);
+    if (connfd < 0) continue;
+    // the request is not parsed, a plain connection (nc) and an http client (curl) both get the dump
+    struct timeval timeout = {0, 100000};
+    setsockopt(connfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    char req[1024];
+    recv(connfd, req, sizeof(req), 0);
+    string body = dump();
+    string resp = "HTTP/1.0 200 OK\r\nContent-Type: text/plain\r\nContent-Length: " + to_string(body.size()) + "\r\n\r\n" + body;
+    int sent = 0;
+    while (sent < resp.size()) {
+      int len = send(connfd, resp.c_str() + sent, resp.size() - sent, MSG_NOSIGNAL);
+      if (len <= 0) break;
+      sent += len;
+    }
+    close(connfd);
+  }
+}
+
+void Metrics::dumpTo(string filename, int interval) {
+  string tmpname = filename + ".tmp";
+  while (true) {
+    this_thread::sleep_for(chrono::milliseconds(interval));
+    // readers never see a partial dump
+    ofstream out(tmpname, ios::trunc);
+    out << dump();
+    out.close();
+    if (rename(tmpname.c_str(), filename.c_str()) != 0) {
+      LOG_ERROR << "Metrics::dumpTo.fail to write " << filename;
+    }
+  }
+}
+
+void Metrics::start(Config* conf) {
+  if (conf->_metrics_port > 0) {
+    unsigned int ip = conf->_localIp;
+    int port = conf->_metrics_port;
+    thread([=]{serve(ip, port);}).detach();
+  }
+  if (conf->_metrics_dump_file != "-" && conf->_metrics_dump_file != "" && conf->_metrics_dump_interval > 0) {
+    string filename = conf->_metrics_dump_file;
+    int interval = conf->_metrics_dump_interval;
+    thread([=]{dumpTo(filename, interval);}).detach();
+  }
+}
@@ -0,0 +1,90 @@
+#ifndef _METRICS_HH_
+#define _METRICS_HH_
+
+#include "Config.hh"
+
+#include "../inc/include.hh"
+
+#include <atomic>
+#include <map>
+
+using namespace std;
+
+class Counter {
+  private:
+    atomic<long> _value;
+  public:
+    Counter();
+    void add(long value = 1);
+    long get();
+};
+
+class Gauge {
+  private:
+    atomic<long> _value;
+  public:
+    Gauge();
+    void set(long value);
+    void add(long value);
+    long get();
+};
+
+/*
+ * Latency histogram with log-linear buckets
+ *
+ * Values are recorded in us. Each power of two is split into HIST_SUB_BUCKETS linear buckets,
+ * so a reported percentile is within 1/HIST_SUB_BUCKETS of the recorded value.
+ */
+#define HIST_SUB_BITS 4
+#define HIST_SUB_BUCKETS (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS) * HIST_SUB_BUCKETS)
+
+class Histogram {
+  private:
+    atomic<long> _buckets[HIST_BUCKETS];
+    atomic<long> _count;
+    atomic<long> _sum;
+    atomic<long> _max;
+
+    static int bucketOf(long us);
+    static long upperOf(int bucket);
+  public:
+    Histogram();
+    // ms, as returned by RedisUtil::duration
+    void record(double ms);
+    long getCount();
+    // us of the p-th percentile, p in [0, 100]
+    long percentile(double p);
+    string dump(string name);
+};
+
+/*
+ * Process-wide registry of the metrics of agents and coordinator
+ *
+ * Looking up a name takes a lock and creates the metric on first use, call sites keep the
+ * returned pointer (e.g. in a function-local static) so that recording only touches atomics.
+ * Metrics are never freed. The dump is one line per metric sorted by name:
+ *   counter/gauge: name value
+ *   histogram: name count=.. mean=.. p50=.. p90=.. p99=.. p999=.. max=.. (ms)
+ */
+class Metrics {
+  private:
+    static mutex _lock;
+    static map<string, Counter*> _counters;
+    static map<string, Gauge*> _gauges;
+    static map<string, Histogram*> _histograms;
+
+    static void serve(unsigned int ip, int port);
+    static void dumpTo(string filename, int interval);
+  public:
+    static Counter* counter(string name);
+    static Gauge* gauge(string name);
+    static Histogram* histogram(string name);
+    static string dump();
+
+    // metrics.port: text endpoint on local.addr, any request gets the dump (0 disables)
+    // metrics.dump.file: file rewritten with the dump every metrics.dump.interval ms (- disables)
+    static void start(Config* conf);
+};
+
+#endif
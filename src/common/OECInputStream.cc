@@ -4,6 +4,20 @@ OECInputStream::OECInputStream(Config* conf,
                                string filename) {
   _conf = conf;
   _filename = filename;
+  _offset = 0;
+  _length = -1;
+  _localCtx = RedisUtil::createContext(_conf->_localIp);
+  init();
+}
+
+OECInputStream::OECInputStream(Config* conf,
+                               string filename,
+                               long offset,
+                               long length) {
+  _conf = conf;
+  _filename = filename;
+  _offset = offset;
+  _length = length;
   _localCtx = RedisUtil::createContext(_conf->_localIp);
   init();
 }
@@ -14,7 +28,8 @@ OECInputStream::~OECInputStream() {
 
 void OECInputStream::init() {
   AGCommand* agCmd = new AGCommand();
-  agCmd->buildType1(1, _filename);
+  if (_length < 0) agCmd->buildType1(1, _filename);
+  else agCmd->buildType8(8, _filename, _offset, _length);
   agCmd->sendTo(_conf->_localIp);
   delete agCmd;
 
@@ -25,10 +40,41 @@ void OECInputStream::init() {
   int tmpfilesize;
   memcpy((char*)&tmpfilesize, response, 4); response += 4;
   _filesizeMB = ntohl(tmpfilesize);
+  // |filesizeMB|filesizeB| from agents that know the exact length of the file
+  long filebytes = (long)_filesizeMB * 1048576;
+  if (rReply -> element[1] -> len >= 12) {
+    int tmphigh, tmplow;
+    memcpy((char*)&tmphigh, response, 4); response += 4;
+    memcpy((char*)&tmplow, response, 4); response += 4;
+    filebytes = (long)(((unsigned long)(unsigned int)ntohl(tmphigh) << 32) | (unsigned int)ntohl(tmplow));
+  }
 
   freeReplyObject(rReply);
 
   _readQueue = new BlockingQueue<OECDataPacket*>();
+  // filesizeMB < 0: the file does not exist and the agent sends no pkts
+  if (_filesizeMB < 0) {
+    LOG_ERROR << "OECInputStream::init." << _filename << " not found";
+    _pktnum = 0;
+    _skip = 0;
+    _length = 0;
+    return;
+  }
+
+  // clamp the range to the file in the same way as OECWorker::clientRead
+  if (_length < 0) {
+    _pktnum = (filebytes + _conf->_pktSize - 1) / _conf->_pktSize;
+    _skip = 0;
+    _offset = 0;
+    _length = filebytes;
+  } else {
+    if (_offset < 0) _offset = 0;
+    if (_offset > filebytes) _offset = filebytes;
+    if (_offset + _length > filebytes) _length = filebytes - _offset;
+    int firstpkt = _offset / _conf->_pktSize;
+    _pktnum = (_length > 0) ? (_offset + _length - 1) / _conf->_pktSize - firstpkt + 1 : 0;
+    _skip = _offset - (long)firstpkt * _conf->_pktSize;
+  }
 
   _collectThread = thread([=]{readWorker(_readQueue, _filename);});
 }
@@ -37,7 +83,7 @@ void OECInputStream::readWorker(BlockingQueue<OECDataPacket*>* readQueue, string
   struct timeval t1, t2, start, end;
   gettimeofday(&start, NULL);
 
-  int pktnum = _filesizeMB * 1048576/_conf->_pktSize;
+  int pktnum = _pktnum;
   redisReply* rReply;
   redisContext* readCtx = _localCtx;
 
@@ -62,7 +108,7 @@ void OECInputStream::readWorker(BlockingQueue<OECDataPacket*>* readQueue, string
     freeReplyObject(rReply);
   }
   gettimeofday(&end, NULL);
-  cout << "OECInputStream::readWorker.duration: " << RedisUtil::duration(start, end) << endl;
+  LOG_DEBUG << "OECInputStream::readWorker.duration: " << RedisUtil::duration(start, end);
 }
 
 void OECInputStream::output2file(string saveas) {
@@ -72,13 +118,22 @@ void OECInputStream::output2file(string saveas) {
   ofs.close();
   ofs.open(saveas, ios::app);
 
-  int num = _filesizeMB * 1048576 / _conf->_pktSize;
+  int num = _pktnum;
 
+  // drop the bytes before _offset in the first packet and after _offset+_length in the last one
+  long remain = _length;
   for (int i=0; i<num; i++) {
     OECDataPacket* curPkt = _readQueue->pop();
     int len = curPkt->getDatalen();
     if (len) {
-      ofs.write(curPkt->getData(), len);
+      char* data = curPkt->getData();
+      if (i == 0) {
+        data += _skip;
+        len -= _skip;
+      }
+      if (len > remain) len = remain;
+      if (len > 0) ofs.write(data, len);
+      remain -= len;
     }
     else break;
     delete curPkt;
@@ -86,9 +141,17 @@ void OECInputStream::output2file(string saveas) {
 
   ofs.close();
   gettimeofday(&time2, NULL);
-  cout << "OECInputStream::output2file.time = " << RedisUtil::duration(time1, time2) << endl;
+  LOG_DEBUG << "OECInputStream::output2file.time = " << RedisUtil::duration(time1, time2);
+}
+
+bool OECInputStream::exist() {
+  return _filesizeMB >= 0;
+}
+
+long OECInputStream::getLength() {
+  return _length;
 }
 
 void OECInputStream::close() {
-  _collectThread.join();
+  if (_collectThread.joinable()) _collectThread.join();
 }
@@ -20,14 +20,28 @@ class OECInputStream {
     BlockingQueue<OECDataPacket*>* _readQueue;
     int _filesizeMB;
     thread _collectThread;
+
+    // requested byte range, _length < 0 reads the whole file
+    long _offset;
+    long _length;
+    // packets cached by the agent for the range and bytes to skip in the first one
+    int _pktnum;
+    int _skip;
   public:
     OECInputStream(Config* conf, 
                    string filename);
+    OECInputStream(Config* conf,
+                   string filename,
+                   long offset,
+                   long length);
     ~OECInputStream();
     void init();
     void readWorker(BlockingQueue<OECDataPacket*>* readQueue,
                    string keybase);
+    // false if the file does not exist, nothing is read then
+    bool exist();
     void output2file(string saveas);
+    long getLength();
     void close();
 };
 
@@ -13,6 +13,10 @@ OECOutputStream::OECOutputStream(Config* conf,
   _localCtx = RedisUtil::createContext(_conf->_localIp);
   _pktid = 0;
   _replyid = 0;
+  _window = 1;
+  if (_mode == "online" && _conf->_ecPolicyMap.find(_ecidpool) != _conf->_ecPolicyMap.end()) {
+    _window = _conf->_ecPolicyMap[_ecidpool]->getK();
+  }
   init();
 }
 
@@ -23,6 +27,7 @@ OECOutputStream::~OECOutputStream() {
 void OECOutputStream::init() {
   /*
    *  tell local OECAgent that I want to write a file of size
+   *  (filesizeMB < 0 if the size is unknown, online mode only)
    */
   AGCommand* agCmd = new AGCommand();  
   agCmd->buildType0(0, _filename, _ecidpool, _mode, _filesizeMB);
@@ -41,11 +46,28 @@ void OECOutputStream::write(char* buf, int len) {
   string key = _filename + ":" + to_string(_pktid++);
   // pipelining
   redisAppendCommand(_localCtx, "RPUSH %s %b", key.c_str(), buf, len);
+
+  // keep at most two stripes unacknowledged: the first redisGetReply flushes the pipeline, so
+  // the agent encodes stripes as they fill and the client does not buffer the whole file
+  if (_pktid - _replyid >= 2 * _window) {
+    redisReply* rReply;
+    while (_pktid - _replyid > _window) {
+      redisGetReply(_localCtx, (void**)&rReply);
+      freeReplyObject(rReply);
+      _replyid++;
+    }
+  }
 }
 
 void OECOutputStream::close() {
   struct timeval time1, time2, time3;
   gettimeofday(&time1, NULL);
+
+  // filesizeMB < 0: the size is not known in advance, end the stream with a pkt of length 0
+  if (_filesizeMB < 0) {
+    int tmplen = htonl(0);
+    write((char*)&tmplen, 4);
+  }
  
   redisReply* rReply;
   for (int i=_replyid; i<_pktid; i++) { 
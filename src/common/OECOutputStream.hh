@@ -19,6 +19,8 @@ class OECOutputStream {
     redisContext* _localCtx;
     int _pktid;
     int _replyid;
+    // pkts sent ahead of their replies, one stripe of the online code
+    int _window;
   public:
     OECOutputStream(Config* conf, string filename, string ecidpool, string mode, int filesizeMB);
     ~OECOutputStream();
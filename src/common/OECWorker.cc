@@ -1,5 +1,17 @@
 #include "OECWorker.hh"
 
+// codes one stripe, the time and bytes go to the agent.compute metrics
+static void computeStripe(char** code, char** data, int* matrix, int row, int col, int len) {
+  static Histogram* latency = Metrics::histogram("agent.compute");
+  static Counter* computeBytes = Metrics::counter("agent.compute.bytes");
+  struct timeval time1, time2;
+  gettimeofday(&time1, NULL);
+  Computation::Multi(code, data, matrix, row, col, len, "Isal");
+  gettimeofday(&time2, NULL);
+  latency->record(RedisUtil::duration(time1, time2));
+  computeBytes->add((long)len * col);
+}
+
 OECWorker::OECWorker(Config* conf) : _conf(conf) {
   // create local context
   try {
@@ -8,7 +20,7 @@ OECWorker::OECWorker(Config* conf) : _conf(conf) {
     _coorCtx = RedisUtil::createContext(_conf -> _coorIp);
   } catch (int e) {
     // TODO: error handling
-    cerr << "initializing redis context error" << endl;
+    LOG_ERROR << "initializing redis context error";
   }
 
   _underfs = FSUtil::createFS(_conf->_fsType, _conf->_fsFactory[_conf->_fsType], _conf);
@@ -29,22 +41,31 @@ OECWorker::~OECWorker() {
 
 void OECWorker::doProcess() {
   redisReply* rReply;
+  // request latency by type, the histograms are looked up once per worker
+  unordered_map<int, Histogram*> latency;
+  vector<pair<int, string>> requestNames = {{0, "clientWrite"}, {1, "clientRead"}, {2, "readDisk"}, {3, "fetchCompute"},
+                                            {5, "persist"}, {7, "readFetchCompute"}, {8, "clientRead"}, {12, "batch"}};
+  for (auto item: requestNames) latency.insert(make_pair(item.first, Metrics::histogram("agent.request." + item.second)));
+  Counter* requests = Metrics::counter("agent.requests");
+  Gauge* inflight = Metrics::gauge("agent.inflight");
   while (true) {
-    cout << "OECWorker::doProcess" << endl;  
+    LOG_DEBUG << "OECWorker::doProcess";  
     // will never stop looping
     rReply = (redisReply*)redisCommand(_processCtx, "blpop ag_request 0");
     if (rReply -> type == REDIS_REPLY_NIL) {
-      cerr << "OECWorker::doProcess() get feed back empty queue " << endl;
+      LOG_ERROR << "OECWorker::doProcess() get feed back empty queue ";
       //freeReplyObject(rReply);
     } else if (rReply -> type == REDIS_REPLY_ERROR) {
-      cerr << "OECWorker::doProcess() get feed back ERROR happens " << endl;
+      LOG_ERROR << "OECWorker::doProcess() get feed back ERROR happens ";
     } else {
       struct timeval time1, time2;
       gettimeofday(&time1, NULL);
       char* reqStr = rReply -> element[1] -> str;
       AGCommand* agCmd = new AGCommand(reqStr);
       int type = agCmd->getType();
-      cout << "OECWorker::doProcess() receive a request of type " << type << endl;
+      LOG_DEBUG << "OECWorker::doProcess() receive a request of type " << type;
+      requests->add();
+      inflight->add(1);
       //agCmd->dump();
       switch (type) {
         case 0: clientWrite(agCmd); break;
@@ -54,10 +75,15 @@ void OECWorker::doProcess() {
         case 5: persist(agCmd); break;
 //        case 6: readDiskList(agCmd); break;
         case 7: readFetchCompute(agCmd); break;
+        case 8: clientRead(agCmd); break;
+        case 12: batch(agCmd); break;
+        case 13: _underfs->invalidate(agCmd->getFilename()); break;
         default:break;
       }
-//      gettimeofday(&time2, NULL);
+      gettimeofday(&time2, NULL);
 //      cout << "OECWorker::doProcess().duration = " << RedisUtil::duration(time1, time2) << endl;
+      inflight->add(-1);
+      if (latency.find(type) != latency.end()) latency[type]->record(RedisUtil::duration(time1, time2));
       // delete agCmd
       delete agCmd;
     }
@@ -67,17 +93,18 @@ void OECWorker::doProcess() {
 }
 
 void OECWorker::clientWrite(AGCommand* agcmd) {
-  cout << "OECWorker::clientWrite" << endl;
+  LOG_DEBUG << "OECWorker::clientWrite";
   string filename = agcmd->getFilename();
   string ecid = agcmd->getEcid();
   string mode = agcmd->getMode();
   int filesizeMB = agcmd->getFilesizeMB();
   if (mode == "online") onlineWrite(filename, ecid, filesizeMB);
+  else if (mode == "offline" && filesizeMB < 0) LOG_DEBUG << "OECWorker::clientWrite.offline write needs filesizeMB";
   else if (mode == "offline") offlineWrite(filename, ecid, filesizeMB);
 }
 
 void OECWorker::onlineWrite(string filename, string ecid, int filesizeMB) {
-  cout <<"OECWorker::onlineWrite" << endl;
+  LOG_DEBUG << "OECWorker::onlineWrite";
   struct timeval time1, time2, time3, time4;
   
   // 0. send request to coordinator that I want to write a file with online erasure coding
@@ -104,11 +131,15 @@ void OECWorker::onlineWrite(string filename, string ecid, int filesizeMB) {
   int computen = agCmd->getComputen();
   delete agCmd;
 
-  int totalNumPkt = filesizeMB * 1048576/_conf->_pktSize;
-  int totalNumRounds = totalNumPkt / eck;
-  int lastNum = totalNumPkt % eck;
+  // filesizeMB < 0: the client streams the file without knowing its size in advance,
+  // the number of pkts and stripes is only known when the client ends the stream
+  bool streaming = filesizeMB < 0;
+  int totalNumPkt = streaming ? -1 : filesizeMB * 1048576/_conf->_pktSize;
+  int totalNumRounds = streaming ? -1 : totalNumPkt / eck;
+  int lastNum = streaming ? 0 : totalNumPkt % eck;
   bool zeropadding = false;
   if (lastNum > 0) zeropadding = true;
+  long filesizeB = (long)totalNumPkt * _conf->_pktSize;
 
   // 2. get compute tasks
   vector<ECTask*> computeTasks;
@@ -123,15 +154,19 @@ void OECWorker::onlineWrite(string filename, string ecid, int filesizeMB) {
   }
   redisFree(waitCtx);
   gettimeofday(&time2, NULL);
-  cout << "OECWorker::onlineWrite.registerFile.duraiton = " << RedisUtil::duration(time1, time2) << endl;
+  LOG_DEBUG << "OECWorker::onlineWrite.registerFile.duraiton = " << RedisUtil::duration(time1, time2);
 
   // 2. create threads for Load tasks to load data from local redis
   BlockingQueue<OECDataPacket*>** loadQueue = (BlockingQueue<OECDataPacket*>**)calloc(eck, sizeof(BlockingQueue<OECDataPacket*>*));
   for (int i=0; i<eck; i++) {
     loadQueue[i] = new BlockingQueue<OECDataPacket*>();
   }
-  vector<thread> loadThreads = vector<thread>(eck);
-  for (int i=0; i<eck; i++) {
+  vector<thread> loadThreads = vector<thread>(streaming ? 1 : eck);
+  if (streaming) {
+    long* streamsize = &filesizeB;
+    loadThreads[0] = thread([=]{streamLoadWorker(loadQueue, filename, eck, streamsize);});
+  }
+  for (int i=0; !streaming && i<eck; i++) {
     int curnum = totalNumRounds;
     bool curzero = false;
     if (lastNum > 0 && i < lastNum) curnum = curnum + 1;
@@ -147,6 +182,7 @@ void OECWorker::onlineWrite(string filename, string ecid, int filesizeMB) {
     int curnum = totalNumRounds;
     if (lastNum > 0 && i < lastNum) curnum = curnum + 1;
     if (lastNum > 0 && i >= eck) curnum = curnum + 1;
+    if (streaming) curnum = -1;
     string objname = filename+"_oecobj_"+to_string(i);
     createThreads[i] = thread([=]{objstreams[i] = new FSObjOutputStream(_conf, objname, _underfs, curnum);});
   }
@@ -164,7 +200,7 @@ void OECWorker::onlineWrite(string filename, string ecid, int filesizeMB) {
   thread computeThread([=]{computeWorker(computeTasks, loadQueue, objstreams, stripenum, ecn, eck, ecw);});
    
   // join
-  for (int i=0; i<eck; i++) loadThreads[i].join();
+  for (int i=0; i<loadThreads.size(); i++) loadThreads[i].join();
   computeThread.join();
   for (int i=0; i<ecn; i++) persistThreads[i].join();
 
@@ -189,7 +225,7 @@ void OECWorker::onlineWrite(string filename, string ecid, int filesizeMB) {
     redisFree(waitCtx);
   } 
   gettimeofday(&time3, NULL);
-  cout << "OECWorker::onlineWrite.duration: " << RedisUtil::duration(time1, time3) << endl;
+  LOG_DEBUG << "OECWorker::onlineWrite.duration: " << RedisUtil::duration(time1, time3);
 
   // free
   for (int i=0; i<eck; i++) delete loadQueue[i];
@@ -198,9 +234,9 @@ void OECWorker::onlineWrite(string filename, string ecid, int filesizeMB) {
   free(objstreams);
   for (auto compute: computeTasks) delete compute;
 
-  // finalize writing offline-encoded file
+  // finalize writing online-encoded file with its exact length
   CoorCommand* coorCmd1 = new CoorCommand();
-  coorCmd1->buildType2(2, _conf->_localIp, filename); 
+  coorCmd1->buildType13(13, _conf->_localIp, filename, filesizeB); 
   coorCmd1->sendTo(_coorCtx);
   delete coorCmd1;
 }
@@ -230,8 +266,8 @@ void OECWorker::offlineWrite(string filename, string ecpoolid, int filesizeMB) {
   int basesizeMB = agCmd->getBasesizeMB();
   delete agCmd;
   gettimeofday(&time2, NULL);
-  cout << "offlineWrite::get response from coordinator: " << RedisUtil::duration(time1, time2) << endl;
-  cout << "offlineWrite::objnum = " << objnum << ", basesizeMB = " << basesizeMB << endl;
+  LOG_DEBUG << "offlineWrite::get response from coordinator: " << RedisUtil::duration(time1, time2);
+  LOG_DEBUG << "offlineWrite::objnum = " << objnum << ", basesizeMB = " << basesizeMB;
 
   vector<int> pktnums;
   for (int i=0; i<objnum; i++) {
@@ -294,7 +330,7 @@ void OECWorker::offlineWrite(string filename, string ecpoolid, int filesizeMB) {
     redisReply* rReply;
     redisContext* waitCtx = RedisUtil::createContext(_conf->_localIp);
     string wkey = "writefinish:" + filename;
-    cout << "write " << wkey << " into redis" << endl;
+    LOG_DEBUG << "write " << wkey << " into redis";
     int tmpval = htonl(1);
     rReply = (redisReply*)redisCommand(waitCtx, "rpush %s %b", wkey.c_str(), (char*)&tmpval, sizeof(tmpval));
     freeReplyObject(rReply);
@@ -306,9 +342,11 @@ void OECWorker::offlineWrite(string filename, string ecpoolid, int filesizeMB) {
   free(objstreams);
   free(loadQueue);
 
-  // finalize writing offline-encoded file
+  // finalize writing offline-encoded file with its exact length
+  long filesizeB = 0;
+  for (int i=0; i<objnum; i++) filesizeB += (long)pktnums[i] * _conf->_pktSize;
   CoorCommand* coorCmd1 = new CoorCommand();
-  coorCmd1->buildType2(2, _conf->_localIp, filename); 
+  coorCmd1->buildType13(13, _conf->_localIp, filename, filesizeB); 
   coorCmd1->sendTo(_coorCtx);
   delete coorCmd1;
 }
@@ -319,11 +357,8 @@ void OECWorker::loadWorker(BlockingQueue<OECDataPacket*>* readQueue,
                     int step,
                     int round,
                     bool zeropadding) {
-  cout << "OECWorker::loadWorker. keybase = " << keybase;
-  cout << ", startid = " << startid;
-  cout << ", step = " << step;
-  cout << ", round = " << round;
-  cout << ", zeropadding = " << zeropadding << endl;
+  LOG_DEBUG << "OECWorker::loadWorker. keybase = " << keybase << ", startid = " << startid << ", step = " << step
+            << ", round = " << round << ", zeropadding = " << zeropadding;
   struct timeval time1, time2, time3;
   gettimeofday(&time1, NULL);
   // read from redis
@@ -355,7 +390,64 @@ void OECWorker::loadWorker(BlockingQueue<OECDataPacket*>* readQueue,
   }
   redisFree(readCtx);
   gettimeofday(&time2, NULL);
-  cout << "OECWorker::loadWorker.from client.duration = " << RedisUtil::duration(time1, time2) << endl;
+  LOG_DEBUG << "OECWorker::loadWorker.from client.duration = " << RedisUtil::duration(time1, time2);
+  static Histogram* latency = Metrics::histogram("agent.load");
+  latency->record(RedisUtil::duration(time1, time2));
+}
+
+void OECWorker::streamLoadWorker(BlockingQueue<OECDataPacket*>** readQueue,
+                    string keybase,
+                    int eck,
+                    long* filesizeB) {
+  // The client streams pkts keybase:0, keybase:1, ... and ends the stream with a pkt
+  // of length 0. pkt i goes to readQueue[i%eck]. A short last pkt is zero-filled to
+  // a whole pkt, NULL pkts pad the last stripe and a NULL pkt in readQueue[0] ends
+  // the stream for computeWorker
+  LOG_DEBUG << "OECWorker::streamLoadWorker. keybase = " << keybase;
+  struct timeval time1, time2;
+  gettimeofday(&time1, NULL);
+  redisContext* readCtx = RedisUtil::createContext(_conf->_localIp);
+  int pktsize = _conf->_pktSize;
+  long bytes = 0;
+  int pktid = 0;
+  while (true) {
+    string key = keybase + ":" + to_string(pktid);
+    redisReply* rReply = (redisReply*)redisCommand(readCtx, "blpop %s 0", key.c_str());
+    char* content = rReply->element[1]->str;
+    int tmplen;
+    memcpy((char*)&tmplen, content, 4);
+    int datalen = ntohl(tmplen);
+    if (datalen <= 0) {
+      freeReplyObject(rReply);
+      break;
+    }
+    OECDataPacket* pkt = new OECDataPacket(pktsize);
+    memcpy(pkt->getData(), content + 4, datalen < pktsize ? datalen : pktsize);
+    freeReplyObject(rReply);
+    readQueue[pktid % eck]->push(pkt);
+    bytes += datalen < pktsize ? datalen : pktsize;
+    pktid++;
+    // only the last pkt of the stream can be short
+    if (datalen < pktsize) break;
+  }
+  // a short last pkt is followed by the end of stream pkt, remove it as well
+  if (bytes < (long)pktid * pktsize) {
+    string key = keybase + ":" + to_string(pktid);
+    redisReply* rReply = (redisReply*)redisCommand(readCtx, "blpop %s 0", key.c_str());
+    freeReplyObject(rReply);
+  }
+  *filesizeB = bytes;
+  if (pktid % eck) {
+    for (int i=pktid % eck; i<eck; i++) readQueue[i]->push(NULL);
+  }
+  readQueue[0]->push(NULL);
+  redisFree(readCtx);
+  gettimeofday(&time2, NULL);
+  LOG_DEBUG << "OECWorker::streamLoadWorker.pktnum = " << pktid << ", filesizeB = " << bytes << ", duration = " << RedisUtil::duration(time1, time2);
+  static Histogram* latency = Metrics::histogram("agent.load");
+  latency->record(RedisUtil::duration(time1, time2));
+  static Counter* loadBytes = Metrics::counter("agent.load.bytes");
+  loadBytes->add(bytes);
 }
 
 void OECWorker::computeWorkerDegradedOffline(FSObjInputStream** readStreams,
@@ -375,9 +467,7 @@ void OECWorker::computeWorkerDegradedOffline(FSObjInputStream** readStreams,
   for (int i=0; i<idlist.size(); i++) {
     int sid=idlist[i];
     vector<int> cidlist = sid2Cids[sid];
-    cout << "OECWorker::computeWDO.sid: " << sid << ", cidlist: ";
-    for (int j=0; j<cidlist.size(); j++) cout << cidlist[j] << " ";
-    cout << endl;
+    LOG_DEBUG << "OECWorker::computeWDO.sid: " << sid << ", cidlist: " << logList(cidlist);
   }
   for (int stripeid = 0; stripeid < stripenum; stripeid++) {
     unordered_map<int, char*> bufMap;
@@ -446,7 +536,7 @@ void OECWorker::computeWorkerDegradedOffline(FSObjInputStream** readStreams,
           codeBufIdx++;
         }
         // perform compute operation
-        Computation::Multi(code, data, matrix, row, col, splitsize, "Isal");
+        computeStripe(code, data, matrix, row, col, splitsize);
       }
       // check whether there is a need to discuss about row*col = 1
     }
@@ -476,7 +566,7 @@ void OECWorker::computeWorker(FSObjInputStream** readStreams,
                               int ecn,
                               int eck,
                               int ecw) {
-  cout << "OECWorker::computeWorker.stripenum: " << stripenum << endl;
+  LOG_DEBUG << "OECWorker::computeWorker.stripenum: " << stripenum;
   // In this method, we read available data from readStreams, whose stripeidx is in idlist
   // Then we perform compute task one by on in computeTasks for each stripe.
   // Finally, we put original eck data pkts in writeQueue
@@ -554,7 +644,7 @@ void OECWorker::computeWorker(FSObjInputStream** readStreams,
           codeBufIdx++;
         }
         // perform compute operation
-        Computation::Multi(code, data, matrix, row, col, splitsize, "Isal");
+        computeStripe(code, data, matrix, row, col, splitsize);
       }
       // check whether there is a need to discuss about row*col = 1
     }
@@ -582,7 +672,7 @@ void OECWorker::computeWorker(FSObjInputStream** readStreams,
     if (curStripe[i] != NULL) delete curStripe[i];
   }
   if (curStripe) free(curStripe);
-  cout << "OECWorker::computeWorker finishes" << endl;
+  LOG_DEBUG << "OECWorker::computeWorker finishes";
 }
 
 void OECWorker::computeWorker(vector<ECTask*> computeTasks,
@@ -594,7 +684,6 @@ void OECWorker::computeWorker(vector<ECTask*> computeTasks,
                        int ecw) {
   struct timeval time1, time2, time3;
   gettimeofday(&time1, NULL);
-  cout << "OECWorker::computeWorker.stripenum: " << stripenum;
   // In this method, we fetch eck pkts from readQueue and cache into runtime memory
   // If there is need, we need to divide pkt into splits for sub-packetization
   // Then we perform calculations inside ECTask list one by one, results are cached in runtime memory
@@ -603,17 +692,35 @@ void OECWorker::computeWorker(vector<ECTask*> computeTasks,
   OECDataPacket** curStripe = (OECDataPacket**)calloc(ecn, sizeof(OECDataPacket*));
   int pktsize = _conf->_pktSize;
   int splitsize = pktsize / ecw;
-  cout << ", pktsize: " << pktsize
-       << ", splitsize: " << splitsize
-       << ", ecn: " << ecn
-       << ", eck: " << eck
-       << ", ecw: " << ecw << endl;
-
-  for (int stripeid=0; stripeid<stripenum; stripeid++) {
+  LOG_DEBUG << "OECWorker::computeWorker.stripenum: " << stripenum << ", pktsize: " << pktsize
+            << ", splitsize: " << splitsize
+            << ", ecn: " << ecn
+            << ", eck: " << eck
+            << ", ecw: " << ecw;
+
+  // stripenum < 0 means the stripe number is unknown (streaming write):
+  // a NULL pkt at readQueue[0] ends the stream, NULL pkts in the other queues
+  // are zero pkts that pad the last stripe and are not persisted
+  vector<bool> padded(eck, false);
+  for (int stripeid=0; stripenum < 0 || stripeid<stripenum; stripeid++) {
+    bool endOfStream = false;
     for (int pktidx=0; pktidx < eck; pktidx++) {
       OECDataPacket* curPkt = readQueue[pktidx]->pop();
+      padded[pktidx] = false;
+      if (curPkt == NULL) {
+        if (pktidx == 0) {
+          endOfStream = true;
+          break;
+        }
+        curPkt = new OECDataPacket(pktsize);
+        padded[pktidx] = true;
+      }
       curStripe[pktidx] = curPkt;
     }
+    if (endOfStream) {
+      for (int pktidx=0; pktidx<ecn; pktidx++) objstreams[pktidx]->enqueue(NULL);
+      break;
+    }
     // now we have k pkt in a stripe, prepare pkt for parity pkt 
     for (int i=0; i<(ecn-eck); i++) {
       OECDataPacket* paritypkt = new OECDataPacket(pktsize);
@@ -635,24 +742,16 @@ void OECWorker::computeWorker(vector<ECTask*> computeTasks,
       ECTask* compute = computeTasks[taskid];
       vector<int> children = compute->getChildren();
 
-      if (stripeid == 0) {
-        cout << "children: ";
-        for (int childid=0; childid<children.size(); childid++) {
-          cout << children[childid] << " ";
-        }
-        cout << endl;
-      }
+      if (stripeid == 0) LOG_DEBUG << "children: " << logList(children);
 
       unordered_map<int, vector<int>> coefMap = compute->getCoefMap();
 
       if (stripeid == 0) {
-        cout << "coef: "<< endl;
+        LOG_DEBUG << "coef: ";
         for (auto item: coefMap) {
           int target = item.first;
           vector<int> coefs = item.second;
-          cout << "    " << target << ": " << "( ";
-          for (int coefidx=0; coefidx<coefs.size(); coefidx++) cout << coefs[coefidx] << " ";
-          cout << ")" << endl;
+          LOG_DEBUG << "    " << target << ": " << "( " << logList(coefs) << " )";
         }
       }
 
@@ -673,7 +772,7 @@ void OECWorker::computeWorker(vector<ECTask*> computeTasks,
           assert (bufMap.find(child) != bufMap.end());
           data[bufIdx] = bufMap[child];
           if (stripeid == 0) {
-            cout << "data["<<bufIdx<<"] = bufMap[" <<child<<"]"<< endl;
+            LOG_DEBUG << "data["<<bufIdx<<"] = bufMap[" <<child<<"]";
           }
         }
         // prepare the code buf
@@ -684,10 +783,10 @@ void OECWorker::computeWorker(vector<ECTask*> computeTasks,
           if (bufMap.find(target) == bufMap.end()) {
             codebuf = (char*)calloc(splitsize, sizeof(char));
             bufMap.insert(make_pair(target, codebuf)); 
-            if (stripeid == 0) cout << "code["<<codeBufIdx<<"] = new" << endl;
+            if (stripeid == 0) LOG_DEBUG << "code["<<codeBufIdx<<"] = new";
           } else {
             codebuf = bufMap[target];
-            if (stripeid == 0) cout << "code["<<codeBufIdx<<"] = bufMap[" << target << "]" << endl;
+            if (stripeid == 0) LOG_DEBUG << "code["<<codeBufIdx<<"] = bufMap[" << target << "]";
           }
           code[codeBufIdx] = codebuf;
 
@@ -698,23 +797,21 @@ void OECWorker::computeWorker(vector<ECTask*> computeTasks,
           }
           codeBufIdx++;
         }
-        if (stripeid == 0) {
-          cout << "matrix: " << endl;
+        if (stripeid == 0 && LOG_ENABLED(LOG_LEVEL_DEBUG)) {
+          LOG_DEBUG << "matrix: ";
           for (int ii=0; ii<row; ii++) {
-            for (int jj=0; jj<col; jj++) {
-              cout << matrix[ii*col+jj] << " ";
-            }
-            cout << endl;
+            LOG_DEBUG << logList(vector<int>(matrix + ii*col, matrix + (ii+1)*col));
           }
         }
         // perform compute operation
-        Computation::Multi(code, data, matrix, row, col, splitsize, "Isal");
+        computeStripe(code, data, matrix, row, col, splitsize);
       }
       // check whether there is a need to discuss about row*col = 1
     }
     // now computation is finished, we take out pkt from stripe and put into outputstream
     for (int pktidx=0; pktidx<ecn; pktidx++) {
-      objstreams[pktidx]->enqueue(curStripe[pktidx]);
+      if (pktidx < eck && padded[pktidx]) delete curStripe[pktidx];
+      else objstreams[pktidx]->enqueue(curStripe[pktidx]);
       curStripe[pktidx] = NULL;
     }
     // clear data in bufMap
@@ -734,7 +831,51 @@ void OECWorker::computeWorker(vector<ECTask*> computeTasks,
   // free
   free(curStripe);
   gettimeofday(&time2, NULL);
-  cout << "OECWorker::computeWorker.duration = " << RedisUtil::duration(time1, time2) << endl;
+  LOG_DEBUG << "OECWorker::computeWorker.duration = " << RedisUtil::duration(time1, time2);
+}
+
+void OECWorker::batch(AGCommand* agcmd) {
+  // commands of a stripe are consecutive, stripes are in the same order on every agent
+  vector<vector<AGCommand*>> stripes;
+  string laststripe;
+  for (auto cmdstr: agcmd->getBatchCmds()) {
+    AGCommand* curcmd = new AGCommand((char*)cmdstr.c_str());
+    if (stripes.size() == 0 || curcmd->getStripeName() != laststripe) {
+      stripes.push_back(vector<AGCommand*>());
+      laststripe = curcmd->getStripeName();
+    }
+    stripes.back().push_back(curcmd);
+  }
+  LOG_DEBUG << "OECWorker::batch " << stripes.size() << " stripes";
+
+  // the commands of a stripe depend on each other and run together, at most ec.batch.window stripes
+  // are in flight so that the packets of later stripes do not pile up in redis
+  int window = _conf->_ec_batch_window > 0 ? _conf->_ec_batch_window : 1;
+  vector<vector<thread>> stripeThreads(stripes.size());
+  for (int i=0; i<stripes.size(); i++) {
+    if (i >= window) {
+      for (auto& t: stripeThreads[i-window]) t.join();
+    }
+    for (auto curcmd: stripes[i]) {
+      stripeThreads[i].push_back(thread([=]{
+        switch (curcmd->getType()) {
+          case 2: readDisk(curcmd); break;
+          case 3: fetchCompute(curcmd); break;
+          case 5: persist(curcmd); break;
+          case 7: readFetchCompute(curcmd); break;
+          default: break;
+        }
+      }));
+    }
+  }
+  for (int i=max(0, (int)stripes.size()-window); i<stripes.size(); i++) {
+    for (auto& t: stripeThreads[i]) t.join();
+  }
+
+  for (auto item: stripes) {
+    for (auto curcmd: item) delete curcmd;
+  }
+  LOG_DEBUG << "OECWorker::batch finishes!";
 }
 
 void OECWorker::readDisk(AGCommand* agcmd) {
@@ -745,6 +886,8 @@ void OECWorker::readDisk(AGCommand* agcmd) {
   vector<int> cidlist = agcmd->getReadCidList();
   sort(cidlist.begin(), cidlist.end());
   unordered_map<int, int> refs = agcmd->getCacheRefs();
+  string traceid = agcmd->getTraceId();
+  TraceSpan span(traceid, "readDisk", stripename, objname);
 
   int pktsize = _conf->_pktSize;
   int slicesize = pktsize/w;
@@ -753,27 +896,39 @@ void OECWorker::readDisk(AGCommand* agcmd) {
 
   FSObjInputStream* objstream = new FSObjInputStream(_conf, objname, _underfs);
   if (!objstream->exist()) {
-    cout << "OECWorker::readWorker." << objname << " does not exist!" << endl;
+    LOG_DEBUG << "OECWorker::readWorker." << objname << " does not exist!";
     return;
   }
 
   if (w == 1 || w == cidlist.size()) {
     // serail read
     // read data in serial from disk
-    thread readThread = thread([=]{objstream->readObj(slicesize);});
+    thread readThread = thread([=]{
+      TraceSpan span(traceid, "load", stripename, objname);
+      objstream->readObj(slicesize);
+    });
     BlockingQueue<OECDataPacket*>* readQueue = objstream->getQueue();
     // cacheThread
-    thread cacheThread = thread([=]{selectCacheWorker(readQueue, num, stripename, w, cidlist, refs);});
+    thread cacheThread = thread([=]{
+      TraceSpan span(traceid, "cache", stripename, objname);
+      selectCacheWorker(readQueue, num, stripename, w, cidlist, refs);
+    });
 
     //join
     readThread.join();
     cacheThread.join();
   } else {
     // random read
-    thread readThread = thread([=]{objstream->readObj(w, cidlist, slicesize);});
+    thread readThread = thread([=]{
+      TraceSpan span(traceid, "load", stripename, objname);
+      objstream->readObj(w, cidlist, slicesize);
+    });
     BlockingQueue<OECDataPacket*>* readQueue = objstream->getQueue();
     // cacheThrad
-    thread cacheThread = thread([=]{partialCacheWorker(readQueue, num, stripename, w, cidlist, refs);});
+    thread cacheThread = thread([=]{
+      TraceSpan span(traceid, "cache", stripename, objname);
+      partialCacheWorker(readQueue, num, stripename, w, cidlist, refs);
+    });
     
     // join
     readThread.join();
@@ -782,7 +937,7 @@ void OECWorker::readDisk(AGCommand* agcmd) {
 
   // delete
   if (objstream) delete objstream;
-  cout << "OECWorker::readDisk finishes!" << endl;
+  LOG_DEBUG << "OECWorker::readDisk finishes!";
 }
 
 void OECWorker::selectCacheWorker(BlockingQueue<OECDataPacket*>* cacheQueue,
@@ -840,7 +995,9 @@ void OECWorker::selectCacheWorker(BlockingQueue<OECDataPacket*>* cacheQueue,
   }
 
   gettimeofday(&time2, NULL);
-  cout << "OECWorker::selectCacheWorker.duration: " << RedisUtil::duration(time1, time2) << " for " << keybase << endl;
+  LOG_DEBUG << "OECWorker::selectCacheWorker.duration: " << RedisUtil::duration(time1, time2) << " for " << keybase;
+  static Histogram* latency = Metrics::histogram("agent.cache");
+  latency->record(RedisUtil::duration(time1, time2));
   redisFree(writeCtx);
 }
 
@@ -887,7 +1044,9 @@ void OECWorker::partialCacheWorker(BlockingQueue<OECDataPacket*>* cacheQueue,
   }
 
   gettimeofday(&time2, NULL);
-  cout << "OECWorker::selectCacheWorker.duration: " << RedisUtil::duration(time1, time2) << " for " << keybase << endl;
+  LOG_DEBUG << "OECWorker::selectCacheWorker.duration: " << RedisUtil::duration(time1, time2) << " for " << keybase;
+  static Histogram* latency = Metrics::histogram("agent.cache");
+  latency->record(RedisUtil::duration(time1, time2));
   redisFree(writeCtx);
 }
 
@@ -900,11 +1059,13 @@ void OECWorker::fetchCompute(AGCommand* agcmd) {
   vector<unsigned int> prevlocs = agcmd->getPrevLocs();
   unordered_map<int, vector<int>> coefs = agcmd->getCoefs();
   unordered_map<int, int> refs = agcmd->getCacheRefs();
+  string traceid = agcmd->getTraceId();
 
   vector<int> computefor;
   for (auto item:coefs) {
     computefor.push_back(item.first);
   }
+  TraceSpan span(traceid, "fetchCompute", stripename, logList(computefor));
 
   // create fetch queue
   BlockingQueue<OECDataPacket*>** fetchQueue = (BlockingQueue<OECDataPacket*>**)calloc(nprevs, sizeof(BlockingQueue<OECDataPacket*>*));
@@ -922,18 +1083,27 @@ void OECWorker::fetchCompute(AGCommand* agcmd) {
   vector<thread> fetchThreads = vector<thread>(nprevs);
   for (int i=0; i<nprevs; i++) {
     string keybase = stripename+":"+to_string(prevcids[i]);
-    fetchThreads[i] = thread([=]{fetchWorker(fetchQueue[i], keybase, prevlocs[i], num);});
+    fetchThreads[i] = thread([=]{
+      TraceSpan span(traceid, "fetch", stripename, keybase + " from " + RedisUtil::ip2Str(prevlocs[i]));
+      fetchWorker(fetchQueue[i], keybase, prevlocs[i], num);
+    });
   }
 
   // create compute thread
-  thread computeThread = thread([=]{computeWorker(fetchQueue, nprevs, num, coefs, computefor, writeQueue, _conf->_pktSize/w);});
+  thread computeThread = thread([=]{
+    TraceSpan span(traceid, "compute", stripename, logList(computefor));
+    computeWorker(fetchQueue, nprevs, num, coefs, computefor, writeQueue, _conf->_pktSize/w);
+  });
 
   // create cache thread
   vector<thread> cacheThreads = vector<thread>(computefor.size());
   for (int i=0; i<computefor.size(); i++) {
     string keybase = stripename+":"+to_string(computefor[i]);
     int r = refs[computefor[i]];
-    cacheThreads[i] = thread([=]{cacheWorker(writeQueue[i], keybase, num, r);});
+    cacheThreads[i] = thread([=]{
+      TraceSpan span(traceid, "cache", stripename, keybase);
+      cacheWorker(writeQueue[i], keybase, num, r);
+    });
   }
 
   // join
@@ -954,7 +1124,7 @@ void OECWorker::fetchCompute(AGCommand* agcmd) {
     delete writeQueue[i];
   }
   free(writeQueue);
-  cout << "OECWorker::fetchCompute finishes!" << endl;
+  LOG_DEBUG << "OECWorker::fetchCompute finishes!";
 }
 
 void OECWorker::fetchWorker(BlockingQueue<OECDataPacket*>* fetchQueue,
@@ -988,7 +1158,11 @@ void OECWorker::fetchWorker(BlockingQueue<OECDataPacket*>* fetchQueue,
     freeReplyObject(rReply);
   }
   gettimeofday(&time2, NULL);
-  cout << "OECWorker::fetchWorker.duration: " << RedisUtil::duration(time1, time2) << " for " << keybase << endl;
+  LOG_DEBUG << "OECWorker::fetchWorker.duration: " << RedisUtil::duration(time1, time2) << " for " << keybase;
+  static Histogram* latency = Metrics::histogram("agent.fetch");
+  latency->record(RedisUtil::duration(time1, time2));
+  static Counter* fetchPkts = Metrics::counter("agent.fetch.pkts");
+  fetchPkts->add(num);
   redisFree(fetchCtx);
 }
 
@@ -1010,15 +1184,14 @@ void OECWorker::computeWorker(BlockingQueue<OECDataPacket*>** fetchQueue,
       matrix[i*col+j] = coef[j];
     }
   }
-  cout << "OECWorker::computeWorker.num: " << num << ", row: " << row << ", col: " << col << endl;
-  cout << "-------------------"<< endl;
-  for (int i=0; i<row; i++) {
-    for (int j=0; j<col; j++) {
-      cout << matrix[i*col+j] << " ";
+  LOG_DEBUG << "OECWorker::computeWorker.num: " << num << ", row: " << row << ", col: " << col;
+  if (LOG_ENABLED(LOG_LEVEL_DEBUG)) {
+    LOG_DEBUG << "-------------------";
+    for (int i=0; i<row; i++) {
+      LOG_DEBUG << logList(vector<int>(matrix + i*col, matrix + (i+1)*col));
     }
-    cout << endl;
+    LOG_DEBUG << "-------------------";
   }
-  cout << "-------------------"<< endl;
 
   OECDataPacket** curstripe = (OECDataPacket**)calloc(row+col, sizeof(OECDataPacket*));
   char** data = (char**)calloc(col, sizeof(char*));
@@ -1035,7 +1208,7 @@ void OECWorker::computeWorker(BlockingQueue<OECDataPacket*>** fetchQueue,
       code[i] = curstripe[col+i]->getData();
     }
     // compute
-    Computation::Multi(code, data, matrix, row, col, slicesize, "Isal");
+    computeStripe(code, data, matrix, row, col, slicesize);
 
     // now we free data
     for (int i=0; i<col; i++) {
@@ -1075,15 +1248,14 @@ void OECWorker::computeWorker(BlockingQueue<OECDataPacket*>** fetchQueue,
       matrix[i*col+j] = coef[j];
     }
   }
-  cout << "OECWorker::computeWorker.num: " << num << ", row: " << row << ", col: " << col << endl;
-  cout << "-------------------"<< endl;
-  for (int i=0; i<row; i++) {
-    for (int j=0; j<col; j++) {
-      cout << matrix[i*col+j] << " ";
+  LOG_DEBUG << "OECWorker::computeWorker.num: " << num << ", row: " << row << ", col: " << col;
+  if (LOG_ENABLED(LOG_LEVEL_DEBUG)) {
+    LOG_DEBUG << "-------------------";
+    for (int i=0; i<row; i++) {
+      LOG_DEBUG << logList(vector<int>(matrix + i*col, matrix + (i+1)*col));
     }
-    cout << endl;
+    LOG_DEBUG << "-------------------";
   }
-  cout << "-------------------"<< endl;
 
   OECDataPacket** curstripe = (OECDataPacket**)calloc(row+col, sizeof(OECDataPacket*));
   char** data = (char**)calloc(col, sizeof(char*));
@@ -1100,7 +1272,7 @@ void OECWorker::computeWorker(BlockingQueue<OECDataPacket*>** fetchQueue,
       code[i] = curstripe[col+i]->getData();
     }
     // compute
-    Computation::Multi(code, data, matrix, row, col, slicesize, "Isal");
+    computeStripe(code, data, matrix, row, col, slicesize);
 
     // put needed data into writeQueue
     for (auto item: writeQueue) {
@@ -1171,7 +1343,9 @@ void OECWorker::cacheWorker(BlockingQueue<OECDataPacket*>* writeQueue,
   // xiaolu start 20180822 end
 
   gettimeofday(&time2, NULL);
-  cout << "OECWorker::writeWorker.duration: " << RedisUtil::duration(time1, time2) << " for " << keybase << endl;
+  LOG_DEBUG << "OECWorker::writeWorker.duration: " << RedisUtil::duration(time1, time2) << " for " << keybase;
+  static Histogram* latency = Metrics::histogram("agent.cache");
+  latency->record(RedisUtil::duration(time1, time2));
   redisFree(writeCtx);
 }
 
@@ -1186,7 +1360,7 @@ void OECWorker::cacheWorker(BlockingQueue<OECDataPacket*>* writeQueue,
   redisContext* writeCtx = RedisUtil::createContext("127.0.0.1");
   
   gettimeofday(&time2, NULL);
-  cout << "OECWorker::cacheWorker.createCtx: " << RedisUtil::duration(time1, time2) << endl;
+  LOG_DEBUG << "OECWorker::cacheWorker.createCtx: " << RedisUtil::duration(time1, time2);
 
   int replyid=0;
   int count=0;
@@ -1206,14 +1380,16 @@ void OECWorker::cacheWorker(BlockingQueue<OECDataPacket*>* writeQueue,
     }
   }
   gettimeofday(&time3, NULL);
-  cout<< "OECWorker::cacheWorker.write all data: " << RedisUtil::duration(time2, time3) << endl;
+  LOG_DEBUG << "OECWorker::cacheWorker.write all data: " << RedisUtil::duration(time2, time3);
   for (int i=replyid; i<count; i++) {
     redisGetReply(writeCtx, (void**)&rReply);
     freeReplyObject(rReply);
   }
 
   gettimeofday(&time4, NULL);
-  cout << "OECWorker::writeWorker.duration: " << RedisUtil::duration(time1, time4) << " for " << keybase << endl;
+  LOG_DEBUG << "OECWorker::writeWorker.duration: " << RedisUtil::duration(time1, time4) << " for " << keybase;
+  static Histogram* latency = Metrics::histogram("agent.cache");
+  latency->record(RedisUtil::duration(time1, time4));
   redisFree(writeCtx);
 }
 
@@ -1256,10 +1432,35 @@ void OECWorker::cacheWorker(BlockingQueue<OECDataPacket*>* writeQueue,
   }
 
   gettimeofday(&time4, NULL);
-  cout << "OECWorker::cacheWorker6.duration: " << RedisUtil::duration(time1, time4) << " for " << keybase << endl;
+  LOG_DEBUG << "OECWorker::cacheWorker6.duration: " << RedisUtil::duration(time1, time4) << " for " << keybase;
+  static Histogram* latency = Metrics::histogram("agent.cache");
+  latency->record(RedisUtil::duration(time1, time4));
   redisFree(writeCtx);
 }
 
+void OECWorker::rangeCacheWorker(BlockingQueue<OECDataPacket*>* writeQueue,
+                                 string keybase,
+                                 int startidx,
+                                 int skip,
+                                 int num,
+                                 int total) {
+  // This cache worker fetch total pkts from writeQueue, pkts [skip, skip+num) are
+  // written into local redis as keybase:(startidx + i), the others are dropped
+  if (skip == 0 && num == total) {
+    cacheWorker(writeQueue, keybase, startidx, num, 1);
+    return;
+  }
+  BlockingQueue<OECDataPacket*>* selectQueue = new BlockingQueue<OECDataPacket*>();
+  thread cacheThread = thread([=]{cacheWorker(selectQueue, keybase, startidx, num, 1);});
+  for (int i=0; i<total; i++) {
+    OECDataPacket* curpkt = writeQueue->pop();
+    if (i >= skip && i < skip + num) selectQueue->push(curpkt);
+    else delete curpkt;
+  }
+  cacheThread.join();
+  delete selectQueue;
+}
+
 void OECWorker::persist(AGCommand* agcmd) {
   string stripename = agcmd->getStripeName();
   int w = agcmd->getW();
@@ -1268,12 +1469,16 @@ void OECWorker::persist(AGCommand* agcmd) {
   vector<int> prevcids = agcmd->getPrevCids();
   vector<unsigned int> prevlocs = agcmd->getPrevLocs();
   string objname = agcmd->getWriteObjName();
+  string traceid = agcmd->getTraceId();
+  TraceSpan span(traceid, "persist", stripename, objname);
 
   for (int i=0; i<nprevs; i++) {
     string keybase = stripename+":"+to_string(prevcids[i]);
-    cout << "OECWorker::persist.fetch "<<keybase<<" from " << RedisUtil::ip2Str(prevlocs[i]) << endl;
+    LOG_DEBUG << "OECWorker::persist.fetch "<<keybase<<" from " << RedisUtil::ip2Str(prevlocs[i]);
   }
-  cout << "OECWorker::persist.write as " << objname << " with " << num << " pkts"<< endl;
+  LOG_DEBUG << "OECWorker::persist.write as " << objname << " with " << num << " pkts";
+  struct timeval time1, time2;
+  gettimeofday(&time1, NULL);
 
   // create fetch queue
   BlockingQueue<OECDataPacket*>** fetchQueue = (BlockingQueue<OECDataPacket*>**)calloc(nprevs, sizeof(BlockingQueue<OECDataPacket*>*));
@@ -1285,12 +1490,18 @@ void OECWorker::persist(AGCommand* agcmd) {
   vector<thread> fetchThreads = vector<thread>(nprevs);
   for (int i=0; i<nprevs; i++) {
     string keybase = stripename+":"+to_string(prevcids[i]);
-    fetchThreads[i] = thread([=]{fetchWorker(fetchQueue[i], keybase, prevlocs[i], num);});
+    fetchThreads[i] = thread([=]{
+      TraceSpan span(traceid, "fetch", stripename, keybase + " from " + RedisUtil::ip2Str(prevlocs[i]));
+      fetchWorker(fetchQueue[i], keybase, prevlocs[i], num);
+    });
   }
 
   // create objstream and writeThread
   FSObjOutputStream* objstream = new FSObjOutputStream(_conf, objname, _underfs, num*nprevs);
-  thread writeThread = thread([=]{objstream->writeObj();});
+  thread writeThread = thread([=]{
+    TraceSpan span(traceid, "write", stripename, objname);
+    objstream->writeObj();
+  });
 
   int total = num;
   while(total--) {
@@ -1313,22 +1524,20 @@ void OECWorker::persist(AGCommand* agcmd) {
   }
   free(fetchQueue);
   if (objstream) delete objstream;
+  gettimeofday(&time2, NULL);
+  static Histogram* persistLatency = Metrics::histogram("agent.persist");
+  persistLatency->record(RedisUtil::duration(time1, time2));
 
-  // write a finish flag to local?
-  // writefinish:objname
-  redisReply* rReply;
-  redisContext* writeCtx = RedisUtil::createContext(_conf->_localIp);
-
-  string wkey = "writefinish:" + objname;
-  int tmpval = htonl(1);
-  rReply = (redisReply*)redisCommand(writeCtx, "rpush %s %b", wkey.c_str(), (char*)&tmpval, sizeof(tmpval));
-  freeReplyObject(rReply);
-  redisFree(writeCtx);
-  cout << "OECWorker::persist finishes!" << endl;
+  // report to the completion listener of the coordinator
+  CoorCommand* coorCmd = new CoorCommand();
+  coorCmd->buildType14(14, _conf->_localIp, objname, traceid);
+  coorCmd->sendTo(_conf->_coorIp);
+  delete coorCmd;
+  LOG_DEBUG << "OECWorker::persist finishes!";
 }
 
 void OECWorker::clientRead(AGCommand* agcmd) {
-  cout << "OECWorker::clientRead" << endl;
+  LOG_DEBUG << "OECWorker::clientRead";
   struct timeval time1, time2;
   gettimeofday(&time1, NULL);
   string filename = agcmd->getFilename();
@@ -1339,7 +1548,7 @@ void OECWorker::clientRead(AGCommand* agcmd) {
   coorCmd->sendTo(_coorCtx);
   delete coorCmd;
 
-  // 1. get response type|filesizeMB
+  // 1. get response type|filesizeMB|...|filesizeB|
   string metakey = "filemeta:"+filename;
   redisReply* metareply;
   redisContext* metaCtx = RedisUtil::createContext(_conf->_localIp);
@@ -1353,49 +1562,81 @@ void OECWorker::clientRead(AGCommand* agcmd) {
   int filesizeMB;
   memcpy((char*)&filesizeMB, metastr, 4); metastr += 4;
   filesizeMB = ntohl(filesizeMB);
+  int ecn, eck, ecw, objnum;
+  if (redundancy == 0) {
+    // |ecn|eck|ecw|
+    // 1.3.1 ecn
+    memcpy((char*)&ecn, metastr, 4); metastr += 4;
+    ecn = ntohl(ecn);
+    // 1.3.2 eck
+    memcpy((char*)&eck, metastr, 4); metastr += 4;
+    eck = ntohl(eck);
+    // 1.3.3 ecw
+    memcpy((char*)&ecw, metastr, 4); metastr += 4;
+    ecw = ntohl(ecw);
+  } else {
+    // 1.3 objnum
+    memcpy((char*)&objnum, metastr, 4); metastr += 4;
+    objnum = ntohl(objnum);
+  }
+  // 1.4 filesizeB
+  int tmphigh, tmplow;
+  memcpy((char*)&tmphigh, metastr, 4); metastr += 4;
+  memcpy((char*)&tmplow, metastr, 4); metastr += 4;
+  long filesizeB = (long)(((unsigned long)(unsigned int)ntohl(tmphigh) << 32) | (unsigned int)ntohl(tmplow));
 
-  // 2. return filesizeMB to client
+  // 2. return |filesizeMB|filesizeB| to client
   redisReply* rReply;
   redisContext* cliCtx = RedisUtil::createContext(_conf->_localIp);
   string skey = "filesize:"+filename;
+  char sizebuf[12];
   int tmpval = htonl(filesizeMB);
-  rReply = (redisReply*)redisCommand(cliCtx, "rpush %s %b", skey.c_str(), (char*)&tmpval, sizeof(tmpval));
+  memcpy(sizebuf, (char*)&tmpval, 4);
+  memcpy(sizebuf + 4, (char*)&tmphigh, 4);
+  memcpy(sizebuf + 8, (char*)&tmplow, 4);
+  rReply = (redisReply*)redisCommand(cliCtx, "rpush %s %b", skey.c_str(), sizebuf, sizeof(sizebuf));
   freeReplyObject(rReply);
   redisFree(cliCtx);
  
   gettimeofday(&time2, NULL);
-  cout << "OECWorker::clientRead.get metadata duration = " << RedisUtil::duration(time1, time2) << endl;
+  LOG_DEBUG << "OECWorker::clientRead.get metadata duration = " << RedisUtil::duration(time1, time2);
 
-  if (redundancy == 0) {
-    // |ecn|eck|ecw|
-    // 0.1 ecn
-    int ecn;
-    memcpy((char*)&ecn, metastr, 4); metastr += 4;
-    ecn = ntohl(ecn);
-    // 0.2 eck
-    int eck;
-    memcpy((char*)&eck, metastr, 4); metastr += 4;
-    eck = ntohl(eck);
-    // 0.3 ecw
-    int ecw;
-    memcpy((char*)&ecw, metastr, 4); metastr += 4;
-    ecw = ntohl(ecw);
+  // the file does not exist, the client takes filesizeMB < 0 as not found
+  if (redundancy < 0) {
+    LOG_WARN << "OECWorker::clientRead." << filename << " not found";
+    freeReplyObject(metareply);
+    redisFree(metaCtx);
+    return;
+  }
 
-    readOnline(filename, filesizeMB, ecn, eck, ecw);
+  // 3. map the requested byte range to packets [firstpkt, firstpkt+pktcnt) of the file,
+  //    OECInputStream clamps the range in the same way
+  int pktnum = (filesizeB + _conf->_pktSize - 1) / _conf->_pktSize;
+  int firstpkt = 0;
+  int pktcnt = pktnum;
+  if (agcmd->getType() == 8) {
+    long offset = agcmd->getOffset();
+    long length = agcmd->getLength();
+    if (offset < 0) offset = 0;
+    if (offset > filesizeB) offset = filesizeB;
+    if (length < 0 || offset + length > filesizeB) length = filesizeB - offset;
+    firstpkt = offset / _conf->_pktSize;
+    pktcnt = (length > 0) ? (offset + length - 1) / _conf->_pktSize - firstpkt + 1 : 0;
+  }
+
+  if (redundancy == 0) {
+    readOnline(filename, pktnum, ecn, eck, ecw, firstpkt, pktcnt);
   } else {
-    // objnum
-    int objnum;
-    memcpy((char*)&objnum, metastr, 4); metastr += 4;
-    objnum = ntohl(objnum);
-    readOffline(filename, filesizeMB, objnum);
+    readOffline(filename, filesizeMB, objnum, firstpkt, pktcnt);
   }
 
   freeReplyObject(metareply);
   redisFree(metaCtx);
 }
 
-void OECWorker::readOffline(string filename, int filesizeMB, int objnum) {
-  cout << "OECWorker::readOffline.filename: " << filename << ", filesizeMB: " << filesizeMB << ", objnum: " << objnum << endl;
+void OECWorker::readOffline(string filename, int filesizeMB, int objnum, int firstpkt, int pktcnt) {
+  LOG_DEBUG << "OECWorker::readOffline.filename: " << filename << ", filesizeMB: " << filesizeMB << ", objnum: " << objnum
+       << ", firstpkt: " << firstpkt << ", pktcnt: " << pktcnt;
 
   // create inputstream
   vector<thread> createThreads = vector<thread>(objnum);
@@ -1408,13 +1649,50 @@ void OECWorker::readOffline(string filename, int filesizeMB, int objnum) {
     createThreads[i].join();
   }
 
-  // read object one by one
+  // read up to _offline_read_window objects concurrently, each object caches
+  // its packets under its own key range so the client still sees file order.
+  // lost objects are scheduled first so that their reconstruction overlaps
+  // with reading the healthy ones
   int objsizeMB = filesizeMB/objnum;
   int pktnum = objsizeMB * 1048576/_conf->_pktSize;
+  // only objects overlapping the requested packets are read
+  vector<int> readorder;
   for (int i=0; i<objnum; i++) {
-    string objname = filename+"_oecobj_"+to_string(i);
-    readOfflineObj(filename, objname, objsizeMB, objstreams[i], pktnum, i);
+    if (firstpkt >= (i+1) * pktnum || firstpkt + pktcnt <= i * pktnum) continue;
+    if (!objstreams[i]->exist()) readorder.push_back(i);
   }
+  for (int i=0; i<objnum; i++) {
+    if (firstpkt >= (i+1) * pktnum || firstpkt + pktcnt <= i * pktnum) continue;
+    if (objstreams[i]->exist()) readorder.push_back(i);
+  }
+
+  int window = _conf->_offline_read_window;
+  if (window < 1) window = 1;
+  mutex windowLock;
+  condition_variable windowCv;
+  int inflight = 0;
+  vector<thread> readThreads;
+  for (int i=0; i<readorder.size(); i++) {
+    {
+      unique_lock<mutex> lck(windowLock);
+      windowCv.wait(lck, [&]{ return inflight < window; });
+      inflight++;
+    }
+    int idx = readorder[i];
+    string objname = filename+"_oecobj_"+to_string(idx);
+    int startpkt = max(firstpkt, idx * pktnum);
+    int endpkt = min(firstpkt + pktcnt, (idx+1) * pktnum);
+    readThreads.push_back(thread([=, &windowLock, &windowCv, &inflight]{
+      readOfflineObj(filename, objname, objsizeMB, objstreams[idx], pktnum, idx,
+                     startpkt - idx * pktnum, endpkt - startpkt, startpkt - firstpkt);
+      {
+        unique_lock<mutex> lck(windowLock);
+        inflight--;
+      }
+      windowCv.notify_one();
+    }));
+  }
+  for (int i=0; i<readThreads.size(); i++) readThreads[i].join();
 
   // free
   for (int i=0; i<objnum; i++) {
@@ -1423,27 +1701,36 @@ void OECWorker::readOffline(string filename, int filesizeMB, int objnum) {
   free(objstreams);
 }
 
-void OECWorker::readOfflineObj(string filename, string objname, int objsizeMB, FSObjInputStream* objstream, int pktnum, int idx) {
-  cout << "OECWorker::readOfflineObj" << endl;
+void OECWorker::readOfflineObj(string filename, string objname, int objsizeMB, FSObjInputStream* objstream, int pktnum, int idx,
+                               int startpkt, int cnt, int keystart) {
+  // packets [startpkt, startpkt+cnt) of this object are cached as filename:keystart...
+  LOG_DEBUG << "OECWorker::readOfflineObj";
   bool objexist = objstream->exist();
   if (objexist) {
-    cout << "OECWorker::readOfflineObj. "  << objname << " exists!" << endl;
+    LOG_DEBUG << "OECWorker::readOfflineObj. "  << objname << " exists!";
     // this obj is in good health
     // 1. create read thread
-    thread readThread = thread([=]{objstream->readObj();});
+    thread readThread;
+    if (startpkt == 0 && cnt == pktnum) {
+      readThread = thread([=]{objstream->readObj();});
+    } else {
+      objstream->setRange((long)startpkt * _conf->_pktSize, (long)cnt * _conf->_pktSize, false);
+      readThread = thread([=]{objstream->readRange();});
+    }
     BlockingQueue<OECDataPacket*>* writeQueue = objstream->getQueue();
     // 2. cache thread
-    thread cacheThread = thread([=]{cacheWorker(writeQueue, filename, pktnum * idx, pktnum, 1);});
+    thread cacheThread = thread([=]{cacheWorker(writeQueue, filename, keystart, cnt, 1);});
     // join
     readThread.join();
     cacheThread.join();
   } else {
-    cout << "OECWorker::readOfflineObj. "  << objname << " does not exist!" << endl;
+    LOG_DEBUG << "OECWorker::readOfflineObj. "  << objname << " does not exist!";
     // we need to repair this lost obj
     // issue degraded read for this obj
+    // several objects of a file can be read concurrently, do not share _coorCtx
     CoorCommand* coorCmd = new CoorCommand();
     coorCmd->buildType5(5, _conf->_localIp, objname); 
-    coorCmd->sendTo(_coorCtx);
+    coorCmd->sendTo(_conf->_coorIp);
     delete coorCmd;
     
     // wait for response
@@ -1457,7 +1744,7 @@ void OECWorker::readOfflineObj(string filename, string objname, int objsizeMB, F
     int opt;
     memcpy((char*)&opt, inststr, 4); inststr += 4;
     opt = ntohl(opt);
-    cout << "opt = " << opt << endl;
+    LOG_DEBUG << "opt = " << opt;
 
     if (opt < 0) {
       // we fetch available data here and repair
@@ -1465,9 +1752,9 @@ void OECWorker::readOfflineObj(string filename, string objname, int objsizeMB, F
       int lostidx;
       memcpy((char*)&lostidx, inststr, 4); inststr += 4;
       lostidx = ntohl(lostidx);
-      cout << "lostidx = " << lostidx << endl;
+      LOG_DEBUG << "lostidx = " << lostidx;
       // |ecn|eck|ecw|loadn|loadidx-objname-numcids-cidlist|..|computen|computetask|..|
-      cout << "OfflineDegradedRead without technique" << endl;
+      LOG_DEBUG << "OfflineDegradedRead without technique";
       // 0.1 ecn
       int ecn;
       memcpy((char*)&ecn, inststr, 4); inststr += 4;
@@ -1480,7 +1767,7 @@ void OECWorker::readOfflineObj(string filename, string objname, int objsizeMB, F
       int ecw;
       memcpy((char*)&ecw, inststr, 4); inststr += 4;
       ecw = ntohl(ecw);
-      cout << "ecn = " << ecn << ", eck = " << eck << ", ecw = " << ecw << endl;
+      LOG_DEBUG << "ecn = " << ecn << ", eck = " << eck << ", ecw = " << ecw;
       // 0.4 load
       int loadn;
       memcpy((char*)&loadn, inststr, 4); inststr += 4;
@@ -1518,13 +1805,9 @@ void OECWorker::readOfflineObj(string filename, string objname, int objsizeMB, F
       }
       for (int loadi=0; loadi<loadn; loadi++) {
         int cursid = loadidx[loadi];
-        cout << "loadsid: " << cursid << ", ";
         string curobjname = loadobj[loadi];
-        cout << "objname: " << curobjname << ", ";
         vector<int> curlist = sid2Cids[cursid];
-        cout << "cidlist: ";
-        for (int ii=0; ii<curlist.size(); ii++) cout << curlist[ii] << " ";
-        cout << endl;
+        LOG_DEBUG << "loadsid: " << cursid << ", objname: " << curobjname << ", cidlist: " << logList(curlist);
       }
       // 0.5 computen
       int computen;
@@ -1564,7 +1847,7 @@ void OECWorker::readOfflineObj(string filename, string objname, int objsizeMB, F
 
       // 2. create cache queue and cache thread
       BlockingQueue<OECDataPacket*>* writeQueue = new BlockingQueue<OECDataPacket*>();
-      thread cacheThread = thread([=]{cacheWorker(writeQueue, filename, pktnum * idx, pktnum, 1);});
+      thread cacheThread = thread([=]{rangeCacheWorker(writeQueue, filename, keystart, startpkt, cnt, pktnum);});
 
       // 3. computeThread
       thread computeThread = thread([=]{computeWorkerDegradedOffline(readStreams, loadidx, sid2Cids, writeQueue, lostidx, computeTasks, pktnum, ecn, eck, ecw);});
@@ -1606,7 +1889,7 @@ void OECWorker::readOfflineObj(string filename, string objname, int objsizeMB, F
         memcpy((char*)&ip, inststr, 4); inststr += 4;
         ip = ntohl(ip);
         iplist.push_back(ip);
-        cout << "Fetch " << stripename << ":" << to_string(cidx) << " from " << RedisUtil::ip2Str(ip) << endl;
+        LOG_DEBUG << "Fetch " << stripename << ":" << to_string(cidx) << " from " << RedisUtil::ip2Str(ip);
       }
 
       // create fetch queue
@@ -1625,7 +1908,7 @@ void OECWorker::readOfflineObj(string filename, string objname, int objsizeMB, F
         fetchThreads[i] = thread([=]{fetchWorker(fetchQueue[i], keybase, iplist[i], pktnum);});
       } 
 
-      thread cacheThread = thread([=]{cacheWorker(writeQueue, filename, pktnum * idx, pktnum, 1);});
+      thread cacheThread = thread([=]{rangeCacheWorker(writeQueue, filename, keystart, startpkt, cnt, pktnum);});
 
       //fetch pkt from fetchQueue to writeQueue
       for (int i=0; i<pktnum; i++) {
@@ -1664,10 +1947,20 @@ void OECWorker::readOfflineObj(string filename, string objname, int objsizeMB, F
   }
 }
 
-void OECWorker::readOnline(string filename, int filesizeMB, int ecn, int eck, int ecw) {
+void OECWorker::readOnline(string filename, int pktnum, int ecn, int eck, int ecw, int firstpkt, int pktcnt) {
   struct timeval time1, time2, time3, time4;
   gettimeofday(&time1, NULL);
-  cout << "OECWorker::readOnline.filename: " << filename << ", filesizeMB: " << filesizeMB << ", ecn: " << ecn << ", eck: " << eck << ", ecw: " << ecw << endl;
+  LOG_DEBUG << "OECWorker::readOnline.filename: " << filename << ", pktnum: " << pktnum << ", ecn: " << ecn << ", eck: " << eck << ", ecw: " << ecw
+       << ", firstpkt: " << firstpkt << ", pktcnt: " << pktcnt;
+
+  // packet i of the file is slot i/eck of object i%eck, so a range of packets
+  // covers stripes [firststripe, firststripe+stripecnt)
+  bool ranged = !(firstpkt == 0 && pktcnt == pktnum);
+  if (pktcnt == 0) return;
+  int firststripe = firstpkt / eck;
+  int stripecnt = (firstpkt + pktcnt - 1) / eck - firststripe + 1;
+  long rangeoffset = (long)firststripe * _conf->_pktSize;
+  long rangelength = (long)stripecnt * _conf->_pktSize;
 
   // 1. create ecn input stream and check integrity
   vector<int> integrity;
@@ -1690,21 +1983,26 @@ void OECWorker::readOnline(string filename, int filesizeMB, int ecn, int eck, in
     }
   }  
   gettimeofday(&time2, NULL);
-  cout << "OECWorker::readOnline.createInputStream.duration: " << RedisUtil::duration(time1, time2) << endl;
+  LOG_DEBUG << "OECWorker::readOnline.createInputStream.duration: " << RedisUtil::duration(time1, time2);
 
   if (!needRecovery) {
-    cout << "OECWorker::readOnline.do not need recovery" << endl;
+    LOG_DEBUG << "OECWorker::readOnline.do not need recovery";
     // we do not need recovery
     vector<thread> readThreads = vector<thread>(eck);
     for (int i=0; i<eck; i++) {
-      readThreads[i] = thread([=]{objstreams[i]->readObj();});
+      if (ranged) {
+        objstreams[i]->setRange(rangeoffset, rangelength, false);
+        readThreads[i] = thread([=]{objstreams[i]->readRange();});
+      } else {
+        readThreads[i] = thread([=]{objstreams[i]->readObj();});
+      }
     }
 
     // version 1 start: single caching thread
-    int pktnum = filesizeMB * 1048576/_conf->_pktSize; 
     BlockingQueue<OECDataPacket*>* writeQueue = new BlockingQueue<OECDataPacket*>();
     // 1.1 cacheThread
-    thread cacheThread = thread([=]{cacheWorker(writeQueue, filename, pktnum, 1);});
+    int total = min(stripecnt * eck, pktnum - firststripe * eck);
+    thread cacheThread = thread([=]{rangeCacheWorker(writeQueue, filename, 0, firstpkt - firststripe * eck, pktcnt, total);});
 
     // 1.3 get pkt from readThread to writeThread
     struct timeval push1, push2;
@@ -1724,7 +2022,7 @@ void OECWorker::readOnline(string filename, int filesizeMB, int ecn, int eck, in
       if (!goon) break;
     }
     gettimeofday(&push2, NULL);
-    cout << "OECWorker::readOnline.pushduration: " << RedisUtil::duration(push1, push2) << endl;
+    LOG_DEBUG << "OECWorker::readOnline.pushduration: " << RedisUtil::duration(push1, push2);
 
     // join
     for (int i=0; i<eck; i++) readThreads[i].join();
@@ -1734,7 +2032,7 @@ void OECWorker::readOnline(string filename, int filesizeMB, int ecn, int eck, in
     delete writeQueue;
     // version 1 end
   } else {
-    cout << "OECWorker::readOnline.need repair" << endl;
+    LOG_DEBUG << "OECWorker::readOnline.need repair";
     // need recovery
     // send request to coordinator
     CoorCommand* degradedCmd = new CoorCommand();
@@ -1753,7 +2051,6 @@ void OECWorker::readOnline(string filename, int filesizeMB, int ecn, int eck, in
     char* inststr = instreply->element[1]->str;
 
     // 0.1 loadn
-    cout << "OECWorker::readOnline.degraded.loadidx: ";
     int loadn;
     memcpy((char*)&loadn, inststr, 4); inststr += 4;
     loadn = ntohl(loadn);
@@ -1762,10 +2059,9 @@ void OECWorker::readOnline(string filename, int filesizeMB, int ecn, int eck, in
       int idx;
       memcpy((char*)&idx, inststr, 4); inststr += 4;
       idx = ntohl(idx);
-      cout << idx << " ";
       loadidx.push_back(idx);
     }
-    cout << endl;
+    LOG_DEBUG << "OECWorker::readOnline.degraded.loadidx: " << logList(loadidx);
     // 0.2 computen
     int computen;
     memcpy((char*)&computen, inststr, 4); inststr += 4;
@@ -1788,27 +2084,37 @@ void OECWorker::readOnline(string filename, int filesizeMB, int ecn, int eck, in
     redisFree(waitCtx);
     gettimeofday(&instt2, NULL);
 
-    cout << "OECWorker::readOnline.wait degraded inst = " << RedisUtil::duration(time1, time2) << endl;
-    cout << "OECWorker::loadn = " << loadn << ", loadidx.size() = " << loadidx.size() << endl;
+    LOG_DEBUG << "OECWorker::readOnline.wait degraded inst = " << RedisUtil::duration(time1, time2);
+    LOG_DEBUG << "OECWorker::loadn = " << loadn << ", loadidx.size() = " << loadidx.size();
  
     FSObjInputStream** readStreams = (FSObjInputStream**)calloc(loadn, sizeof(FSObjInputStream*));
     for (int i=0; i<loadn; i++) {
       readStreams[i] = objstreams[loadidx[i]];
-      cout << "readStreams[" << i << "] = objstreams[" << loadidx[i] << "]" << endl;
+      LOG_DEBUG << "readStreams[" << i << "] = objstreams[" << loadidx[i] << "]";
     }
 
+    // only the stripes covering the range are loaded and decoded. Data objects
+    // end before a zero-padded last stripe, so ranged reads pad with zeros,
+    // which is also needed for a whole file that ends in a partial stripe
+    bool padded = ranged || (pktnum % eck != 0);
     vector<thread> readThreads = vector<thread>(loadn);
     for (int i=0; i<loadn; i++) {
-      readThreads[i] = thread([=]{readStreams[i]->readObj();});
+      if (padded) {
+        readStreams[i]->setRange(rangeoffset, rangelength, true);
+        readThreads[i] = thread([=]{readStreams[i]->readRange();});
+      } else {
+        readThreads[i] = thread([=]{readStreams[i]->readObj();});
+      }
     }
 
+    // 2.1 computeThread
+    int stripenum = padded ? stripecnt : pktnum/eck;
+
     BlockingQueue<OECDataPacket*>* writeQueue = new BlockingQueue<OECDataPacket*>();
     // 1.1 cacheThread
-    int pktnum = filesizeMB * 1048576/_conf->_pktSize; 
-    thread cacheThread = thread([=]{cacheWorker(writeQueue, filename, pktnum, 1);});
-
-    // 2.1 computeThread
-    int stripenum = pktnum/eck;
+    thread cacheThread;
+    if (padded) cacheThread = thread([=]{rangeCacheWorker(writeQueue, filename, 0, firstpkt - firststripe * eck, pktcnt, stripenum * eck);});
+    else cacheThread = thread([=]{cacheWorker(writeQueue, filename, pktnum, 1);});
     thread computeThread = thread([=]{computeWorker(readStreams, loadidx, writeQueue, computeTasks, stripenum, ecn, eck, ecw);});
 
     // join
@@ -1829,11 +2135,11 @@ void OECWorker::readOnline(string filename, int filesizeMB, int ecn, int eck, in
   }
   free(objstreams);
   gettimeofday(&time3, NULL);
-  cout << "OECWorker::readOnline.duration: " << RedisUtil::duration(time1, time3) << endl;
+  LOG_DEBUG << "OECWorker::readOnline.duration: " << RedisUtil::duration(time1, time3);
 }
 
 void OECWorker::readFetchCompute(AGCommand* agCmd) {
-  cout << "OECWorker::readFetchCompute" << endl;
+  LOG_DEBUG << "OECWorker::readFetchCompute";
   string stripename = agCmd->getStripeName();
   int ecw = agCmd->getW();
   int pktnum = agCmd->getNum();
@@ -1846,14 +2152,16 @@ void OECWorker::readFetchCompute(AGCommand* agCmd) {
   vector<unsigned int> prevLocs = agCmd->getPrevLocs();
   unordered_map<int, vector<int>> coefs = agCmd->getCoefs();
   unordered_map<int, int> cacheRefs = agCmd->getCacheRefs();
+  string traceid = agCmd->getTraceId();
 
   vector<int> computefor;
   for (auto item: coefs) computefor.push_back(item.first);
+  TraceSpan span(traceid, "readFetchCompute", stripename, logList(computefor));
 
   // create objstream to read data from disk
   FSObjInputStream* objstream = new FSObjInputStream(_conf, readObjName, _underfs);
   if (!objstream->exist()) {
-    cout << "OECWorker::readWorker." << readObjName << " does not exist!" << endl;
+    LOG_DEBUG << "OECWorker::readWorker." << readObjName << " does not exist!";
     return;
   }
   BlockingQueue<OECDataPacket*>* readQueue = objstream->getQueue();
@@ -1882,15 +2190,24 @@ void OECWorker::readFetchCompute(AGCommand* agCmd) {
   int slicesize = pktsize/ecw;
   for (int i=0; i<nprevs; i++) {
     if (prevCids[i] == cid) {
-      fetchThreads[i] = thread([=]{objstream->readObj(pktsize);});
+      fetchThreads[i] = thread([=]{
+        TraceSpan span(traceid, "load", stripename, readObjName);
+        objstream->readObj(pktsize);
+      });
     } else {
       string keybase = stripename+":"+to_string(prevCids[i]);
-      fetchThreads[i] = thread([=]{fetchWorker(fetchQueue[i], keybase, prevLocs[i], pktnum);});
+      fetchThreads[i] = thread([=]{
+        TraceSpan span(traceid, "fetch", stripename, keybase + " from " + RedisUtil::ip2Str(prevLocs[i]));
+        fetchWorker(fetchQueue[i], keybase, prevLocs[i], pktnum);
+      });
     }
   }
 
   // create compute thread
-  thread computeThread = thread([=]{computeWorker(fetchQueue, nprevs, prevCids, pktnum, coefs, computefor, writeQueue, slicesize);});
+  thread computeThread = thread([=]{
+    TraceSpan span(traceid, "compute", stripename, logList(computefor));
+    computeWorker(fetchQueue, nprevs, prevCids, pktnum, coefs, computefor, writeQueue, slicesize);
+  });
 
   // create cache thread
   vector<thread> cacheThreads = vector<thread>(cacheRefs.size());
@@ -1900,7 +2217,10 @@ void OECWorker::readFetchCompute(AGCommand* agCmd) {
     int ref = item.second;
     string keybase = stripename+":"+to_string(cid);
     BlockingQueue<OECDataPacket*>* queue = writeQueue[cid];
-    cacheThreads[cacheid++] = thread([=]{cacheWorker(queue, keybase, pktnum, ref);});
+    cacheThreads[cacheid++] = thread([=]{
+      TraceSpan span(traceid, "cache", stripename, keybase);
+      cacheWorker(queue, keybase, pktnum, ref);
+    });
   }
 
   // join
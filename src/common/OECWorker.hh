@@ -5,7 +5,9 @@
 #include "Config.hh"
 #include "FSObjInputStream.hh"
 #include "FSObjOutputStream.hh"
+#include "Metrics.hh"
 #include "OECDataPacket.hh"
+#include "Tracer.hh"
 //#include "ECBase.hh"
 //#include "RSCONV.hh"
 //#include "Util/hdfs.h"
@@ -37,9 +39,10 @@ class OECWorker {
     void clientRead(AGCommand* agCmd);
     void onlineWrite(string filename, string ecid, int filesizeMB);
     void offlineWrite(string filename, string ecpoolid, int filesizeMB);
-    void readOnline(string filename, int filesizeMB, int ecn, int eck, int ecw);
-    void readOffline(string filename, int filesizeMB, int objnum);
-    void readOfflineObj(string filename, string objname, int objsizeMB, FSObjInputStream* objstream, int pktnum, int idx);
+    void readOnline(string filename, int pktnum, int ecn, int eck, int ecw, int firstpkt, int pktcnt);
+    void readOffline(string filename, int filesizeMB, int objnum, int firstpkt, int pktcnt);
+    void readOfflineObj(string filename, string objname, int objsizeMB, FSObjInputStream* objstream, int pktnum, int idx,
+                        int startpkt, int cnt, int keystart);
 
     // load data from redis
     void loadWorker(BlockingQueue<OECDataPacket*>* readQueue,
@@ -48,6 +51,10 @@ class OECWorker {
                     int step,
                     int round,
                     bool zeropadding);
+    void streamLoadWorker(BlockingQueue<OECDataPacket*>** readQueue,
+                    string keybase,
+                    int eck,
+                    long* filesizeB);
     // compute
     void computeWorker(vector<ECTask*> compute, 
                        BlockingQueue<OECDataPacket*>** readQueue,
@@ -76,6 +83,8 @@ class OECWorker {
                                       int ecw);
 
     // deal with coor instruction
+    // runs the ectask commands of several stripes, type 12
+    void batch(AGCommand* agCmd);
     void readDisk(AGCommand* agCmd);
     void fetchCompute(AGCommand* agCmd);
     void persist(AGCommand* agCmd);
@@ -127,6 +136,12 @@ class OECWorker {
                      int step,
                      int num,
                      int refs);
+    void rangeCacheWorker(BlockingQueue<OECDataPacket*>* writeQueue,
+                          string keybase,
+                          int startidx,
+                          int skip,
+                          int num,
+                          int total);
 
 //    void offlineWrite(AGCommand* agCmd);
 //    void clientRead(AGCommand* agCmd);
@@ -0,0 +1,163 @@
+#include "PlacementEngine.hh"
+
+PlacementEngine::PlacementEngine(Config* conf) {
+  _rackMax = conf->_placement_rack_max;
+  _sampleThreshold = conf->_placement_sample_threshold;
+  _sampleChoices = conf->_placement_sample_choices > 0 ? conf->_placement_sample_choices : 1;
+
+  unordered_map<string, int> rackIds;
+  vector<double> weights;
+  bool weighted = false;
+  for (auto ip: conf->_agentsIPs) {
+    if (_ip2Node.find(ip) != _ip2Node.end()) continue;
+    int nodeid = _nodes.size();
+    string rack = conf->_ip2Rack[ip];
+    unordered_map<string, int>::iterator it = rackIds.find(rack);
+    int rackid;
+    if (it == rackIds.end()) {
+      rackid = _rackNodes.size();
+      rackIds.insert(make_pair(rack, rackid));
+      _rackNodes.push_back(vector<int>());
+    } else {
+      rackid = it->second;
+    }
+    _nodes.push_back(ip);
+    _nodeRack.push_back(rackid);
+    _rackNodes[rackid].push_back(nodeid);
+    _ip2Node.insert(make_pair(ip, nodeid));
+
+    double weight = 1;
+    unordered_map<unsigned int, double>::iterator wit = conf->_ip2Weight.find(ip);
+    if (wit != conf->_ip2Weight.end()) weight = wit->second;
+    if (weight != 1) weighted = true;
+    weights.push_back(weight);
+  }
+  if (weighted) buildAlias(weights);
+}
+
+void PlacementEngine::buildAlias(vector<double>& weights) {
+  // Vose's alias method
+  int num = weights.size();
+  double sum = 0;
+  for (auto w: weights) sum += w;
+  _aliasProb.resize(num);
+  _alias.resize(num);
+  vector<double> scaled(num);
+  vector<int> small, large;
+  for (int i=0; i<num; i++) {
+    scaled[i] = sum > 0 ? weights[i] * num / sum : 1;
+    if (scaled[i] < 1) small.push_back(i);
+    else large.push_back(i);
+  }
+  while (!small.empty() && !large.empty()) {
+    int s = small.back(); small.pop_back();
+    int l = large.back(); large.pop_back();
+    _aliasProb[s] = scaled[s];
+    _alias[s] = l;
+    scaled[l] = scaled[l] + scaled[s] - 1;
+    if (scaled[l] < 1) small.push_back(l);
+    else large.push_back(l);
+  }
+  for (auto i: large) { _aliasProb[i] = 1; _alias[i] = i; }
+  for (auto i: small) { _aliasProb[i] = 1; _alias[i] = i; }
+}
+
+int PlacementEngine::sampleNode() {
+  int nodeid = rand() % _nodes.size();
+  if (_aliasProb.empty()) return nodeid;
+  if ((double)rand() / RAND_MAX < _aliasProb[nodeid]) return nodeid;
+  return _alias[nodeid];
+}
+
+void PlacementEngine::buildState(const vector<unsigned int>& placedIp, const vector<int>& colocWith,
+                                 const vector<unsigned int>& exclude, StripeState& state) {
+  for (auto ip: placedIp) {
+    unordered_map<unsigned int, int>::iterator it = _ip2Node.find(ip);
+    if (it == _ip2Node.end()) continue;
+    state.used.insert(it->second);
+    state.rackCount[_nodeRack[it->second]]++;
+  }
+  for (auto ip: exclude) {
+    unordered_map<unsigned int, int>::iterator it = _ip2Node.find(ip);
+    if (it != _ip2Node.end()) state.used.insert(it->second);
+  }
+  for (auto idx: colocWith) {
+    if (idx >= placedIp.size()) continue;
+    unordered_map<unsigned int, int>::iterator it = _ip2Node.find(placedIp[idx]);
+    if (it == _ip2Node.end()) continue;
+    int rack = _nodeRack[it->second];
+    if (find(state.colocRacks.begin(), state.colocRacks.end(), rack) == state.colocRacks.end())
+      state.colocRacks.push_back(rack);
+  }
+}
+
+bool PlacementEngine::rackFull(StripeState& state, int rack) {
+  if (_rackMax <= 0) return false;
+  unordered_map<int, int>::iterator it = state.rackCount.find(rack);
+  return it != state.rackCount.end() && it->second >= _rackMax;
+}
+
+void PlacementEngine::enumerate(StripeState& state, bool domain, vector<unsigned int>& toret) {
+  for (int i=0; i<_nodes.size(); i++) {
+    if (state.used.find(i) != state.used.end()) continue;
+    if (domain && rackFull(state, _nodeRack[i])) continue;
+    toret.push_back(_nodes[i]);
+  }
+}
+
+vector<unsigned int> PlacementEngine::candidates(const vector<unsigned int>& placedIp,
+                                                 const vector<int>& colocWith,
+                                                 const vector<unsigned int>& exclude) {
+  vector<unsigned int> toret;
+  StripeState state;
+  buildState(placedIp, colocWith, exclude, state);
+
+  // 0. colocated objects stay within the racks of their group
+  for (auto rack: state.colocRacks) {
+    for (auto nodeid: _rackNodes[rack]) {
+      if (state.used.find(nodeid) == state.used.end()) toret.push_back(_nodes[nodeid]);
+    }
+  }
+  if (toret.size() > 0) return toret;
+
+  // 1. large cluster: draw a few agents, each draw is accepted with high probability
+  if (_nodes.size() > _sampleThreshold) {
+    int attempts = _sampleChoices * 16;
+    for (int i=0; i<attempts && toret.size() < _sampleChoices; i++) {
+      int nodeid = sampleNode();
+      if (state.used.find(nodeid) != state.used.end()) continue;
+      if (rackFull(state, _nodeRack[nodeid])) continue;
+      if (find(toret.begin(), toret.end(), _nodes[nodeid]) != toret.end()) continue;
+      toret.push_back(_nodes[nodeid]);
+    }
+    if (toret.size() > 0) return toret;
+  }
+
+  // 2. all eligible agents, then relax the failure domain
+  enumerate(state, true, toret);
+  if (toret.size() == 0 && _rackMax > 0) enumerate(state, false, toret);
+  return toret;
+}
+
+bool PlacementEngine::eligible(unsigned int ip,
+                               const vector<unsigned int>& placedIp,
+                               const vector<int>& colocWith) {
+  unordered_map<unsigned int, int>::iterator it = _ip2Node.find(ip);
+  if (it == _ip2Node.end()) return false;
+  int nodeid = it->second;
+  StripeState state;
+  buildState(placedIp, colocWith, vector<unsigned int>(), state);
+  if (state.used.find(nodeid) != state.used.end()) return false;
+
+  int rack = _nodeRack[nodeid];
+  if (state.colocRacks.size() > 0) {
+    if (find(state.colocRacks.begin(), state.colocRacks.end(), rack) != state.colocRacks.end()) return true;
+    // another agent is left in the racks of the group
+    for (auto crack: state.colocRacks) {
+      for (auto cnode: _rackNodes[crack]) {
+        if (state.used.find(cnode) == state.used.end()) return false;
+      }
+    }
+  }
+  return !rackFull(state, rack);
+}
@@ -0,0 +1,67 @@
+#ifndef _PLACEMENTENGINE_HH_
+#define _PLACEMENTENGINE_HH_
+
+#include "Config.hh"
+
+#include "../inc/include.hh"
+
+#include <unordered_set>
+
+using namespace std;
+
+/*
+ * Rack-aware placement of the objects of a stripe
+ *
+ * Agents are indexed by node id, with node id -> rack id and rack id -> node ids, so that
+ * checking a candidate costs O(1) instead of a scan over the placed objects.
+ *
+ * - colocWith: an object in a group of ECPolicy::Place goes to the racks of the placed
+ *   members of its group, the whole cluster is used if they have no free node
+ * - failure domain: at most _rackMax objects of a stripe in one rack (0 disables),
+ *   relaxed when no rack is left
+ * - small clusters enumerate all eligible agents, clusters larger than _sampleThreshold
+ *   draw _sampleChoices of them by agent weight with an alias table (O(1) per draw)
+ */
+class PlacementEngine {
+  private:
+    int _rackMax;
+    int _sampleThreshold;
+    int _sampleChoices;
+
+    vector<unsigned int> _nodes;           // node id -> ip
+    vector<int> _nodeRack;                 // node id -> rack id
+    vector<vector<int>> _rackNodes;        // rack id -> node ids
+    unordered_map<unsigned int, int> _ip2Node;
+
+    // alias table of node weights, empty when all weights are equal
+    vector<double> _aliasProb;
+    vector<int> _alias;
+
+    typedef struct {
+      unordered_set<int> used;             // placed and excluded nodes
+      unordered_map<int, int> rackCount;   // placed objects per rack
+      vector<int> colocRacks;
+    } StripeState;
+
+    void buildAlias(vector<double>& weights);
+    int sampleNode();
+    void buildState(const vector<unsigned int>& placedIp, const vector<int>& colocWith,
+                    const vector<unsigned int>& exclude, StripeState& state);
+    bool rackFull(StripeState& state, int rack);
+    void enumerate(StripeState& state, bool domain, vector<unsigned int>& toret);
+
+  public:
+    PlacementEngine(Config* conf);
+
+    // placedIp[i] is the location of the i-th placed object, colocWith holds its indexes
+    // in placedIp; exclude lists agents that must not be chosen
+    vector<unsigned int> candidates(const vector<unsigned int>& placedIp,
+                                    const vector<int>& colocWith,
+                                    const vector<unsigned int>& exclude = vector<unsigned int>());
+    // whether ip satisfies the colocation and failure-domain constraints
+    bool eligible(unsigned int ip,
+                  const vector<unsigned int>& placedIp,
+                  const vector<int>& colocWith);
+};
+
+#endif
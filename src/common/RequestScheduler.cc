@@ -0,0 +1,108 @@
+#include "RequestScheduler.hh"
+
+RequestScheduler::RequestScheduler(Config* conf) {
+  _conf = conf;
+  _threadNum = _conf->_coorThreadNum;
+  int reserved = 0;
+  for (int i=0; i<REQ_CLASS_NUM; i++) {
+    _weight[i] = _conf->_coor_sched_weight[i] > 0 ? _conf->_coor_sched_weight[i] : 1;
+    _reserve[i] = _conf->_coor_sched_reserve[i] > 0 ? _conf->_coor_sched_reserve[i] : 0;
+    // the reservations leave at least one thread shared by all classes
+    if (reserved + _reserve[i] > _threadNum - 1) _reserve[i] = max(0, _threadNum - 1 - reserved);
+    reserved += _reserve[i];
+    _pass[i] = 0;
+    _busy[i] = 0;
+  }
+  _vtime = 0;
+  _busyAll = 0;
+}
+
+int RequestScheduler::classOf(int type) {
+  switch (type) {
+    case 5:
+    case 9: return REQ_DEGRADED;
+    case 0:
+    case 2:
+    case 13: return REQ_WRITE;
+    case 8: return REQ_REPAIR;
+    case 4:
+    case 15: return REQ_ENCODE;
+    default: return REQ_META;
+  }
+}
+
+int RequestScheduler::classOf(CoorCommand* coorCmd) {
+  if (coorCmd->getType() != 12) return classOf(coorCmd->getType());
+  string op = coorCmd->getBenchOp();
+  if (op == "regonline" || op == "regoffline") return REQ_WRITE;
+  if (op == "degraded") return REQ_DEGRADED;
+  if (op == "encode") return REQ_ENCODE;
+  return REQ_META;
+}
+
+void RequestScheduler::receive() {
+  redisContext* localCtx = RedisUtil::createContext(_conf->_localIp);
+  redisReply* rReply;
+  while (true) {
+    rReply = (redisReply*)redisCommand(localCtx, "blpop coor_request 0");
+    if (rReply -> type == REDIS_REPLY_NIL) {
+      LOG_ERROR << "RequestScheduler::receive() get feed back empty queue ";
+    } else if (rReply -> type == REDIS_REPLY_ERROR) {
+      LOG_ERROR << "RequestScheduler::receive() get feed back ERROR happens ";
+    } else {
+      char* reqStr = rReply -> element[1] -> str;
+      push(new CoorCommand(reqStr));
+    }
+    freeReplyObject(rReply);
+  }
+  redisFree(localCtx);
+}
+
+void RequestScheduler::push(CoorCommand* coorCmd) {
+  int cls = classOf(coorCmd);
+  unique_lock<mutex> lk(_lock);
+  // an idle class restarts from the current virtual time instead of spending saved credit
+  if (_queue[cls].empty() && _pass[cls] < _vtime) _pass[cls] = _vtime;
+  _queue[cls].push_back(coorCmd);
+  lk.unlock();
+  _cond.notify_all();
+}
+
+bool RequestScheduler::admit(int cls) {
+  if (_busy[cls] < _reserve[cls]) return true;
+  int unused = 0;
+  for (int i=0; i<REQ_CLASS_NUM; i++) {
+    if (i != cls && _busy[i] < _reserve[i]) unused += _reserve[i] - _busy[i];
+  }
+  int idle = _threadNum - _busyAll;
+  return idle - 1 >= unused;
+}
+
+CoorCommand* RequestScheduler::pop(int& cls) {
+  unique_lock<mutex> lk(_lock);
+  while (true) {
+    cls = -1;
+    for (int i=0; i<REQ_CLASS_NUM; i++) {
+      if (_queue[i].empty() || !admit(i)) continue;
+      if (cls < 0 || _pass[i] < _pass[cls]) cls = i;
+    }
+    if (cls >= 0) break;
+    _cond.wait(lk);
+  }
+  CoorCommand* toret = _queue[cls].front();
+  _queue[cls].pop_front();
+  _vtime = _pass[cls];
+  _pass[cls] += 1.0 / _weight[cls];
+  _busy[cls]++;
+  _busyAll++;
+  return toret;
+}
+
+void RequestScheduler::done(int cls) {
+  unique_lock<mutex> lk(_lock);
+  _busy[cls]--;
+  _busyAll--;
+  lk.unlock();
+  // a finished command may admit a class that was held back by the reservations
+  _cond.notify_all();
+}
@@ -0,0 +1,63 @@
+#ifndef _REQUESTSCHEDULER_HH_
+#define _REQUESTSCHEDULER_HH_
+
+#include "Config.hh"
+
+#include "../inc/include.hh"
+#include "../protocol/CoorCommand.hh"
+#include "../util/RedisUtil.hh"
+
+#include <condition_variable>
+
+using namespace std;
+
+/*
+ * Dispatch of coor_request among the coordinator threads
+ *
+ * A receiver thread pops coor_request and queues each command by class. Coordinator threads
+ * dequeue with stride scheduling: every class has a pass that advances by 1/weight per
+ * dequeued command, the runnable class with the smallest pass goes first.
+ * A class with reserved threads always finds them: a thread only takes a command of another
+ * class if enough threads stay idle to cover the unused reservations.
+ */
+
+#define REQ_META 0      // foreground metadata: getLocation, getFileMeta and short bookkeeping
+#define REQ_DEGRADED 1  // degraded read instructions
+#define REQ_WRITE 2     // write registration and finalize
+#define REQ_REPAIR 3    // repair requests from StripeStore
+#define REQ_ENCODE 4    // background offline encode
+#define REQ_CLASS_NUM 5
+
+class RequestScheduler {
+  private:
+    Config* _conf;
+    int _threadNum;
+    int _weight[REQ_CLASS_NUM];
+    int _reserve[REQ_CLASS_NUM];
+
+    mutex _lock;
+    condition_variable _cond;
+    deque<CoorCommand*> _queue[REQ_CLASS_NUM];
+    double _pass[REQ_CLASS_NUM];
+    double _vtime;
+    int _busy[REQ_CLASS_NUM];
+    int _busyAll;
+
+    bool admit(int cls);
+
+  public:
+    RequestScheduler(Config* conf);
+
+    static int classOf(int type);
+    // benchmark requests are queued in the class of the request they emulate
+    static int classOf(CoorCommand* coorCmd);
+
+    // pops coor_request forever
+    void receive();
+    void push(CoorCommand* coorCmd);
+    // blocks until a command may run on the calling thread, which calls done(cls) afterwards
+    CoorCommand* pop(int& cls);
+    void done(int cls);
+};
+
+#endif
@@ -1,14 +1,63 @@
 #include "SSEntry.hh"
 
+#include <unordered_set>
+
+static const string* internEcidpool(const string& ecidpool) {
+  static mutex internLock;
+  static unordered_set<string> interned;
+  lock_guard<mutex> lock(internLock);
+  return &*interned.insert(ecidpool).first;
+}
+
 SSEntry::SSEntry(string filename, int type, int filesizeMB, string ecidpool, vector<string> objname, vector<unsigned int> loc) {
   _filename = filename;
   _type = type;
   _filesizeMB = filesizeMB;
-  _ecidpool = ecidpool;
-  _objList = objname;
+  _filesizeB = (filesizeMB < 0) ? -1 : (long)filesizeMB * 1048576;
+  _ecidpool = internEcidpool(ecidpool);
+  setObjList(objname);
   _objLoc = loc;
 }
 
+void SSEntry::setObjList(const vector<string>& objnames) {
+  _objnum = objnames.size();
+  _nameKind = OBJNAME_INDEXED;
+  for (int i=0; i<_objnum; i++) {
+    if (objnames[i] != objName(i)) {
+      _nameKind = OBJNAME_LIST;
+      break;
+    }
+  }
+  if (_nameKind == OBJNAME_LIST && _objnum == 1 && objnames[0] == _filename) _nameKind = OBJNAME_SELF;
+  if (_nameKind == OBJNAME_LIST) _objList = objnames;
+}
+
+string SSEntry::objName(int idx) {
+  if (_nameKind == OBJNAME_INDEXED) return _filename + "_oecobj_" + to_string(idx);
+  if (_nameKind == OBJNAME_SELF) return _filename;
+  return _objList[idx];
+}
+
+int SSEntry::findObj(const string& objname) {
+  if (_nameKind == OBJNAME_INDEXED) {
+    // <filename>_oecobj_<i>
+    int prefixlen = _filename.length() + 8;
+    if (objname.length() <= prefixlen || objname.compare(0, _filename.length(), _filename) != 0
+        || objname.compare(_filename.length(), 8, "_oecobj_") != 0) return -1;
+    string idxstr = objname.substr(prefixlen);
+    // at most 9 digits, so that any name from a request fits an int
+    if (idxstr.length() > 9 || idxstr.find_first_not_of("0123456789") != string::npos
+        || (idxstr.length() > 1 && idxstr[0] == '0')) return -1;
+    int idx = stoi(idxstr);
+    return idx < _objnum ? idx : -1;
+  }
+  if (_nameKind == OBJNAME_SELF) return objname == _filename ? 0 : -1;
+  for (int i=0; i<_objList.size(); i++) {
+    if (objname == _objList[i]) return i;
+  }
+  return -1;
+}
+
 SSEntry::SSEntry(string line) {
 //  int start = 0;
 //  int pos = line.find_first_of(";");
@@ -23,6 +72,8 @@ SSEntry::SSEntry(string line) {
 //  entryitems.push_back(item);
 //  for (int i=0; i<entryitems.size(); i++) cout << entryitems[i] << endl;
   vector<string> entryitems = RedisUtil::str2container(line);
+  // the line ends with ';', drop the empty item after it
+  if (entryitems.size() > 0 && entryitems[entryitems.size()-1] == "") entryitems.pop_back();
   
   // entryitems[0]:filename
   _filename = entryitems[0];
@@ -31,18 +82,40 @@ SSEntry::SSEntry(string line) {
   // entryitems[2]:filesizeMB
   _filesizeMB = stoi(entryitems[2]);
   // entryitems[3]:ecidpool
-  _ecidpool = entryitems[3];
-  // remain: objs
+  _ecidpool = internEcidpool(entryitems[3]);
+  _filesizeB = (_filesizeMB < 0) ? -1 : (long)_filesizeMB * 1048576;
+  // remain: objs, followed by the exact filesize in bytes if it is recorded
   int objnum = (entryitems.size() - 4) / 2;
+  if ((entryitems.size() - 4) % 2 == 1) _filesizeB = stol(entryitems[entryitems.size()-1]);
+  vector<string> objnames;
   for (int i=0; i<objnum; i++) {
     int idx = 4 + i * 2;
     string objname = entryitems[idx];
     string objlocstr = entryitems[idx+1];
-    _objList.push_back(objname);
+    objnames.push_back(objname);
     unsigned long loc = stoul(objlocstr, nullptr, 0);
     unsigned int objloc = (unsigned int)loc;
     _objLoc.push_back(objloc);
   }
+  setObjList(objnames);
+}
+
+SSEntry::SSEntry(const char* buf, int len) {
+  // |filename|type|filesizeMB|filesizeB|ecidpool|namekind|objnum|(objnum * objname)|objnum * objloc|
+  // objnames are only stored for OBJNAME_LIST
+  _filename = MetaStore::readString(buf);
+  _type = MetaStore::readInt(buf);
+  _filesizeMB = MetaStore::readInt(buf);
+  _filesizeB = MetaStore::readLong(buf);
+  _ecidpool = internEcidpool(MetaStore::readString(buf));
+  _nameKind = (char)MetaStore::readInt(buf);
+  _objnum = MetaStore::readInt(buf);
+  if (_nameKind == OBJNAME_LIST) {
+    _objList.reserve(_objnum);
+    for (int i=0; i<_objnum; i++) _objList.push_back(MetaStore::readString(buf));
+  }
+  _objLoc.resize(_objnum);
+  if (_objnum > 0) memcpy((char*)&_objLoc[0], buf, _objnum * sizeof(unsigned int));
 }
 
 string SSEntry::getFilename() {
@@ -54,83 +127,119 @@ int SSEntry::getType() {
 }
 
 int SSEntry::getFilesizeMB() {
+  lock_guard<mutex> lock(_updateLock);
   return _filesizeMB;
 }
 
+long SSEntry::getFilesizeB() {
+  lock_guard<mutex> lock(_updateLock);
+  return _filesizeB;
+}
+
 string SSEntry::getEcidpool() {
-  return _ecidpool;
+  return *_ecidpool;
 }
 
 vector<string> SSEntry::getObjlist() {
-  return _objList;
+  if (_nameKind == OBJNAME_LIST) return _objList;
+  vector<string> toret;
+  toret.reserve(_objnum);
+  for (int i=0; i<_objnum; i++) toret.push_back(objName(i));
+  return toret;
+}
+
+int SSEntry::getObjnum() {
+  return _objnum;
+}
+
+bool SSEntry::hasDerivedObjNames() {
+  return _nameKind != OBJNAME_LIST;
 }
 
 vector<unsigned int> SSEntry::getObjloc() {
+  lock_guard<mutex> lock(_updateLock);
   return _objLoc;
 }
 
 int SSEntry::getIdxOfObj(string objname) {
-  int toret=-1;
-  for (int i=0; i<_objList.size(); i++) {
-    if (objname == _objList[i]) {
-      toret = i;
-      break;
-    }
-  }
+  int toret = findObj(objname);
   assert (toret != -1);
   return toret;
 }
 
 unsigned int SSEntry::getLocOfObj(string objname) {
-  unsigned int toret;
-  bool find=false;
-  for (int i=0; i<_objList.size(); i++) {
-    if (objname == _objList[i]) {
-      toret = _objLoc[i];
-      find = true;
-      break;
-    }
-  }
-  assert (find);
-  return toret;
+  int idx = findObj(objname);
+  assert (idx != -1);
+  lock_guard<mutex> lock(_updateLock);
+  return _objLoc[idx];
 }
 
 void SSEntry::updateObjLoc(string objname, unsigned int loc) {
+  int idx = findObj(objname);
+  assert(idx != -1);
   _updateLock.lock();
-  int idx=-1;
-  for (int i=0; i<_objList.size(); i++) {
-    if (_objList[i] == objname) {
-      idx = i;
-      break;
-    }
-  }
-  if (idx != -1) _objLoc[idx] = loc;
+  _objLoc[idx] = loc;
   _updateLock.unlock();
-  assert(idx != -1);
+}
+
+void SSEntry::setFilesizeB(long filesizeB) {
+  _updateLock.lock();
+  _filesizeB = filesizeB;
+  _filesizeMB = (filesizeB + 1048575) / 1048576;
+  _updateLock.unlock();
+}
+
+void SSEntry::setBackedUp() {
+  _backedUp = true;
+}
+
+bool SSEntry::isBackedUp() {
+  return _backedUp;
 }
 
 string SSEntry::toString() {
+  lock_guard<mutex> lock(_updateLock);
   string toret = "";
   toret += _filename+";";
   toret += to_string(_type)+";";
   toret += to_string(_filesizeMB)+";";
-  toret += _ecidpool+";";
-  int num = _objList.size();
+  toret += *_ecidpool+";";
+  int num = _objnum;
   for (int i=0; i<num; i++) {
-    string obj = _objList[i];
+    string obj = objName(i);
     toret += obj+";";
     unsigned int loc = _objLoc[i];
     toret += to_string(loc)+";";
   }
+  toret += to_string(_filesizeB)+";";
   toret += "\n";
   return toret;
 }
 
+string SSEntry::toBinary() {
+  string toret;
+  _updateLock.lock();
+  MetaStore::writeString(toret, _filename);
+  MetaStore::writeInt(toret, _type);
+  MetaStore::writeInt(toret, _filesizeMB);
+  MetaStore::writeLong(toret, _filesizeB);
+  MetaStore::writeString(toret, *_ecidpool);
+  MetaStore::writeInt(toret, _nameKind);
+  MetaStore::writeInt(toret, _objnum);
+  if (_nameKind == OBJNAME_LIST) {
+    for (int i=0; i<_objnum; i++) MetaStore::writeString(toret, _objList[i]);
+  }
+  if (_objnum > 0) toret.append((char*)&_objLoc[0], _objnum * sizeof(unsigned int));
+  _updateLock.unlock();
+  return toret;
+}
+
 void SSEntry::dump() {
-  cout << "SSEntry:: filename: "<< _filename << ", type: " << _type << ", filesizeMB: " << _filesizeMB 
-       << ", ecidpool: " << _ecidpool << ", objname: ";
-  for (int i=0; i<_objList.size(); i++) cout << _objList[i] << " ";
-  cout << ", objloc: ";
-  for (int i=0; i<_objLoc.size(); i++) cout << RedisUtil::ip2Str(_objLoc[i]) << " ";
-  cout << endl;
+  if (!LOG_ENABLED(LOG_LEVEL_DEBUG)) return;
+  vector<string> objnames;
+  for (int i=0; i<_objnum; i++) objnames.push_back(objName(i));
+  vector<string> objlocs;
+  for (int i=0; i<_objLoc.size(); i++) objlocs.push_back(RedisUtil::ip2Str(_objLoc[i]));
+  LOG_DEBUG << "SSEntry:: filename: "<< _filename << ", type: " << _type << ", filesizeMB: " << _filesizeMB << ", filesizeB: " << _filesizeB
+            << ", ecidpool: " << *_ecidpool << ", objname: " << logList(objnames) << ", objloc: " << logList(objlocs);
 }
@@ -1,42 +1,72 @@
 #ifndef _SSENTRY_HH_
 #define _SSENTRY_HH_
 
+#include "MetaStore.hh"
+
 #include "../inc/include.hh"
 #include "../util/RedisUtil.hh"
 
+#include <atomic>
+
 using namespace std;
 
+#define OBJNAME_INDEXED 0
+#define OBJNAME_SELF 1
+#define OBJNAME_LIST 2
+
 class SSEntry {
   private:
     string _filename;
     int _type; //0: online; 1: offline
     int _filesizeMB;
+    long _filesizeB; // exact length in bytes, -1 until a streaming write finalizes
 
-    string _ecidpool; // online: ecid; offline: ecpool
-    vector<string> _objList; // OpenEC transfer file into several oecobj, this is the obj name in sequence
+    const string* _ecidpool; // online: ecid; offline: ecpool, interned as there are only a few of them
+    // OpenEC transfer file into several oecobj, the obj names in sequence are derived from the
+    // filename unless they do not follow a known pattern:
+    //   OBJNAME_INDEXED: <filename>_oecobj_<i>
+    //   OBJNAME_SELF:    a single obj named as the file, e.g. a parity obj of an offline pool
+    //   OBJNAME_LIST:    names in _objList
+    char _nameKind;
+    int _objnum;
+    vector<string> _objList;
     vector<unsigned int> _objLoc;  // location for each obj in this file
 
+    // guards the fields that change after registration: filesize and objloc
     mutex _updateLock; 
+    // set once the entry is in the metastore, i.e. the write finished or the stripe is encoded
+    atomic<bool> _backedUp{false};
 
+    void setObjList(const vector<string>& objnames);
+    string objName(int idx);
   public:
     SSEntry(string filename, int type, int filesizeMB, string ecidpool, vector<string> objname, vector<unsigned int> loc);
     SSEntry(string raw);
+    SSEntry(const char* buf, int len);
 
     string getFilename();
     int getType();
     int getFilesizeMB();
+    long getFilesizeB();
     string getEcidpool();
     vector<string> getObjlist();
+    int getObjnum();
+    bool hasDerivedObjNames();
     vector<unsigned int> getObjloc();
     int getIdxOfObj(string objname);
+    int findObj(const string& objname); // -1 if objname is not in this entry
     unsigned int getLocOfObj(string objname);
     string toString();
+    string toBinary();
 
     // for debug
     void dump();
 
     // update
     void updateObjLoc(string objname, unsigned int loc);
+    void setFilesizeB(long filesizeB);
+    void setBackedUp();
+    bool isBackedUp();
 };
 
 #endif
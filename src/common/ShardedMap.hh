@@ -0,0 +1,106 @@
+#ifndef _SHARDEDMAP_HH_
+#define _SHARDEDMAP_HH_
+
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+/*
+ * Hash map split into shards, each guarded by its own mutex, so that
+ * threads working on different keys rarely wait for each other.
+ * Every access takes the lock of the key's shard; forEach locks one shard at a time.
+ */
+template <class K, class V>
+class ShardedMap {
+  private:
+    struct Shard {
+      mutex _mutex;
+      unordered_map<K, V> _map;
+    };
+    int _shardNum;
+    Shard* _shards;
+    hash<K> _hasher;
+
+    Shard& shardOf(const K& key) {
+      // mix the high bits in, string hashes of similar names differ mostly there
+      size_t h = _hasher(key);
+      h ^= h >> 16;
+      return _shards[h & (_shardNum - 1)];
+    };
+
+  public:
+    // shardnum is rounded up to a power of 2
+    ShardedMap(int shardnum = 64) {
+      _shardNum = 1;
+      while (_shardNum < shardnum) _shardNum <<= 1;
+      _shards = new Shard[_shardNum];
+    };
+
+    ~ShardedMap() {
+      delete [] _shards;
+    };
+
+    bool find(const K& key, V& value) {
+      Shard& shard = shardOf(key);
+      lock_guard<mutex> lock(shard._mutex);
+      typename unordered_map<K, V>::iterator it = shard._map.find(key);
+      if (it == shard._map.end()) return false;
+      value = it->second;
+      return true;
+    };
+
+    bool contains(const K& key) {
+      Shard& shard = shardOf(key);
+      lock_guard<mutex> lock(shard._mutex);
+      return shard._map.find(key) != shard._map.end();
+    };
+
+    // insert if the key does not exist, return whether it is inserted
+    bool insert(const K& key, const V& value) {
+      Shard& shard = shardOf(key);
+      lock_guard<mutex> lock(shard._mutex);
+      return shard._map.insert(make_pair(key, value)).second;
+    };
+
+    // insert or replace
+    void set(const K& key, const V& value) {
+      Shard& shard = shardOf(key);
+      lock_guard<mutex> lock(shard._mutex);
+      shard._map[key] = value;
+    };
+
+    bool erase(const K& key) {
+      Shard& shard = shardOf(key);
+      lock_guard<mutex> lock(shard._mutex);
+      return shard._map.erase(key) > 0;
+    };
+
+    size_t size() {
+      size_t toret = 0;
+      for (int i=0; i<_shardNum; i++) {
+        lock_guard<mutex> lock(_shards[i]._mutex);
+        toret += _shards[i]._map.size();
+      }
+      return toret;
+    };
+
+    void reserve(size_t num) {
+      for (int i=0; i<_shardNum; i++) {
+        lock_guard<mutex> lock(_shards[i]._mutex);
+        _shards[i]._map.reserve(num / _shardNum + 1);
+      }
+    };
+
+    // func must not access this map
+    void forEach(function<void(const K&, V&)> func) {
+      for (int i=0; i<_shardNum; i++) {
+        lock_guard<mutex> lock(_shards[i]._mutex);
+        for (auto& item: _shards[i]._map) func(item.first, item.second);
+      }
+    };
+};
+
+#endif
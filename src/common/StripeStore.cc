@@ -1,90 +1,179 @@
 #include "StripeStore.hh"
 
+#include <cmath>
+
 StripeStore::StripeStore(Config* conf) {
   _conf = conf;
   // by default, encode scheduling is delayed
   _enableScan = false;
   _enableRepair = false;
+  _encodeSeq = 0;
+  _repairSeq = 0;
+  _snapshotRequested = false;
 
 //   if (_conf->_repair_scheduling == "delay") _enableRepair = false;
 //   else if (_conf->_repair_scheduling == "threshold") _enableRepair = false;
 //   else _enableRepair = true;
 
-  // TODO: if metaStore exists, we need to load metadata into memory
-  //       if not, we need to create a metaStore 
+  // load metadata from the metastore, or migrate the text stores of earlier versions into it
+  _metaStore = new MetaStore(_conf->_meta_snapshot_records);
+  if (_metaStore->exist()) {
+    loadMeta();
+  } else {
+    _metaStore->rotate();
+    loadLegacy();
+    if (_ssEntryMap.size() > 0 || _backupStripes.size() > 0) snapshot();
+  }
+}
+
+void StripeStore::loadMeta() {
+  struct timeval time1, time2;
+  gettimeofday(&time1, NULL);
+  vector<MetaRecord> records;
+  _metaStore->load(records);
+
+  // 1. decode records in parallel
+  int recnum = records.size();
+  vector<SSEntry*> entries(recnum, NULL);
+  vector<vector<string>> stripes(recnum);
+  int threadnum = _conf->_meta_load_threads > 0 ? _conf->_meta_load_threads : 1;
+  if (recnum < threadnum) threadnum = recnum > 0 ? recnum : 1;
+  int step = (recnum + threadnum - 1) / threadnum;
+  vector<thread> decodeThreads = vector<thread>(threadnum);
+  for (int t=0; t<threadnum; t++) {
+    decodeThreads[t] = thread([&, t]{
+      for (int i=t*step; i<recnum && i<(t+1)*step; i++) {
+        const char* buf = records[i].data;
+        if (records[i].type == META_ENTRY_RECORD) {
+          entries[i] = new SSEntry(buf, records[i].len);
+        } else if (records[i].type == META_STRIPE_RECORD) {
+          // |ecpoolid|stripename|objnum|objnum * objname|
+          stripes[i].push_back(MetaStore::readString(buf));
+          stripes[i].push_back(MetaStore::readString(buf));
+          int objnum = MetaStore::readInt(buf);
+          for (int j=0; j<objnum; j++) stripes[i].push_back(MetaStore::readString(buf));
+        }
+      }
+    });
+  }
+  for (int t=0; t<threadnum; t++) decodeThreads[t].join();
+  _metaStore->releaseLoad();
+
+  // 2. apply in log order, a later record of an entry or stripe replaces the earlier one
+  unordered_map<string, SSEntry*> latest;
+  latest.reserve(recnum);
+  unordered_map<string, vector<string>> latestStripes;
+  vector<string> stripeOrder;
+  for (int i=0; i<recnum; i++) {
+    if (entries[i]) {
+      unordered_map<string, SSEntry*>::iterator it = latest.find(entries[i]->getFilename());
+      if (it == latest.end()) latest.insert(make_pair(entries[i]->getFilename(), entries[i]));
+      else {
+        delete it->second;
+        it->second = entries[i];
+      }
+    } else if (stripes[i].size() >= 2) {
+      string key = stripes[i][0] + ":" + stripes[i][1];
+      if (latestStripes.find(key) == latestStripes.end()) stripeOrder.push_back(key);
+      latestStripes[key] = stripes[i];
+    }
+  }
+  _ssEntryMap.reserve(latest.size());
+  for (auto item: latest) {
+    item.second->setBackedUp();
+    insertEntry(item.second);
+  }
+  for (auto key: stripeOrder) {
+    vector<string>& entryitems = latestStripes[key];
+    string ecpoolid = entryitems[0];
+    string ecid = _conf->_offlineECMap[ecpoolid];
+    int basesizeMB = _conf->_offlineECBase[ecpoolid];
+    ECPolicy* ecpolicy = _conf->_ecPolicyMap[ecid];
+    OfflineECPool* ecpool = getECPool(ecpoolid, ecpolicy, basesizeMB);
+    ecpool->constructPool(entryitems);
+    _backupStripes[ecpoolid].push_back(entryitems[1]);
+  }
+  gettimeofday(&time2, NULL);
+  LOG_INFO << "StripeStore::loadMeta.entries: " << _ssEntryMap.size() << ", stripes: " << stripeOrder.size()
+       << ", duration: " << RedisUtil::duration(time1, time2);
+}
+
+void StripeStore::loadLegacy() {
   // check whether entryStore exists, and read data from entryStore
   ifstream entryStore(_entryStorePath);
   if (entryStore.is_open()) {
-    cout << "StripeStore::read entryStore" << endl;
+    LOG_DEBUG << "StripeStore::read entryStore";
     string line;
     while (getline(entryStore, line)) {
       SSEntry* ssentry = new SSEntry(line);
-      ssentry->dump();
-      // insert ssentry into stripestore
-      insertEntry(ssentry);
+      ssentry->setBackedUp();
+      SSEntry* old = getEntry(ssentry->getFilename());
+      if (old) {
+        // a later line of an entry replaces the earlier one
+        _ssEntryMap.set(ssentry->getFilename(), ssentry);
+        if (!ssentry->hasDerivedObjNames()) {
+          for (auto obj: ssentry->getObjlist()) _objEntryMap.set(obj, ssentry);
+        }
+        delete old;
+      } else {
+        insertEntry(ssentry);
+      }
     }
     entryStore.close();
   }
   // check whether poolStore exists, and read data from poolStore
   ifstream poolStore(_poolStorePath);
   if (poolStore.is_open()) {
-    cout << "StripeStore::read poolStore" << endl;
+    LOG_DEBUG << "StripeStore::read poolStore";
     string line;
     while (getline(poolStore, line)) {
       vector<string> entryitems = RedisUtil::str2container(line);
+      if (entryitems.size() > 0 && entryitems[entryitems.size()-1] == "") entryitems.pop_back();
+      if (entryitems.size() < 2) continue;
       string ecpoolid = entryitems[0];
       string ecid = _conf->_offlineECMap[ecpoolid];
       int basesizeMB = _conf->_offlineECBase[ecpoolid];
       ECPolicy* ecpolicy = _conf->_ecPolicyMap[ecid];
       OfflineECPool* ecpool = getECPool(ecpoolid, ecpolicy, basesizeMB);
       ecpool->constructPool(entryitems);
+      _backupStripes[ecpoolid].push_back(entryitems[1]);
     }
     poolStore.close();
   }
 }
 
 bool StripeStore::existEntry(string filename) {
-  unordered_map<string, SSEntry*>::iterator it = _ssEntryMap.find(filename);
-  return it == _ssEntryMap.end() ? false:true;
-}
-
-void StripeStore::insertEntry(SSEntry* entry) {
-  unordered_map<string, SSEntry*>::iterator it = _ssEntryMap.find(entry->getFilename());
-  if (it == _ssEntryMap.end()) {
-    // the entry does not exist, insert this entry
-    _lockSSEntryMap.lock();
-    _ssEntryMap.insert(make_pair(entry->getFilename(), entry));
-    _lockSSEntryMap.unlock();
-
-    for (auto obj: entry->getObjlist()) {
-      _lockObjEntryMap.lock();
-      _objEntryMap.insert(make_pair(obj, entry));
-      _lockObjEntryMap.unlock();
-    }
-  } else {
-//     // the entry exist, only need to update the entry
-//     _lockSSEntryMap.lock();
-//     SSEntry* oldEntry = _ssEntryMap[entry->_filename];
-//     _ssEntryMap[entry->_filename] = entry;
-//     _lockSSEntryMap.unlock();
-//     // need to delete the old entry?
-//     delete oldEntry;
-  }
+  return _ssEntryMap.contains(filename);
+}
 
-  // TODO: add it to metaStore
-//  string entrystr = entry->toString();
-//  backupEntry(entrystr);
-//  cout << "StripeStore::insertEntry.entrystr: " << entrystr << endl;
+bool StripeStore::insertEntry(SSEntry* entry) {
+  // the entry is inserted only if it does not exist
+  if (!_ssEntryMap.insert(entry->getFilename(), entry)) return false;
+  // derived obj names are resolved from the filename, only other names are indexed
+  if (!entry->hasDerivedObjNames()) {
+    for (auto obj: entry->getObjlist()) _objEntryMap.insert(obj, entry);
+  }
+  return true;
 }
 
 SSEntry* StripeStore::getEntry(string filename) {
-  if (existEntry(filename)) return _ssEntryMap[filename];
-  else return NULL;
+  SSEntry* toret = NULL;
+  _ssEntryMap.find(filename, toret);
+  return toret;
 }
 
 SSEntry* StripeStore::getEntryFromObj(string objname) {
-  if (_objEntryMap.find(objname) != _objEntryMap.end()) return _objEntryMap[objname];
-  else return NULL;
+  SSEntry* toret = NULL;
+  // <filename>_oecobj_<i>
+  size_t pos = objname.rfind("_oecobj_");
+  if (pos != string::npos && _ssEntryMap.find(objname.substr(0, pos), toret) && toret->findObj(objname) != -1) return toret;
+  // an obj named as its file
+  toret = NULL;
+  if (_ssEntryMap.find(objname, toret) && toret->findObj(objname) != -1) return toret;
+  // other names
+  toret = NULL;
+  _objEntryMap.find(objname, toret);
+  return toret;
 }
 
 void StripeStore::insertECPool(string ecpoolid, OfflineECPool* pool) {
@@ -107,86 +196,89 @@ OfflineECPool* StripeStore::getECPool(string ecpoolid, ECPolicy* ecpolicy, int b
 }
 
 OfflineECPool* StripeStore::getECPool(string poolname) {
-  // TODO: the poolname must exist!
-  OfflineECPool* toret;
+  // NULL for a pool that does not exist (e.g., a stale poolid in a report)
+  OfflineECPool* toret = NULL;
   _lockECPoolMap.lock();
   unordered_map<string, OfflineECPool*>::iterator it = _offlineECPoolMap.find(poolname);
-  assert (it != _offlineECPoolMap.end());
+  if (it != _offlineECPoolMap.end()) toret = it->second;
   _lockECPoolMap.unlock();
-  return _offlineECPoolMap[poolname];
-}
-
-int StripeStore::getControlLoad(unsigned int ip) {
-  int toret;
-  _lockCLMap.lock();
-  unordered_map<unsigned int, int>::iterator it = _controlLoadMap.find(ip);
-  if (it == _controlLoadMap.end()) toret = 0;
-  else toret = _controlLoadMap[ip];
-  _lockCLMap.unlock();
   return toret;
 }
 
-void StripeStore::increaseControlLoadMap(unsigned int ip, int load) {
-  _lockCLMap.lock();
-  unordered_map<unsigned int, int>::iterator it = _controlLoadMap.find(ip);
-  if (it == _controlLoadMap.end()) _controlLoadMap.insert(make_pair(ip, load));
-  else _controlLoadMap[ip] += load;
-  _lockCLMap.unlock();
-}
-
-int StripeStore::getDataLoad(unsigned int ip) {
-  int toret;
-  _lockDLMap.lock();
-  unordered_map<unsigned int, int>::iterator it = _dataLoadMap.find(ip);
-  if (it == _dataLoadMap.end()) toret = 0;
-  else toret = _dataLoadMap[ip];
-  _lockDLMap.unlock();
+StripeStore::NodeLoad* StripeStore::getNodeLoad(unsigned int ip) {
+  NodeLoad* toret;
+  _lockNodeLoadMap.lock();
+  unordered_map<unsigned int, NodeLoad*>::iterator it = _nodeLoadMap.find(ip);
+  if (it != _nodeLoadMap.end()) toret = it->second;
+  else {
+    toret = new NodeLoad();
+    for (int i=0; i<LOAD_CLASS_NUM; i++) {
+      toret->inflight[i] = 0;
+      toret->history[i] = 0;
+    }
+    gettimeofday(&toret->last, NULL);
+    _nodeLoadMap.insert(make_pair(ip, toret));
+  }
+  _lockNodeLoadMap.unlock();
   return toret;
 }
 
-void StripeStore::increaseDataLoadMap(unsigned int ip, int load) {
-  _lockDLMap.lock();
-  unordered_map<unsigned int, int>::iterator it = _dataLoadMap.find(ip);
-  if (it == _dataLoadMap.end()) _dataLoadMap.insert(make_pair(ip, load));
-  else _dataLoadMap[ip] += load;
-  _lockDLMap.unlock();
+void StripeStore::decayLoad(NodeLoad* node, struct timeval now) {
+  // called with node->lock held
+  double elapsed = RedisUtil::duration(node->last, now);
+  if (elapsed <= 0) return;
+  double factor = _conf->_load_decay_halflife > 0 ? pow(0.5, elapsed / _conf->_load_decay_halflife) : 0;
+  for (int i=0; i<LOAD_CLASS_NUM; i++) node->history[i] *= factor;
+  node->last = now;
 }
 
-int StripeStore::getRepairLoad(unsigned int ip) {
-  int toret;
-  _lockRLMap.lock();
-  unordered_map<unsigned int, int>::iterator it = _repairLoadMap.find(ip);
-  if (it == _repairLoadMap.end()) toret = 0;
-  else toret = _repairLoadMap[ip];
-  _lockRLMap.unlock();
-  return toret;
+void StripeStore::addLoad(unsigned int ip, int loadclass, int load, string task) {
+  NodeLoad* node = getNodeLoad(ip);
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  node->lock.lock();
+  decayLoad(node, now);
+  node->history[loadclass] += load;
+  node->lock.unlock();
+  if (task.empty()) return;
+  node->inflight[loadclass] += load;
+  _lockTaskLoadMap.lock();
+  for (int i=0; i<load; i++) _taskLoadMap[task].push_back(make_pair(ip, loadclass));
+  _lockTaskLoadMap.unlock();
 }
 
-void StripeStore::increaseRepairLoadMap(unsigned int ip, int load) {
-  _lockRLMap.lock();
-  unordered_map<unsigned int, int>::iterator it = _repairLoadMap.find(ip);
-  if (it == _repairLoadMap.end()) _repairLoadMap.insert(make_pair(ip, load));
-  else _repairLoadMap[ip] += load;
-  _lockRLMap.unlock();
+void StripeStore::finishTaskLoad(string task) {
+  vector<pair<unsigned int, int>> loads;
+  _lockTaskLoadMap.lock();
+  unordered_map<string, vector<pair<unsigned int, int>>>::iterator it = _taskLoadMap.find(task);
+  if (it != _taskLoadMap.end()) {
+    loads.swap(it->second);
+    _taskLoadMap.erase(it);
+  }
+  _lockTaskLoadMap.unlock();
+  for (auto item: loads) getNodeLoad(item.first)->inflight[item.second]--;
 }
 
+double StripeStore::getLoad(unsigned int ip, int loadclass) {
+  NodeLoad* node = getNodeLoad(ip);
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  node->lock.lock();
+  decayLoad(node, now);
+  double history = node->history[loadclass];
+  node->lock.unlock();
+  return node->inflight[loadclass] + _conf->_load_history_weight * history;
+}
 
-int StripeStore::getEncodeLoad(unsigned int ip) {
-  int toret;
-  _lockELMap.lock();
-  unordered_map<unsigned int, int>::iterator it = _encodeLoadMap.find(ip);
-  if (it == _encodeLoadMap.end()) toret = 0;
-  else toret = _encodeLoadMap[ip];
-  _lockELMap.unlock();
+int StripeStore::getInflight(unsigned int ip) {
+  NodeLoad* node = getNodeLoad(ip);
+  int toret = 0;
+  for (int i=0; i<LOAD_CLASS_NUM; i++) toret += node->inflight[i];
   return toret;
 }
 
-void StripeStore::increaseEncodeLoadMap(unsigned int ip, int load) {
-  _lockELMap.lock();
-  unordered_map<unsigned int, int>::iterator it = _encodeLoadMap.find(ip);
-  if (it == _encodeLoadMap.end()) _encodeLoadMap.insert(make_pair(ip, load));
-  else _encodeLoadMap[ip] += load;
-  _lockELMap.unlock();
+int StripeStore::getInflight(unsigned int ip, int loadclass) {
+  return getNodeLoad(ip)->inflight[loadclass];
 }
 
 void StripeStore::setECStatus(int op, string ectype) {
@@ -197,41 +289,141 @@ void StripeStore::setECStatus(int op, string ectype) {
     if (op == 1) _enableRepair = true;
     else _enableRepair = false;
   }
+  wakeScheduler();
+}
+
+void StripeStore::wakeScheduler() {
+  // notify with the locks held, so that a scheduler checking its condition cannot miss it
+  _lockPECQueue.lock();
+  _encodeSeq++;
+  _encodeCond.notify_all();
+  _lockPECQueue.unlock();
+  _lockLostMap.lock();
+  _repairSeq++;
+  _repairCond.notify_all();
+  _lockLostMap.unlock();
+}
+
+vector<unsigned int> StripeStore::stripeAgents(string ecpoolid, string stripename, string except) {
+  vector<unsigned int> toret;
+  OfflineECPool* pool = getECPool(ecpoolid);
+  if (pool == NULL) return toret;
+  pool->lock();
+  vector<string> objlist = pool->getStripeObjList(stripename);
+  pool->unlock();
+  for (auto obj: objlist) {
+    if (obj == except) continue;
+    SSEntry* entry = getEntryFromObj(obj);
+    if (entry == NULL) continue;
+    unsigned int ip = entry->getLocOfObj(obj);
+    if (find(toret.begin(), toret.end(), ip) == toret.end()) toret.push_back(ip);
+  }
+  return toret;
+}
+
+vector<unsigned int> StripeStore::repairAgents(string objname) {
+  vector<unsigned int> toret;
+  SSEntry* entry = getEntryFromObj(objname);
+  if (entry == NULL) return toret;
+  if (entry->getType() == 0) {
+    // online: the other objs of the file
+    unsigned int lostip = entry->getLocOfObj(objname);
+    for (auto ip: entry->getObjloc()) {
+      if (ip != lostip && find(toret.begin(), toret.end(), ip) == toret.end()) toret.push_back(ip);
+    }
+    return toret;
+  }
+  // offline: the other objs of the stripe in the pool
+  OfflineECPool* pool = getECPool(entry->getEcidpool());
+  if (pool == NULL) return toret;
+  pool->lock();
+  string stripename = pool->getStripeForObj(objname);
+  pool->unlock();
+  return stripeAgents(entry->getEcidpool(), stripename, objname);
+}
+
+bool StripeStore::admitAgents(vector<unsigned int>& agents) {
+  if (_conf->_ec_agent_concurrent <= 0) return true;
+  for (auto ip: agents) {
+    if (getInflight(ip, LOAD_ENCODE) + getInflight(ip, LOAD_REPAIR) >= _conf->_ec_agent_concurrent) return false;
+  }
+  return true;
 }
 
 // offline encoding
 void StripeStore::scanning() {
   int concurrentNum = _conf->_ec_concurrent;
   while(true) {
-    std::this_thread::sleep_for (std::chrono::seconds(1));
-    if (!_enableScan) continue;
-    // offline encoding is enabled
-    cout << "StripeStore::scanning the pendingECQueue" << endl;
-    _lockPECQueue.lock();
-    int ecInProgressNum = getECInProgressNum();
-    cout << "StripeStore::pendingECQueue.size = " << _pendingECQueue.getSize() << ", ecInProgress = "  << ecInProgressNum << ", concurrentNum = " << concurrentNum << endl;
-    while (_pendingECQueue.getSize() && ecInProgressNum < concurrentNum) {
-      pair<string, string> curpair = _pendingECQueue.pop();
+    // 1. wait for a candidate and a free slot
+    unique_lock<mutex> lk(_lockPECQueue);
+    while (!_enableScan || _pendingECQueue.size() == 0 || getECInProgressNum() >= concurrentNum) _encodeCond.wait(lk);
+    long seq = _encodeSeq;
+    // 2. take a window of candidates, their agents are looked up without the queue lock,
+    // as the coordinator adds candidates with the pool locked
+    vector<pair<string, string>> window;
+    while (_pendingECQueue.size() && window.size() < concurrentNum) {
+      window.push_back(_pendingECQueue.front());
+      _pendingECQueue.pop_front();
+    }
+    lk.unlock();
+
+    int started = 0;
+    deque<pair<string, string>> deferred;
+    // stripes started in this window by pool
+    vector<string> pools;
+    unordered_map<string, vector<string>> pool2stripes;
+    for (auto curpair: window) {
       string ecpoolid = curpair.first;
       string stripename = curpair.second;
-      startECStripe(stripename);     
+      vector<unsigned int> agents;
+      if (getECInProgressNum() < concurrentNum) agents = stripeAgents(ecpoolid, stripename, "");
+      if (getECInProgressNum() >= concurrentNum || !admitAgents(agents)) {
+        // stripes that cannot start keep their place in the queue
+        deferred.push_back(curpair);
+        continue;
+      }
+      startECStripe(stripename);
+      // the data objs are read from their agents until finishECStripe
+      for (auto ip: agents) addLoad(ip, LOAD_ENCODE, 1, "encode:"+stripename);
+
+      if (pool2stripes.find(ecpoolid) == pool2stripes.end()) pools.push_back(ecpoolid);
+      pool2stripes[ecpoolid].push_back(stripename);
+      started++;
+    }
 
-      // send offline encode request to coordinator
-      CoorCommand* coorCmd = new CoorCommand();
-      coorCmd->buildType4(4, _conf->_localIp, ecpoolid, stripename);
-      coorCmd->sendTo(_conf->_coorIp);
-      delete coorCmd;
+    // send offline encode requests to coordinator, up to ec.batch.size stripes of a pool per request
+    int batchSize = _conf->_ec_batch_size > 0 ? _conf->_ec_batch_size : 1;
+    for (auto ecpoolid: pools) {
+      vector<string>& stripes = pool2stripes[ecpoolid];
+      for (int i=0; i<stripes.size(); i+=batchSize) {
+        vector<string> batch(stripes.begin()+i, stripes.begin()+min((int)stripes.size(), i+batchSize));
+        // the trace of the request covers its wait in the scheduler of the coordinator
+        string traceid = Tracer::newId();
+        for (auto stripename: batch) Tracer::mark(traceid, "request", stripename, ecpoolid);
+        CoorCommand* coorCmd = new CoorCommand();
+        if (batch.size() == 1) coorCmd->buildType4(4, _conf->_localIp, ecpoolid, batch[0], traceid);
+        else coorCmd->buildType15(15, _conf->_localIp, ecpoolid, batch, traceid);
+        coorCmd->sendTo(_conf->_coorIp);
+        delete coorCmd;
+      }
+    }
 
-      // obtain latest ecInProgress
-      ecInProgressNum = getECInProgressNum();
-    } 
-    _lockPECQueue.unlock();
+    lk.lock();
+    _pendingECQueue.insert(_pendingECQueue.begin(), deferred.begin(), deferred.end());
+    LOG_DEBUG << "StripeStore::scanning.started = " << started << ", pendingECQueue.size = " << _pendingECQueue.size()
+         << ", ecInProgress = " << getECInProgressNum() << ", concurrentNum = " << concurrentNum;
+    // 3. the agents of all candidates are busy, wait until a task finishes or a candidate arrives
+    if (started == 0) {
+      while (_encodeSeq == seq) _encodeCond.wait(lk);
+    }
   }
 }
 
 void StripeStore::addEncodeCandidate(string ecpoolid, string stripename) {
   _lockPECQueue.lock();
-  _pendingECQueue.push(make_pair(ecpoolid, stripename));
+  _pendingECQueue.push_back(make_pair(ecpoolid, stripename));
+  _encodeSeq++;
+  _encodeCond.notify_all();
   _lockPECQueue.unlock();
 }
 
@@ -256,12 +448,14 @@ void StripeStore::finishECStripe(OfflineECPool* pool, string stripename) {
   if (pos != _ECInProgress.end()) _ECInProgress.erase(pos);
   if (_ECInProgress.size() == 0) {
     gettimeofday(&_endEnc, NULL);
-    cout << "StripeStore::finishECStripe.encodeTime = " << RedisUtil::duration(_startEnc, _endEnc) << endl;
+    LOG_INFO << "StripeStore::finishECStripe.encodeTime = " << RedisUtil::duration(_startEnc, _endEnc);
   }
   _lockECInProgress.unlock();
+  finishTaskLoad("encode:"+stripename);
+  wakeScheduler();
 
   // we need to backup offlineecpool
-  backupPoolStripe(pool->stripe2String(stripename));
+  backupPoolStripe(pool, stripename);
 }
 
 int StripeStore::getRPInProgressNum() {
@@ -272,6 +466,45 @@ int StripeStore::getRPInProgressNum() {
 }
 
 
+string StripeStore::stripeOfObj(string objname, int& tolerance) {
+  tolerance = 1;
+  SSEntry* entry = getEntryFromObj(objname);
+  if (entry == NULL) return objname;
+  if (entry->getType() == 0) {
+    // online: the objs of a file form its stripes
+    ECPolicy* ecpolicy = _conf->_ecPolicyMap[entry->getEcidpool()];
+    if (ecpolicy) tolerance = ecpolicy->getN() - ecpolicy->getK();
+    return entry->getFilename();
+  }
+  OfflineECPool* pool = getECPool(entry->getEcidpool());
+  if (pool == NULL) {
+    tolerance = -1;
+    return "";
+  }
+  pool->lock();
+  string stripename = pool->getStripeForObj(objname);
+  pool->unlock();
+  tolerance = pool->getEcpolicy()->getN() - pool->getEcpolicy()->getK();
+  return entry->getEcidpool()+"/"+stripename;
+}
+
+int StripeStore::remainingOf(string objname) {
+  unordered_map<string, string>::iterator it = _lostStripe.find(objname);
+  if (it == _lostStripe.end()) return 0;
+  pair<int, vector<string>>& lost = _stripeLost[it->second];
+  return lost.first - lost.second.size();
+}
+
+void StripeStore::pushRepairItem(string objname) {
+  unordered_map<string, int>::iterator it = _lostMap.find(objname);
+  if (it == _lostMap.end()) return;
+  RepairItem item;
+  item.remaining = remainingOf(objname);
+  item.reqnum = it->second;
+  item.objname = objname;
+  _repairQueue.push(item);
+}
+
 void StripeStore::addLostObj(string objname) {
   // check whether objname is in _RPInProgress
   bool inrepair = false;
@@ -281,62 +514,100 @@ void StripeStore::addLostObj(string objname) {
   }
   _lockRPInProgress.unlock();
   if (inrepair) return;
+
+  // the stripe is only looked up for the first report of an obj
   _lockLostMap.lock();
-  if (_lostMap.find(objname) == _lostMap.end()) {
-    _lostMap.insert(make_pair(objname, 1));
-  } else {
-    _lostMap[objname]++;
+  bool known = _lostStripe.find(objname) != _lostStripe.end();
+  _lockLostMap.unlock();
+  int tolerance = 0;
+  string stripe;
+  if (!known) stripe = stripeOfObj(objname, tolerance);
+  if (!known && tolerance < 0) {
+    LOG_WARN << "StripeStore::addLostObj.no pool for " << objname << ", not repaired";
+    return;
   }
+
+  _lockLostMap.lock();
+  ++_lostMap[objname];
+  if (!known && _lostStripe.find(objname) == _lostStripe.end()) {
+    _lostStripe.insert(make_pair(objname, stripe));
+    pair<int, vector<string>>& lost = _stripeLost[stripe];
+    lost.first = tolerance;
+    lost.second.push_back(objname);
+    // the other lost objs of the stripe have less tolerance left now
+    for (auto obj: lost.second) {
+      if (obj != objname) pushRepairItem(obj);
+    }
+    if (lost.second.size() > tolerance) {
+      LOG_DEBUG << "StripeStore::addLostObj.stripe " << stripe << " lost " << lost.second.size()
+           << " objs, beyond its tolerance " << tolerance;
+    }
+  }
+  pushRepairItem(objname);
+  _repairSeq++;
+  _repairCond.notify_all();
   _lockLostMap.unlock();
 }
 
 void StripeStore::scanRepair() {
   int concurrentNum = _conf->_ec_concurrent;
   while (true) {
-     std::this_thread::sleep_for(std::chrono::seconds(1));
-     if (!_enableRepair) continue;
-     cout << "StripeStore::scanning repair queue" << endl;
-     int rpInProgressNum = getRPInProgressNum();
-     cout << "StripeStore::scanRepair.rpInProgressNum = " << rpInProgressNum << endl;
-     while (_lostMap.size() && (rpInProgressNum < concurrentNum)) {
-       string objname;
- 
-       // search the lost map and find the one with the most request num
-       int maxreq=0;
-       _lockLostMap.lock();
-       for (auto item: _lostMap) {
-         if (item.second > maxreq) {
-           maxreq = item.second;
-           objname = item.first;
-         }
-       }
-       _lockLostMap.unlock();
- 
-       // now we have the obj with the most request num
-       if (_conf->_repair_scheduling == "threshold") {
-         if (!_enableRepair) continue;
-         if (maxreq < _conf->_repair_threshold) continue;
-       }
-
-      if ((_conf->_repair_scheduling == "delay" ) && 
-          !_enableRepair) continue;
-
-//      if (_conf->_repair_scheduling == "normal") continue;
-    
-      // send repair request to coordinator  
+    // 1. wait for a lost obj and a free slot
+    unique_lock<mutex> lk(_lockLostMap);
+    while (!_enableRepair || _lostMap.size() == 0 || getRPInProgressNum() >= concurrentNum) _repairCond.wait(lk);
+    long seq = _repairSeq;
+    // 2. take the objs of the most degraded stripes, stale entries are dropped
+    vector<string> window;
+    vector<string> held;
+    // held objs do not count against the window, the scan goes on until the window is full
+    while (_repairQueue.size() && window.size() < concurrentNum) {
+      RepairItem top = _repairQueue.top();
+      _repairQueue.pop();
+      unordered_map<string, int>::iterator it = _lostMap.find(top.objname);
+      if (it == _lostMap.end() || it->second != top.reqnum || remainingOf(top.objname) != top.remaining) continue;
+      // below the threshold only stripes that cannot lose another obj are repaired
+      if (_conf->_repair_scheduling == "threshold" && top.reqnum < _conf->_repair_threshold && top.remaining > 0) {
+        held.push_back(top.objname);
+        continue;
+      }
+      window.push_back(top.objname);
+    }
+    for (auto objname: held) pushRepairItem(objname);
+    lk.unlock();
+
+    vector<string> started;
+    vector<string> deferred;
+    for (auto objname: window) {
+      vector<unsigned int> agents;
+      if (getRPInProgressNum() < concurrentNum) agents = repairAgents(objname);
+      if (getRPInProgressNum() >= concurrentNum || !admitAgents(agents)) {
+        deferred.push_back(objname);
+        continue;
+      }
+      // now we move the obj to RPInProgress
+      startRepair(objname);
+      // the other objs of the stripe are read from their agents until finishRepair
+      for (auto ip: agents) addLoad(ip, LOAD_REPAIR, 1, "repair:"+objname);
+
+      // send repair request to coordinator
+      string traceid = Tracer::newId();
+      Tracer::mark(traceid, "request", "", objname);
       CoorCommand* coorCmd = new CoorCommand();
-      coorCmd->buildType8(8, _conf->_localIp, objname);
+      coorCmd->buildType8(8, _conf->_localIp, objname, traceid);
       coorCmd->sendTo(_conf->_coorIp);
-
       delete coorCmd;
+      started.push_back(objname);
+    }
 
-      // now we move the obj to RPInProgress
-      startRepair(objname);
-      _lockLostMap.lock();
-      _lostMap.erase(_lostMap.find(objname));
-      _lockLostMap.unlock();
-
-      rpInProgressNum = getRPInProgressNum();
+    lk.lock();
+    for (auto objname: started) _lostMap.erase(objname);
+    // reports may have arrived meanwhile, the priority is taken again
+    for (auto objname: deferred) pushRepairItem(objname);
+    LOG_DEBUG << "StripeStore::scanRepair.started = " << started.size() << ", lostMap.size = " << _lostMap.size()
+         << ", rpInProgress = " << getRPInProgressNum() << ", concurrentNum = " << concurrentNum;
+    // 3. nothing can start now, wait for a finished task, a report or a status change
+    if (started.size() == 0) {
+      while (_repairSeq == seq) _repairCond.wait(lk);
     }
   }
 }
@@ -352,28 +623,103 @@ void StripeStore::finishRepair(string objname) {
   vector<string>::iterator pos = find(_RPInProgress.begin(), _RPInProgress.end(), objname);
   if (pos != _RPInProgress.end()) _RPInProgress.erase(pos);
   _lockRPInProgress.unlock();
+  finishTaskLoad("repair:"+objname);
+
+  // the stripe tolerates one more loss, which lowers the priority of its other lost objs
+  _lockLostMap.lock();
+  unordered_map<string, string>::iterator it = _lostStripe.find(objname);
+  if (it != _lostStripe.end()) {
+    unordered_map<string, pair<int, vector<string>>>::iterator sit = _stripeLost.find(it->second);
+    _lostStripe.erase(it);
+    if (sit != _stripeLost.end()) {
+      vector<string>& lostobjs = sit->second.second;
+      vector<string>::iterator pos = find(lostobjs.begin(), lostobjs.end(), objname);
+      if (pos != lostobjs.end()) lostobjs.erase(pos);
+      if (lostobjs.size() == 0) _stripeLost.erase(sit);
+      else for (auto obj: lostobjs) pushRepairItem(obj);
+    }
+  }
+  _lockLostMap.unlock();
+  wakeScheduler();
 }
 
-void StripeStore::backupEntry(string entrystr) {
-  struct timeval time1, time2;
-  gettimeofday(&time1, NULL);
-  _lockEntryStore.lock();
-  _entryStore.open(_entryStorePath, ios::out | ios::app);
-  _entryStore << entrystr;
-  _entryStore.close();
-  _lockEntryStore.unlock();
-  gettimeofday(&time2, NULL);
-//  cout << "StripeStore::backupEntry.duration = " << RedisUtil::duration(time1, time2) << endl;
+void StripeStore::backupEntry(SSEntry* entry) {
+  // flagged before the append: a snapshot that misses the flag rotated before the append,
+  // so the record lands in the log it replays
+  entry->setBackedUp();
+  _metaStore->append(META_ENTRY_RECORD, entry->toBinary());
+  if (_metaStore->needSnapshot()) requestSnapshot();
 }
 
-void StripeStore::backupPoolStripe(string poolstr) {
+string StripeStore::stripe2Binary(OfflineECPool* pool, string stripename) {
+  // |ecpoolid|stripename|objnum|objnum * objname|
+  string toret;
+  vector<string> objlist = pool->getStripeObjList(stripename);
+  MetaStore::writeString(toret, pool->getECPoolId());
+  MetaStore::writeString(toret, stripename);
+  MetaStore::writeInt(toret, objlist.size());
+  for (auto obj: objlist) MetaStore::writeString(toret, obj);
+  return toret;
+}
+
+void StripeStore::backupPoolStripe(OfflineECPool* pool, string stripename) {
+  _lockBackupStripes.lock();
+  _backupStripes[pool->getECPoolId()].push_back(stripename);
+  _lockBackupStripes.unlock();
+  pool->lock();
+  string poolstr = stripe2Binary(pool, stripename);
+  pool->unlock();
+  _metaStore->append(META_STRIPE_RECORD, poolstr);
+  if (_metaStore->needSnapshot()) requestSnapshot();
+}
+
+void StripeStore::requestSnapshot() {
+  // the request thread goes on, the snapshot is taken by snapshotting
+  _lockSnapshotReq.lock();
+  _snapshotRequested = true;
+  _snapshotCond.notify_one();
+  _lockSnapshotReq.unlock();
+}
+
+void StripeStore::snapshotting() {
+  while (true) {
+    unique_lock<mutex> lk(_lockSnapshotReq);
+    while (!_snapshotRequested) _snapshotCond.wait(lk);
+    _snapshotRequested = false;
+    lk.unlock();
+    // requests raised while the last snapshot was taken may already be covered by it
+    if (_metaStore->needSnapshot()) snapshot();
+  }
+}
+
+void StripeStore::snapshot() {
+  // one snapshot at a time, appenders go on appending to the new log
+  if (!_lockSnapshot.try_lock()) return;
   struct timeval time1, time2;
   gettimeofday(&time1, NULL);
-  _lockPoolStore.lock();
-  _poolStore.open(_poolStorePath, ios::out | ios::app);
-  _poolStore << poolstr;
-  _poolStore.close();
-  _lockPoolStore.unlock();
+  // records appended after rotate go to the new log and are replayed over the snapshot
+  int gen = _metaStore->rotate();
+
+  vector<pair<char, string>> records;
+  records.reserve(_ssEntryMap.size());
+  // files still being written and parity of stripes not encoded yet are not in the metastore
+  _ssEntryMap.forEach([&](const string& filename, SSEntry*& entry) {
+    if (!entry->isBackedUp()) return;
+    records.push_back(make_pair((char)META_ENTRY_RECORD, entry->toBinary()));
+  });
+
+  _lockBackupStripes.lock();
+  unordered_map<string, vector<string>> backupStripes = _backupStripes;
+  _lockBackupStripes.unlock();
+  for (auto item: backupStripes) {
+    OfflineECPool* pool = getECPool(item.first);
+    pool->lock();
+    for (auto stripename: item.second) records.push_back(make_pair((char)META_STRIPE_RECORD, stripe2Binary(pool, stripename)));
+    pool->unlock();
+  }
+
+  _metaStore->writeSnapshot(gen, records);
   gettimeofday(&time2, NULL);
-//  cout << "StripeStore::backupPool.duration = " << RedisUtil::duration(time1, time2) << endl;
+  LOG_INFO << "StripeStore::snapshot.duration = " << RedisUtil::duration(time1, time2);
+  _lockSnapshot.unlock();
 }
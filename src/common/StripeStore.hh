@@ -3,16 +3,29 @@
 
 #include "BlockingQueue.hh"
 #include "Config.hh"
+#include "MetaStore.hh"
+#include "ShardedMap.hh"
 #include "SSEntry.hh"
+#include "Tracer.hh"
 //#include "ECPolicy.hh"
 //#include "OfflineECPool.hh"
 
 #include "../inc/include.hh"
+
+#include <atomic>
+#include <condition_variable>
+#include <queue>
 #include "../ec/OfflineECPool.hh"
 #include "../protocol/CoorCommand.hh"
 
 using namespace std;
 
+#define LOAD_CONTROL 0
+#define LOAD_DATA 1
+#define LOAD_REPAIR 2
+#define LOAD_ENCODE 3
+#define LOAD_CLASS_NUM 4
+
 class StripeStore {
   private:
     Config* _conf;
@@ -20,31 +33,62 @@ class StripeStore {
     // map original file name to SSEntry
     // for online-encoded file, we can get objname for each split
     // for offline encoded file, we can get splited blocks
-    unordered_map<string, SSEntry*> _ssEntryMap;  
-    mutex _lockSSEntryMap;
+    // both maps are sharded, lookups only lock the shard of the key
+    ShardedMap<string, SSEntry*> _ssEntryMap;
     // map objname to original file name
     // for online encoded file, given a split name, we can get the original filename
     // for offline encoded file, given a block name, we can get the original filename
-    unordered_map<string, SSEntry*> _objEntryMap;
-    mutex _lockObjEntryMap;
+    // only objs whose names are not derived from their filename are indexed here
+    ShardedMap<string, SSEntry*> _objEntryMap;
     
-    unordered_map<unsigned int, int> _dataLoadMap;
-    mutex _lockDLMap;
-    unordered_map<unsigned int, int> _controlLoadMap;
-    mutex _lockCLMap;
-    unordered_map<unsigned int, int> _repairLoadMap;
-    mutex _lockRLMap;
-    unordered_map<unsigned int, int> _encodeLoadMap;
-    mutex _lockELMap;
+    // per-node load of each class: in-flight tasks are counted until the task finishes,
+    // history is the number of assignments decayed with load.decay.halflife
+    struct NodeLoad {
+      atomic<int> inflight[LOAD_CLASS_NUM];
+      mutex lock;
+      double history[LOAD_CLASS_NUM];
+      struct timeval last;
+    };
+    unordered_map<unsigned int, NodeLoad*> _nodeLoadMap;
+    mutex _lockNodeLoadMap;
+    // task -> (ip, class) of the in-flight load it holds
+    unordered_map<string, vector<pair<unsigned int, int>>> _taskLoadMap;
+    mutex _lockTaskLoadMap;
+
+    NodeLoad* getNodeLoad(unsigned int ip);
+    void decayLoad(NodeLoad* node, struct timeval now);
 
     unordered_map<string, OfflineECPool*> _offlineECPoolMap;
     mutex _lockECPoolMap;
-    BlockingQueue<pair<string, string>> _pendingECQueue;
+    // encode and repair scheduling wait on these conditions until there is work they may start:
+    // a new candidate, a status change or a finished task
+    deque<pair<string, string>> _pendingECQueue;
     mutex _lockPECQueue;
+    condition_variable _encodeCond;
+    long _encodeSeq;  // counts wakeups, a scheduler waits for a change after a round started nothing
     vector<string> _ECInProgress;
     mutex _lockECInProgress;
     unordered_map<string, int> _lostMap;
+    // repair order: objs of the stripes with the least fault tolerance left first, then the
+    // most requested ones. An entry is stale once its priority differs from the current one.
+    typedef struct {
+      int remaining;  // further objs the stripe can lose
+      int reqnum;
+      string objname;
+    } RepairItem;
+    struct RepairOrder {
+      bool operator()(const RepairItem& a, const RepairItem& b) const {
+        if (a.remaining != b.remaining) return a.remaining > b.remaining;
+        return a.reqnum < b.reqnum;
+      }
+    };
+    priority_queue<RepairItem, vector<RepairItem>, RepairOrder> _repairQueue;
+    // stripe of each lost obj until it is repaired, and tolerance and lost objs of each stripe
+    unordered_map<string, string> _lostStripe;
+    unordered_map<string, pair<int, vector<string>>> _stripeLost;
     mutex _lockLostMap;
+    condition_variable _repairCond;
+    long _repairSeq;
     vector<string> _RPInProgress;
     mutex _lockRPInProgress;
 
@@ -57,19 +101,41 @@ class StripeStore {
     bool _enableRepair;
 
     // backup
+    MetaStore* _metaStore;
+    // encoded stripes of each offline pool, which are backed up
+    unordered_map<string, vector<string>> _backupStripes;
+    mutex _lockBackupStripes;
+    mutex _lockSnapshot;
+    // appenders that find the log long enough hand the snapshot to the snapshotting thread
+    mutex _lockSnapshotReq;
+    condition_variable _snapshotCond;
+    bool _snapshotRequested;
+
+    // text stores of earlier versions, only read to migrate them into the metastore
     string _entryStorePath = "entryStore";
-    ofstream _entryStore;
-    mutex _lockEntryStore;
-
     string _poolStorePath = "poolStore";
-    ofstream _poolStore;
-    mutex _lockPoolStore;
+
+    // agents that an encode or repair of the stripe reads from
+    vector<unsigned int> stripeAgents(string ecpoolid, string stripename, string except);
+    vector<unsigned int> repairAgents(string objname);
+    // whether every agent runs fewer encode/repair tasks than ec.agent.concurrent
+    bool admitAgents(vector<unsigned int>& agents);
+    // stripe of an obj and the number of objs it tolerates to lose
+    string stripeOfObj(string objname, int& tolerance);
+    // called with _lockLostMap held
+    int remainingOf(string objname);
+    void pushRepairItem(string objname);
+    void wakeScheduler();
+
+    void loadMeta();
+    void loadLegacy();
+    string stripe2Binary(OfflineECPool* pool, string stripename);
     
   public:
     StripeStore(Config* conf);
 
     bool existEntry(string filename);
-    void insertEntry(SSEntry* entry);
+    bool insertEntry(SSEntry* entry);
     SSEntry* getEntry(string filename);
     SSEntry* getEntryFromObj(string objname);
 
@@ -78,14 +144,13 @@ class StripeStore {
     void insertECPool(string ecpoolid, OfflineECPool* pool);
 
 //    int getSize();
-    void increaseDataLoadMap(unsigned int ip, int load);
-    void increaseControlLoadMap(unsigned int ip, int load);
-    void increaseRepairLoadMap(unsigned int ip, int load);
-    void increaseEncodeLoadMap(unsigned int ip, int load);
-    int getDataLoad(unsigned int ip);
-    int getControlLoad(unsigned int ip);
-    int getRepairLoad(unsigned int ip);
-    int getEncodeLoad(unsigned int ip);
+    // load accounting, loadclass is one of LOAD_*
+    // a load added for a task is in flight until finishTaskLoad(task), a load without task only adds to history
+    void addLoad(unsigned int ip, int loadclass, int load, string task);
+    void finishTaskLoad(string task);
+    double getLoad(unsigned int ip, int loadclass);
+    int getInflight(unsigned int ip);
+    int getInflight(unsigned int ip, int loadclass);
 
 //    bool poolExists(string poolname);
 //    void addECPool(OfflineECPool* ecpool);
@@ -113,8 +178,11 @@ class StripeStore {
     int getRPInProgressNum();
   
     // backup
-    void backupEntry(string entrystr);
-    void backupPoolStripe(string stripename);
+    void backupEntry(SSEntry* entry);
+    void backupPoolStripe(OfflineECPool* pool, string stripename);
+    void snapshot();
+    void requestSnapshot();
+    void snapshotting();
 };
 
 #endif
@@ -0,0 +1,93 @@
+#include "Tracer.hh"
+
+FILE* Tracer::_out = NULL;
+mutex Tracer::_lock;
+string Tracer::_role;
+string Tracer::_host;
+unsigned int Tracer::_pid = 0;
+atomic<unsigned int> Tracer::_nextId(0);
+
+// small per-process thread ids keep the rows of the viewer readable
+static atomic<int> nextTid(0);
+static thread_local int localTid = -1;
+
+static string escape(string s) {
+  string toret;
+  for (auto c: s) {
+    if (c == '"' || c == '\\') toret += '\\';
+    if ((unsigned char)c < 0x20) continue;
+    toret += c;
+  }
+  return toret;
+}
+
+void Tracer::start(Config* conf, string role) {
+  if (conf->_trace_file == "-" || conf->_trace_file == "") return;
+  FILE* out = fopen(conf->_trace_file.c_str(), "a");
+  if (out == NULL) {
+    LOG_ERROR << "Tracer::start.fail to open " << conf->_trace_file;
+    return;
+  }
+  _role = role;
+  _host = RedisUtil::ip2Str(conf->_localIp);
+  _pid = ntohl(conf->_localIp);
+  _nextId.store((unsigned int)now());
+  lock_guard<mutex> lck(_lock);
+  _out = out;
+  LOG_INFO << "Tracer::start.trace to " << conf->_trace_file;
+}
+
+bool Tracer::enabled() {
+  return _out != NULL;
+}
+
+string Tracer::newId() {
+  if (!enabled()) return "";
+  // unique over hosts as long as a host creates less than 2^32 traces
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%08x%08x", _pid, _nextId.fetch_add(1));
+  return string(buf);
+}
+
+long Tracer::now() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (long)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+void Tracer::write(string event, string traceid, string name, string stripe, string detail, long ts, long dur) {
+  if (localTid < 0) localTid = nextTid.fetch_add(1);
+  char head[256];
+  if (event == "X") {
+    snprintf(head, sizeof(head), "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%ld,\"dur\":%ld,\"pid\":%u,\"tid\":%d,",
+             escape(name).c_str(), _role.c_str(), ts, dur, _pid, localTid);
+  } else {
+    snprintf(head, sizeof(head), "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%ld,\"pid\":%u,\"tid\":%d,",
+             escape(name).c_str(), _role.c_str(), ts, _pid, localTid);
+  }
+  string line = string(head) + "\"args\":{\"host\":\"" + _host + "\",\"trace\":\"" + escape(traceid)
+              + "\",\"stripe\":\"" + escape(stripe) + "\",\"detail\":\"" + escape(detail) + "\"}}\n";
+  lock_guard<mutex> lck(_lock);
+  // a killed process keeps what it has traced
+  fputs(line.c_str(), _out);
+  fflush(_out);
+}
+
+void Tracer::record(string traceid, string name, string stripe, string detail, long start, long end) {
+  if (traceid == "" || !enabled()) return;
+  write("X", traceid, name, stripe, detail, start, max(end - start, 0L));
+}
+
+void Tracer::mark(string traceid, string name, string stripe, string detail) {
+  if (traceid == "" || !enabled()) return;
+  write("i", traceid, name, stripe, detail, now(), 0);
+}
+
+TraceSpan::TraceSpan(string traceid, string name, string stripe, string detail) :
+  _traceid(traceid), _name(name), _stripe(stripe), _detail(detail) {
+  _start = (traceid == "" || !Tracer::enabled()) ? 0 : Tracer::now();
+}
+
+TraceSpan::~TraceSpan() {
+  if (_start > 0) Tracer::record(_traceid, _name, _stripe, _detail, _start, Tracer::now());
+}
@@ -0,0 +1,59 @@
+#ifndef _TRACER_HH_
+#define _TRACER_HH_
+
+#include "Config.hh"
+
+#include "../inc/include.hh"
+
+#include <atomic>
+
+using namespace std;
+
+/*
+ * Per-stripe execution tracing
+ *
+ * A trace id is created when an encode or repair is requested and travels with the CoorCommand
+ * and every AGCommand of the job. Each process appends the spans it runs for a traced job to its
+ * trace.file, one Chrome trace event (JSON object) per line:
+ *   {"name":"fetch","cat":"agent","ph":"X","ts":..,"dur":..,"pid":..,"tid":..,"args":{"host":..,"trace":..,"stripe":..,"detail":..}}
+ * ts is the wall clock in us, so spans of different hosts line up as far as their clocks do.
+ * script/tracemerge.py merges the files of all nodes for a stripe, a trace or a time window.
+ */
+class Tracer {
+  private:
+    static FILE* _out;
+    static mutex _lock;
+    static string _role;
+    static string _host;
+    static unsigned int _pid;
+    static atomic<unsigned int> _nextId;
+
+    static void write(string event, string traceid, string name, string stripe, string detail, long ts, long dur);
+  public:
+    // trace.file: file the spans of this process are appended to (- disables tracing)
+    static void start(Config* conf, string role);
+    static bool enabled();
+    // a new trace id, empty if tracing is disabled
+    static string newId();
+    // wall clock in us
+    static long now();
+    // span of [start, end), nothing is recorded for an empty trace id
+    static void record(string traceid, string name, string stripe, string detail, long start, long end);
+    // instant event
+    static void mark(string traceid, string name, string stripe, string detail);
+};
+
+// records a span from construction to destruction
+class TraceSpan {
+  private:
+    string _traceid;
+    string _name;
+    string _stripe;
+    string _detail;
+    long _start;
+  public:
+    TraceSpan(string traceid, string name, string stripe, string detail = "");
+    ~TraceSpan();
+};
+
+#endif
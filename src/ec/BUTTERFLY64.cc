@@ -1,7 +1,7 @@
 #include "BUTTERFLY64.hh"
 
 BUTTERFLY64::BUTTERFLY64(int n, int k, int w, int opt, vector<string> param) {
-  cout << "BUTTERRFLY64" << endl;
+  LOG_DEBUG << "BUTTERRFLY64";
   _n = n;
   _k = k;
   _w = w;
@@ -197,8 +197,7 @@ ECDAG* BUTTERFLY64::Decode(vector<int> from, vector<int> to) {
     vector<int> off4={4,5,6,7}; // for nodeid=4
     for (int i=0; i<off4.size(); i++) data.push_back(4*_chunk_num_per_node+off4[i]);
     
-    for (int i=0; i<data.size(); i++) cout << data[i] << " ";
-    cout << endl;
+    LOG_DEBUG << logList(data);
 
     int a[160] = { 0,0,0,0,0,0,0,1,0,0,1,0,0,0,0,1,0,0,0,1,
                    0,0,0,0,0,0,1,0,0,0,0,1,0,0,1,1,0,0,1,0,
@@ -9,13 +9,7 @@ Cluster::Cluster(vector<int> childs, int parent) {
 }
 
 bool Cluster::childsInCluster(vector<int> childs) {
-  if (CLUSTER_DEBUG_ENABLE) {
-    cout << "Cluster::childsInCluster.my childs: ( ";
-    for (auto c: _childs) cout << c << " ";
-    cout << "), input childs: ( ";
-    for (auto c: childs) cout << c << " ";
-    cout << ") " << endl;
-  }
+  LOG_DEBUG << "Cluster::childsInCluster.my childs: ( " << logList(_childs) << " ), input childs: ( " << logList(childs) << " ) ";
   if (childs.size() != _childs.size()) return false;
 
   for (auto child: childs) {
@@ -33,11 +27,7 @@ void Cluster::setOpt(int opt) {
 }
 
 void Cluster::dump() {
-  cout << "Cluster:: ( ";
-  for (int i=0; i<_childs.size(); i++) cout << _childs[i] << " ";
-  cout << ") -> ( ";
-  for (int i=0; i<_parents.size(); i++) cout << _parents[i] << " ";
-  cout << ") , opted: " << _opted << endl;
+  LOG_DEBUG << "Cluster:: ( " << logList(_childs) << " ) -> ( " << logList(_parents) << " ) , opted: " << _opted;
 }
 
 int Cluster::getOpt() {
@@ -3,7 +3,6 @@
 
 #include "../inc/include.hh"
 
-#define CLUSTER_DEBUG_ENABLE false
 
 using namespace std;
 
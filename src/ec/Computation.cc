@@ -26,5 +26,6 @@ void Computation::Multi(char** dst, char** src, int* mat, int rowCnt, int colCnt
     unsigned char itable[32 * rowCnt * colCnt];
     ec_init_tables(colCnt, rowCnt, (unsigned char*)imatrix, itable);
     ec_encode_data(len, colCnt, rowCnt, itable, (unsigned char**)src, (unsigned char**)dst);
+    free(imatrix);
   }
 }
@@ -44,7 +44,7 @@ ECDAG* DRC963::Decode(vector<int> from, vector<int> to) {
   ECDAG* ecdag = new ECDAG();
   int corruptsid;
   corruptsid = to[0]/_w;
-  cout << "corruptsid = " << corruptsid << endl;
+  LOG_DEBUG << "corruptsid = " << corruptsid;
   int tmp = _total_chunk_num;
   if (corruptsid == 0) {
     // for group1
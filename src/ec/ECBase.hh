@@ -15,6 +15,8 @@ class ECBase {
 
     ECBase();
     ECBase(int n, int k, int w, int opt, vector<string> param);
+    // codes are deleted through ECBase*
+    virtual ~ECBase() {}
     
     virtual ECDAG* Encode() = 0;
     virtual ECDAG* Decode(vector<int> from, vector<int> to) = 0;
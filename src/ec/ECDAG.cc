@@ -24,12 +24,7 @@ int ECDAG::findCluster(vector<int> childs) {
 
 void ECDAG::Join(int pidx, vector<int> cidx, vector<int> coefs) {
   // debug start
-  string msg = "ECDAG::Join(" + to_string(pidx) + ",";
-  for (int i=0; i<cidx.size(); i++) msg += " "+to_string(cidx[i]);
-  msg += ",";
-  for (int i=0; i<coefs.size(); i++) msg += " "+to_string(coefs[i]);
-  msg += ")";
-  if (ECDAG_DEBUG_ENABLE) cout << msg << endl;
+  LOG_DEBUG << "ECDAG::Join(" << pidx << ", " << logList(cidx) << ", " << logList(coefs) << ")";
   // debug end
 
   // 0. deal with childs
@@ -388,8 +383,8 @@ void ECDAG::Opt2(unordered_map<int, string> n2Rack) {
   for (int clusteridx = 0; clusteridx < _clusterMap.size(); clusteridx++) {
     Cluster* curCluster = _clusterMap[clusteridx];
     if (curCluster->getOpt() != -1) continue;
-    if (ECDAG_DEBUG_ENABLE) cout << "ECDAG::Opt2.deal with ";
-    if (ECDAG_DEBUG_ENABLE) curCluster->dump();
+    LOG_DEBUG << "ECDAG::Opt2.deal with";
+    curCluster->dump();
     vector<int> curChilds = curCluster->getChilds();
     vector<int> curParents = curCluster->getParents();
     int numoutput = curParents.size();
@@ -403,11 +398,11 @@ void ECDAG::Opt2(unordered_map<int, string> n2Rack) {
         subchilds.insert(make_pair(r, tmp));
       } else subchilds[r].push_back(curChilds[i]);
     }
-    if (ECDAG_DEBUG_ENABLE) cout << "ECDAG::childs are sorted into " << subchilds.size() << " racks" << endl;
+    LOG_DEBUG << "ECDAG::childs are sorted into " << subchilds.size() << " racks";
 
     if (numoutput == 1) {
       // we deploy pipelining technique for current cluster
-      if (ECDAG_DEBUG_ENABLE) cout << "numoutput == 1, deploy pipelining optimization" << endl;
+      LOG_DEBUG << "numoutput == 1, deploy pipelining optimization";
       int parent = curParents[0];
       ECNode* parentnode = _ecNodeMap[parent];
       bool isProot = false;
@@ -486,15 +481,11 @@ void ECDAG::Opt2(unordered_map<int, string> n2Rack) {
         vector<int> itemchilds = item.second;
         vector<int> subparents;
         
-        if (ECDAG_DEBUG_ENABLE) {
-          cout << "deal with subgroup ( ";
-          for (auto cid: itemchilds) cout << cid <<" ";
-          cout << "), rack: " << item.first << endl;
-        }
+        LOG_DEBUG << "deal with subgroup ( " << logList(itemchilds) << " ), rack: " << item.first;
   
         if (itemchilds.size() > numoutput) {
           update = true;
-          if (ECDAG_DEBUG_ENABLE) cout << "inputsize = " << itemchilds.size() << ", outputsize = " << numoutput << ", there is space for optimization" << endl;
+          LOG_DEBUG << "inputsize = " << itemchilds.size() << ", outputsize = " << numoutput << ", there is space for optimization";
           // we will reconstruct this group, clean ref for all itemchilds
           for (int i=0; i<itemchilds.size(); i++) {
             ECNode* itemchildnode = _ecNodeMap[itemchilds[i]];
@@ -507,14 +498,8 @@ void ECDAG::Opt2(unordered_map<int, string> n2Rack) {
             globalChilds.push_back(tmpid);        // update globalChilds here
           }
   
-          if (ECDAG_DEBUG_ENABLE) {
-            cout << "updated subparents: ( ";
-            for (auto cid: subparents) cout << cid << " ";
-            cout << ")" << endl;
-            cout << "updated globalchilds: ( ";
-            for (auto cid: globalChilds) cout << cid << " ";
-            cout << ")" << endl;
-          }
+          LOG_DEBUG << "updated subparents: ( " << logList(subparents) << " )";
+          LOG_DEBUG << "updated globalchilds: ( " << logList(globalChilds) << " )";
   
           // for each global parent, we need to figure out corresponding coefs to create tmpparent
           for (int i=0; i<numoutput; i++) {
@@ -531,14 +516,8 @@ void ECDAG::Opt2(unordered_map<int, string> n2Rack) {
             }
             // for each itemchid, ref-=1
             Join(tmpparent, itemchilds, tmpcoef);
-            if (ECDAG_DEBUG_ENABLE) {
-              cout << tmpparent << " = ( ";
-              for (auto c: tmpcoef) cout << c << " ";
-              cout << ") * ( ";
-              for (auto c: itemchilds) cout << c << " ";
-              cout << ")" << endl;
-              cout << "current cluster.size = " << _clusterMap.size() << endl;
-            }
+            LOG_DEBUG << tmpparent << " = ( " << logList(tmpcoef) << " ) * ( " << logList(itemchilds) << " )";
+            LOG_DEBUG << "current cluster.size = " << _clusterMap.size();
 
             // update globalCoefs here
             if (globalCoefs.find(parent) == globalCoefs.end()) {
@@ -673,7 +652,7 @@ unordered_map<int, AGCommand*> ECDAG::parseForOEC(unordered_map<int, unsigned in
     for (auto item: tomerge) {
       int cid = item.first;
       int childid = item.second;
-      if (ECDAG_DEBUG_ENABLE) cout << "ECDAG::parseForOEC.merge " << cid << " and " << childid << endl;
+      LOG_DEBUG << "ECDAG::parseForOEC.merge " << cid << " and " << childid;
       AGCommand* cmd = agCmds[cid];
       AGCommand* childCmd = agCmds[childid];
       // get information from existing commands
@@ -733,7 +712,7 @@ vector<AGCommand*> ECDAG::persist(unordered_map<int, unsigned int> cid2ip,
   // sort headers
   sort(_ecHeaders.begin(), _ecHeaders.end());
   int numblks = _ecHeaders.size()/w;
-  if (ECDAG_DEBUG_ENABLE) cout << "ECDAG:: persist. numblks: " << numblks << endl;
+  LOG_DEBUG << "ECDAG:: persist. numblks: " << numblks;
   for (int i=0; i<numblks; i++) {
     int cid = _ecHeaders[i*w];
     int sid = cid/w;
@@ -757,9 +736,9 @@ vector<AGCommand*> ECDAG::persist(unordered_map<int, unsigned int> cid2ip,
 }
 
 void ECDAG::dump() {
+  if (!LOG_ENABLED(LOG_LEVEL_DEBUG)) return;
   for (auto id : _ecHeaders) {
-    _ecNodeMap[id] ->dump(-1);
-    cout << endl;
+    LOG_DEBUG << _ecNodeMap[id]->dump(-1);
   }
   for (auto cluster: _clusterMap) {
     cluster->dump();
@@ -9,7 +9,6 @@
 
 using namespace std;
 
-#define ECDAG_DEBUG_ENABLE true
 #define BINDSTART 200
 #define OPTSTART 300
 
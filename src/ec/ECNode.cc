@@ -1,5 +1,7 @@
 #include "ECNode.hh"
 
+#include <unordered_set>
+
 ECNode::ECNode(int id) {
   _nodeId = id;
   _hasConstraint = false;
@@ -115,11 +117,11 @@ void ECNode::setConstraint(bool cons, int id) {
   if (_hasConstraint) _consId = id;
 }
 
-void ECNode::dump(int parent) {
+string ECNode::dump(int parent) {
   if (parent == -1) parent = _nodeId;
-  cout << "(data" << _nodeId;
+  string toret = "(data" + to_string(_nodeId);
   if (_childNodes.size() > 0) {
-    cout << " = ";
+    toret += " = ";
   }
   vector<int> curCoef;
   if (_coefMap.size() > 1) {
@@ -132,13 +134,14 @@ void ECNode::dump(int parent) {
     curCoef = _coefMap[_nodeId];
   }
   for (int i=0; i<_childNodes.size(); i++) {
-    cout << curCoef[i] << " ";
-    _childNodes[i]->dump(_nodeId);
+    toret += to_string(curCoef[i]) + " ";
+    toret += _childNodes[i]->dump(_nodeId);
     if (i < _childNodes.size() - 1) {
-      cout << " + ";
+      toret += " + ";
     }
   }
-  cout << ")";
+  toret += ")";
+  return toret;
 }
 
 void ECNode::parseForClient(vector<ECTask*>& tasks) {
@@ -167,9 +170,9 @@ void ECNode::parseForClient(vector<ECTask*>& tasks) {
   }
 }
 
-vector<unsigned int> ECNode::candidateIps(unordered_map<int, unsigned int> sid2ip,
-                                          unordered_map<int, unsigned int> cid2ip,
-                                          vector<unsigned int> allIps,
+vector<unsigned int> ECNode::candidateIps(const unordered_map<int, unsigned int>& sid2ip,
+                                          const unordered_map<int, unsigned int>& cid2ip,
+                                          const vector<unsigned int>& allIps,
                                           int n,
                                           int k,
                                           int w,
@@ -180,13 +183,13 @@ vector<unsigned int> ECNode::candidateIps(unordered_map<int, unsigned int> sid2i
   // 0. current node has constraint
   if (_hasConstraint) {
     assert(cid2ip.find(_consId) != cid2ip.end());
-    toret.push_back(cid2ip[_consId]);
+    toret.push_back(cid2ip.at(_consId));
     return toret;
   }
 
   // 1. current node is preassigned a location
   if (sid2ip.find(sid) != sid2ip.end()) {
-    toret.push_back(sid2ip[sid]);
+    toret.push_back(sid2ip.at(sid));
     return toret;
   }
 
@@ -195,24 +198,26 @@ vector<unsigned int> ECNode::candidateIps(unordered_map<int, unsigned int> sid2i
     for (int i=0; i<_childNodes.size(); i++) {
       int cidx = _childNodes[i]->getNodeId();
       assert (cid2ip.find(cidx) != cid2ip.end());
-      toret.push_back(cid2ip[cidx]);
+      toret.push_back(cid2ip.at(cidx));
     }
     return toret;
   } else {
     // prepare candidate without child
     vector<unsigned int> childIps;
+    unordered_set<unsigned int> childSet;
     for (int i=0; i<_childNodes.size(); i++) {
       int cidx = _childNodes[i]->getNodeId();
       assert (cid2ip.find(cidx) != cid2ip.end());
-      childIps.push_back(cid2ip[cidx]);
+      childIps.push_back(cid2ip.at(cidx));
+      childSet.insert(cid2ip.at(cidx));
     }
+    toret.reserve(allIps.size());
     for (auto ip: allIps) {
-      if (find(childIps.begin(), childIps.end(), ip) == childIps.end())
+      if (childSet.find(ip) == childSet.end())
         toret.push_back(ip);
     }
     if (toret.size() == 0) {
-      // choose randomly
-      srand((unsigned)time(0));
+      // choose randomly, rand is seeded once by the caller
       int randomidx = rand() % childIps.size();
       toret.push_back(childIps[randomidx]);
     }
@@ -220,9 +225,9 @@ vector<unsigned int> ECNode::candidateIps(unordered_map<int, unsigned int> sid2i
   }
 }
 
-vector<unsigned int> ECNode::candidateIps(unordered_map<int, unsigned int> sid2ip,
-                                          unordered_map<int, unsigned int> cid2ip,
-                                          vector<unsigned int> allIps,
+vector<unsigned int> ECNode::candidateIps(const unordered_map<int, unsigned int>& sid2ip,
+                                          const unordered_map<int, unsigned int>& cid2ip,
+                                          const vector<unsigned int>& allIps,
                                           int n,
                                           int k,
                                           int w,
@@ -233,13 +238,13 @@ vector<unsigned int> ECNode::candidateIps(unordered_map<int, unsigned int> sid2i
   // 0. current node has constraint
   if (_hasConstraint) {
     assert(cid2ip.find(_consId) != cid2ip.end());
-    toret.push_back(cid2ip[_consId]);
+    toret.push_back(cid2ip.at(_consId));
     return toret;
   }
 
   // 1. current node is preassigned a location
   if (sid2ip.find(sid) != sid2ip.end() && sid != lostid) {
-    toret.push_back(sid2ip[sid]);
+    toret.push_back(sid2ip.at(sid));
     return toret;
   }
 
@@ -248,24 +253,26 @@ vector<unsigned int> ECNode::candidateIps(unordered_map<int, unsigned int> sid2i
     for (int i=0; i<_childNodes.size(); i++) {
       int cidx = _childNodes[i]->getNodeId();
       assert (cid2ip.find(cidx) != cid2ip.end());
-      toret.push_back(cid2ip[cidx]);
+      toret.push_back(cid2ip.at(cidx));
     }
     return toret;
   } else {
     // prepare candidate without child
     vector<unsigned int> childIps;
+    unordered_set<unsigned int> childSet;
     for (int i=0; i<_childNodes.size(); i++) {
       int cidx = _childNodes[i]->getNodeId();
       assert (cid2ip.find(cidx) != cid2ip.end());
-      childIps.push_back(cid2ip[cidx]);
+      childIps.push_back(cid2ip.at(cidx));
+      childSet.insert(cid2ip.at(cidx));
     }
+    toret.reserve(allIps.size());
     for (auto ip: allIps) {
-      if (find(childIps.begin(), childIps.end(), ip) == childIps.end())
+      if (childSet.find(ip) == childSet.end())
         toret.push_back(ip);
     }
     if (toret.size() == 0) {
-      // choose randomly
-      srand((unsigned)time(0));
+      // choose randomly, rand is seeded once by the caller
       int randomidx = rand() % childIps.size();
       toret.push_back(childIps[randomidx]);
     }
@@ -430,31 +437,24 @@ AGCommand* ECNode::parseAGCommand(string stripename,
 }
 
 void ECNode::dumpRawTask() {
-  cout << "Raw ECTasks : " << _nodeId << ", " << RedisUtil::ip2Str(_ip) << endl;
+  if (!LOG_ENABLED(LOG_LEVEL_DEBUG)) return;
+  LOG_DEBUG << "Raw ECTasks : " << _nodeId << ", " << RedisUtil::ip2Str(_ip);
   for (int i=0; i<4; i++) {
     if (_oecTasks.find(i) == _oecTasks.end()) continue;
     ECTask* ectask = _oecTasks[i];
     if (i == 0) {
       vector<int> indices = ectask->getIndices();
-      cout << "    Load: " ;
-      for (int j=0; j<indices.size(); j++) cout << indices[j] << " ";
-      cout << endl;
+      LOG_DEBUG << "    Load: " << logList(indices);
     } else if (i == 1) {
-      cout << "    Fetch: ( ";
       vector<int> childrenIdx = ectask->getChildren();
-      for (int j=0; j<childrenIdx.size(); j++) cout << childrenIdx[j] << " ";
-      cout << ")" << endl;
+      LOG_DEBUG << "    Fetch: ( " << logList(childrenIdx) << " )";
     } else if (i == 2) {
       vector<int> childrenIdx = ectask->getChildren();
       unordered_map<int, vector<int>> coefmap = ectask->getCoefMap();
       for (auto item: coefmap) {
         int target = item.first;
         vector<int> coefs = item.second;
-        cout << "    Compute: " << target << " = ( ";
-        for (int j=0; j<childrenIdx.size(); j++) cout << childrenIdx[j] << " ";
-        cout << ") * ( ";
-        for (int j=0; j<coefs.size(); j++) cout << coefs[j] << " ";
-        cout << ")" << endl;
+        LOG_DEBUG << "    Compute: " << target << " = ( " << logList(childrenIdx) << " ) * ( " << logList(coefs) << " )";
       }
     } else if (i == 3) {
       unordered_map<int, int> refmap = ectask->getRefMap();
@@ -462,8 +462,7 @@ void ECNode::dumpRawTask() {
       for (auto item: refmap) {
         int target = item.first;
         int ref = item.second;
-        cout << "    Cache: ";
-        cout << target << ": " << ref << " times " << endl;
+        LOG_DEBUG << "    Cache: " << target << ": " << ref << " times ";
       }
     }
   }
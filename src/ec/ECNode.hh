@@ -62,13 +62,13 @@ class ECNode {
 
     // parseForOEC tasks
     void parseForOEC(unsigned int ip);
-    vector<unsigned int> candidateIps(unordered_map<int, unsigned int> sid2ip,
-                           unordered_map<int, unsigned int> cid2ip,
-                           vector<unsigned int> allIps,
+    vector<unsigned int> candidateIps(const unordered_map<int, unsigned int>& sid2ip,
+                           const unordered_map<int, unsigned int>& cid2ip,
+                           const vector<unsigned int>& allIps,
                            int n, int k, int w, bool locality);
-    vector<unsigned int> candidateIps(unordered_map<int, unsigned int> sid2ip,
-                           unordered_map<int, unsigned int> cid2ip,
-                           vector<unsigned int> allIps,
+    vector<unsigned int> candidateIps(const unordered_map<int, unsigned int>& sid2ip,
+                           const unordered_map<int, unsigned int>& cid2ip,
+                           const vector<unsigned int>& allIps,
                            int n, int k, int w, bool locality, int lostid);
     unordered_map<int, ECTask*> getTasks();
     void clearTasks();
@@ -79,7 +79,8 @@ class ECNode {
                               unordered_map<int, unsigned int> cid2ip);
 
     // for debug
-    void dump(int parent);
+    // expression of the node over its children
+    string dump(int parent);
     void dumpRawTask();
 };
 
@@ -42,7 +42,7 @@ ECBase* ECPolicy::createECClass() {
 //    toret = new WASLRC(_n, _k, _w, _locality, _opt, _param);
     toret = new WASLRC(_n, _k, _w, _opt, _param);
   } else {
-    cout << "unrecognized code, use default RSCONV" << endl;
+    LOG_WARN << "unrecognized code, use default RSCONV";
 //    toret = new RSCONV(_n, _k, _w, _locality, _opt, _param);
     toret = new RSCONV(_n, _k, _w, _opt, _param);
   }
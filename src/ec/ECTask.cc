@@ -82,6 +82,14 @@ unordered_map<int, int> ECTask::getRefMap() {
   return _refNum;
 }
 
+char* ECTask::getCmd() {
+  return _taskCmd;
+}
+
+int ECTask::getCmdLen() {
+  return _cmLen;
+}
+
 void ECTask::writeInt(int value) {
   int tmpv = htonl(value);
   memcpy(_taskCmd + _cmLen, (char*)&tmpv, 4); _cmLen += 4;
@@ -157,11 +165,8 @@ void ECTask::dump() {
     for (auto item: _coefMap) {
       int target = item.first;
       vector<int> coef = item.second;
-      cout << " Compute: " << target << " = ( ";
-      for (int i=0; i<coef.size(); i++) cout << coef[i] << " ";
-      cout << ") X ( ";
-      for (int i=0; i<coef.size(); i++) cout << _children[i] << " ";
-      cout << ")" << endl;
+      vector<int> children(_children.begin(), _children.begin() + coef.size());
+      LOG_DEBUG << " Compute: " << target << " = ( " << logList(coef) << " ) X ( " << logList(children) << " )";
     }
   }
 }
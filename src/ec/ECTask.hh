@@ -59,6 +59,8 @@ class ECTask {
     unordered_map<int, vector<int>> getCoefMap();
     int getPersistType();
     unordered_map<int, int> getRefMap();
+    char* getCmd();
+    int getCmdLen();
 
     // basic construction methods
     void writeInt(int value);
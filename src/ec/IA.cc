@@ -180,7 +180,7 @@ ECDAG* IA::Decode(vector<int> from, vector<int> to) {
   generate_encoding_matrix();
   int rBlkIdx = to[0]/_k;
   generate_decoding_matrix(rBlkIdx);
-  cout << "final decoding matrix:" << endl;
+  LOG_DEBUG << "final decoding matrix:";
 //  print_matrix(_recovery_equations, _k, _n-1);
   int tmpidx = _n * _k;
  
@@ -6,34 +6,56 @@ OfflineECPool::OfflineECPool(string ecpoolid, ECPolicy* ecpolicy, int basesize)
   _basesize = basesize;
 }
 
+int OfflineECPool::getObjId(const string& objname) {
+  unordered_map<string, int>::iterator it = _objIds.find(objname);
+  return it == _objIds.end() ? -1 : it->second;
+}
+
+int OfflineECPool::getStripeId(const string& stripename) {
+  unordered_map<string, int>::iterator it = _stripeIds.find(stripename);
+  if (it != _stripeIds.end()) return it->second;
+  int stripeid = _stripeNames.size();
+  it = _stripeIds.insert(make_pair(stripename, stripeid)).first;
+  _stripeNames.push_back(&it->first);
+  _stripe2objs.push_back(vector<int>());
+  return stripeid;
+}
+
+vector<string> OfflineECPool::objNames(int stripeid) {
+  vector<string> toret;
+  for (auto objid: _stripe2objs[stripeid]) toret.push_back(*_objNames[objid]);
+  return toret;
+}
+
 void OfflineECPool::addObj(string objname, string stripename) {
-  _objs.insert(make_pair(objname, false));
-  if (find(_stripes.begin(), _stripes.end(), stripename) == _stripes.end())
-    _stripes.push_back(stripename);
-  unordered_map<string, vector<string>>::iterator it1 = _stripe2objs.find(stripename);
-  if (it1 != _stripe2objs.end()) _stripe2objs[stripename].push_back(objname);
-  else {
-    vector<string> curlist;
-    curlist.push_back(objname);
-    _stripe2objs.insert(make_pair(stripename, curlist));
-  }
-  _obj2stripe.insert(make_pair(objname, stripename));
+  int stripeid = getStripeId(stripename);
+  unordered_map<string, int>::iterator it = _objIds.find(objname);
+  if (it != _objIds.end()) return;
+  int objid = _objNames.size();
+  it = _objIds.insert(make_pair(objname, objid)).first;
+  _objNames.push_back(&it->first);
+  _obj2stripe.push_back(stripeid);
+  _objFinal.push_back(false);
+  _stripe2objs[stripeid].push_back(objid);
 }
 
 void OfflineECPool::finalizeObj(string objname) {
-  assert(_objs.find(objname) != _objs.end());
-  _objs[objname] = true;
+  int objid = getObjId(objname);
+  assert(objid != -1);
+  _objFinal[objid] = true;
 }
 
 bool OfflineECPool::isCandidateForEC(string stripename) {
   int eck = _ecpolicy->getK();
-  vector<string> objlist = _stripe2objs[stripename];
+  unordered_map<string, int>::iterator it = _stripeIds.find(stripename);
+  if (it == _stripeIds.end()) return false;
+  vector<int>& objlist = _stripe2objs[it->second];
   if (objlist.size() < eck) return false;
   if (objlist.size() == eck) {
     // this might be a candidate, check finalize for each obj
     bool toret = true;
-    for (auto obj: objlist) {
-      if (!_objs[obj]) {
+    for (auto objid: objlist) {
+      if (!_objFinal[objid]) {
         toret = false;
         break;
       }
@@ -45,25 +67,26 @@ bool OfflineECPool::isCandidateForEC(string stripename) {
   }
 }
 
+string OfflineECPool::getECPoolId() {
+  return _ecpoolid;
+}
+
 int OfflineECPool::getBasesize() {
   return _basesize;
 }
 
 string OfflineECPool::getStripeForObj(string objname) {
   string stripename;
-//  if (find(_objs.begin(), _objs.end(), objname) != _objs.end()) {
-//    cout << "OfflineECPool::getStripeForObj return " << _obj2stripe[objname] << endl;
-//    return _obj2stripe[objname];
-//  } 
-  if (_objs.find(objname) != _objs.end()) {
-    return _obj2stripe[objname];
+  int objid = getObjId(objname);
+  if (objid != -1) {
+    return *_stripeNames[_obj2stripe[objid]];
   }
-  vector<string> objlist;
-  if (_stripes.size() == 0) {
+  if (_stripeNames.size() == 0) {
     stripename = "oecstripe-"+getTimeStamp();
   } else {
-    stripename = _stripes.back();
-    if (_stripe2objs[stripename].size() >= _ecpolicy->getK()) {
+    int lastid = _stripeNames.size() - 1;
+    stripename = *_stripeNames[lastid];
+    if (_stripe2objs[lastid].size() >= _ecpolicy->getK()) {
       stripename = "oecstripe-"+getTimeStamp();
     } 
   }  
@@ -72,8 +95,8 @@ string OfflineECPool::getStripeForObj(string objname) {
 
 vector<string> OfflineECPool::getStripeObjList(string stripename) {
   vector<string> toret;
-  unordered_map<string, vector<string>>::iterator it = _stripe2objs.find(stripename);
-  if (it != _stripe2objs.end()) toret = _stripe2objs[stripename];
+  unordered_map<string, int>::iterator it = _stripeIds.find(stripename);
+  if (it != _stripeIds.end()) toret = objNames(it->second);
   return toret;
 }
 
@@ -99,7 +122,7 @@ string OfflineECPool::stripe2String(string stripename) {
   string toret = "";
   toret += _ecpoolid+";";
   toret += stripename+";";
-  vector<string> objlist = _stripe2objs[stripename];
+  vector<string> objlist = getStripeObjList(stripename);
   for (int i=0; i<objlist.size(); i++) {
     toret += objlist[i]+";";
   }
@@ -112,18 +135,11 @@ void OfflineECPool::constructPool(vector<string> items) {
   // only used when stripestore initialize
   _lockECPool.lock();
   string stripename = items[1];
-  cout << stripename << endl;
-  _stripes.push_back(stripename);
   int objnum = (items.size() - 2);
-  vector<string> stripelist;
   for (int i=0; i<objnum; i++) {
     int idx = 2+i;
-    string objname = items[idx];
-    _objs.insert(make_pair(objname, true));
-    _obj2stripe.insert(make_pair(objname, stripename));
-    stripelist.push_back(objname);
-    cout << objname << endl;
+    addObj(items[idx], stripename);
+    _objFinal[getObjId(items[idx])] = true;
   }
-  _stripe2objs.insert(make_pair(stripename, stripelist));
   _lockECPool.unlock();
 }
@@ -13,11 +13,19 @@ class OfflineECPool {
     int _basesize;
 
     mutex _lockECPool;
-//    vector<string> _objs;
-    unordered_map<string, bool> _objs;
-    vector<string> _stripes;
-    unordered_map<string, vector<string>> _stripe2objs;
-    unordered_map<string, string> _obj2stripe;
+    // objects and stripes are numbered in the order they join the pool, each name is kept
+    // once as a key of the id map and the per-id tables point to it
+    unordered_map<string, int> _objIds;
+    vector<const string*> _objNames;
+    vector<int> _obj2stripe;
+    vector<bool> _objFinal;
+    unordered_map<string, int> _stripeIds;
+    vector<const string*> _stripeNames;
+    vector<vector<int>> _stripe2objs;
+
+    int getObjId(const string& objname);
+    int getStripeId(const string& stripename);
+    vector<string> objNames(int stripeid);
     
     string getTimeStamp();
 
@@ -28,6 +36,7 @@ class OfflineECPool {
     void finalizeObj(string objname);
     bool isCandidateForEC(string stripename);
 
+    string getECPoolId();
     int getBasesize();
     string getStripeForObj(string objname);
     vector<string> getStripeObjList(string stripename);
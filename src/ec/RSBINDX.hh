@@ -8,13 +8,10 @@
 
 using namespace std;
 
-#define RSBINDX_N_MAX (32)
-
-#define RSBINDX_DEBUG_ENABLE true
 
 class RSBINDX : public ECBase {
   private:
-    int _encode_matrix[RSBINDX_N_MAX * RSBINDX_N_MAX];
+    vector<int> _encode_matrix;
     int _m;
 
     void generate_matrix(int* matrix, int rows, int cols, int w);  // This w is for galois field, which is different from our sub-packetization level _w
@@ -7,8 +7,8 @@ RSCONV::RSCONV(int n, int k, int w, int opt, vector<string> param) {
   _opt = opt;
 
   _m = _n - _k;
-  memset(_encode_matrix, 0, (_k+_m) * _k * sizeof(int));
-  if(RSCONV_DEBUG_ENABLE) cout << "RSCONV::constructor ends" << endl; 
+  _encode_matrix.assign(_n * _k, 0);
+  LOG_DEBUG << "RSCONV::constructor ends";
 }
 
 ECDAG* RSCONV::Encode() {
@@ -17,16 +17,10 @@ ECDAG* RSCONV::Encode() {
   vector<int> code;
   for (int i=0; i<_k; i++) data.push_back(i);
   for (int i=_k; i<_n; i++) code.push_back(i);
-  if (RSCONV_DEBUG_ENABLE) {
-    cout << "RSCONV::Encode.data:";
-    for (int i=0; i<data.size(); i++) cout << " " << data[i];
-    cout << endl;
-    cout << "RSCONV::Encode.code:";
-    for (int i=0; i<code.size(); i++) cout << " " << code[i];
-    cout << endl;
-  }
+  LOG_DEBUG << "RSCONV::Encode.data: " << logList(data);
+  LOG_DEBUG << "RSCONV::Encode.code: " << logList(code);
   
-  generate_matrix(_encode_matrix, _n, _k, 8);
+  generate_matrix(_encode_matrix.data(), _n, _k, 8);
   for (int i=0; i<_m; i++) {
     vector<int> coef;
     for (int j=0; j<_k; j++) {
@@ -39,14 +33,14 @@ ECDAG* RSCONV::Encode() {
 
 ECDAG* RSCONV::Decode(vector<int> from, vector<int> to) {
   ECDAG* ecdag = new ECDAG();
-  generate_matrix(_encode_matrix, _n, _k, 8);
+  generate_matrix(_encode_matrix.data(), _n, _k, 8);
   vector<int> data;
   int _select_matrix[_k*_k];
   for (int i=0; i<_k; i++) {
     data.push_back(from[i]);
     int sidx = from[i];
     memcpy(_select_matrix + i * _k,
-           _encode_matrix + sidx * _k,
+           _encode_matrix.data() + sidx * _k,
  	   sizeof(int) * _k);
   }
   int _invert_matrix[_k*_k];
@@ -56,7 +50,7 @@ ECDAG* RSCONV::Decode(vector<int> from, vector<int> to) {
     int ridx = to[i];
     int _select_vector[_k];
     memcpy(_select_vector,
-           _encode_matrix + ridx * _k,
+           _encode_matrix.data() + ridx * _k,
 	   _k * sizeof(int));
     int* _coef_vector = jerasure_matrix_multiply(
         _select_vector, _invert_matrix, 1, _k, _k, _k, 8);
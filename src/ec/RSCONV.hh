@@ -8,13 +8,9 @@
 
 using namespace std;
 
-#define RS_N_MAX (32)
-
-#define RSCONV_DEBUG_ENABLE false
-
 class RSCONV : public ECBase {
   private:
-    int _encode_matrix[RS_N_MAX * RS_N_MAX];
+    vector<int> _encode_matrix;
     int _m;
 
     void generate_matrix(int* matrix, int rows, int cols, int w);  // This w is for galois field, which is different from our sub-packetization level _w
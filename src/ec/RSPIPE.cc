@@ -7,7 +7,7 @@ RSPIPE::RSPIPE(int n, int k, int w, int opt, vector<string> param) {
   _opt = opt;
 
   _m = _n - _k;
-  memset(_encode_matrix, 0, (_k+_m)*_m*sizeof(int));
+  _encode_matrix.assign(_n * _k, 0);
 }
 
 ECDAG* RSPIPE::Encode() {
@@ -17,7 +17,7 @@ ECDAG* RSPIPE::Encode() {
   for (int i=0; i<_k; i++) data.push_back(i);
   for (int i=_k; i<_n; i++) code.push_back(i);
 
-  generate_matrix(_encode_matrix, _n, _k, 8);
+  generate_matrix(_encode_matrix.data(), _n, _k, 8);
   for (int i=0; i<_m; i++) {
     vector<int> coef;
     for (int j=0; j<_k; j++) {
@@ -32,13 +32,13 @@ ECDAG* RSPIPE::Encode() {
 ECDAG* RSPIPE::Decode(vector<int> from, vector<int> to) {
   ECDAG* ecdag = new ECDAG();
 
-  generate_matrix(_encode_matrix, _n, _k, 8);
+  generate_matrix(_encode_matrix.data(), _n, _k, 8);
 
   int _select_matrix[_k*_k];
   for (int i=0; i<_k; i++) {
     int sidx = from[i];
     memcpy(_select_matrix + i * _k,
-           _encode_matrix + sidx * _k,
+           _encode_matrix.data() + sidx * _k,
 	   sizeof(int) * _k);
   }
   
@@ -51,7 +51,7 @@ ECDAG* RSPIPE::Decode(vector<int> from, vector<int> to) {
     int ridx = to[i];
     int _select_vector[_k];
     memcpy(_select_vector,
-           _encode_matrix + ridx * _k,
+           _encode_matrix.data() + ridx * _k,
 	   _k * sizeof(int));
     int* _coef_vector = jerasure_matrix_multiply(
              _select_vector, _invert_matrix, 1, _k, _k, _k, 8);
@@ -5,14 +5,12 @@
 #include "ECBase.hh"
 #include "ECDAG.hh"
 
-#define RSPIPE_N_MAX 32
-
 using namespace std;
 
 class RSPIPE : public ECBase {
   private:
     int _m;
-    int _encode_matrix[RSPIPE_N_MAX * RSPIPE_N_MAX];
+    vector<int> _encode_matrix;
 
     void generate_matrix(int* matrix, int rows, int cols, int w);
   public:
@@ -8,11 +8,11 @@ WASLRC::WASLRC(int n, int k, int w, int opt, vector<string> param) {
   // there should be two other parameters in param
   // 0. l (local parity num)
   // 1. r (global parity num)
-  cout << param.size() << endl;
+  LOG_DEBUG << param.size();
   _l = atoi(param[0].c_str());
   _r = atoi(param[1].c_str());
 
-  memset(_encode_matrix, 0, _n * _k * sizeof(int));
+  _encode_matrix.assign((_k+_l+_r) * _k, 0);
 }
 
 ECDAG* WASLRC::Encode() {
@@ -22,7 +22,7 @@ ECDAG* WASLRC::Encode() {
   for (int i=0; i<_k; i++) data.push_back(i);
   for (int i=_k; i<_n; i++) code.push_back(i);
   
-  generate_matrix(_encode_matrix, _k, _l, _r, 8); 
+  generate_matrix(_encode_matrix.data(), _k, _l, _r, 8); 
   for (int i=0; i<code.size(); i++) {
     vector<int> coef;
     for (int j=0; j<_k; j++) {
@@ -65,7 +65,7 @@ ECDAG* WASLRC::Decode(vector<int> from, vector<int> to) {
       }
     } else {
       // global parity
-      generate_matrix(_encode_matrix, _k, _l, _r, 8);
+      generate_matrix(_encode_matrix.data(), _k, _l, _r, 8);
       for (int i=0; i<_k; i++) {
         data.push_back(i);
         coef.push_back(_encode_matrix[ridx*_k+i]);
@@ -6,13 +6,11 @@
 
 using namespace std;
 
-#define RS_N_MAX (32)
-
 class WASLRC : public ECBase {
   private:
     int _l;
     int _r;
-    int _encode_matrix[RS_N_MAX * RS_N_MAX];     
+    vector<int> _encode_matrix;
 
     void generate_matrix(int* matrix, int k, int l, int r, int w);
   public:
@@ -4,21 +4,24 @@ UnderFS* FSUtil::createFS(string type, vector<string> param, Config* conf) {
   UnderFS* toret;
   if (type == "HDFS3") {
     #ifdef HDFS3
-    cout << "FSUtil::HDFS3" << endl;
+    LOG_DEBUG << "FSUtil::HDFS3";
     toret = new Hadoop3(param, conf);
     #endif
   } else if (type == "HDFSRAID") {
     #ifdef HDFSRAID
-    cout << "FSUtil::HDFSRAID" << endl;
+    LOG_DEBUG << "FSUtil::HDFSRAID";
     toret = new Hadoop20(param, conf);
     #endif
   } else if (type == "QFS") {
     #ifdef QFS
-    cout << "FSUtil::QuantcastFS" << endl;
+    LOG_DEBUG << "FSUtil::QuantcastFS";
     toret = new QuantcastFS(param, conf);
     #endif
+  } else if (type == "Local") {
+    LOG_DEBUG << "FSUtil::LocalFS";
+    toret = new LocalFS(param, conf);
   } else {
-    cout << "unrecognized FS type!" << endl;
+    LOG_WARN << "unrecognized FS type!";
     toret = NULL;
   }
 
@@ -28,18 +31,21 @@ UnderFS* FSUtil::createFS(string type, vector<string> param, Config* conf) {
 void FSUtil::deleteFS(string type, UnderFS* fshandler) {
   if (type == "HDFS3") {
     #ifdef HDFS3
-    cout << "FSUtil::HDFS3" << endl;
+    LOG_DEBUG << "FSUtil::HDFS3";
     delete (Hadoop3*)fshandler;
     #endif
   } else if (type == "HDFSRAID") {
     #ifdef HDFSRAID
-    cout << "FSUtil::HDFSRAID" << endl;
+    LOG_DEBUG << "FSUtil::HDFSRAID";
     delete (Hadoop20*)fshandler;
     #endif
   } else if (type == "QFS") {
     #ifdef QFS
-    cout << "FSUtil::QuantcastFS" << endl;
+    LOG_DEBUG << "FSUtil::QuantcastFS";
     delete (QuantcastFS*)fshandler;
     #endif
+  } else if (type == "Local") {
+    LOG_DEBUG << "FSUtil::LocalFS";
+    delete (LocalFS*)fshandler;
   }
 }
@@ -13,6 +13,7 @@
 #include "QuantcastFS.hh"
 #endif
 
+#include "LocalFS.hh"
 #include "UnderFS.hh"
 #include "../common/Config.hh"
 #include "../inc/include.hh"
@@ -1,13 +1,13 @@
 #include "Hadoop20.hh"
 
 Hadoop20::Hadoop20(vector<string> params, Config* conf) {
-  cout << "Hadoop20::Hadoop20" << endl;
+  LOG_DEBUG << "Hadoop20::Hadoop20";
   _ip = params[0];
   _port = atoi(params[1].c_str());
   _fs = hdfsConnect(_ip.c_str(), _port);
 
   if (!_fs) {
-    cerr << "Failed to connect to hadoop20!\n" << endl;
+    LOG_ERROR << "Failed to connect to hadoop20!\n";
     exit(-1);
   }
 
@@ -15,7 +15,8 @@ Hadoop20::Hadoop20(vector<string> params, Config* conf) {
 }
 
 Hadoop20::~Hadoop20() {
-  cout << "Hadoop20::~Hadoop20" << endl;
+  LOG_DEBUG << "Hadoop20::~Hadoop20";
+  clearCache();
   hdfsDisconnect(_fs);
 }
 
@@ -23,22 +24,24 @@ Hadoop20File* Hadoop20::openFile(string filename, string mode) {
   Hadoop20File* toret;
   hdfsFile underfile;
   if (mode == "read") {
-    cout << "Hadoop20::openFile " << filename << " for read" << endl;
-    underfile = hdfsOpenFile(_fs, filename.c_str(), O_RDONLY, _conf->_pktSize, 0, 0);
+    LOG_DEBUG << "Hadoop20::openFile " << filename << " for read";
+    int bufsize = _conf->_pktSize > _conf->_readahead_size ? _conf->_pktSize : _conf->_readahead_size;
+    underfile = hdfsOpenFile(_fs, filename.c_str(), O_RDONLY, bufsize, 0, 0);
     if (underfile) {
       // try to read 1 byte
       int tmpres;
       int res = hdfsRead(_fs, underfile, (void*)&tmpres, 1);
-      cout << "Hadoop20::openFile.try to read 1 byte, res: " << res << endl;
+      LOG_DEBUG << "Hadoop20::openFile.try to read 1 byte, res: " << res;
       if (res < 1) underfile = NULL;
       else hdfsSeek(_fs, underfile, 0);
     }
   } else {
-    cout << "Hadoop20::openFile "  << filename << " for write" << endl;
+    LOG_DEBUG << "Hadoop20::openFile "  << filename << " for write";
+    invalidate(filename);
     underfile = hdfsOpenFile(_fs, filename.c_str(), O_WRONLY |O_CREAT|O_WRONLY, 0, 0, 0);
   }
   if (!underfile) {
-    cerr << "Failed to open " << filename << " in Hadoop20" << endl;
+    LOG_ERROR << "Failed to open " << filename << " in Hadoop20";
     toret = NULL;
   } else {
     toret = new Hadoop20File(filename, underfile);
@@ -55,7 +58,7 @@ void Hadoop20::flushFile(UnderFile* file) {
 }
 
 void Hadoop20::closeFile(UnderFile* file) {
-  cout << "Hadoop20::closeFile"  << endl;
+  LOG_DEBUG << "Hadoop20::closeFile";
   hdfsFile objfile = ((Hadoop20File*)file)->_objfile;
   if (objfile) {
     hdfsCloseFile(_fs, objfile);
@@ -68,12 +71,24 @@ int Hadoop20::readFile(UnderFile* file, char* buffer, int len) {
   return hdfsRead(_fs, ((Hadoop20File*)file)->_objfile, (void*)buffer, len);
 }
 
-int Hadoop20::pReadFile(UnderFile* file, int offset, char* buffer, int len) {
+int Hadoop20::pReadFile(UnderFile* file, long offset, char* buffer, int len) {
   return hdfsPread(_fs, ((Hadoop20File*)file)->_objfile, offset, (void*)buffer, len);
 }
 
-int Hadoop20::getFileSize(UnderFile* file) {
+void Hadoop20::seekFile(UnderFile* file, long offset) {
+  hdfsSeek(_fs, ((Hadoop20File*)file)->_objfile, offset);
+}
+
+long Hadoop20::getFileSize(UnderFile* file) {
   hdfsFileInfo* fileinfo = hdfsGetPathInfo(_fs, ((Hadoop20File*)file)->_objname.c_str());
-  return fileinfo->mSize;
+  if (!fileinfo) return 0;
+  long size = fileinfo->mSize;
+  hdfsFreeFileInfo(fileinfo, 1);
+  return size;
+}
+
+void Hadoop20::deleteFile(string filename) {
+  invalidate(filename);
+  if (hdfsDelete(_fs, filename.c_str(), 0) < 0) LOG_WARN << "Failed to delete " << filename << " in Hadoop20";
 }
 
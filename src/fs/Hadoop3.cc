@@ -1,7 +1,7 @@
 #include "Hadoop3.hh"
 
 Hadoop3::Hadoop3(vector<string> params, Config* conf) {
-  cout << "hadoop3 constructor!" << endl;
+  LOG_DEBUG << "hadoop3 constructor!";
   _ip = params[0];
   _port = atoi(params[1].c_str());
   _fs = hdfsConnect(_ip.c_str(), _port);
@@ -11,6 +11,7 @@ Hadoop3::Hadoop3(vector<string> params, Config* conf) {
 
 Hadoop3::~Hadoop3() {
 //  cout << "Hadoop3::~Hadoop3" << endl;
+  clearCache();
   hdfsDisconnect(_fs);
 } 
 
@@ -18,16 +19,22 @@ Hadoop3File* Hadoop3::openFile(string filename, string mode) {
   Hadoop3File* toret = NULL;
   hdfsFile underfile;
   if (mode == "read") {
-    cout << "Hadoop3.openFile for read" << endl;
-    underfile = hdfsOpenFile(_fs, filename.c_str(), O_RDONLY, _conf->_pktSize, 0, 0);
+    LOG_DEBUG << "Hadoop3.openFile for read";
+    int bufsize = _conf->_pktSize > _conf->_readahead_size ? _conf->_pktSize : _conf->_readahead_size;
+    underfile = hdfsOpenFile(_fs, filename.c_str(), O_RDONLY, bufsize, 0, 0);
   } else {
-    cout << "Hadoop3.openFile "<<filename<<" for write" << endl;
-    underfile = hdfsOpenFile(_fs, filename.c_str(), O_WRONLY | O_CREAT, 0, 0, 0);
-    hdfsCloseFile(_fs, underfile);
-    underfile = hdfsOpenFile(_fs, filename.c_str(), O_WRONLY | O_APPEND, 0, 0, 0);
+    LOG_DEBUG << "Hadoop3.openFile "<<filename<<" for write";
+    invalidate(filename);
+    // O_WRONLY creates (or truncates) the file and returns a writable handle in one round trip
+    underfile = hdfsOpenFile(_fs, filename.c_str(), O_WRONLY, 0, 0, 0);
+    if (!underfile) {
+      underfile = hdfsOpenFile(_fs, filename.c_str(), O_WRONLY | O_CREAT, 0, 0, 0);
+      if (underfile) hdfsCloseFile(_fs, underfile);
+      underfile = hdfsOpenFile(_fs, filename.c_str(), O_WRONLY | O_APPEND, 0, 0, 0);
+    }
   }
   if (!underfile) {
-    cerr << "Failed to open " << filename << " in Hadoop3" << endl;
+    LOG_ERROR << "Failed to open " << filename << " in Hadoop3";
     toret = NULL;
   } else {
     toret = new Hadoop3File(filename, underfile);
@@ -43,7 +50,7 @@ void Hadoop3::writeFile(UnderFile* file, char* buffer, int len) {
 void Hadoop3::flushFile(UnderFile* file) {
 //  cout << "Hadoop3::flushFile" << endl;
   if (hdfsFlush(_fs, ((Hadoop3File*)file)->_objfile)) {
-    cerr << "Failed to 'flush' " << ((Hadoop3File*)file)->_objname << endl;
+    LOG_ERROR << "Failed to 'flush' " << ((Hadoop3File*)file)->_objname;
     exit(-1);
   }
 }
@@ -63,13 +70,25 @@ int Hadoop3::readFile(UnderFile* file, char* buffer, int len) {
   return hdfsRead(_fs, ((Hadoop3File*)file)->_objfile, buffer, len);
 }
 
-int Hadoop3::pReadFile(UnderFile* file, int offset, char* buffer, int len) {
+int Hadoop3::pReadFile(UnderFile* file, long offset, char* buffer, int len) {
 //  cout << "Hadoop3::pReadFile" << endl;
   return hdfsPread(_fs, ((Hadoop3File*)file)->_objfile, offset, buffer, len);
 }
 
-int Hadoop3::getFileSize(UnderFile* file) {
+void Hadoop3::seekFile(UnderFile* file, long offset) {
+  hdfsSeek(_fs, ((Hadoop3File*)file)->_objfile, offset);
+}
+
+long Hadoop3::getFileSize(UnderFile* file) {
 //  cout << "Hadoop3::getFileSize" << endl;
   hdfsFileInfo* fileinfo = hdfsGetPathInfo(_fs, ((Hadoop3File*)file)->_objname.c_str());
-  return fileinfo->mSize;
+  if (!fileinfo) return 0;
+  long size = fileinfo->mSize;
+  hdfsFreeFileInfo(fileinfo, 1);
+  return size;
+}
+
+void Hadoop3::deleteFile(string filename) {
+  invalidate(filename);
+  if (hdfsDelete(_fs, filename.c_str(), 0) < 0) LOG_WARN << "Failed to delete " << filename << " in Hadoop3";
 }
@@ -0,0 +1,99 @@
+#include "LocalFS.hh"
+
+LocalFS::LocalFS(vector<string> params, Config* conf) {
+  _root = params[0];
+  while (_root.size() > 1 && _root.back() == '/') _root.pop_back();
+  mkdir(_root.c_str(), 0755);
+  _conf = conf;
+}
+
+LocalFS::~LocalFS() {
+  clearCache();
+}
+
+string LocalFS::pathOf(string filename) {
+  if (filename.size() && filename[0] == '/') return _root + filename;
+  return _root + "/" + filename;
+}
+
+LocalFile* LocalFS::openFile(string filename, string mode) {
+  LocalFile* toret = NULL;
+  string path = pathOf(filename);
+  int fd;
+  if (mode == "read") {
+    fd = open(path.c_str(), O_RDONLY);
+  } else {
+    invalidate(filename);
+    // create the parent directories of the object
+    for (size_t pos = path.find('/', _root.size()+1); pos != string::npos; pos = path.find('/', pos+1)) {
+      mkdir(path.substr(0, pos).c_str(), 0755);
+    }
+    fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  }
+  if (fd < 0) {
+    LOG_ERROR << "Failed to open " << filename << " in LocalFS";
+  } else {
+    toret = new LocalFile(filename, fd);
+  }
+  return toret;
+}
+
+void LocalFS::writeFile(UnderFile* file, char* buffer, int len) {
+  int fd = ((LocalFile*)file)->_fd;
+  int off = 0;
+  while (off < len) {
+    int res = write(fd, buffer + off, len - off);
+    if (res <= 0) {
+      LOG_ERROR << "Failed to write " << ((LocalFile*)file)->_objname;
+      return;
+    }
+    off += res;
+  }
+}
+
+void LocalFS::flushFile(UnderFile*) {
+  // written data is visible to the other agents once write returns, as after an hflush
+}
+
+void LocalFS::closeFile(UnderFile* file) {
+  int fd = ((LocalFile*)file)->_fd;
+  if (fd >= 0) close(fd);
+  delete file;
+}
+
+int LocalFS::readFile(UnderFile* file, char* buffer, int len) {
+  int fd = ((LocalFile*)file)->_fd;
+  int off = 0;
+  while (off < len) {
+    int res = read(fd, buffer + off, len - off);
+    if (res <= 0) break;
+    off += res;
+  }
+  return off;
+}
+
+int LocalFS::pReadFile(UnderFile* file, long offset, char* buffer, int len) {
+  int fd = ((LocalFile*)file)->_fd;
+  int off = 0;
+  while (off < len) {
+    int res = pread(fd, buffer + off, len - off, offset + off);
+    if (res <= 0) break;
+    off += res;
+  }
+  return off;
+}
+
+void LocalFS::seekFile(UnderFile* file, long offset) {
+  lseek(((LocalFile*)file)->_fd, offset, SEEK_SET);
+}
+
+long LocalFS::getFileSize(UnderFile* file) {
+  struct stat st;
+  if (fstat(((LocalFile*)file)->_fd, &st) < 0) return 0;
+  return st.st_size;
+}
+
+void LocalFS::deleteFile(string filename) {
+  invalidate(filename);
+  if (unlink(pathOf(filename).c_str()) < 0) LOG_WARN << "Failed to delete " << filename << " in LocalFS";
+}
@@ -0,0 +1,39 @@
+#ifndef _LOCALFS_HH_
+#define _LOCALFS_HH_
+
+#include "LocalFile.hh"
+#include "UnderFS.hh"
+#include "UnderFile.hh"
+#include "../common/Config.hh"
+#include "../inc/include.hh"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+/*
+ * Objects as files under a local directory, dss.parameter is the directory.
+ * Agents that share the directory see the same objects, which stands in for a DFS when
+ * all agents run on one host.
+ */
+class LocalFS : public UnderFS {
+  private:
+    string _root;
+
+    string pathOf(string filename);
+  public:
+    LocalFS(vector<string> params, Config* conf);
+    ~LocalFS();
+    LocalFile* openFile(string filename, string mode);
+    void writeFile(UnderFile* file, char* buffer, int len);
+    void flushFile(UnderFile* file);
+    void closeFile(UnderFile* file);
+    int readFile(UnderFile* file, char* buffer, int len);
+    int pReadFile(UnderFile* file, long offset, char* buffer, int len);
+    void seekFile(UnderFile* file, long offset);
+    long getFileSize(UnderFile* file);
+    void deleteFile(string filename);
+};
+
+#endif
@@ -0,0 +1,8 @@
+#include "LocalFile.hh"
+
+LocalFile::LocalFile(string objname, int fd) {
+  _objname = objname;
+  _fd = fd;
+}
+
+LocalFile::~LocalFile(){}
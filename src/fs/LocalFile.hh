@@ -0,0 +1,16 @@
+#ifndef _LOCALFILE_HH_
+#define _LOCALFILE_HH_
+
+#include "UnderFile.hh"
+#include "../inc/include.hh"
+
+class LocalFile : public UnderFile {
+  public:
+    string _objname;
+    int _fd;
+
+    LocalFile(string objname, int fd);
+    ~LocalFile();
+};
+
+#endif
@@ -5,11 +5,13 @@ QuantcastFS::QuantcastFS(vector<string> params, Config* conf) {
   _port = atoi(params[1].c_str());
   _fs = KFS::Connect(_ip, _port);
   if (!_fs) {
-    cout << "fail to connect qfs" << endl;
+    LOG_ERROR << "fail to connect qfs";
   }
+  _conf = conf;
 }
 
 QuantcastFS::~QuantcastFS() {
+  clearCache();
   delete _fs;
 }
 
@@ -17,16 +19,16 @@ QFSFile* QuantcastFS::openFile(string filename, string mode) {
   QFSFile* toret = NULL;
   int fd;
   if (mode == "read") {
-    cout << "QuantcastFS::openFile " << filename << " for read" << endl;
+    LOG_DEBUG << "QuantcastFS::openFile " << filename << " for read";
     if ((fd = _fs->Open(filename.c_str(), O_RDONLY)) < 0) {
-      cout << "QuantcastFS::openFile error!" << endl;
+      LOG_ERROR << "QuantcastFS::openFile error!";
     } else {
-      cout << "QuantcastFS::openFile.fd: " << fd << endl;
+      LOG_DEBUG << "QuantcastFS::openFile.fd: " << fd;
       // try to read 1 byte?
       int tmpres;
       int res = _fs->Read(fd, (char*)&tmpres, 4);
       if (res != 4) {
-        cout << "QuantcastFS::openFile error!" << endl; 
+        LOG_ERROR << "QuantcastFS::openFile error!"; 
         _fs->Close(fd);
       } else {
         // reset offset
@@ -35,11 +37,12 @@ QFSFile* QuantcastFS::openFile(string filename, string mode) {
       }
     }
   } else {
-    cout << "QuantcastFS::openFile " << filename << " for write" << endl;
+    LOG_DEBUG << "QuantcastFS::openFile " << filename << " for write";
+    invalidate(filename);
     if ((fd = _fs->Create(filename.c_str(), 1)) < 0) {
-      cout << "QuantcastFS::openFile error!" << endl;
+      LOG_ERROR << "QuantcastFS::openFile error!";
     } else {
-      cout << "QuantcastFS::openFile.fd: " << fd << endl;
+      LOG_DEBUG << "QuantcastFS::openFile.fd: " << fd;
       toret = new QFSFile(filename, fd);
     }
   }
@@ -66,16 +69,26 @@ int QuantcastFS::readFile(UnderFile* file, char* buffer, int len) {
   return _fs->Read(fd, buffer, len);
 }
 
-int QuantcastFS::pReadFile(UnderFile* file, int offset, char* buffer, int len) {
+int QuantcastFS::pReadFile(UnderFile* file, long offset, char* buffer, int len) {
   int fd = ((QFSFile*)file)->_fd;
   _fs->Seek(fd, offset);
   return _fs->Read(fd, buffer, len);
 }
 
-int QuantcastFS::getFileSize(UnderFile* file) {
+void QuantcastFS::seekFile(UnderFile* file, long offset) {
+  int fd = ((QFSFile*)file)->_fd;
+  _fs->Seek(fd, offset);
+}
+
+long QuantcastFS::getFileSize(UnderFile* file) {
   KFS::KfsFileAttr fileAttr;
   string filename = ((QFSFile*)file)->_objname;
   _fs->Stat(filename.c_str(), fileAttr);
   long size = fileAttr.fileSize;
-  return (int)size;
+  return size;
+}
+
+void QuantcastFS::deleteFile(string filename) {
+  invalidate(filename);
+  if (_fs->Remove(filename.c_str()) < 0) LOG_WARN << "QuantcastFS::deleteFile error!";
 }
@@ -24,8 +24,10 @@ class QuantcastFS : public UnderFS {
     void flushFile(UnderFile* file);
     void closeFile(UnderFile* file);
     int readFile(UnderFile* file, char* buffer, int len);
-    int pReadFile(UnderFile* file, int offset, char* buffer, int len);
-    int getFileSize(UnderFile* file);
+    int pReadFile(UnderFile* file, long offset, char* buffer, int len);
+    void seekFile(UnderFile* file, long offset);
+    long getFileSize(UnderFile* file);
+    void deleteFile(string filename);
 };
 
 #endif
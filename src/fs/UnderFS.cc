@@ -1,10 +1,180 @@
 #include "UnderFS.hh"
 
-UnderFS::UnderFS() {
+UnderFS::UnderFS() : _registered(false) {
 }
 
-UnderFS::UnderFS(vector<string> param, Config* conf) {
+UnderFS::UnderFS(vector<string> param, Config* conf) : _registered(false) {
 }
 
+mutex UnderFS::_registryLock;
+unordered_set<UnderFS*> UnderFS::_registry;
+atomic<int> UnderFS::_registeredNum(0);
+atomic<long> UnderFS::_epochs[UNDERFS_EPOCH_SLOTS];
+
 UnderFS::~UnderFS() {
+  // the subclass has already cleared the cache
+  if (!_registered) return;
+  lock_guard<mutex> lck(_registryLock);
+  _registry.erase(this);
+  _registeredNum--;
+}
+
+void UnderFS::registerCache() {
+  // caller does not hold _cacheLock, invalidate takes _registryLock first
+  if (_registered.load()) return;
+  lock_guard<mutex> lck(_registryLock);
+  _registry.insert(this);
+  _registered = true;
+  _registeredNum++;
+}
+
+atomic<long>& UnderFS::epochOf(const string& filename) {
+  return _epochs[hash<string>()(filename) % UNDERFS_EPOCH_SLOTS];
+}
+
+bool UnderFS::cacheEnabled() {
+  return _conf && _conf->_fscache_ttl > 0;
+}
+
+bool UnderFS::expired(struct timeval t) {
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  long ms = (now.tv_sec - t.tv_sec) * 1000 + (now.tv_usec - t.tv_usec) / 1000;
+  return ms >= _conf->_fscache_ttl;
+}
+
+void UnderFS::purgeExpired() {
+  // caller holds _cacheLock
+  for (auto it = _handleCache.begin(); it != _handleCache.end();) {
+    vector<pair<UnderFile*, struct timeval>>& handles = it->second;
+    for (int i=handles.size()-1; i>=0; i--) {
+      if (!expired(handles[i].second)) continue;
+      closeFile(handles[i].first);
+      handles.erase(handles.begin() + i);
+      _handleNum--;
+    }
+    if (handles.empty()) it = _handleCache.erase(it);
+    else it++;
+  }
+  for (auto it = _sizeCache.begin(); it != _sizeCache.end();) {
+    if (expired(it->second.second)) it = _sizeCache.erase(it);
+    else it++;
+  }
+}
+
+UnderFile* UnderFS::openCachedFile(string filename) {
+  if (!cacheEnabled()) return openFile(filename, "read");
+  UnderFile* toret = NULL;
+  {
+    lock_guard<mutex> lck(_cacheLock);
+    auto it = _handleCache.find(filename);
+    if (it != _handleCache.end()) {
+      vector<pair<UnderFile*, struct timeval>>& handles = it->second;
+      while (!handles.empty() && !toret) {
+        pair<UnderFile*, struct timeval> item = handles.back();
+        handles.pop_back();
+        _handleNum--;
+        if (expired(item.second)) closeFile(item.first);
+        else toret = item.first;
+      }
+      if (handles.empty()) _handleCache.erase(it);
+    }
+  }
+  if (toret) {
+    seekFile(toret, 0);
+    return toret;
+  }
+  // the epoch is taken before the open, an invalidate during the open keeps the handle out of the cache
+  long epoch = epochOf(filename).load();
+  toret = openFile(filename, "read");
+  if (toret) toret->_epoch = epoch;
+  return toret;
+}
+
+void UnderFS::releaseFile(string filename, UnderFile* file) {
+  if (!file) return;
+  if (!cacheEnabled()) {
+    closeFile(file);
+    return;
+  }
+  registerCache();
+  {
+    lock_guard<mutex> lck(_cacheLock);
+    if (_handleNum >= _conf->_fscache_handles) purgeExpired();
+    // the name was invalidated while the handle was out, e.g. deleted and written again
+    if (_handleNum < _conf->_fscache_handles && file->_epoch == epochOf(filename).load()) {
+      struct timeval now;
+      gettimeofday(&now, NULL);
+      _handleCache[filename].push_back(make_pair(file, now));
+      _handleNum++;
+      return;
+    }
+  }
+  closeFile(file);
+}
+
+long UnderFS::getCachedFileSize(string filename, UnderFile* file) {
+  if (!cacheEnabled()) return getFileSize(file);
+  {
+    lock_guard<mutex> lck(_cacheLock);
+    auto it = _sizeCache.find(filename);
+    if (it != _sizeCache.end()) {
+      if (!expired(it->second.second)) return it->second.first;
+      _sizeCache.erase(it);
+    }
+  }
+  long size = getFileSize(file);
+  // an empty object is treated as missing, do not remember it, nor a size of an invalidated handle
+  if (size > 0) {
+    registerCache();
+    lock_guard<mutex> lck(_cacheLock);
+    if (file->_epoch == epochOf(filename).load()) {
+      struct timeval now;
+      gettimeofday(&now, NULL);
+      _sizeCache[filename] = make_pair(size, now);
+    }
+  }
+  return size;
+}
+
+void UnderFS::invalidate(string filename) {
+  if (!cacheEnabled()) return;
+  // bumped before the drop: a handle released or a size stored in between sees the new epoch
+  epochOf(filename)++;
+  if (_registeredNum.load() == 0) return;
+  vector<pair<UnderFS*, vector<UnderFile*>>> dropped;
+  {
+    lock_guard<mutex> lck(_registryLock);
+    for (auto fs: _registry) {
+      vector<UnderFile*> files;
+      fs->dropCached(filename, files);
+      if (files.size()) dropped.push_back(make_pair(fs, files));
+    }
+  }
+  // handles of the dss are closed without holding the locks
+  for (auto item: dropped) {
+    for (auto file: item.second) item.first->closeFile(file);
+  }
+}
+
+void UnderFS::dropCached(string filename, vector<UnderFile*>& dropped) {
+  lock_guard<mutex> lck(_cacheLock);
+  _sizeCache.erase(filename);
+  auto it = _handleCache.find(filename);
+  if (it == _handleCache.end()) return;
+  for (auto item: it->second) {
+    dropped.push_back(item.first);
+    _handleNum--;
+  }
+  _handleCache.erase(it);
+}
+
+void UnderFS::clearCache() {
+  lock_guard<mutex> lck(_cacheLock);
+  for (auto it: _handleCache) {
+    for (auto item: it.second) closeFile(item.first);
+  }
+  _handleCache.clear();
+  _sizeCache.clear();
+  _handleNum = 0;
 }
@@ -5,23 +5,65 @@
 #include "../common/Config.hh"
 #include "../inc/include.hh"
 
+#include <atomic>
+#include <sys/time.h>
+#include <unordered_set>
+
+// invalidation epochs of object names are kept in this many hashed slots
+#define UNDERFS_EPOCH_SLOTS 4096
+
 using namespace std;
 
 class UnderFS {
+  private:
+    // idle read handles and file sizes, valid for _conf->_fscache_ttl ms
+    mutex _cacheLock;
+    unordered_map<string, vector<pair<UnderFile*, struct timeval>>> _handleCache;
+    unordered_map<string, pair<long, struct timeval>> _sizeCache;
+    int _handleNum = 0;
+    // the instances of the process that hold cached items, see invalidate
+    static mutex _registryLock;
+    static unordered_set<UnderFS*> _registry;
+    static atomic<int> _registeredNum;
+    atomic<bool> _registered;
+    // bumped by invalidate, a handle or size read before the bump is not cached after it.
+    // Names that share a slot only lose a chance to be cached
+    static atomic<long> _epochs[UNDERFS_EPOCH_SLOTS];
+
+    bool cacheEnabled();
+    bool expired(struct timeval t);
+    void purgeExpired();
+    void registerCache();
+    static atomic<long>& epochOf(const string& filename);
+    // the handles are handed to the caller, which closes them without holding any lock
+    void dropCached(string filename, vector<UnderFile*>& dropped);
+
   public:
-    Config* _conf;
+    Config* _conf = NULL;
 
     UnderFS();
     UnderFS(vector<string> param, Config* conf);    
-    ~UnderFS();
+    virtual ~UnderFS();
 
     virtual UnderFile* openFile(string filename, string mode) = 0;
     virtual void writeFile(UnderFile* file, char* buffer, int len) = 0;
     virtual void flushFile(UnderFile* file) = 0;
     virtual void closeFile(UnderFile* file) = 0;
     virtual int readFile(UnderFile* file, char* buffer, int len) = 0;
-    virtual int pReadFile(UnderFile* file, int offset, char* buffer, int len) = 0;
-    virtual int getFileSize(UnderFile* file) = 0;
+    virtual int pReadFile(UnderFile* file, long offset, char* buffer, int len) = 0;
+    virtual void seekFile(UnderFile* file, long offset) = 0;
+    virtual long getFileSize(UnderFile* file) = 0;
+    // removes the object, readers see it as lost
+    virtual void deleteFile(string filename) = 0;
+
+    // cached read path: a handle from openCachedFile is returned with
+    // releaseFile and may be handed out again, rewound to offset 0
+    UnderFile* openCachedFile(string filename);
+    void releaseFile(string filename, UnderFile* file);
+    long getCachedFileSize(string filename, UnderFile* file);
+    // drops the object from the caches of every UnderFS of the process (e.g., all workers of an agent)
+    void invalidate(string filename);
+    void clearCache();
 };
 
 #endif
@@ -7,6 +7,9 @@ using namespace std;
 
 class UnderFile {
   public:
+    // invalidation epoch of the name when the handle was opened, see UnderFS::invalidate
+    long _epoch = 0;
+
     UnderFile();
 };
 
@@ -26,5 +26,7 @@
 
 #define MAX_COMMAND_LEN 4096
 
+#include "../util/Logger.hh"
+
 #endif
 
@@ -3,6 +3,7 @@
 AGCommand::AGCommand() {
   _agCmd = (char*)calloc(MAX_COMMAND_LEN, sizeof(char));
   _cmLen = 0;
+  _cmCap = MAX_COMMAND_LEN;
   _rKey = "ag_request";
 }
 
@@ -28,21 +29,33 @@ AGCommand::AGCommand(char* reqStr) {
     case 3: resolveType3(); break;
     case 5: resolveType5(); break;
     case 7: resolveType7(); break;
+    case 8: resolveType8(); break;
     case 10: resolveType10(); break;
     case 11: resolveType11(); break;
+    case 12: resolveType12(); break;
+    case 13: resolveType1(); break;
     default: break;
   }
   _agCmd = nullptr;
   _cmLen = 0;
 }
 
+void AGCommand::reserve(int len) {
+  // commands of wide stripes outgrow MAX_COMMAND_LEN, receivers take the length from redis
+  if (_cmLen + len <= _cmCap) return;
+  while (_cmLen + len > _cmCap) _cmCap *= 2;
+  _agCmd = (char*)realloc(_agCmd, _cmCap);
+}
+
 void AGCommand::writeInt(int value) {
+  reserve(4);
   int tmpv = htonl(value);
   memcpy(_agCmd + _cmLen, (char*)&tmpv, 4); _cmLen += 4;
 }
 
 void AGCommand::writeString(string s) {
   int slen = s.length();
+  reserve(4 + slen);
   int tmpslen = htonl(slen);
   // string length
   memcpy(_agCmd + _cmLen, (char*)&tmpslen, 4); _cmLen += 4;
@@ -50,6 +63,12 @@ void AGCommand::writeString(string s) {
   memcpy(_agCmd + _cmLen, s.c_str(), slen); _cmLen += slen;
 }
 
+void AGCommand::writeLong(long value) {
+  // high 32 bits first, both halves in network order
+  writeInt((int)((unsigned long)value >> 32));
+  writeInt((int)(value & 0xffffffff));
+}
+
 int AGCommand::readInt() {
   int tmpint;
   memcpy((char*)&tmpint, _agCmd + _cmLen, 4); _cmLen += 4;
@@ -66,6 +85,12 @@ string AGCommand::readString() {
   return toret;
 }
 
+long AGCommand::readLong() {
+  unsigned long high = (unsigned int)readInt();
+  unsigned long low = (unsigned int)readInt();
+  return (long)((high << 32) | low);
+}
+
 int AGCommand::getType() {
   return _type;
 }
@@ -94,6 +119,14 @@ int AGCommand::getFilesizeMB() {
   return _filesizeMB;
 }
 
+long AGCommand::getOffset() {
+  return _offset;
+}
+
+long AGCommand::getLength() {
+  return _length;
+}
+
 bool AGCommand::getShouldSend() {
   return _shouldSend;
 }
@@ -166,10 +199,31 @@ int AGCommand::getBasesizeMB() {
   return _basesizeMB;
 }
 
+vector<string> AGCommand::getBatchCmds() {
+  return _batchCmds;
+}
+
+string AGCommand::getTraceId() {
+  return _traceId;
+}
+
 void AGCommand::setRkey(string key) {
   _rKey = key;
 } 
 
+void AGCommand::writeTrace() {
+  _traceOff = _cmLen;
+  writeString(_traceId);
+}
+
+void AGCommand::setTraceId(string traceid) {
+  if (_traceOff < 0) return;
+  // the traceid is the last field, rewrite it in place
+  _traceId = traceid;
+  _cmLen = _traceOff;
+  writeString(_traceId);
+}
+
 void AGCommand::sendTo(unsigned int ip) {
   redisContext* sendCtx = RedisUtil::createContext(ip);
   redisReply* rReply = (redisReply*)redisCommand(sendCtx, "RPUSH %s %b", _rKey.c_str(), _agCmd, _cmLen);
@@ -177,6 +231,11 @@ void AGCommand::sendTo(unsigned int ip) {
   redisFree(sendCtx);
 }
 
+void AGCommand::sendTo(redisContext* sendCtx) {
+  redisReply* rReply = (redisReply*)redisCommand(sendCtx, "RPUSH %s %b", _rKey.c_str(), _agCmd, _cmLen);
+  freeReplyObject(rReply);
+}
+
 void AGCommand::buildType0(int type,
                            string filename,
                            string ecid,
@@ -225,6 +284,27 @@ void AGCommand::resolveType1() {
   _filename = readString();
 }
 
+void AGCommand::buildType8(int type,
+                           string filename,
+                           long offset,
+                           long length) {
+  _type = type;
+  _filename = filename;
+  _offset = offset;
+  _length = length;
+
+  writeInt(_type);
+  writeString(_filename);
+  writeLong(_offset);
+  writeLong(_length);
+}
+
+void AGCommand::resolveType8() {
+  _filename = readString();
+  _offset = readLong();
+  _length = readLong();
+}
+
 void AGCommand::buildType2(int type,
                      unsigned int sendIp,
                      string stripeName,
@@ -256,6 +336,7 @@ void AGCommand::buildType2(int type,
     writeInt(id);
     writeInt(ref[id]);
   }
+  writeTrace();
 }
 
 void AGCommand::resolveType2() {
@@ -270,6 +351,7 @@ void AGCommand::resolveType2() {
     _readCidList.push_back(id);
     _cacheRefs.insert(make_pair(id, ref));
   }
+  _traceId = readString();
 }
 
 void AGCommand::buildType3(int type,
@@ -315,6 +397,7 @@ void AGCommand::buildType3(int type,
     for (int i=0; i<_nprevs; i++) writeInt(coef[i]);
     writeInt(r);
   }
+  writeTrace();
 }
 
 void AGCommand::resolveType3() {
@@ -335,6 +418,7 @@ void AGCommand::resolveType3() {
     _coefs.insert(make_pair(target, coef));
     _cacheRefs.insert(make_pair(target, r));
   }
+  _traceId = readString();
 }
 
 void AGCommand::buildType5(int type,
@@ -367,6 +451,7 @@ void AGCommand::buildType5(int type,
     writeInt(_prevLocs[i]);
   }
   writeString(_writeObjName);
+  writeTrace();
 }
 
 void AGCommand::resolveType5() {
@@ -379,6 +464,7 @@ void AGCommand::resolveType5() {
     _prevLocs.push_back(readInt());
   }
   _writeObjName = readString();
+  _traceId = readString();
 }
 
 void AGCommand::buildType7(int type,
@@ -430,6 +516,7 @@ void AGCommand::buildType7(int type,
     writeInt(item.first);
     writeInt(item.second);
   }
+  writeTrace();
 }
 
 void AGCommand::resolveType7() {
@@ -457,6 +544,7 @@ void AGCommand::resolveType7() {
     int r = readInt();
     _cacheRefs.insert(make_pair(cid, r));
   }
+  _traceId = readString();
 }
 
 void AGCommand::buildType10(int type,
@@ -502,53 +590,86 @@ void AGCommand::resolveType11() {
   _basesizeMB = readInt();
 }
 
+void AGCommand::buildType12(int type,
+                            unsigned int sendIp) {
+  _type = type;
+  _shouldSend = true;
+  _sendIp = sendIp;
+  _objnum = 0;
+
+  writeInt(_type);
+  // number of commands, updated by addBatchCmd
+  writeInt(_objnum);
+}
+
+bool AGCommand::addBatchCmd(AGCommand* cmd) {
+  int cmLen = cmd->getCmdLen();
+  if (_objnum > 0 && _cmLen + 4 + cmLen > MAX_COMMAND_LEN) return false;
+  writeInt(cmLen);
+  reserve(cmLen);
+  memcpy(_agCmd + _cmLen, cmd->getCmd(), cmLen); _cmLen += cmLen;
+  _objnum++;
+  int tmpnum = htonl(_objnum);
+  memcpy(_agCmd + 4, (char*)&tmpnum, 4);
+  return true;
+}
+
+void AGCommand::resolveType12() {
+  _objnum = readInt();
+  for (int i=0; i<_objnum; i++) {
+    int cmLen = readInt();
+    _batchCmds.push_back(string(_agCmd + _cmLen, cmLen)); _cmLen += cmLen;
+  }
+}
+
 void AGCommand::dump() {
+  if (!LOG_ENABLED(LOG_LEVEL_DEBUG)) return;
   if (_type == 0) {
-    cout << "AGCommand::clientWrite: " << _filename << ", ecid: " << _ecid << ", mode: " << _mode << ", size: " << _filesizeMB << endl;
+    LOG_DEBUG << "AGCommand::clientWrite: " << _filename << ", ecid: " << _ecid << ", mode: " << _mode << ", size: " << _filesizeMB;
   } else if (_type == 1) {
-    cout << "AGCommand::clientRead: " << _filename << endl;
+    LOG_DEBUG << "AGCommand::clientRead: " << _filename;
+  } else if (_type == 13) {
+    LOG_DEBUG << "AGCommand::invalidate: " << _filename;
+  } else if (_type == 8) {
+    LOG_DEBUG << "AGCommand::clientRangeRead: " << _filename << ", offset: " << _offset << ", length: " << _length;
   } else if (_type == 2) {
-    cout << "AGCommand::Load, ip: " << RedisUtil::ip2Str(_sendIp) << " objname: " << _readObjName << ", cidlist: ";
-    for (int i=0; i<_readCidList.size(); i++) cout << _readCidList[i] << " ";
-    cout << ", write: ";
+    string writes;
     for (auto item: _cacheRefs) {
-      cout << item.first << " -> " << item.second << ", ";
+      writes += to_string(item.first) + " -> " + to_string(item.second) + ", ";
     }
-    cout << endl;
+    LOG_DEBUG << "AGCommand::Load, ip: " << RedisUtil::ip2Str(_sendIp) << " objname: " << _readObjName << ", cidlist: "
+              << logList(_readCidList) << ", write: " << writes << ", trace: " << _traceId;
   } else if (_type == 3) {
-    cout << "AGCommand::FetchAndCompute, ip: " << RedisUtil::ip2Str(_sendIp) << endl;
+    LOG_DEBUG << "AGCommand::FetchAndCompute, ip: " << RedisUtil::ip2Str(_sendIp) << ", trace: " << _traceId;
     for (int i=0; i<_nprevs; i++) {
-      cout << "    Fetch: " << _prevCids[i] << " from " << RedisUtil::ip2Str(_prevLocs[i]) << endl;
+      LOG_DEBUG << "    Fetch: " << _prevCids[i] << " from " << RedisUtil::ip2Str(_prevLocs[i]);
     }
     for (auto item: _coefs) {
       int target = item.first;
       vector<int> coef = item.second;
-      cout << "    Compute: " << target << ", coef: ";
-      for (int i=0; i<coef.size(); i++) cout << coef[i] << " ";
-      cout << ", cache: " << _cacheRefs[target] << endl;
+      LOG_DEBUG << "    Compute: " << target << ", coef: " << logList(coef) << ", cache: " << _cacheRefs[target];
     }
   } else if (_type == 5) {
-    cout << "AGCommand::FetchAndPersist, ip: " << RedisUtil::ip2Str(_sendIp) << endl;
+    LOG_DEBUG << "AGCommand::FetchAndPersist, ip: " << RedisUtil::ip2Str(_sendIp) << ", trace: " << _traceId;
     for (int i=0; i<_nprevs; i++) {
-      cout << "    Fetch: " << _prevCids[i] << " from " << RedisUtil::ip2Str(_prevLocs[i]) << endl;
+      LOG_DEBUG << "    Fetch: " << _prevCids[i] << " from " << RedisUtil::ip2Str(_prevLocs[i]);
     }
-    cout << "    Persist as " << _writeObjName << endl;
+    LOG_DEBUG << "    Persist as " << _writeObjName;
   } else if (_type == 7) {
-    cout << "AGCommand::ReadFetchComputeAndCache, ip: " << RedisUtil::ip2Str(_sendIp) << endl;
-    cout << "    Read: objname: " << _readObjName << ", cidlist: ";
-    for (int i=0; i<_readCidList.size(); i++) cout << _readCidList[i] << " ";
-    cout << endl;
+    LOG_DEBUG << "AGCommand::ReadFetchComputeAndCache, ip: " << RedisUtil::ip2Str(_sendIp) << ", trace: " << _traceId;
+    LOG_DEBUG << "    Read: objname: " << _readObjName << ", cidlist: " << logList(_readCidList);
     for (int i=0; i<_nprevs; i++) {
-      cout << "    Fetch: " << _prevCids[i] << " from " << RedisUtil::ip2Str(_prevLocs[i]) << endl;
+      LOG_DEBUG << "    Fetch: " << _prevCids[i] << " from " << RedisUtil::ip2Str(_prevLocs[i]);
     }
     for (auto item: _coefs) {
       int target = item.first;
       vector<int> coef = item.second;
-      cout << "    Compute: " << target << ", coef: ";
-      for (int i=0; i<coef.size(); i++) cout << coef[i] << " ";
+      LOG_DEBUG << "    Compute: " << target << ", coef: " << logList(coef);
     }
     for (auto item: _cacheRefs) {
-      cout << "    Cache: " << item.first << " : " << item.second << endl;
+      LOG_DEBUG << "    Cache: " << item.first << " : " << item.second;
     }
+  } else if (_type == 12) {
+    LOG_DEBUG << "AGCommand::Batch, ip: " << RedisUtil::ip2Str(_sendIp) << ", commands: " << _objnum;
   }
 }
@@ -9,7 +9,7 @@ using namespace std;
 /*
  * OECAgent Command format
  * agent_request: type
- *    type=0 (client write data)| filename | ecid | mode |
+ *    type=0 (client write data)| filename | ecid | mode | filesizeMB | (filesizeMB = -1: size unknown, online only)
  *    type=1 (client read data) | filename |
  *    type=2 (read disk->memory) | read? (| objname | unitIdx | scratio | cid |)
  *    type=3 (fetch->compute->memory) | n prevs | n* (prevloc|prevkey) | m res | m * (n int) | key |
@@ -17,8 +17,13 @@ using namespace std;
  *    type=5 (persis)
  *   ? type=6 (read disk of a list)
  *    type=7 (read disk, fetch remote and compute)
+ *    type=8 (client read a byte range) | filename | offset | length |
  *    type=10: (coor return cmd summary for client to online encoding)| |
  *    type=11: (coor return cmd summary for client to write obj of offline encoding)
+ *    type=12: (batch of ectask commands of several stripes) | num | num * (len | command) |
+ *    type=13: (drop the cached read handles and size of an obj, built as type 1) | objname |
+ *
+ * ectask commands (type 2, 3, 5, 7) end with | traceid | (empty if the job is not traced)
  */
 
 
@@ -26,6 +31,7 @@ class AGCommand {
   private:
     char* _agCmd = 0;
     int _cmLen = 0;
+    int _cmCap = 0;
 
     string _rKey;
 
@@ -40,6 +46,11 @@ class AGCommand {
     // type 1
     // _filename
 
+    // type 8
+    // _filename
+    long _offset;
+    long _length;
+
     // common variables for ectasks
     bool _shouldSend;
     unsigned int _sendIp = 0;  // if sendIp = 0, then do not send, if sendIp>0, we send it
@@ -47,6 +58,8 @@ class AGCommand {
     int _ecw; // s/c ratio: a pkt is divided into _scratio slices
     int _num; // we based on the conf->pktSize, num = objsize/pktSize;
     unordered_map<int, int> _cacheRefs;
+    string _traceId;
+    int _traceOff = -1; // offset of the traceid in _agCmd
 
     // type 2
     // read data from disk and write into memory
@@ -79,6 +92,9 @@ class AGCommand {
     // type 11
     int _objnum;
     int _basesizeMB;
+
+    // type 12
+    vector<string> _batchCmds;
     
   public:
     AGCommand();
@@ -86,10 +102,14 @@ class AGCommand {
     AGCommand(char* reqStr);
 
     // basic construction methods
+    void reserve(int len);
     void writeInt(int value);
     void writeString(string s);
+    void writeLong(long value);
+    void writeTrace();
     int readInt();
     string readString();
+    long readLong();
 
     int getType();
     char* getCmd();
@@ -98,6 +118,8 @@ class AGCommand {
     string getEcid();
     string getMode();
     int getFilesizeMB();
+    long getOffset();
+    long getLength();
     bool getShouldSend();
     unsigned int getSendIp();
     string getStripeName();
@@ -116,10 +138,15 @@ class AGCommand {
     int getComputen();
     int getObjnum();
     int getBasesizeMB();
+    vector<string> getBatchCmds();
+    string getTraceId();
 
     // send method
     void setRkey(string key);
     void sendTo(unsigned int ip);
+    void sendTo(redisContext* sendCtx);
+    // tags a built ectask command with the trace id of its job
+    void setTraceId(string traceid);
 
     // build AGCommand
     void buildType0(int type,
@@ -129,6 +156,10 @@ class AGCommand {
                     int filesizeMB);
     void buildType1(int type,
                     string filename);
+    void buildType8(int type,
+                    string filename,
+                    long offset,
+                    long length);
     void buildType2(int type,
                     unsigned int sendIp,
                     string stripeName,
@@ -176,6 +207,10 @@ class AGCommand {
     void buildType11(int type,
                      int objnum,
                      int basesizeMB);
+    void buildType12(int type,
+                     unsigned int sendIp);
+    // false if cmd does not fit in MAX_COMMAND_LEN, the first cmd of a batch always fits
+    bool addBatchCmd(AGCommand* cmd);
     // resolve AGCommand
     void resolveType0();
     void resolveType1();
@@ -183,8 +218,10 @@ class AGCommand {
     void resolveType3();
     void resolveType5();
     void resolveType7();
+    void resolveType8();
     void resolveType10();
     void resolveType11();
+    void resolveType12();
 
     // for debug
     void dump();
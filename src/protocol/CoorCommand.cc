@@ -3,6 +3,7 @@
 CoorCommand::CoorCommand() {
   _coorCmd = (char*)calloc(MAX_COMMAND_LEN, sizeof(char));
   _cmLen = 0;
+  _cmCap = MAX_COMMAND_LEN;
   _rKey = "coor_request";
 }
 
@@ -34,19 +35,31 @@ CoorCommand::CoorCommand(char* reqStr) {
     case 9: resolveType9(); break;
     case 11: resolveType11(); break;
     case 12: resolveType12(); break;
+    case 13: resolveType13(); break;
+    case 14: resolveType14(); break;
+    case 15: resolveType15(); break;
     default: break;
   }
   _coorCmd = nullptr;
   _cmLen = 0;
 }
 
+void CoorCommand::reserve(int len) {
+  // a batch of many stripes (type 15) outgrows MAX_COMMAND_LEN, receivers take the length from redis
+  if (_cmLen + len <= _cmCap) return;
+  while (_cmLen + len > _cmCap) _cmCap *= 2;
+  _coorCmd = (char*)realloc(_coorCmd, _cmCap);
+}
+
 void CoorCommand::writeInt(int value) {
+  reserve(4);
   int tmpv = htonl(value);
   memcpy(_coorCmd + _cmLen, (char*)&tmpv, 4); _cmLen += 4;
 }
 
 void CoorCommand::writeString(string s) {
   int slen = s.length();
+  reserve(4 + slen);
   int tmpslen = htonl(slen);
   // string length
   memcpy(_coorCmd + _cmLen, (char*)&tmpslen, 4); _cmLen += 4;
@@ -54,6 +67,12 @@ void CoorCommand::writeString(string s) {
   memcpy(_coorCmd + _cmLen, s.c_str(), slen); _cmLen += slen;
 }
 
+void CoorCommand::writeLong(long value) {
+  // high 32 bits first, both halves in network order
+  writeInt((int)((unsigned long)value >> 32));
+  writeInt((int)(value & 0xffffffff));
+}
+
 int CoorCommand::readInt() {
   int tmpint;
   memcpy((char*)&tmpint, _coorCmd + _cmLen, 4); _cmLen += 4;
@@ -76,6 +95,12 @@ string CoorCommand::readString() {
   return toret;
 }
 
+long CoorCommand::readLong() {
+  unsigned long high = (unsigned int)readInt();
+  unsigned long low = (unsigned int)readInt();
+  return (long)((high << 32) | low);
+}
+
 int CoorCommand::getType() {
   return _type;
 }
@@ -128,6 +153,30 @@ string CoorCommand::getBenchName() {
   return _benchname;
 }
 
+string CoorCommand::getBenchOp() {
+  return _benchop;
+}
+
+string CoorCommand::getBenchTarget() {
+  return _benchtarget;
+}
+
+long CoorCommand::getFilesizeB() {
+  return _filesizeB;
+}
+
+vector<string> CoorCommand::getStripeNames() {
+  return _stripenames;
+}
+
+string CoorCommand::getTraceId() {
+  return _traceId;
+}
+
+void CoorCommand::setRkey(string key) {
+  _rKey = key;
+}
+
 void CoorCommand::sendTo(unsigned int ip) {
   redisContext* sendCtx = RedisUtil::createContext(ip);
   redisReply* rReply = (redisReply*)redisCommand(sendCtx, "RPUSH %s %b", _rKey.c_str(), _coorCmd, _cmLen);
@@ -215,22 +264,25 @@ void CoorCommand::resolveType3() {
   _filename = readString();
 }
 
-void CoorCommand::buildType4(int type, unsigned int ip, string poolname, string stripename) {
+void CoorCommand::buildType4(int type, unsigned int ip, string poolname, string stripename, string traceid) {
   _type = type;
   _clientIp = ip;
   _ecpoolid = poolname;
   _stripename = stripename;
+  _traceId = traceid;
 
   writeInt(_type);
   writeInt(_clientIp);
   writeString(_ecpoolid);
   writeString(_stripename);
+  writeString(_traceId);
 }
 
 void CoorCommand::resolveType4() {
   _clientIp = readInt();
   _ecpoolid = readString();
   _stripename = readString();
+  _traceId = readString();
 }
 
 void CoorCommand::buildType5(int type, unsigned int ip, string objname) {
@@ -248,6 +300,16 @@ void CoorCommand::resolveType5() {
   _filename = readString();
 }
 
+void CoorCommand::buildType6(int type, unsigned int ip, string filename) {
+  _type = type;
+  _clientIp = ip;
+  _filename = filename;
+
+  writeInt(_type);
+  writeInt(_clientIp);
+  writeString(_filename);
+}
+
 void CoorCommand::resolveType6() {
   _clientIp = readInt();
   _filename = readString(); 
@@ -268,19 +330,22 @@ void CoorCommand::resolveType7() {
   _ectype = readString();
 }
 
-void CoorCommand::buildType8(int type, unsigned int ip, string objname) {
+void CoorCommand::buildType8(int type, unsigned int ip, string objname, string traceid) {
   _type = type;
   _clientIp = ip;
   _filename = objname;
+  _traceId = traceid;
 
   writeInt(_type);
   writeInt(_clientIp);
   writeString(_filename);
+  writeString(_traceId);
 }
 
 void CoorCommand::resolveType8() {
   _clientIp = readInt();
   _filename = readString();
+  _traceId = readString();
 }
 
 void CoorCommand::buildType9(int type,
@@ -315,44 +380,139 @@ void CoorCommand::resolveType11() {
 
 void CoorCommand::buildType12(int type,
                               unsigned int ip,
-                              string benchname) {
+                              string benchname,
+                              string op,
+                              string target) {
   _type = type;
   _clientIp = ip;
   _benchname = benchname;
+  _benchop = op;
+  _benchtarget = target;
 
   writeInt(_type);
   writeInt(_clientIp);
   writeString(_benchname);
+  writeString(_benchop);
+  writeString(_benchtarget);
 }
 
 void CoorCommand::resolveType12() {
   _clientIp = readInt();
   _benchname = readString();
+  _benchop = readString();
+  _benchtarget = readString();
+}
+
+void CoorCommand::buildType13(int type,
+                              unsigned int ip,
+                              string filename,
+                              long filesizeB) {
+  _type = type;
+  _clientIp = ip;
+  _filename = filename;
+  _filesizeB = filesizeB;
+
+  writeInt(_type);
+  writeInt(_clientIp);
+  writeString(_filename);
+  writeLong(_filesizeB);
+}
+
+void CoorCommand::resolveType13() {
+  _clientIp = readInt();
+  _filename = readString();
+  _filesizeB = readLong();
+}
+
+void CoorCommand::buildType14(int type,
+                              unsigned int ip,
+                              string objname,
+                              string traceid) {
+  _type = type;
+  _clientIp = ip;
+  _filename = objname;
+  _traceId = traceid;
+  _rKey = "coor_finish";
+
+  writeInt(_type);
+  writeInt(_clientIp);
+  writeString(_filename);
+  writeString(_traceId);
+}
+
+void CoorCommand::resolveType14() {
+  _clientIp = readInt();
+  _filename = readString();
+  _traceId = readString();
+}
+
+void CoorCommand::buildType15(int type,
+                              unsigned int ip,
+                              string poolname,
+                              vector<string> stripenames,
+                              string traceid) {
+  _type = type;
+  _clientIp = ip;
+  _ecpoolid = poolname;
+  _stripenames = stripenames;
+  _traceId = traceid;
+
+  writeInt(_type);
+  writeInt(_clientIp);
+  writeString(_ecpoolid);
+  writeInt(_stripenames.size());
+  for (auto stripename: _stripenames) writeString(stripename);
+  writeString(_traceId);
+}
+
+void CoorCommand::resolveType15() {
+  _clientIp = readInt();
+  _ecpoolid = readString();
+  int num = readInt();
+  for (int i=0; i<num; i++) _stripenames.push_back(readString());
+  _traceId = readString();
 }
 
 void CoorCommand::dump() {
-  cout << "CoorCommand::type: " << _type;
+  if (!LOG_ENABLED(LOG_LEVEL_DEBUG)) return;
   if (_type == 0) {
-    cout << ", client: " << RedisUtil::ip2Str(_clientIp)
+    LOG_DEBUG << "CoorCommand::type: " << _type << ", client: " << RedisUtil::ip2Str(_clientIp)
          << ", filename: " << _filename << ", ecid: " << _ecid << ", mode: " << _mode 
-         << ", filesizeMB: " << _filesizeMB << endl;
+         << ", filesizeMB: " << _filesizeMB;
   } else if (_type == 1) {
-    cout << ", client: " << RedisUtil::ip2Str(_clientIp)
-         << ", filename: " << _filename << ", numOfReplicas: " << _numOfReplicas << endl;
+    LOG_DEBUG << "CoorCommand::type: " << _type << ", client: " << RedisUtil::ip2Str(_clientIp)
+         << ", filename: " << _filename << ", numOfReplicas: " << _numOfReplicas;
   } else if (_type == 2) {
-    cout << ", client: " << RedisUtil::ip2Str(_clientIp)
-         << ", filename: " << _filename << endl;
+    LOG_DEBUG << "CoorCommand::type: " << _type << ", client: " << RedisUtil::ip2Str(_clientIp)
+         << ", filename: " << _filename;
   } else if (_type == 3) {
-    cout << ", client: " << RedisUtil::ip2Str(_clientIp)
-         << ", filename: " << _filename << endl;
+    LOG_DEBUG << "CoorCommand::type: " << _type << ", client: " << RedisUtil::ip2Str(_clientIp)
+         << ", filename: " << _filename;
   } else if (_type == 4) {
-    cout << ", client: " << RedisUtil::ip2Str(_clientIp)
+    LOG_DEBUG << "CoorCommand::type: " << _type << ", client: " << RedisUtil::ip2Str(_clientIp)
          << ", ecpoolid: " << _ecpoolid
-         << ", stripename: " << _stripename << endl;
+         << ", stripename: " << _stripename << ", trace: " << _traceId;
   } else if (_type == 6) {
-    cout << ", client: " << RedisUtil::ip2Str(_clientIp)
-         << ", filename: " << _filename << endl;
+    LOG_DEBUG << "CoorCommand::type: " << _type << ", client: " << RedisUtil::ip2Str(_clientIp)
+         << ", filename: " << _filename;
   } else if (_type == 7) {
-    cout << ", enable: " << _op << ", ectype: " << _ectype << endl;
+    LOG_DEBUG << "CoorCommand::type: " << _type << ", enable: " << _op << ", ectype: " << _ectype;
+  } else if (_type == 8) {
+    LOG_DEBUG << "CoorCommand::type: " << _type << ", client: " << RedisUtil::ip2Str(_clientIp)
+         << ", lostobj: " << _filename << ", trace: " << _traceId;
+  } else if (_type == 12) {
+    LOG_DEBUG << "CoorCommand::type: " << _type << ", client: " << RedisUtil::ip2Str(_clientIp)
+         << ", benchname: " << _benchname << ", op: " << _benchop << ", target: " << _benchtarget;
+  } else if (_type == 13) {
+    LOG_DEBUG << "CoorCommand::type: " << _type << ", client: " << RedisUtil::ip2Str(_clientIp)
+         << ", filename: " << _filename << ", filesizeB: " << _filesizeB;
+  } else if (_type == 14) {
+    LOG_DEBUG << "CoorCommand::type: " << _type << ", client: " << RedisUtil::ip2Str(_clientIp)
+         << ", objname: " << _filename << ", trace: " << _traceId;
+  } else if (_type == 15) {
+    LOG_DEBUG << "CoorCommand::type: " << _type << ", client: " << RedisUtil::ip2Str(_clientIp)
+         << ", ecpoolid: " << _ecpoolid << ", stripes: " << logList(_stripenames) << ", trace: " << _traceId;
+  } else {
+    LOG_DEBUG << "CoorCommand::type: " << _type;
   }
 }
@@ -13,16 +13,23 @@ using namespace std;
  *   type = 1: clientip | objname |
  *   type = 2: clientip | filename |
  *   type = 3: clientip | filename | get redundancyType, filesize, ecid|
- *   type = 4: clientip | poolname | stripename |
+ *   type = 4: clientip | poolname | stripename | traceid |
  *   type = 5: clientip | objname // offline degraded for object
  *   type = 5: clientip | filename | poolname | stripename |
  *   type = 6: clientip | filename |   // report lost
  *   type = 7:  0 (disable)/ 1 (enable) | encode/repair
- *   type = 8: clientip | lostobjname |  // stripestore send repair request to coordinator
+ *   type = 8: clientip | lostobjname | traceid |  // stripestore send repair request to coordinator
  *   type = 9: clientip | filename | corrupnum | idx1-idx2..| // 
  *  ? type = 10: clientip| filename |  // update lostmap in stripestore
  *   type = 11: clientip| filename |   // report successfully repair
- *   type = 12: clientip | benchname | 
+ *   type = 12: clientip | benchname | op | target |  // coordinator benchmark, target is an ecid or a filename
+ *   type = 13: clientip | filename | filesizeB |  // finalize with the exact file length
+ *   type = 15: clientip | poolname | num | num * stripename | traceid |  // encode several stripes of a pool
+ *
+ * coor_finish: type
+ *   type = 14: clientip | objname | traceid |  // agent finished persisting objname
+ *
+ * traceid is empty if the job is not traced
  */
 
 
@@ -30,6 +37,7 @@ class CoorCommand {
   private:
     char* _coorCmd;
     int _cmLen;
+    int _cmCap;
     string _rKey;
     int _type;
     unsigned int _clientIp;
@@ -64,6 +72,19 @@ class CoorCommand {
 
     // type12
     string _benchname;
+    string _benchop;
+    string _benchtarget;
+
+    // type13
+    // _filename
+    long _filesizeB;
+
+    // type15
+    // _ecpoolid
+    vector<string> _stripenames;
+
+    // type 4, 8, 14, 15
+    string _traceId;
 
   public:
     CoorCommand();
@@ -71,11 +92,14 @@ class CoorCommand {
     CoorCommand(char* reqStr);
 
     // basic construction methods
+    void reserve(int len);
     void writeInt(int value);
     void writeString(string s);
+    void writeLong(long value);
     int readInt();
     int readRawInt();
     string readString();
+    long readLong();
 
     int getType();
     unsigned int getClientip();
@@ -90,8 +114,14 @@ class CoorCommand {
     string getECType();
     vector<int> getCorruptIdx();
     string getBenchName();
+    string getBenchOp();
+    string getBenchTarget();
+    long getFilesizeB();
+    vector<string> getStripeNames();
+    string getTraceId();
 
     // send method
+    void setRkey(string key);
     void sendTo(unsigned int ip);
     void sendTo(redisContext* sendCtx);
 
@@ -111,23 +141,43 @@ class CoorCommand {
     void buildType4(int type,
                     unsigned int ip,
                     string poolname,
-                    string stripename);
+                    string stripename,
+                    string traceid);
     void buildType5(int type,
                     unsigned int ip,
                     string objname);
+    void buildType6(int type,
+                    unsigned int ip,
+                    string filename);
     void buildType7(int type,
                     int op,
                     string ectype);
     void buildType8(int type,
                     unsigned int ip,
-                    string objname);
+                    string objname,
+                    string traceid);
     void buildType9(int type, 
                     unsigned int ip,
                     string filename,
                     vector<int> corruptIdx);
     void buildType12(int type,
                      unsigned int ip,
-                     string benchname);
+                     string benchname,
+                     string op,
+                     string target);
+    void buildType13(int type,
+                     unsigned int ip,
+                     string filename,
+                     long filesizeB);
+    void buildType14(int type,
+                     unsigned int ip,
+                     string objname,
+                     string traceid);
+    void buildType15(int type,
+                     unsigned int ip,
+                     string poolname,
+                     vector<string> stripenames,
+                     string traceid);
     // resolve CoorCommand
     void resolveType0();
     void resolveType1();
@@ -141,6 +191,9 @@ class CoorCommand {
     void resolveType9();
     void resolveType11();
     void resolveType12();
+    void resolveType13();
+    void resolveType14();
+    void resolveType15();
 
     // for debug
     void dump();
@@ -0,0 +1,212 @@
+#include "Logger.hh"
+
+#include <csignal>
+#include <sys/time.h>
+
+typedef struct {
+  long us;
+  int level;
+  int tid;
+  string text;
+} LogEntry;
+
+// single-producer single-consumer ring of a thread, the consumer holds the drain lock
+typedef struct {
+  LogEntry* slots[LOG_RING_SIZE];
+  atomic<unsigned int> head;
+  atomic<unsigned int> tail;
+  // set when the thread exits, the ring is freed once it is drained
+  atomic<bool> closed;
+  int tid;
+} LogRing;
+
+// shared state of the writer, never freed so that threads logging during exit find it alive
+typedef struct {
+  mutex ringLock;
+  vector<LogRing*> rings;
+  int nextTid;
+  mutex drainLock;
+  FILE* out;
+} LogState;
+
+static LogState* logState() {
+  static LogState* state = NULL;
+  static once_flag once;
+  call_once(once, []{
+    state = new LogState();
+    state->nextTid = 0;
+    state->out = stdout;
+    atexit([]{ Logger::flush(); });
+    // the writer drains the rings of all threads
+    thread([]{
+      while (true) {
+        this_thread::sleep_for(chrono::milliseconds(LOG_FLUSH_MS));
+        Logger::flush();
+      }
+    }).detach();
+  });
+  return state;
+}
+
+class LogRingHolder {
+  public:
+    LogRing* ring = NULL;
+    ~LogRingHolder() {
+      if (ring) ring->closed.store(true, memory_order_release);
+    }
+};
+
+static thread_local LogRingHolder localHolder;
+
+static LogRing* localRing() {
+  if (localHolder.ring) return localHolder.ring;
+  LogState* state = logState();
+  LogRing* ring = new LogRing();
+  ring->head.store(0);
+  ring->tail.store(0);
+  ring->closed.store(false);
+  state->ringLock.lock();
+  ring->tid = state->nextTid++;
+  state->rings.push_back(ring);
+  state->ringLock.unlock();
+  localHolder.ring = ring;
+  return ring;
+}
+
+static const char* levelName(int level) {
+  switch (level) {
+    case LOG_LEVEL_DEBUG: return "DEBUG";
+    case LOG_LEVEL_INFO: return "INFO";
+    case LOG_LEVEL_WARN: return "WARN";
+    default: return "ERROR";
+  }
+}
+
+atomic<int> Logger::_level(LOG_LEVEL_INFO);
+
+int Logger::getLevel() {
+  return _level.load(memory_order_relaxed);
+}
+
+void Logger::setLevel(int level) {
+  if (level < LOG_LEVEL_DEBUG) level = LOG_LEVEL_DEBUG;
+  if (level > LOG_LEVEL_OFF) level = LOG_LEVEL_OFF;
+  _level.store(level, memory_order_relaxed);
+}
+
+int Logger::parseLevel(string name) {
+  if (name == "debug") return LOG_LEVEL_DEBUG;
+  if (name == "info") return LOG_LEVEL_INFO;
+  if (name == "warn") return LOG_LEVEL_WARN;
+  if (name == "error") return LOG_LEVEL_ERROR;
+  if (name == "off") return LOG_LEVEL_OFF;
+  return -1;
+}
+
+void Logger::setFile(string filename) {
+  LogState* state = logState();
+  FILE* out = stdout;
+  if (filename != "-" && filename != "") {
+    out = fopen(filename.c_str(), "a");
+    if (out == NULL) {
+      fprintf(stderr, "Logger::setFile.fail to open %s, log to stdout\n", filename.c_str());
+      out = stdout;
+    }
+  }
+  drain();
+  lock_guard<mutex> lck(state->drainLock);
+  if (state->out != stdout) fclose(state->out);
+  state->out = out;
+}
+
+void Logger::append(int level, string text) {
+  LogEntry* entry = new LogEntry();
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  entry->us = (long)tv.tv_sec * 1000000 + tv.tv_usec;
+  entry->level = level;
+  entry->text = text;
+
+  LogRing* ring = localRing();
+  entry->tid = ring->tid;
+  unsigned int head = ring->head.load(memory_order_relaxed);
+  // full: wait for the writer instead of dropping the line
+  while (head - ring->tail.load(memory_order_acquire) >= LOG_RING_SIZE) this_thread::yield();
+  ring->slots[head % LOG_RING_SIZE] = entry;
+  ring->head.store(head + 1, memory_order_release);
+
+  if (level >= LOG_LEVEL_ERROR) drain();
+}
+
+void Logger::flush() {
+  drain();
+}
+
+void Logger::drain() {
+  LogState* state = logState();
+  lock_guard<mutex> lck(state->drainLock);
+  vector<LogRing*> rings;
+  state->ringLock.lock();
+  rings = state->rings;
+  state->ringLock.unlock();
+
+  vector<LogEntry*> entries;
+  vector<LogRing*> finished;
+  for (auto ring: rings) {
+    // closed is read before head, a closed ring gets no more lines after its last head
+    bool closed = ring->closed.load(memory_order_acquire);
+    unsigned int tail = ring->tail.load(memory_order_relaxed);
+    unsigned int head = ring->head.load(memory_order_acquire);
+    for (; tail != head; tail++) entries.push_back(ring->slots[tail % LOG_RING_SIZE]);
+    ring->tail.store(tail, memory_order_release);
+    if (closed) finished.push_back(ring);
+  }
+  if (finished.size() > 0) {
+    state->ringLock.lock();
+    for (auto ring: finished) {
+      state->rings.erase(find(state->rings.begin(), state->rings.end(), ring));
+      delete ring;
+    }
+    state->ringLock.unlock();
+  }
+  if (entries.empty()) return;
+
+  // lines of a thread are in order already, merge the threads by time
+  stable_sort(entries.begin(), entries.end(), [](LogEntry* a, LogEntry* b) { return a->us < b->us; });
+  for (auto entry: entries) {
+    time_t sec = entry->us / 1000000;
+    struct tm tm;
+    localtime_r(&sec, &tm);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm);
+    int len = entry->text.size();
+    while (len > 0 && entry->text[len-1] == '\n') len--;
+    fprintf(state->out, "%s.%06ld %-5s [%d] %.*s\n", stamp, entry->us % 1000000, levelName(entry->level),
+            entry->tid, len, entry->text.c_str());
+    delete entry;
+  }
+  fflush(state->out);
+}
+
+void Logger::init(string level, string filename) {
+  int parsed = parseLevel(level);
+  if (parsed < 0) {
+    LOG_WARN << "Logger::init.unknown level " << level << ", use info";
+    parsed = LOG_LEVEL_INFO;
+  }
+  setLevel(parsed);
+  setFile(filename);
+  signal(SIGUSR1, [](int) { setLevel(getLevel() - 1); });
+  signal(SIGUSR2, [](int) { setLevel(getLevel() + 1); });
+}
+
+LogLine::LogLine(int level) : _level(level) {
+}
+
+LogLine::~LogLine() {
+  Logger::append(_level, _stream.str());
+}
+
+ostream& LogLine::stream() {
+  return _stream;
+}
@@ -0,0 +1,94 @@
+#ifndef _LOGGER_HH_
+#define _LOGGER_HH_
+
+#include "../inc/include.hh"
+
+#include <atomic>
+#include <sstream>
+
+using namespace std;
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_OFF 4
+
+// levels below the compile level are eliminated, e.g. -DLOG_COMPILE_LEVEL=LOG_LEVEL_INFO
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+// LOG_INFO << "Class::method.info = " << value;
+// the operands are not evaluated when the level is disabled. The statement is a single
+// expression (& binds looser than <<), so an unbraced "if (x) LOG_*" cannot capture an else
+#define LOG_AT(level) \
+  !LOG_ENABLED(level) ? (void)0 : LogVoidify() & LogLine(level).stream()
+
+#define LOG_DEBUG LOG_AT(LOG_LEVEL_DEBUG)
+#define LOG_INFO LOG_AT(LOG_LEVEL_INFO)
+#define LOG_WARN LOG_AT(LOG_LEVEL_WARN)
+#define LOG_ERROR LOG_AT(LOG_LEVEL_ERROR)
+
+// guards a block that builds a line piece by piece
+#define LOG_ENABLED(level) ((level) >= LOG_COMPILE_LEVEL && Logger::enabled(level))
+
+// size of the buffer of a thread in lines, a thread waits for the writer when it is full
+#define LOG_RING_SIZE 1024
+// the writer drains the buffers at this interval
+#define LOG_FLUSH_MS 5
+
+/*
+ * Asynchronous leveled logger
+ *
+ * Each thread appends its lines to its own single-producer ring, so logging threads never
+ * contend with each other. A writer thread drains the rings, orders the lines by time and
+ * writes them to stdout or the log file. Error lines and process exit flush synchronously.
+ */
+class Logger {
+  private:
+    static atomic<int> _level;
+    static void drain();
+  public:
+    // checked on every log statement, kept inline
+    static bool enabled(int level) { return level >= _level.load(memory_order_relaxed); }
+    static int getLevel();
+    static void setLevel(int level);
+    // debug/info/warn/error/off, -1 if unknown
+    static int parseLevel(string name);
+    // - for stdout
+    static void setFile(string filename);
+    static void append(int level, string text);
+    static void flush();
+    // level and file of the configuration, SIGUSR1/SIGUSR2 make the log more/less verbose at runtime
+    static void init(string level, string filename);
+};
+
+// items separated by spaces, e.g. LOG_DEBUG << "toposeq: " << logList(toposeq);
+template <class T>
+string logList(const vector<T>& items) {
+  ostringstream toret;
+  for (int i=0; i<items.size(); i++) {
+    if (i) toret << " ";
+    toret << items[i];
+  }
+  return toret.str();
+}
+
+// turns the stream of a log statement into void for the ?: of LOG_AT
+class LogVoidify {
+  public:
+    void operator&(ostream&) {}
+};
+
+class LogLine {
+  private:
+    int _level;
+    ostringstream _stream;
+  public:
+    LogLine(int level);
+    ~LogLine();
+    ostream& stream();
+};
+
+#endif
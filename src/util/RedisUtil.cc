@@ -17,10 +17,10 @@ redisContext* RedisUtil::createContext(string ip, int port) {
   redisContext* retVal = redisConnect(ip.c_str(), port);
   if (retVal == NULL || retVal -> err) {
     if (retVal) {
-      cerr << "Error: " << retVal -> errstr << endl;
+      LOG_ERROR << "Error: " << retVal -> errstr;
       redisFree(retVal);
     } else {
-      cerr << "redis context creation error" << endl;
+      LOG_ERROR << "redis context creation error";
     }
     throw REDIS_CREATION_FAILURE;
   }